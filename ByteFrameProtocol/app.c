@@ -0,0 +1,128 @@
+/*
+ * Small program to test ByteFrame on a PC: sends a sample message, feeds the
+ * bytes to the receiver and shows what was received. Then measures how many
+ * frames per second each send path produces.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "proto.h"
+
+#define BENCH_BYTES (64L * 1024 * 1024)    /* Payload bytes sent per benchmark run */
+
+/* The "wire": whatever tx() sends ends up here */
+static uint8_t wire[MAX_FRAME_LEN(4096 + FRAME_CRC_LEN)];
+static int wire_len;
+
+static void tx(uint8_t byte) {
+    wire[wire_len++] = byte;
+}
+
+static void tx_write(const uint8_t *buf, int len) {
+    memcpy(wire + wire_len, buf, (size_t)len);
+    wire_len += len;
+}
+
+static void print_bytes(const char *label, const uint8_t *data, int len) {
+    int i;
+
+    printf("%-9s (%2d bytes):", label, len);
+    for(i = 0; i < len; i++) {
+        printf(" %02X", data[i]);
+    }
+    printf("\n");
+}
+
+static void on_packet(const uint8_t *data, int len) {
+    print_bytes("Received", data, len);
+}
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Sends frames of 'len' random bytes with both paths and prints frames/s */
+static void bench(int len) {
+    static uint8_t data[4096];
+    long frames = BENCH_BYTES / len, n;
+    double t, per_byte, bulk, bulk_crc;
+    int i;
+
+    srand(1);
+    for(i = 0; i < len; i++) {
+        data[i] = (uint8_t)rand();
+    }
+
+    t = now_sec();
+    for(n = 0; n < frames; n++) {
+        wire_len = 0;
+        send_packet(data, len, tx);
+    }
+    per_byte = frames / (now_sec() - t);
+
+    t = now_sec();
+    for(n = 0; n < frames; n++) {
+        wire_len = 0;
+        send_packet_bulk(data, len, tx_write);
+    }
+    bulk = frames / (now_sec() - t);
+
+    t = now_sec();
+    for(n = 0; n < frames; n++) {
+        wire_len = 0;
+        send_packet_bulk_crc(data, len, tx_write);
+    }
+    bulk_crc = frames / (now_sec() - t);
+
+    printf("%4d byte frames: send_packet %10.0f frames/s, send_packet_bulk %10.0f frames/s (x%.1f), "
+           "with CRC %10.0f frames/s\n", len, per_byte, bulk, bulk / per_byte, bulk_crc);
+}
+
+int main(void) {
+    const uint8_t msg[] = { 0x01, 0xC0, 0x02, 0xDB, 0x03 };
+    uint8_t rx_buf[256];
+    receiver rx;
+    int i;
+
+    print_bytes("Sent", msg, sizeof(msg));
+
+    wire_len = 0;
+    send_packet(msg, sizeof(msg), tx);
+    print_bytes("On wire", wire, wire_len);
+
+    receiver_init(&rx, rx_buf, sizeof(rx_buf), on_packet);
+    for(i = 0; i < wire_len; i++) {
+        receive_byte(&rx, wire[i]);
+    }
+
+    /* The bulk path must put the same bytes on the wire */
+    wire_len = 0;
+    send_packet_bulk(msg, sizeof(msg), tx_write);
+    print_bytes("Bulk", wire, wire_len);
+
+    /* With the CRC trailer a corrupted frame is dropped instead of delivered */
+    wire_len = 0;
+    send_packet_crc(msg, sizeof(msg), tx);
+    print_bytes("With CRC", wire, wire_len);
+    receiver_init(&rx, rx_buf, sizeof(rx_buf), on_packet);
+    receiver_enable_crc(&rx);
+    for(i = 0; i < wire_len; i++) {
+        receive_byte(&rx, wire[i]);
+    }
+    wire[2] ^= 0x10;
+    for(i = 0; i < wire_len; i++) {
+        receive_byte(&rx, wire[i]);
+    }
+    printf("CRC: %u frames, %u dropped\n", (unsigned)rx.frames, (unsigned)(rx.crc_errors + rx.decode_errors));
+
+    bench(16);
+    bench(64);
+    bench(256);
+    bench(1500);
+    bench(4096);
+    return 0;
+}
@@ -0,0 +1,60 @@
+#include <string.h>
+#include "cobs.h"
+#include "scan.h"
+
+int cobs_encode(uint8_t *buf, int len, int cap) {
+    const uint8_t *src;
+    uint8_t *out = buf;
+    int i = 0;
+
+    if((len < 0) || (cap < COBS_MAX_LEN(len))) {
+        return -1;
+    }
+
+    /*
+     * Move the data to the end of the buffer and encode it forward into the
+     * start: the output never overtakes the input because it only grows by
+     * the code bytes, which the spare room at the end was sized for.
+     */
+    src = buf + cap - len;
+    memmove(buf + cap - len, buf, (size_t)len);
+
+    for(;;) {
+        int limit = (len - i < COBS_BLOCK) ? len - i : COBS_BLOCK;
+        int run = (int)scan_find2(src + i, (size_t)limit, 0x00, 0x00);
+
+        *out++ = (uint8_t)(run + 1);
+        memmove(out, src + i, (size_t)run);
+        out += run;
+        i += run;
+
+        if(run == COBS_BLOCK) {
+            continue;   /* Full block, no zero consumed */
+        }
+        if(i == len) {
+            break;      /* Ended at the implicit trailing zero */
+        }
+        i++;            /* Skip the zero ending this block */
+    }
+    return (int)(out - buf);
+}
+
+int cobs_decode(uint8_t *buf, int len) {
+    uint8_t *out = buf;
+    int i = 0;
+
+    while(i < len) {
+        int code = buf[i++];
+
+        if((code == 0) || (code - 1 > len - i)) {
+            return -1;
+        }
+        memmove(out, buf + i, (size_t)(code - 1));
+        out += code - 1;
+        i += code - 1;
+        if((code != 0xFF) && (i < len)) {
+            *out++ = 0x00;
+        }
+    }
+    return (int)(out - buf);
+}
@@ -0,0 +1,34 @@
+#ifndef COBS_H
+#define COBS_H
+
+#include <stdint.h>
+
+/*
+ * Consistent Overhead Byte Stuffing: removes every 0x00 from the data so 0x00
+ * can delimit frames. The data is cut into blocks that end at a 0x00 (or
+ * after 254 non-zero bytes); each block is sent as a code byte (block length
+ * + 1, 0xFF for a full block without a zero) followed by its non-zero bytes.
+ *
+ * Overhead is at most 1 byte per 254, whatever the data: compare with SLIP
+ * escaping, which doubles a frame made only of special bytes.
+ */
+
+#define COBS_BLOCK          254
+
+/* Worst case encoded size of 'len' bytes */
+#define COBS_MAX_LEN(len)   ((len) + (len) / COBS_BLOCK + 1)
+
+/*
+ * Encodes the 'len' bytes at the start of 'buf' in place. 'cap' is the size
+ * of 'buf' and should be COBS_MAX_LEN(len).
+ * Returns the encoded length, or -1 if it does not fit.
+ */
+int cobs_encode(uint8_t *buf, int len, int cap);
+
+/*
+ * Decodes 'len' encoded bytes (without the 0x00 delimiter) in place.
+ * Returns the decoded length, or -1 if the data is not valid COBS.
+ */
+int cobs_decode(uint8_t *buf, int len);
+
+#endif
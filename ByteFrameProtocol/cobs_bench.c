@@ -0,0 +1,124 @@
+/*
+ * Compares SLIP escaping (the default ByteFrame mode) with COBS: bytes on the
+ * wire and throughput for 1 KB frames of different data, both through the
+ * streaming API the protocol uses: send_packet_bulk() to send,
+ * receive_byte() for every byte received. The COBS mode of proto.c is built
+ * a second time under other names (see the Makefile), so both run in one
+ * program.
+ * Build: make cobs_bench
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "proto.h"
+#include "cobs.h"
+
+#define FRAME_LEN   1024
+#define ROUNDS      50000
+
+/* proto.c built with -DBYTEFRAME_COBS (proto_cobs.o); the receiver has the same layout in both modes */
+void cobs_send_packet_bulk(const uint8_t *data, int len, void (*write)(const uint8_t *buf, int len));
+void cobs_receiver_init(receiver *rx, uint8_t *buf, int size, packet_handler on_packet);
+void cobs_receive_byte(receiver *rx, uint8_t byte);
+
+typedef struct {
+    const char *name;
+    void (*send)(const uint8_t *data, int len, void (*write)(const uint8_t *buf, int len));
+    void (*init)(receiver *rx, uint8_t *buf, int size, packet_handler on_packet);
+    void (*receive)(receiver *rx, uint8_t byte);
+} framing;
+
+static const framing framings[2] = {
+    { "SLIP", send_packet_bulk, receiver_init, receive_byte },
+    { "COBS", cobs_send_packet_bulk, cobs_receiver_init, cobs_receive_byte },
+};
+
+static uint8_t wire[MAX_FRAME_LEN(FRAME_LEN)];
+static int wire_len;
+static const uint8_t *expected;
+static uint32_t rx_good;
+
+static void wire_write(const uint8_t *buf, int len) {
+    memcpy(wire + wire_len, buf, (size_t)len);
+    wire_len += len;
+}
+
+static void on_packet(const uint8_t *data, int len) {
+    rx_good += (len == FRAME_LEN && memcmp(data, expected, FRAME_LEN) == 0);
+}
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Sends and receives ROUNDS frames; returns the frame size on the wire without delimiters, -1 on a mismatch */
+static int run(const framing *f, const uint8_t *data, double *send_mbs, double *recv_mbs) {
+    static uint8_t rx_buf[COBS_MAX_LEN(FRAME_LEN)];
+    receiver rx;
+    double t;
+    int i, r;
+
+    t = now_sec();
+    for(r = 0; r < ROUNDS; r++) {
+        wire_len = 0;
+        f->send(data, FRAME_LEN, wire_write);
+    }
+    *send_mbs = (double)FRAME_LEN * ROUNDS / (now_sec() - t) / 1e6;
+
+    f->init(&rx, rx_buf, sizeof(rx_buf), on_packet);
+    expected = data;
+    rx_good = 0;
+    t = now_sec();
+    for(r = 0; r < ROUNDS; r++) {
+        for(i = 0; i < wire_len; i++) {
+            f->receive(&rx, wire[i]);
+        }
+    }
+    *recv_mbs = (double)FRAME_LEN * ROUNDS / (now_sec() - t) / 1e6;
+    return (rx_good == ROUNDS) ? wire_len - 2 : -1;
+}
+
+static void bench(const char *name, const uint8_t *data) {
+    double send_mbs, recv_mbs;
+    int k, len;
+
+    printf("%-10s", name);
+    for(k = 0; k < 2; k++) {
+        len = run(&framings[k], data, &send_mbs, &recv_mbs);
+        if(len < 0) {
+            printf(" %s MISMATCH", framings[k].name);
+            continue;
+        }
+        printf(" %s %4d bytes (+%5.1f%%) send %5.0f MB/s receive %4.0f MB/s%s", framings[k].name, len,
+               100.0 * (len - FRAME_LEN) / FRAME_LEN, send_mbs, recv_mbs, (k == 0) ? " |" : "\n");
+    }
+}
+
+int main(void) {
+    static uint8_t data[FRAME_LEN];
+    int i;
+
+    printf("%d byte frames (sizes without delimiters)\n", FRAME_LEN);
+
+    srand(1);
+    for(i = 0; i < FRAME_LEN; i++) {
+        data[i] = (uint8_t)rand();
+    }
+    bench("random", data);
+
+    for(i = 0; i < FRAME_LEN; i++) {
+        data[i] = (uint8_t)('a' + i % 26);
+    }
+    bench("text", data);
+
+    memset(data, 0xC0, sizeof(data));   /* Worst case for SLIP */
+    bench("all 0xC0", data);
+
+    memset(data, 0x00, sizeof(data));
+    bench("all 0x00", data);
+    return 0;
+}
@@ -0,0 +1,224 @@
+/*
+ * Runs two reliable endpoints over a lossy, delayed link and checks that every
+ * message arrives once, in order and intact.
+ *
+ * The link is a socketpair (a byte stream, like a UART). Frames leaving each
+ * end first go through an impairment queue that drops some of them, corrupts
+ * a byte in others and holds each one for a random delay, so they can also
+ * arrive out of order. ByteFrame with its CRC trailer runs on top, the
+ * reliability layer on top of that.
+ *
+ * Build: make link_test
+ * Usage: ./link_test [loss %] [delay ms]
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#include "proto.h"
+#include "reliable.h"
+
+#define MESSAGES    500
+#define MSG_LEN     200
+#define QUEUE_LEN   128     /* Frames held by the impairment queue */
+#define WIRE_MAX    MAX_FRAME_LEN(RL_MAX_FRAME + FRAME_CRC_LEN)
+
+/* Frames waiting in the link */
+typedef struct {
+    uint32_t due_ms;
+    int len;                /* 0: free */
+    uint8_t bytes[WIRE_MAX];
+} held_frame;
+
+/* One side of the link */
+typedef struct {
+    const char *name;
+    int fd;
+    rl_endpoint ep;
+    receiver rx;
+    uint8_t rx_buf[RX_BUF_LEN(RL_MAX_FRAME + FRAME_CRC_LEN)];
+    held_frame queue[QUEUE_LEN];
+    /* Verification of the received stream */
+    uint32_t next_msg;
+    uint32_t bad;
+} side;
+
+static int loss_pct = 10;
+static int corrupt_pct = 2;
+static int delay_ms = 5;
+static uint32_t start_ms;
+
+/* ByteFrame callbacks take no context: the side being served */
+static side *current;
+static uint8_t wire[WIRE_MAX];
+static int wire_len;
+
+static uint32_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000) - start_ms;
+}
+
+static void wire_write(const uint8_t *buf, int len) {
+    memcpy(wire + wire_len, buf, (size_t)len);
+    wire_len += len;
+}
+
+/* rl_send_fn: frame the message and put it in the impairment queue */
+static void link_send(const uint8_t *frame, int len, void *ctx) {
+    side *s = ctx;
+    int i;
+
+    wire_len = 0;
+    send_packet_bulk_crc(frame, len, wire_write);
+
+    if(rand() % 100 < loss_pct) {
+        return;
+    }
+    if(rand() % 100 < corrupt_pct) {
+        wire[1 + rand() % (wire_len - 2)] ^= (uint8_t)(1 + rand() % 255);
+    }
+    for(i = 0; i < QUEUE_LEN; i++) {
+        if(s->queue[i].len == 0) {
+            s->queue[i].due_ms = now_ms() + (uint32_t)(delay_ms / 2 + rand() % (delay_ms + 1));
+            s->queue[i].len = wire_len;
+            memcpy(s->queue[i].bytes, wire, (size_t)wire_len);
+            return;
+        }
+    }
+    /* Queue full: the link drops it too */
+}
+
+/* Writes the frames whose delay has passed into the socket */
+static void link_flush(side *s) {
+    uint32_t now = now_ms();
+    int i;
+
+    for(i = 0; i < QUEUE_LEN; i++) {
+        if((s->queue[i].len != 0) && ((int32_t)(now - s->queue[i].due_ms) >= 0)) {
+            if(write(s->fd, s->queue[i].bytes, (size_t)s->queue[i].len) != s->queue[i].len) {
+                perror("write");
+                exit(1);
+            }
+            s->queue[i].len = 0;
+        }
+    }
+}
+
+/* rl_deliver_fn: message N is MSG_LEN bytes of (N + i) */
+static void on_message(const uint8_t *data, int len, void *ctx) {
+    side *s = ctx;
+    int i;
+
+    if(len != MSG_LEN) {
+        s->bad++;
+    }
+    for(i = 0; i < len; i++) {
+        if(data[i] != (uint8_t)(s->next_msg + (uint32_t)i)) {
+            s->bad++;
+            break;
+        }
+    }
+    s->next_msg++;
+}
+
+static void on_packet(const uint8_t *data, int len) {
+    reliable_receive(&current->ep, data, len);
+}
+
+/* Reads what arrived on the socket and feeds it through ByteFrame */
+static void link_receive(side *s) {
+    uint8_t buf[4096];
+    ssize_t n, i;
+
+    current = s;
+    while((n = read(s->fd, buf, sizeof(buf))) > 0) {
+        for(i = 0; i < n; i++) {
+            receive_byte(&s->rx, buf[i]);
+        }
+    }
+    if((n < 0) && (errno != EAGAIN)) {
+        perror("read");
+        exit(1);
+    }
+}
+
+static void side_init(side *s, const char *name, int fd, uint8_t window) {
+    memset(s, 0, sizeof(*s));
+    s->name = name;
+    s->fd = fd;
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+    receiver_init(&s->rx, s->rx_buf, sizeof(s->rx_buf), on_packet);
+    receiver_enable_crc(&s->rx);
+    reliable_init(&s->ep, window, (uint32_t)(4 * delay_ms + 10), link_send, on_message, s);
+}
+
+/* A sends MESSAGES messages to B; returns the elapsed time in ms */
+static uint32_t run(uint8_t window) {
+    static side a, b;
+    uint8_t msg[MSG_LEN];
+    uint32_t sent = 0, t0;
+    int fds[2], i;
+
+    if(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+        perror("socketpair");
+        exit(1);
+    }
+    side_init(&a, "A", fds[0], window);
+    side_init(&b, "B", fds[1], window);
+    srand(1);
+
+    t0 = now_ms();
+    while(b.next_msg < MESSAGES) {
+        while((sent < MESSAGES) && (reliable_window_free(&a.ep) > 0)) {
+            for(i = 0; i < MSG_LEN; i++) {
+                msg[i] = (uint8_t)(sent + (uint32_t)i);
+            }
+            reliable_send(&a.ep, msg, MSG_LEN, now_ms());
+            sent++;
+        }
+        link_flush(&a);
+        link_flush(&b);
+        link_receive(&a);
+        link_receive(&b);
+        reliable_poll(&a.ep, now_ms());
+        reliable_poll(&b.ep, now_ms());
+
+        struct timespec nap = { 0, 200000 };
+        nanosleep(&nap, NULL);
+    }
+    t0 = now_ms() - t0;
+
+    printf("window %2u: %u messages in %5u ms (%6.0f msg/s), %u bad, %u retransmits, "
+           "%u out of order, %u duplicates, %u CRC drops\n",
+           window, (unsigned)b.next_msg, (unsigned)t0, b.next_msg * 1000.0 / (t0 ? t0 : 1), (unsigned)b.bad,
+           (unsigned)a.ep.retransmits, (unsigned)b.ep.out_of_order, (unsigned)b.ep.duplicates,
+           (unsigned)(a.rx.crc_errors + b.rx.crc_errors));
+
+    close(fds[0]);
+    close(fds[1]);
+    return t0;
+}
+
+int main(int argc, char **argv) {
+    if(argc > 1) {
+        loss_pct = atoi(argv[1]);
+    }
+    if(argc > 2) {
+        delay_ms = atoi(argv[2]);
+    }
+    start_ms = 0;
+    start_ms = now_ms();
+
+    printf("link: %d%% loss, %d%% corrupted, %d..%d ms delay\n",
+           loss_pct, corrupt_pct, delay_ms / 2, delay_ms / 2 + delay_ms);
+    run(1);     /* Stop-and-wait */
+    run(8);
+    run(RL_MAX_WINDOW);
+    return 0;
+}
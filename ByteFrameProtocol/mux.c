@@ -0,0 +1,137 @@
+#include <string.h>
+#include "mux.h"
+
+void mux_init(mux *m, mux_send_fn send, void *ctx) {
+    memset(m, 0, sizeof(*m));
+    m->send = send;
+    m->ctx = ctx;
+}
+
+int mux_open(mux *m, uint8_t ch, mux_class cls, uint8_t param, mux_rx_fn on_rx) {
+    mux_channel *c;
+
+    if((ch >= MUX_MAX_CHANNELS) || ((cls != MUX_STRICT) && (cls != MUX_WRR)) ||
+       ((cls == MUX_WRR) && (param == 0))) {
+        return -1;
+    }
+    c = &m->ch[ch];
+    memset(c, 0, sizeof(*c));
+    c->cls = cls;
+    c->prio = (cls == MUX_STRICT) ? param : 0;
+    c->weight = (cls == MUX_WRR) ? param : 0;
+    c->on_rx = on_rx;
+    return 0;
+}
+
+int mux_enqueue(mux *m, uint8_t ch, const uint8_t *data, int len, uint32_t now_us) {
+    mux_channel *c;
+    mux_msg *msg;
+
+    if((ch >= MUX_MAX_CHANNELS) || (m->ch[ch].cls == MUX_CLOSED) || (len < 0) || (len > MUX_MAX_MSG)) {
+        return -1;
+    }
+    c = &m->ch[ch];
+    if(c->count == MUX_QUEUE_DEPTH) {
+        c->stats.drops++;
+        return -1;
+    }
+
+    msg = &c->queue[(c->head + c->count) % MUX_QUEUE_DEPTH];
+    msg->frame[0] = ch;
+    memcpy(msg->frame + 1, data, (size_t)len);
+    msg->len = (uint16_t)(len + 1);
+    msg->enq_us = now_us;
+    c->count++;
+    return 0;
+}
+
+/* Sends the head of 'c' and updates its counters */
+static int send_head(mux *m, mux_channel *c, uint32_t now_us) {
+    mux_msg *msg = &c->queue[c->head];
+    uint32_t waited = now_us - msg->enq_us;
+    int len = msg->len;
+
+    m->send(msg->frame, len, m->ctx);
+
+    c->stats.tx_frames++;
+    c->stats.tx_bytes += (uint32_t)len;
+    c->stats.sum_latency_us += waited;
+    if(waited > c->stats.max_latency_us) {
+        c->stats.max_latency_us = waited;
+    }
+    c->head = (uint8_t)((c->head + 1) % MUX_QUEUE_DEPTH);
+    c->count--;
+    return len;
+}
+
+int mux_send_next(mux *m, uint32_t now_us) {
+    mux_channel *best = NULL;
+    uint8_t i, wrr_pending = 0;
+
+    /* Strict priority first */
+    for(i = 0; i < MUX_MAX_CHANNELS; i++) {
+        mux_channel *c = &m->ch[i];
+        if((c->cls == MUX_STRICT) && (c->count > 0) && ((NULL == best) || (c->prio < best->prio))) {
+            best = c;
+        }
+        if((c->cls == MUX_WRR) && (c->count > 0)) {
+            wrr_pending = 1;
+        }
+    }
+    if(NULL != best) {
+        return send_head(m, best, now_us);
+    }
+    if(!wrr_pending) {
+        return 0;
+    }
+
+    /* Deficit round robin: each turn a channel earns weight * MUX_QUANTUM bytes */
+    for(;;) {
+        mux_channel *c = &m->ch[m->rr];
+
+        if((c->cls == MUX_WRR) && (c->count > 0)) {
+            if(!m->granted) {
+                c->deficit += (int32_t)c->weight * MUX_QUANTUM;
+                m->granted = 1;
+            }
+            if(c->deficit >= c->queue[c->head].len) {
+                c->deficit -= c->queue[c->head].len;
+                return send_head(m, c, now_us);
+            }
+        } else if(c->cls == MUX_WRR) {
+            c->deficit = 0;     /* Idle channels do not save up credit */
+        }
+        m->rr = (uint8_t)((m->rr + 1) % MUX_MAX_CHANNELS);
+        m->granted = 0;
+    }
+}
+
+void mux_receive(mux *m, const uint8_t *frame, int len) {
+    mux_channel *c;
+
+    if((len < 1) || (frame[0] >= MUX_MAX_CHANNELS)) {
+        return;
+    }
+    c = &m->ch[frame[0]];
+    if(c->cls == MUX_CLOSED) {
+        return;
+    }
+    c->stats.rx_frames++;
+    c->stats.rx_bytes += (uint32_t)len;
+    if(NULL != c->on_rx) {
+        c->on_rx(frame[0], frame + 1, len - 1, m->ctx);
+    }
+}
+
+int mux_pending(const mux *m) {
+    int i, n = 0;
+
+    for(i = 0; i < MUX_MAX_CHANNELS; i++) {
+        n += m->ch[i].count;
+    }
+    return n;
+}
+
+const mux_stats *mux_get_stats(const mux *m, uint8_t ch) {
+    return (ch < MUX_MAX_CHANNELS) ? &m->ch[ch].stats : NULL;
+}
@@ -0,0 +1,107 @@
+#ifndef MUX_H
+#define MUX_H
+
+#include <stdint.h>
+
+/*
+ * Several logical channels over one ByteFrame link.
+ *
+ * Every frame starts with a channel byte:  | CH | data |
+ *
+ * Each channel has its own bounded queue (MUX_QUEUE_DEPTH messages). When the
+ * link can take a frame, mux_send_next() picks one:
+ *   1. STRICT channels first, lowest 'prio' value first (control traffic)
+ *   2. otherwise the WRR channels share the link by bytes, in proportion to
+ *      their 'weight' (deficit round robin: logging, firmware update, ...)
+ * A control frame therefore waits for at most the frame already on the wire.
+ *
+ * Per channel the mux counts frames, bytes, queue drops and the time each
+ * frame spent queued (enqueue to hand-over to the link).
+ */
+
+#define MUX_MAX_CHANNELS    4
+#define MUX_QUEUE_DEPTH     8       /* Messages queued per channel */
+#define MUX_MAX_MSG         128     /* Largest message (without the channel byte) */
+#define MUX_QUANTUM         64      /* Bytes a WRR channel earns per round and unit of weight */
+#define MUX_MAX_FRAME       (1 + MUX_MAX_MSG)
+
+typedef enum {
+    MUX_CLOSED = 0,
+    MUX_STRICT,
+    MUX_WRR
+} mux_class;
+
+/* Hands one frame to ByteFrame (e.g. send_packet_bulk_crc) */
+typedef void (*mux_send_fn)(const uint8_t *frame, int len, void *ctx);
+
+/* Receives the messages of one channel */
+typedef void (*mux_rx_fn)(uint8_t ch, const uint8_t *data, int len, void *ctx);
+
+typedef struct {
+    uint32_t tx_frames;
+    uint32_t tx_bytes;
+    uint32_t drops;             /* enqueue refused, queue full */
+    uint32_t rx_frames;
+    uint32_t rx_bytes;
+    uint32_t max_latency_us;    /* Longest time a frame waited in the queue */
+    uint64_t sum_latency_us;    /* For the average: sum_latency_us / tx_frames */
+} mux_stats;
+
+typedef struct {
+    uint16_t len;               /* Frame length including the channel byte */
+    uint32_t enq_us;
+    uint8_t frame[MUX_MAX_FRAME];
+} mux_msg;
+
+typedef struct {
+    mux_class cls;
+    uint8_t prio;               /* STRICT: 0 is the most urgent */
+    uint8_t weight;             /* WRR: share of the link */
+    int32_t deficit;            /* WRR: bytes it may still send this round */
+    mux_msg queue[MUX_QUEUE_DEPTH];
+    uint8_t head;
+    uint8_t count;
+    mux_rx_fn on_rx;
+    mux_stats stats;
+} mux_channel;
+
+typedef struct {
+    mux_channel ch[MUX_MAX_CHANNELS];
+    uint8_t rr;                 /* WRR channel whose turn it is */
+    uint8_t granted;            /* It already got its quantum this turn */
+    mux_send_fn send;
+    void *ctx;                  /* Passed to 'send' and to the channel handlers */
+} mux;
+
+/* Resets 'm' with every channel closed */
+void mux_init(mux *m, mux_send_fn send, void *ctx);
+
+/*
+ * Opens channel 'ch' as MUX_STRICT ('param' = priority) or MUX_WRR
+ * ('param' = weight, at least 1). 'on_rx' may be NULL for send only channels.
+ * Returns 0, or -1 on bad arguments.
+ */
+int mux_open(mux *m, uint8_t ch, mux_class cls, uint8_t param, mux_rx_fn on_rx);
+
+/*
+ * Queues a message on 'ch'. Returns 0, or -1 if the channel is closed, the
+ * message is longer than MUX_MAX_MSG or the queue is full (counted as drop).
+ */
+int mux_enqueue(mux *m, uint8_t ch, const uint8_t *data, int len, uint32_t now_us);
+
+/*
+ * Sends the next frame according to the channel classes. Call it whenever
+ * the link can take a frame. Returns the frame length, 0 if nothing is queued.
+ */
+int mux_send_next(mux *m, uint32_t now_us);
+
+/* Feeds one received ByteFrame frame (call it from the packet handler) */
+void mux_receive(mux *m, const uint8_t *frame, int len);
+
+/* Messages waiting on all channels */
+int mux_pending(const mux *m);
+
+/* Statistics of channel 'ch' */
+const mux_stats *mux_get_stats(const mux *m, uint8_t ch);
+
+#endif
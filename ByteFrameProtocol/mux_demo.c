@@ -0,0 +1,114 @@
+/*
+ * Control, logging and firmware update traffic sharing one simulated 115200
+ * baud UART through the multiplexer. The firmware channel always has data
+ * queued; the control latency is compared with and without strict priority.
+ *
+ * Time is simulated (each frame occupies the line for its escaped length
+ * times 10 bits), so the results do not depend on the PC.
+ * Build: make mux_demo
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "proto.h"
+#include "mux.h"
+
+#define BAUD            115200
+#define RUN_US          10000000u   /* 10 s */
+#define CONTROL_EVERY   50000u      /* 8 byte command every 50 ms */
+#define LOG_EVERY       20000u      /* 40 byte log line every 20 ms */
+
+enum { CH_CONTROL, CH_LOG, CH_FIRMWARE };
+
+static const char *names[] = { "control", "log", "firmware" };
+
+/* The line: frames go through ByteFrame into 'wire' and straight to the far end */
+static uint8_t wire[MAX_FRAME_LEN(MUX_MAX_FRAME + FRAME_CRC_LEN)];
+static int wire_len;
+static receiver far_rx;
+static mux far_mux;
+
+static void wire_write(const uint8_t *buf, int len) {
+    memcpy(wire + wire_len, buf, (size_t)len);
+    wire_len += len;
+}
+
+static void link_send(const uint8_t *frame, int len, void *ctx) {
+    (void)ctx;
+    wire_len = 0;
+    send_packet_bulk_crc(frame, len, wire_write);
+}
+
+static void far_packet(const uint8_t *data, int len) {
+    mux_receive(&far_mux, data, len);
+}
+
+static void run(int strict) {
+    static mux m;
+    static uint8_t rx_buf[RX_BUF_LEN(MUX_MAX_FRAME + FRAME_CRC_LEN)];
+    uint8_t msg[MUX_MAX_MSG];
+    uint32_t now = 0, next, line_free = 0, next_control = 0, next_log = 0;
+    const mux_stats *st;
+    int i;
+
+    mux_init(&m, link_send, NULL);
+    mux_open(&m, CH_CONTROL, strict ? MUX_STRICT : MUX_WRR, strict ? 0 : 1, NULL);
+    mux_open(&m, CH_LOG, MUX_WRR, 1, NULL);
+    mux_open(&m, CH_FIRMWARE, MUX_WRR, 3, NULL);
+
+    mux_init(&far_mux, NULL, NULL);
+    for(i = CH_CONTROL; i <= CH_FIRMWARE; i++) {
+        mux_open(&far_mux, (uint8_t)i, MUX_WRR, 1, NULL);
+    }
+    receiver_init(&far_rx, rx_buf, sizeof(rx_buf), far_packet);
+    receiver_enable_crc(&far_rx);
+
+    memset(msg, 0x5A, sizeof(msg));
+    while(now < RUN_US) {
+        /* Traffic sources */
+        if(now >= next_control) {
+            mux_enqueue(&m, CH_CONTROL, msg, 8, now);
+            next_control += CONTROL_EVERY;
+        }
+        if(now >= next_log) {
+            mux_enqueue(&m, CH_LOG, msg, 40, now);
+            next_log += LOG_EVERY;
+        }
+        while(m.ch[CH_FIRMWARE].count < MUX_QUEUE_DEPTH) {
+            mux_enqueue(&m, CH_FIRMWARE, msg, MUX_MAX_MSG, now);
+        }
+
+        /* Line idle: next frame, which keeps it busy for its length in bits */
+        if(now >= line_free) {
+            if(mux_send_next(&m, now) > 0) {
+                line_free = now + (uint32_t)((uint64_t)wire_len * 10 * 1000000 / BAUD);
+                for(i = 0; i < wire_len; i++) {
+                    receive_byte(&far_rx, wire[i]);
+                }
+            }
+        }
+
+        /* Jump to the next thing that happens: a source or the line getting free */
+        next = (next_control < next_log) ? next_control : next_log;
+        if((line_free > now) && (line_free < next)) {
+            next = line_free;
+        }
+        now = next;
+    }
+
+    printf("%s:\n", strict ? "control on a STRICT channel" : "all channels WRR (no priority)");
+    for(i = CH_CONTROL; i <= CH_FIRMWARE; i++) {
+        st = mux_get_stats(&m, (uint8_t)i);
+        printf("  %-9s %5u frames %7.0f B/s  latency avg %6.1f ms max %6.1f ms  drops %4u  received %u\n",
+               names[i], (unsigned)st->tx_frames, st->tx_bytes * 1e6 / RUN_US,
+               st->tx_frames ? st->sum_latency_us / 1000.0 / st->tx_frames : 0.0,
+               st->max_latency_us / 1000.0, (unsigned)st->drops,
+               (unsigned)mux_get_stats(&far_mux, (uint8_t)i)->rx_frames);
+    }
+}
+
+int main(void) {
+    run(0);
+    run(1);
+    return 0;
+}
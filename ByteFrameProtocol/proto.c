@@ -0,0 +1,309 @@
+#include <string.h>
+#include "proto.h"
+#include "scan.h"
+#include "crc.h"
+
+/* CRC-32 trailer, least significant byte first */
+static void put_crc(uint8_t *out, uint32_t crc) {
+    out[0] = (uint8_t)crc;
+    out[1] = (uint8_t)(crc >> 8);
+    out[2] = (uint8_t)(crc >> 16);
+    out[3] = (uint8_t)(crc >> 24);
+}
+
+static uint32_t get_crc(const uint8_t *in) {
+    return (uint32_t)in[0] | ((uint32_t)in[1] << 8) | ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+/* Staging buffer of the bulk senders */
+typedef struct {
+    uint8_t buf[TX_CHUNK_LEN];
+    int used;
+    void (*write)(const uint8_t *buf, int len);
+} tx_chunk;
+
+static void chunk_flush(tx_chunk *c) {
+    if(c->used > 0) {
+        c->write(c->buf, c->used);
+        c->used = 0;
+    }
+}
+
+static void chunk_byte(tx_chunk *c, uint8_t byte) {
+    if(c->used == TX_CHUNK_LEN) {
+        chunk_flush(c);
+    }
+    c->buf[c->used++] = byte;
+}
+
+/* Appends 'len' bytes as they are, in as many chunks as needed */
+static void chunk_copy(tx_chunk *c, const uint8_t *data, int len) {
+    while(len > 0) {
+        int n = (len < TX_CHUNK_LEN - c->used) ? len : TX_CHUNK_LEN - c->used;
+        memcpy(c->buf + c->used, data, (size_t)n);
+        c->used += n;
+        data += n;
+        len -= n;
+        if(c->used == TX_CHUNK_LEN) {
+            chunk_flush(c);
+        }
+    }
+}
+
+#ifdef BYTEFRAME_COBS
+
+/*
+ * COBS encoder for data arriving in pieces (data, then CRC trailer): a block
+ * is collected until its end is known, then sent as code byte + bytes
+ * through 'tx' or into 'chunk'.
+ */
+typedef struct {
+    uint8_t block[COBS_BLOCK];
+    int n;
+    void (*tx)(uint8_t);
+    tx_chunk *chunk;
+} cobs_stream;
+
+static void cobs_emit(cobs_stream *st, uint8_t code) {
+    int i;
+
+    if(st->chunk != NULL) {
+        chunk_byte(st->chunk, code);
+        chunk_copy(st->chunk, st->block, st->n);
+    } else {
+        st->tx(code);
+        for(i = 0; i < st->n; i++) {
+            st->tx(st->block[i]);
+        }
+    }
+    st->n = 0;
+}
+
+static void cobs_put(cobs_stream *st, const uint8_t *data, int len) {
+    while(len > 0) {
+        int room = COBS_BLOCK - st->n;
+        int run = (int)scan_find2(data, (size_t)((len < room) ? len : room), 0x00, 0x00);
+
+        memcpy(st->block + st->n, data, (size_t)run);
+        st->n += run;
+        data += run;
+        len -= run;
+        if(st->n == COBS_BLOCK) {
+            cobs_emit(st, 0xFF);                /* Full block, no zero */
+        } else if(len > 0) {
+            cobs_emit(st, (uint8_t)(st->n + 1)); /* Block ended by the zero at data[0] */
+            data++;
+            len--;
+        }
+    }
+}
+
+/* Frame body: COBS encoded data and optional trailer */
+static void send_body(const uint8_t *data, int len, const uint8_t *trailer,
+                      void (*tx)(uint8_t), tx_chunk *chunk) {
+    cobs_stream st;
+
+    st.n = 0;
+    st.tx = tx;
+    st.chunk = chunk;
+    cobs_put(&st, data, len);
+    if(trailer != NULL) {
+        cobs_put(&st, trailer, FRAME_CRC_LEN);
+    }
+    cobs_emit(&st, (uint8_t)(st.n + 1));        /* Last block ends at the implicit zero */
+}
+
+#else
+
+/* Sends one data byte, escaped if needed */
+static void tx_escaped(uint8_t byte, void (*tx)(uint8_t)) {
+    if(byte == FRAME_END) {
+        tx(FRAME_ESC);
+        tx(ESC_END);
+    } else if(byte == FRAME_ESC) {
+        tx(FRAME_ESC);
+        tx(ESC_ESC);
+    } else {
+        tx(byte);
+    }
+}
+
+/* Appends 'data' escaped */
+static void chunk_escaped(tx_chunk *c, const uint8_t *data, int len) {
+    int i = 0;
+
+    while(i < len) {
+        /* Copy the run up to the next special byte */
+        int run = (int)scan_find2(data + i, (size_t)(len - i), FRAME_END, FRAME_ESC);
+        chunk_copy(c, data + i, run);
+        i += run;
+        if(i == len) {
+            break;
+        }
+
+        if(c->used > TX_CHUNK_LEN - 2) {
+            chunk_flush(c);
+        }
+        c->buf[c->used++] = FRAME_ESC;
+        c->buf[c->used++] = (data[i] == FRAME_END) ? ESC_END : ESC_ESC;
+        i++;
+    }
+}
+
+/* Frame body: escaped data and optional trailer */
+static void send_body(const uint8_t *data, int len, const uint8_t *trailer,
+                      void (*tx)(uint8_t), tx_chunk *chunk) {
+    int i;
+
+    if(chunk != NULL) {
+        chunk_escaped(chunk, data, len);
+        if(trailer != NULL) {
+            chunk_escaped(chunk, trailer, FRAME_CRC_LEN);
+        }
+        return;
+    }
+    for(i = 0; i < len; i++) {
+        tx_escaped(data[i], tx);
+    }
+    for(i = 0; (trailer != NULL) && (i < FRAME_CRC_LEN); i++) {
+        tx_escaped(trailer[i], tx);
+    }
+}
+
+#endif /* BYTEFRAME_COBS */
+
+static void send_frame(const uint8_t *data, int len, const uint8_t *trailer, void (*tx)(uint8_t)) {
+    tx(FRAME_END);
+    send_body(data, len, trailer, tx, NULL);
+    tx(FRAME_END);
+}
+
+static void send_frame_bulk(const uint8_t *data, int len, const uint8_t *trailer,
+                            void (*write)(const uint8_t *buf, int len)) {
+    tx_chunk c;
+
+    c.used = 0;
+    c.write = write;
+    chunk_byte(&c, FRAME_END);
+    send_body(data, len, trailer, NULL, &c);
+    chunk_byte(&c, FRAME_END);
+    chunk_flush(&c);
+}
+
+void send_packet(const uint8_t *data, int len, void (*tx)(uint8_t)) {
+    send_frame(data, len, NULL, tx);
+}
+
+void send_packet_bulk(const uint8_t *data, int len, void (*write)(const uint8_t *buf, int len)) {
+    send_frame_bulk(data, len, NULL, write);
+}
+
+void send_packet_crc(const uint8_t *data, int len, void (*tx)(uint8_t)) {
+    uint8_t trailer[FRAME_CRC_LEN];
+
+    put_crc(trailer, crc32(data, (size_t)len));
+    send_frame(data, len, trailer, tx);
+}
+
+void send_packet_bulk_crc(const uint8_t *data, int len, void (*write)(const uint8_t *buf, int len)) {
+    uint8_t trailer[FRAME_CRC_LEN];
+
+    put_crc(trailer, crc32(data, (size_t)len));
+    send_frame_bulk(data, len, trailer, write);
+}
+
+void receiver_init(receiver *rx, uint8_t *buf, int size, packet_handler on_packet) {
+    rx->state = IDLE;
+    rx->buf = buf;
+    rx->size = size;
+    rx->len = 0;
+    rx->on_packet = on_packet;
+    rx->crc = 0;
+    rx->frames = 0;
+    rx->overruns = 0;
+    rx->crc_errors = 0;
+    rx->decode_errors = 0;
+}
+
+void receiver_enable_crc(receiver *rx) {
+    rx->crc = 1;
+}
+
+/* Checks and strips the CRC trailer if enabled, then hands the frame over */
+static void deliver(receiver *rx) {
+    int len = rx->len;
+
+#ifdef BYTEFRAME_COBS
+    if((len = cobs_decode(rx->buf, len)) < 0) {
+        rx->decode_errors++;
+        return;
+    }
+#endif
+    if(rx->crc) {
+        if((len < FRAME_CRC_LEN) ||
+           (get_crc(rx->buf + len - FRAME_CRC_LEN) != crc32(rx->buf, (size_t)(len - FRAME_CRC_LEN)))) {
+            rx->crc_errors++;
+            return;
+        }
+        len -= FRAME_CRC_LEN;
+    }
+    rx->frames++;
+    if(rx->on_packet != NULL) {
+        rx->on_packet(rx->buf, len);
+    }
+}
+
+/* Stores one data byte; drops the frame and waits for the next one if it does not fit */
+static void store_byte(receiver *rx, uint8_t byte) {
+    if(rx->len >= rx->size) {
+        rx->overruns++;
+        rx->len = 0;
+        rx->state = IDLE;
+        return;
+    }
+    rx->buf[rx->len++] = byte;
+    rx->state = IN_FRAME;
+}
+
+void receive_byte(receiver *rx, uint8_t byte) {
+    switch(rx->state) {
+        case IDLE:
+            if(byte == FRAME_END) {
+                rx->len = 0;
+                rx->state = IN_FRAME;
+            }
+            break;
+
+        case IN_FRAME:
+            if(byte == FRAME_END) {
+                /* An empty frame is the start byte of the next one (back to back frames, lost end byte) */
+                if(rx->len > 0) {
+                    deliver(rx);
+                    rx->len = 0;
+                    rx->state = IDLE;
+                }
+#ifndef BYTEFRAME_COBS
+            } else if(byte == FRAME_ESC) {
+                rx->state = ESC;
+#endif
+            } else {
+                store_byte(rx, byte);
+            }
+            break;
+
+#ifndef BYTEFRAME_COBS
+        case ESC:
+            if(byte == ESC_END) {
+                store_byte(rx, FRAME_END);
+            } else if(byte == ESC_ESC) {
+                store_byte(rx, FRAME_ESC);
+            } else {
+                store_byte(rx, byte);   /* Invalid escape: just store it */
+            }
+            break;
+#else
+        case ESC:
+            break;
+#endif
+    }
+}
@@ -0,0 +1,97 @@
+#ifndef PROTO_H
+#define PROTO_H
+
+#include <stdint.h>
+
+/*
+ * Build with -DBYTEFRAME_COBS to stuff the data with COBS (cobs.h) instead of
+ * SLIP style escaping: frames are then delimited by 0x00 and grow by at most
+ * 1 byte per 254, whatever the data. Both ends must be built the same way.
+ */
+#ifdef BYTEFRAME_COBS
+
+#include "cobs.h"
+
+#define FRAME_END   0x00    /* Starts and ends a frame */
+
+/* Worst case size on the wire for 'len' data bytes */
+#define MAX_FRAME_LEN(len)  (2 + COBS_MAX_LEN(len))
+
+/* Receive buffer needed for frames of 'len' data bytes (decoded in place) */
+#define RX_BUF_LEN(len)     COBS_MAX_LEN(len)
+
+#else
+
+/* Special bytes */
+#define FRAME_END   0xC0    /* Starts and ends a frame */
+#define FRAME_ESC   0xDB    /* Escape */
+#define ESC_END     0xDC    /* FRAME_ESC ESC_END means a data byte 0xC0 */
+#define ESC_ESC     0xDD    /* FRAME_ESC ESC_ESC means a data byte 0xDB */
+
+/* Worst case size on the wire for 'len' data bytes: every byte escaped */
+#define MAX_FRAME_LEN(len)  (2 + 2 * (len))
+
+/* Receive buffer needed for frames of 'len' data bytes */
+#define RX_BUF_LEN(len)     (len)
+
+#endif /* BYTEFRAME_COBS */
+
+/* Optional CRC-32 trailer after the data (before escaping), least significant byte first */
+#define FRAME_CRC_LEN       4
+
+/* Size of the staging buffer used by send_packet_bulk() */
+#define TX_CHUNK_LEN        256
+
+/*
+ * Sends one frame, one byte at a time through 'tx' (e.g. a UART send function).
+ */
+void send_packet(const uint8_t *data, int len, void (*tx)(uint8_t));
+
+/*
+ * Same frame, but the escaped output is staged in a TX_CHUNK_LEN buffer and
+ * handed to 'write' in chunks (e.g. write() on a serial port, a DMA start).
+ */
+void send_packet_bulk(const uint8_t *data, int len, void (*write)(const uint8_t *buf, int len));
+
+/* Same as send_packet() / send_packet_bulk() with the CRC-32 of 'data' appended */
+void send_packet_crc(const uint8_t *data, int len, void (*tx)(uint8_t));
+void send_packet_bulk_crc(const uint8_t *data, int len, void (*write)(const uint8_t *buf, int len));
+
+/* Receiver states */
+typedef enum {
+    IDLE,       /* Waiting for the message to start */
+    IN_FRAME,   /* Message started, collect data */
+    ESC         /* Got FRAME_ESC, the next byte is escaped (not used with COBS) */
+} rx_state;
+
+/* Called with every complete frame; 'data' is only valid during the call */
+typedef void (*packet_handler)(const uint8_t *data, int len);
+
+typedef struct {
+    rx_state state;
+    uint8_t *buf;           /* Caller provided frame buffer */
+    int size;
+    int len;                /* Bytes collected so far */
+    packet_handler on_packet;
+    uint8_t crc;            /* Frames carry a CRC-32 trailer */
+    /* Statistics */
+    uint32_t frames;
+    uint32_t overruns;      /* Frames longer than 'size', dropped */
+    uint32_t crc_errors;    /* Frames with a wrong CRC, dropped */
+    uint32_t decode_errors; /* COBS frames that do not decode, dropped */
+} receiver;
+
+/* Resets 'rx' and attaches the frame buffer ('size' = RX_BUF_LEN(largest frame)) and the handler */
+void receiver_init(receiver *rx, uint8_t *buf, int size, packet_handler on_packet);
+
+/*
+ * Expects a CRC-32 trailer on every frame (both sides must agree): frames
+ * with a wrong CRC are dropped, the trailer is not passed to the handler.
+ * 'size' must include the FRAME_CRC_LEN trailer bytes.
+ */
+void receiver_enable_crc(receiver *rx);
+
+/* Feeds one received byte (UART ISR or polling loop) */
+void receive_byte(receiver *rx, uint8_t byte);
+
+#endif
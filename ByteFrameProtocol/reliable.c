@@ -0,0 +1,147 @@
+#include <string.h>
+#include "reliable.h"
+
+/* Sequence numbers are 8 bit and wrap: compare them as distances */
+#define SEQ_DIST(from, to)  ((uint8_t)((to) - (from)))
+
+void reliable_init(rl_endpoint *ep, uint8_t window, uint32_t timeout_ms,
+                   rl_send_fn send, rl_deliver_fn deliver, void *ctx) {
+    memset(ep, 0, sizeof(*ep));
+    if(window == 0) {
+        window = 1;
+    }
+    ep->window = (window > RL_MAX_WINDOW) ? RL_MAX_WINDOW : window;
+    ep->timeout_ms = timeout_ms;
+    ep->send = send;
+    ep->deliver = deliver;
+    ep->ctx = ctx;
+}
+
+int reliable_window_free(const rl_endpoint *ep) {
+    return ep->window - SEQ_DIST(ep->base, ep->next);
+}
+
+int reliable_send(rl_endpoint *ep, const uint8_t *data, int len, uint32_t now_ms) {
+    rl_slot *slot;
+
+    if((len < 0) || (len > RL_MAX_PAYLOAD) || (reliable_window_free(ep) == 0)) {
+        return -1;
+    }
+
+    slot = &ep->tx[ep->next % RL_MAX_WINDOW];
+    slot->frame[0] = RL_DATA;
+    slot->frame[1] = ep->next;
+    memcpy(slot->frame + RL_HDR_LEN, data, (size_t)len);
+    slot->len = (uint8_t)(RL_HDR_LEN + len);
+    slot->used = 1;
+    slot->sent_ms = now_ms;
+    ep->next++;
+    ep->sent++;
+
+    ep->send(slot->frame, slot->len, ep->ctx);
+    return 0;
+}
+
+/* Acks everything received so far: cumulative NEXT plus the bitmap of buffered SEQs after it */
+static void send_ack(rl_endpoint *ep) {
+    uint8_t ack[RL_ACK_LEN];
+    uint32_t sack = 0;
+    uint8_t i;
+
+    for(i = 1; i < ep->window; i++) {
+        if(ep->rx[(uint8_t)(ep->expected + i) % RL_MAX_WINDOW].used) {
+            sack |= 1ul << (i - 1);
+        }
+    }
+    ack[0] = RL_ACK;
+    ack[1] = ep->expected;
+    ack[2] = (uint8_t)sack;
+    ack[3] = (uint8_t)(sack >> 8);
+    ack[4] = (uint8_t)(sack >> 16);
+    ack[5] = (uint8_t)(sack >> 24);
+    ep->acks++;
+    ep->send(ack, RL_ACK_LEN, ep->ctx);
+}
+
+static void on_data(rl_endpoint *ep, const uint8_t *frame, int len) {
+    uint8_t seq = frame[1];
+    uint8_t dist = SEQ_DIST(ep->expected, seq);
+    rl_slot *slot;
+
+    if(dist >= ep->window) {
+        /* Already delivered (our ack was lost): ack again so the sender moves on */
+        ep->duplicates++;
+        send_ack(ep);
+        return;
+    }
+
+    slot = &ep->rx[seq % RL_MAX_WINDOW];
+    if(slot->used) {
+        ep->duplicates++;
+    } else if(dist == 0) {
+        ep->deliver(frame + RL_HDR_LEN, len - RL_HDR_LEN, ep->ctx);
+        ep->delivered++;
+        ep->expected++;
+
+        /* The hole is filled: hand over what was waiting behind it */
+        slot = &ep->rx[ep->expected % RL_MAX_WINDOW];
+        while(slot->used) {
+            ep->deliver(slot->frame + RL_HDR_LEN, slot->len - RL_HDR_LEN, ep->ctx);
+            ep->delivered++;
+            slot->used = 0;
+            ep->expected++;
+            slot = &ep->rx[ep->expected % RL_MAX_WINDOW];
+        }
+    } else {
+        memcpy(slot->frame, frame, (size_t)len);
+        slot->len = (uint8_t)len;
+        slot->used = 1;
+        ep->out_of_order++;
+    }
+    send_ack(ep);
+}
+
+static void on_ack(rl_endpoint *ep, const uint8_t *frame) {
+    uint8_t cum = frame[1];
+    uint32_t sack = (uint32_t)frame[2] | ((uint32_t)frame[3] << 8) |
+                    ((uint32_t)frame[4] << 16) | ((uint32_t)frame[5] << 24);
+    uint8_t in_flight = SEQ_DIST(ep->base, ep->next);
+    uint8_t i;
+
+    /* Stale or bogus ack: NEXT must lie within base .. next */
+    if(SEQ_DIST(ep->base, cum) > in_flight) {
+        return;
+    }
+
+    while(ep->base != cum) {
+        ep->tx[ep->base % RL_MAX_WINDOW].used = 0;
+        ep->base++;
+    }
+    for(i = 0; sack != 0; i++, sack >>= 1) {
+        uint8_t seq = (uint8_t)(cum + 1 + i);
+        if((sack & 1) && (SEQ_DIST(ep->base, seq) < SEQ_DIST(ep->base, ep->next))) {
+            ep->tx[seq % RL_MAX_WINDOW].used = 0;
+        }
+    }
+}
+
+void reliable_receive(rl_endpoint *ep, const uint8_t *frame, int len) {
+    if((len >= RL_HDR_LEN) && (len <= RL_MAX_FRAME) && (frame[0] == RL_DATA)) {
+        on_data(ep, frame, len);
+    } else if((len == RL_ACK_LEN) && (frame[0] == RL_ACK)) {
+        on_ack(ep, frame);
+    }
+}
+
+void reliable_poll(rl_endpoint *ep, uint32_t now_ms) {
+    uint8_t seq;
+
+    for(seq = ep->base; seq != ep->next; seq++) {
+        rl_slot *slot = &ep->tx[seq % RL_MAX_WINDOW];
+        if(slot->used && (now_ms - slot->sent_ms >= ep->timeout_ms)) {
+            slot->sent_ms = now_ms;
+            ep->retransmits++;
+            ep->send(slot->frame, slot->len, ep->ctx);
+        }
+    }
+}
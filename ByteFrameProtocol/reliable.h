@@ -0,0 +1,93 @@
+#ifndef RELIABLE_H
+#define RELIABLE_H
+
+#include <stdint.h>
+
+/*
+ * Optional reliable delivery on top of ByteFrame (selective repeat).
+ *
+ * Every message travels in one ByteFrame frame with a small header:
+ *
+ *   DATA: | 0x01 | SEQ | payload (up to RL_MAX_PAYLOAD bytes) |
+ *   ACK:  | 0x02 | NEXT | SACK (4 bytes, LSB first) |
+ *
+ * NEXT is the cumulative ack: every SEQ before it has been delivered. Bit i of
+ * SACK says SEQ NEXT + 1 + i has arrived too, so only the holes are sent again.
+ * Up to 'window' messages can be in flight; an unacked message is sent again
+ * after 'timeout_ms'. Both ends must use the same window.
+ *
+ * All buffers are inside the endpoint (fixed size, no allocation). Use the
+ * CRC trailer of ByteFrame underneath so corrupted frames are dropped and
+ * recovered like lost ones.
+ */
+
+#define RL_MAX_WINDOW   32      /* Upper limit for 'window' (SACK has 32 bits) */
+#define RL_MAX_PAYLOAD  240     /* Largest message */
+#define RL_HDR_LEN      2
+#define RL_ACK_LEN      6
+#define RL_MAX_FRAME    (RL_HDR_LEN + RL_MAX_PAYLOAD)
+
+#define RL_DATA         0x01
+#define RL_ACK          0x02
+
+/* Hands one frame to ByteFrame (e.g. send_packet_bulk_crc) */
+typedef void (*rl_send_fn)(const uint8_t *frame, int len, void *ctx);
+
+/* Receives the messages of the peer, in order, each exactly once */
+typedef void (*rl_deliver_fn)(const uint8_t *data, int len, void *ctx);
+
+typedef struct {
+    uint8_t used;           /* Holds a message (TX: unacked, RX: not delivered yet) */
+    uint8_t len;
+    uint32_t sent_ms;       /* TX: last (re)transmission */
+    uint8_t frame[RL_MAX_FRAME];
+} rl_slot;
+
+typedef struct {
+    uint8_t window;
+    uint32_t timeout_ms;
+    rl_send_fn send;
+    rl_deliver_fn deliver;
+    void *ctx;
+
+    /* Sender: SEQ 'base' .. 'next' - 1 are in flight */
+    uint8_t base;
+    uint8_t next;
+    rl_slot tx[RL_MAX_WINDOW];
+
+    /* Receiver: 'expected' is the next SEQ to deliver */
+    uint8_t expected;
+    rl_slot rx[RL_MAX_WINDOW];
+
+    /* Statistics */
+    uint32_t sent;          /* New messages */
+    uint32_t retransmits;
+    uint32_t delivered;
+    uint32_t duplicates;    /* Received again after delivery or buffering */
+    uint32_t out_of_order;  /* Buffered until the hole before them was filled */
+    uint32_t acks;          /* ACK frames sent */
+} rl_endpoint;
+
+/*
+ * Resets 'ep'. 'window' is clamped to 1..RL_MAX_WINDOW (1 is stop-and-wait).
+ */
+void reliable_init(rl_endpoint *ep, uint8_t window, uint32_t timeout_ms,
+                   rl_send_fn send, rl_deliver_fn deliver, void *ctx);
+
+/*
+ * Queues and sends one message.
+ * Returns 0, or -1 if it is too long or the window is full (call reliable_poll()
+ * and retry once acks came in).
+ */
+int reliable_send(rl_endpoint *ep, const uint8_t *data, int len, uint32_t now_ms);
+
+/* Feeds one received ByteFrame frame (call it from the packet handler) */
+void reliable_receive(rl_endpoint *ep, const uint8_t *frame, int len);
+
+/* Sends again what timed out; call it regularly (every few ms) */
+void reliable_poll(rl_endpoint *ep, uint32_t now_ms);
+
+/* Messages that can be sent before the window is full */
+int reliable_window_free(const rl_endpoint *ep);
+
+#endif
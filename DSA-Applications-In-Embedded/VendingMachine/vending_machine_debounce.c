@@ -2,46 +2,63 @@
  * @file debounce.c
  * @brief Button Debounce Logic for Sugarcane Juice Vending Machine
  * @author 
- * @version 1.0
+ * @version 1.1
  * @date 2025
  *
  * @details
  * This file implements a debounce algorithm to ensure stable button press detection.
  * The state-tracking method is used to avoid false triggers due to button bouncing.
+ * One sample is taken per call (shift-register history), so nothing spins; the
+ * INT0 ISR only latches the edge (and wakes the MCU from power-down).
  */
 
 #include "hardware.h"
-#include <util/delay.h>
 
 /** @defgroup Debounce Configuration */
 ///@{
-#define DEBOUNCE_DELAY_MS  20  /**< Debounce time in milliseconds */
+#define DEBOUNCE_MASK  0x1F  /**< Samples that must agree (5 calls, e.g. 5 x 4 ms task) */
 ///@}
 
+/** Last button samples, 1 = released */
+static uint8_t sampleHistory = 0xFF;
+
 /** Global variable to track stable button state */
 static uint8_t previousButtonState = 1;
 
 /** Global variable to track button press event */
 extern volatile uint8_t buttonPressed;
 
+/** Set by the INT0 ISR on a falling edge, cleared once the button is back to a stable release */
+volatile uint8_t buttonEdge = 0;
+
 /**
  * @brief Debounces the button press.
  *
- * Ensures that only valid button presses are registered by checking stability over time.
+ * Takes one sample per call and registers a press once the last samples all
+ * agree. Never blocks: it runs as a periodic scheduler task and lets the CPU
+ * sleep between samples.
  */
 void debounceButton(void) {
-    uint8_t stableState = 1; // Assume button is not pressed
+    uint8_t edge = buttonEdge;  // Before sampling: an edge latched after the sample is kept
+    uint8_t released = (PIND & (1 << BUTTON_PIN)) ? 1 : 0; // Active LOW
+    sampleHistory = (uint8_t)((sampleHistory << 1) | released);
 
-    for (uint8_t i = 0; i < 5; i++) { // Check stability for 5 cycles (~20ms total)
-        if (!(PIND & (1 << BUTTON_PIN))) { // Button is pressed (Active LOW)
-            stableState = 0;
+    if ((sampleHistory & DEBOUNCE_MASK) == 0) {
+        if (previousButtonState == 1) { // Detect valid press
+            buttonPressed = 1;  // Register button press event
+        }
+        previousButtonState = 0;
+    } else if ((sampleHistory & DEBOUNCE_MASK) == DEBOUNCE_MASK) {
+        previousButtonState = 1; // Stable release
+        if (edge) {
+            buttonEdge = 0;
         }
-        _delay_ms(DEBOUNCE_DELAY_MS / 5); // Small delay for sampling
-    }
-
-    if (stableState == 0 && previousButtonState == 1) { // Detect valid press
-        buttonPressed = 1;  // Register button press event
     }
+}
 
-    previousButtonState = stableState; // Store last button state
+/**
+ * @brief Returns 1 while an edge is latched or the samples have not settled.
+ */
+uint8_t debounceBusy(void) {
+    return buttonEdge || (sampleHistory & DEBOUNCE_MASK) != DEBOUNCE_MASK;
 }
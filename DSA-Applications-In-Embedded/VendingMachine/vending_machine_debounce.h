@@ -18,7 +18,16 @@
  * @brief Debounces the button press.
  *
  * Ensures that only valid button presses are registered by checking stability over time.
+ * Takes one sample per call; call it periodically (e.g. every 4 ms).
  */
 void debounceButton(void);
 
+/** Set by the INT0 ISR on a falling edge; debounceButton() clears it */
+extern volatile uint8_t buttonEdge;
+
+/**
+ * @brief Returns 1 while a press is being debounced (the MCU must not power down).
+ */
+uint8_t debounceBusy(void);
+
 #endif // DEBOUNCE_H
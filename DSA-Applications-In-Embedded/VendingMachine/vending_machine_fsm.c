@@ -0,0 +1,79 @@
+/**
+ * @file fsm.c
+ * @brief Implementation of the Generic Table-Driven Finite State Machine
+ * @author
+ * @version 1.0
+ * @date 2025
+ *
+ * @details
+ * Dispatch is O(1): the (state, event) cell is looked up directly, its guard
+ * is evaluated and, if allowed, exit -> transition -> entry actions are run.
+ */
+
+#include "fsm.h"
+#include <stddef.h>
+
+/**
+ * @brief Initializes a state machine and runs the entry action of the initial state.
+ */
+void fsmInit(Fsm *fsm, const FsmDefinition *def, uint8_t initial, void *ctx) {
+    fsm->def = def;
+    fsm->ctx = ctx;
+    fsm->trace = NULL;
+    fsm->clock = NULL;
+    fsm->current = initial;
+
+    if (def->states != NULL && def->states[initial].onEntry != NULL) {
+        def->states[initial].onEntry(ctx);
+    }
+}
+
+/**
+ * @brief Installs (or removes, with NULL) the transition trace hook.
+ */
+void fsmSetTrace(Fsm *fsm, FsmTraceHook hook, FsmClock clock) {
+    fsm->trace = hook;
+    fsm->clock = clock;
+}
+
+/**
+ * @brief Dispatches one event.
+ */
+uint8_t fsmDispatch(Fsm *fsm, uint8_t event) {
+    const FsmDefinition *def = fsm->def;
+    uint8_t from = fsm->current;
+    uint32_t start = 0;
+
+    if (event >= def->numEvents) {
+        return 0; // FSM_NO_EVENT or out of range
+    }
+
+    const FsmTransition *t = &def->table[from * def->numEvents + event];
+    if (t->next == FSM_NO_TRANSITION) {
+        return 0;
+    }
+    if (t->guard != NULL && !t->guard(fsm->ctx)) {
+        return 0;
+    }
+
+    if (fsm->trace != NULL && fsm->clock != NULL) {
+        start = fsm->clock();
+    }
+
+    if (t->next != from && def->states != NULL && def->states[from].onExit != NULL) {
+        def->states[from].onExit(fsm->ctx);
+    }
+    if (t->action != NULL) {
+        t->action(fsm->ctx);
+    }
+    fsm->current = t->next;
+    if (t->next != from && def->states != NULL && def->states[t->next].onEntry != NULL) {
+        def->states[t->next].onEntry(fsm->ctx);
+    }
+
+    if (fsm->trace != NULL) {
+        uint32_t ticks = (fsm->clock != NULL) ? fsm->clock() - start : 0;
+        fsm->trace(from, event, t->next, ticks);
+    }
+    return 1;
+}
@@ -0,0 +1,114 @@
+/**
+ * @file fsm.h
+ * @brief Generic Table-Driven Finite State Machine for Sugarcane Juice Vending Machine
+ * @author
+ * @version 1.0
+ * @date 2025
+ *
+ * @details
+ * A state machine is described by a constant transition table indexed by
+ * (state x event), plus optional entry/exit actions per state. Dispatching an
+ * event is a single table lookup, so the cost does not grow with the number of
+ * states. Both the dispensing logic (`state_machine.c`) and the menu logic
+ * (`ui_control.c`) are expressed with this module.
+ *
+ * An optional trace hook is called after every transition with the elapsed
+ * clock ticks, which gives per-transition latency numbers.
+ */
+
+#ifndef FSM_H
+#define FSM_H
+
+#include <stdint.h>
+
+/** @defgroup FSM Special Values */
+///@{
+#define FSM_NO_TRANSITION 0xFF /**< Table cell value: event is ignored in this state */
+#define FSM_NO_EVENT      0xFF /**< Returned by event sources when nothing happened */
+///@}
+
+/** Guard function: returns non-zero if the transition is allowed. */
+typedef uint8_t (*FsmGuard)(void *ctx);
+
+/** Action function: entry, exit or transition action. */
+typedef void (*FsmAction)(void *ctx);
+
+/** Free-running clock used to time transitions (e.g. schedulerPortMicros). */
+typedef uint32_t (*FsmClock)(void);
+
+/**
+ * @brief One cell of the transition table.
+ *
+ * If `next` equals the current state the transition is internal: only
+ * `action` runs, the exit and entry actions are skipped.
+ */
+typedef struct {
+    uint8_t next;      /**< Next state or FSM_NO_TRANSITION */
+    FsmGuard guard;    /**< Optional guard, NULL means always allowed */
+    FsmAction action;  /**< Optional transition action */
+} FsmTransition;
+
+/** Entry/exit actions of one state. */
+typedef struct {
+    FsmAction onEntry; /**< Called when the state is entered */
+    FsmAction onExit;  /**< Called when the state is left */
+} FsmStateActions;
+
+/**
+ * @brief Constant description of a state machine.
+ *
+ * `table` holds `numStates * numEvents` cells in row-major order, so the cell
+ * for (state, event) is `table[state * numEvents + event]`.
+ */
+typedef struct {
+    const FsmTransition *table;     /**< Transition table */
+    const FsmStateActions *states;  /**< Entry/exit actions, may be NULL */
+    uint8_t numStates;              /**< Number of states */
+    uint8_t numEvents;              /**< Number of events */
+} FsmDefinition;
+
+/** Trace hook called after each transition with its duration in clock ticks. */
+typedef void (*FsmTraceHook)(uint8_t from, uint8_t event, uint8_t to, uint32_t ticks);
+
+/** Run-time instance of a state machine. */
+typedef struct {
+    const FsmDefinition *def; /**< Constant description */
+    void *ctx;                /**< User context passed to guards and actions */
+    FsmTraceHook trace;       /**< Optional trace hook */
+    FsmClock clock;           /**< Clock used by the trace hook */
+    uint8_t current;          /**< Current state */
+} Fsm;
+
+/**
+ * @brief Initializes a state machine and runs the entry action of the initial state.
+ * @param fsm     Instance to initialize.
+ * @param def     Constant description.
+ * @param initial Initial state.
+ * @param ctx     User context passed to guards and actions.
+ */
+void fsmInit(Fsm *fsm, const FsmDefinition *def, uint8_t initial, void *ctx);
+
+/**
+ * @brief Installs (or removes, with NULL) the transition trace hook.
+ * @param fsm   Instance.
+ * @param hook  Trace hook.
+ * @param clock Clock used to time transitions.
+ */
+void fsmSetTrace(Fsm *fsm, FsmTraceHook hook, FsmClock clock);
+
+/**
+ * @brief Dispatches one event.
+ * @param fsm   Instance.
+ * @param event Event index (FSM_NO_EVENT is ignored).
+ * @return 1 if a transition was taken, 0 otherwise.
+ */
+uint8_t fsmDispatch(Fsm *fsm, uint8_t event);
+
+/**
+ * @brief Returns the current state.
+ */
+static inline uint8_t fsmState(const Fsm *fsm) {
+    return fsm->current;
+}
+
+#endif // FSM_H
@@ -8,10 +8,19 @@
  * @details
  * This file implements the functions declared in `hardware.h`.
  * It provides control for the solenoid valve, LEDs, buzzer, and button debounce logic.
+ * UART output goes through a ring buffer drained by the UDRE interrupt, so
+ * telemetry never waits on the line.
  */
 
 #include "hardware.h"
-#include <util/delay.h>
+#include <avr/interrupt.h>
+#include <stddef.h>
+
+/** UART transmit ring: written by uartPutc(), drained by the UDRE interrupt */
+static volatile char txRing[UART_TX_BUFFER];
+static volatile uint8_t txHead = 0; /**< Next free slot (main loop only) */
+static volatile uint8_t txTail = 0; /**< Next character to send (ISR only) */
+static volatile uint8_t txStarted = 0; /**< A character was ever sent (TXC0 is meaningful) */
 
 /**
  * @brief Initializes all hardware components.
@@ -30,7 +39,13 @@ void initHardware(void) {
     // Enable pull-up resistor on button
     PORTD |= (1 << BUTTON_PIN);
 
+    // Power reduction: ADC and analog comparator are unused
+    ADCSRA &= ~(1 << ADEN);
+    ACSR |= (1 << ACD);
+    PRR0 |= (1 << PRADC);
+
     // Enable External Interrupt for button press (Falling Edge Trigger)
+    // INT0 edges are detected asynchronously, so a press also wakes from power-down
     EICRA |= (1 << ISC01); // Falling edge INT0
     EIMSK |= (1 << INT0);  // Enable INT0
 
@@ -65,24 +80,122 @@ void updateLEDStatus(void) {
     PORTD &= ~(1 << ORANGE_LED); // Reset warning LED
 }
 
+/** @defgroup Buzzer Patterns: on/off durations (ms), starting with on, 0-terminated */
+///@{
+static const uint16_t warningPattern[] = {
+    BUZZER_WARNING_BEEP, BUZZER_WARNING_BEEP, BUZZER_WARNING_BEEP, BUZZER_WARNING_BEEP,
+    BUZZER_WARNING_BEEP, BUZZER_WARNING_BEEP, BUZZER_WARNING_BEEP, BUZZER_WARNING_BEEP,
+    BUZZER_WARNING_BEEP, BUZZER_WARNING_BEEP, 0
+};
+static const uint16_t completePattern[] = { BUZZER_COMPLETE_BEEP, 0 };
+///@}
+
+/** Pattern being played (NULL = silent), its current step and when that step started */
+static const uint16_t *buzzerPattern = NULL;
+static uint8_t buzzerStep = 0;
+static uint8_t buzzerStamped = 0;
+static uint32_t buzzerStepMs = 0;
+
 /**
  * @brief Plays a buzzer sound based on the event type.
+ *
+ * Only starts the pattern: updateBuzzer() advances it, so the caller never waits.
  * @param type Type of beep (1 = warning, 2 = completion).
  */
 void playBuzzerSound(uint8_t type) {
-    switch (type) {
-        case 1: // Low Juice Warning (Fast Beeps)
-            for (int i = 0; i < 5; i++) {
-                PORTD |= (1 << BUZZER);
-                _delay_ms(BUZZER_WARNING_BEEP);
-                PORTD &= ~(1 << BUZZER);
-                _delay_ms(BUZZER_WARNING_BEEP);
-            }
-            break;
-        case 2: // Dispensing Complete (Single Long Beep)
-            PORTD |= (1 << BUZZER);
-            _delay_ms(BUZZER_COMPLETE_BEEP);
+    buzzerPattern = (type == 1) ? warningPattern : (type == 2) ? completePattern : NULL;
+    buzzerStep = 0;
+    buzzerStamped = 0;
+    if (buzzerPattern) {
+        PORTD |= (1 << BUZZER);
+    } else {
+        PORTD &= ~(1 << BUZZER);
+    }
+}
+
+/**
+ * @brief Advances the buzzer pattern to time `nowMs`.
+ * @param nowMs Current time in milliseconds (scheduler clock).
+ */
+void updateBuzzer(uint32_t nowMs) {
+    if (buzzerPattern == NULL) {
+        return;
+    }
+    if (!buzzerStamped) {  // First call after playBuzzerSound(): the step starts now
+        buzzerStepMs = nowMs;
+        buzzerStamped = 1;
+    }
+    while (nowMs - buzzerStepMs >= buzzerPattern[buzzerStep]) {
+        buzzerStepMs += buzzerPattern[buzzerStep];
+        buzzerStep++;
+        if (buzzerPattern[buzzerStep] == 0) {  // Pattern done
+            PORTD &= ~(1 << BUZZER);
+            buzzerPattern = NULL;
+            return;
+        }
+        if (buzzerStep & 1) {
             PORTD &= ~(1 << BUZZER);
-            break;
+        } else {
+            PORTD |= (1 << BUZZER);
+        }
+    }
+}
+
+/**
+ * @brief Returns 1 while a buzzer pattern is playing.
+ */
+uint8_t buzzerActive(void) {
+    return buzzerPattern != NULL;
+}
+
+/**
+ * @brief Initializes USART0 for transmit at UART_BAUD.
+ */
+void initUART(void) {
+    UCSR0A = (1 << U2X0);                       // Double speed: lower baud error
+    UBRR0 = (uint16_t)((F_CPU / (8UL * UART_BAUD)) - 1);
+    UCSR0B = (1 << TXEN0);                      // Transmitter only
+    UCSR0C = (1 << UCSZ01) | (1 << UCSZ00);     // 8N1
+}
+
+/**
+ * @brief Queues one character for USART0; the UDRE interrupt sends it.
+ */
+void uartPutc(char c) {
+    uint8_t next = (uint8_t)((txHead + 1) & (UART_TX_BUFFER - 1));
+
+    if (next == txTail) {
+        return; // Full: dropped
     }
+    txRing[txHead] = c;
+    txHead = next;
+    UCSR0B |= (1 << UDRIE0);
+}
+
+/**
+ * @brief Data register empty: sends the next queued character.
+ */
+ISR(USART0_UDRE_vect) {
+    if (txTail == txHead) {
+        UCSR0B &= ~(1 << UDRIE0); // Ring empty
+        return;
+    }
+    UCSR0A |= (1 << TXC0);        // Clear "transmit complete" for this character
+    UDR0 = (uint8_t)txRing[txTail];
+    txTail = (uint8_t)((txTail + 1) & (UART_TX_BUFFER - 1));
+    txStarted = 1;
+}
+
+/**
+ * @brief Returns the number of characters uartPutc() can queue now.
+ */
+uint8_t uartTxFree(void) {
+    return (uint8_t)((txTail - txHead - 1) & (UART_TX_BUFFER - 1));
+}
+
+/**
+ * @brief Returns 1 until the last queued character has left the shift register.
+ */
+uint8_t uartTxBusy(void) {
+    return txHead != txTail || (txStarted && !(UCSR0A & (1 << TXC0)));
 }
@@ -30,12 +30,22 @@
 
 /** @defgroup Timing Macros */
 ///@{
-#define DISPENSE_TIME_MS  3000  /**< Juice dispensing time in milliseconds */
+#ifndef DISPENSE_TIME_MS
+#define DISPENSE_TIME_MS  3000  /**< Juice dispensing time in milliseconds (the host demo shortens it) */
+#endif
+#ifndef COOLDOWN_TIME_MS
 #define COOLDOWN_TIME_MS  3000  /**< Cooldown time before next dispense */
+#endif
 #define BUZZER_WARNING_BEEP 50  /**< Short beep duration for warnings */
 #define BUZZER_COMPLETE_BEEP 300 /**< Long beep duration for completion */
 ///@}
 
+/** @defgroup UART Configuration */
+///@{
+#define UART_BAUD      57600 /**< USART0 baud rate (telemetry export) */
+#define UART_TX_BUFFER 128   /**< TX ring size, a power of two up to 256 */
+///@}
+
 /** @defgroup State Machine States */
 ///@{
 typedef enum {
@@ -74,8 +84,46 @@ void updateLEDStatus(void);
 
 /** 
  * @brief Plays a buzzer sound based on the event type.
+ *
+ * Starts the beep pattern and returns at once; updateBuzzer() plays it.
  * @param type Type of beep (1 = warning, 2 = completion).
  */
 void playBuzzerSound(uint8_t type);
 
+/**
+ * @brief Advances the current beep pattern (call periodically, e.g. every 10 ms).
+ * @param nowMs Current time in milliseconds.
+ */
+void updateBuzzer(uint32_t nowMs);
+
+/**
+ * @brief Returns 1 while a beep pattern is playing.
+ */
+uint8_t buzzerActive(void);
+
+/**
+ * @brief Initializes USART0 for transmit at UART_BAUD.
+ */
+void initUART(void);
+
+/**
+ * @brief Queues one character for USART0; the UDRE interrupt sends it.
+ *
+ * Never waits: a character that does not fit is dropped, so callers check
+ * uartTxFree() first.
+ *
+ * @param c Character to send.
+ */
+void uartPutc(char c);
+
+/**
+ * @brief Returns the number of characters uartPutc() can queue now.
+ */
+uint8_t uartTxFree(void);
+
+/**
+ * @brief Returns 1 until the last queued character has left the shift register.
+ */
+uint8_t uartTxBusy(void);
+
 #endif // HARDWARE_H
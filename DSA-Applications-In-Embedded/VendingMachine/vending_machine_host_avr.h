@@ -0,0 +1,80 @@
+/**
+ * @file host_avr.h
+ * @brief Host (PC) Stand-in for <avr/io.h>, <avr/interrupt.h> and <util/atomic.h>
+ * @author
+ * @version 1.0
+ * @date 2025
+ *
+ * @details
+ * Lets the firmware modules (hardware, state machine, debounce, user
+ * interface) build unchanged on the PC: `make host_sim` links this file as
+ * `avr/io.h`, `avr/interrupt.h` and `util/atomic.h`. The I/O registers they
+ * touch become plain variables, defined by the host program, which drives
+ * the input pins and reads the outputs. TWINT stays set once written, so
+ * SSD1306 transfers complete at once.
+ */
+
+#ifndef HOST_AVR_H
+#define HOST_AVR_H
+
+#include <stdint.h>
+
+/** @defgroup Registers used by the firmware modules */
+///@{
+extern volatile uint8_t PIND, PORTD, DDRD;
+extern volatile uint8_t ADCSRA, ACSR, PRR0, EICRA, EIMSK;
+extern volatile uint8_t UCSR0A, UCSR0B, UCSR0C, UDR0;
+extern volatile uint16_t UBRR0;
+extern volatile uint8_t PINK, PORTK, DDRK, PCICR, PCMSK2;
+extern volatile uint8_t TWCR, TWDR, TWSR, TWBR;
+///@}
+
+/** @defgroup Bit numbers (as in the ATmega2560 headers) */
+///@{
+#define PD2     2
+#define PD3     3
+#define PD4     4
+#define PD5     5
+#define PD6     6
+#define PD7     7
+#define ADEN    7
+#define ACD     7
+#define PRADC   0
+#define ISC01   1
+#define INT0    0
+#define U2X0    1
+#define TXEN0   3
+#define UCSZ01  2
+#define UCSZ00  1
+#define UDRE0   5
+#define UDRIE0  5
+#define TXC0    6
+#define PK0     0
+#define PK1     1
+#define PK2     2
+#define PK3     3
+#define PCINT16 0
+#define PCINT17 1
+#define PCINT18 2
+#define PCINT19 3
+#define PCIE2   2
+#define TWINT   7
+#define TWSTA   5
+#define TWSTO   4
+#define TWEN    2
+///@}
+
+#ifndef F_CPU
+#define F_CPU 16000000UL
+#endif
+
+/** Interrupts are host signals: nothing to enable */
+#define sei()
+#define cli()
+#define ISR(vector) void vector(void)
+
+/** The host program calls the "ISRs" from its own thread: nothing to mask */
+#define ATOMIC_RESTORESTATE 0
+#define ATOMIC_BLOCK(type) for (uint8_t atomicOnce = 1; atomicOnce; atomicOnce = 0)
+
+#endif // HOST_AVR_H
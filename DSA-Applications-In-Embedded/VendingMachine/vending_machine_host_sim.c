@@ -0,0 +1,378 @@
+/**
+ * @file host_sim.c
+ * @brief Host (PC) Simulation of the Hardware-Independent Vending Modules
+ * @author 
+ * @version 1.0
+ * @date 2025
+ *
+ * @details
+ * Builds with the PC compiler (`make host_sim`) and exercises the modules
+ * that do not touch AVR registers.
+ *
+ * OLED: draws the menu screens through the framebuffer, writes each frame to
+ * `frame_N.pbm` and reports how many bytes the incremental flush sent
+ * compared with a full 1 KB redraw.
+ *
+ * User interface: runs the MID_VARIANT menu (`ui_control.c`,
+ * `rotary_encoder.c`) as a scheduler task while a scripted user turns the
+ * encoder (quadrature edges through the pin-change "ISR") and presses the
+ * buttons. Reports the menu state and OLED traffic after every action,
+ * writes the last screen to `ui.pbm`, then waits for the inactivity timeout
+ * to bring the menu back to UI_IDLE.
+ *
+ * Scheduler: runs a task set with emulated execution times for a few seconds
+ * on the host timer tick and reports per-task CPU load, run time, release
+ * jitter and deadline misses.
+ *
+ * Low power: runs the firmware's own state machine, debounce and buzzer
+ * tasks (`state_machine.c`, `debounce.c`, `hardware.c` built against the
+ * register stand-ins of `host_avr.h`) through a few dispense cycles.
+ * Customers arrive as a host signal (stand-in for INT0) that pulls the button
+ * pin low and latches the edge like the ISR; one of them finds the tank low.
+ * Reports the fraction of time spent active, in idle sleep and powered down,
+ * plus an estimated charge per cycle. The same cycles feed the telemetry
+ * histograms through the state machine's trace hook, which are exported to
+ * stdout in the format sent over the UART.
+ */
+
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "oled_display.h"
+#include "oled_host.h"
+#include "scheduler.h"
+#include "telemetry.h"
+#include "state_machine.h"
+#include "debounce.h"
+#include "ui_control.h"
+#include "rotary_encoder.h"
+
+#define SIM_DURATION_MS 3000 /**< Length of the scheduler simulation */
+
+/** @defgroup Low Power Simulation */
+///@{
+#define SIM_CYCLES         3    /**< Customers to simulate */
+#define SIM_LOW_JUICE_CYCLE 1   /**< This customer finds the tank low */
+#define SIM_CUSTOMER_GAP_MS 800 /**< Idle time before the next customer */
+#define SIM_PRESS_MS       80   /**< How long a customer holds the button */
+#define MCU_ACTIVE_MA      14.0 /**< Approx. ATmega2560 active current, 16 MHz / 5 V */
+#define MCU_IDLE_MA        4.0  /**< Approx. idle-mode current */
+#define MCU_PWR_DOWN_MA    0.001/**< Approx. power-down current */
+///@}
+
+/**
+ * @brief Draws a sequence of menu screens and reports bus traffic per frame.
+ */
+static void simulateDisplay(void) {
+    static const char *const juices[] = { "CLASSIC", "GINGER", "LEMON", "GINGER" };
+    char path[32];
+
+    oledInit(oledHostWritePage);
+    oledDrawLine(0, "SUGARCANE JUICE");
+    oledDrawLine(6, "TURN TO START");
+    printf("frame 0: %4u bytes (initial full refresh)\n", oledFlush());
+    oledHostDumpPbm("frame_0.pbm");
+
+    for (int i = 0; i < 4; i++) {
+        char line[OLED_CHARS_PER_LINE + 1];
+        snprintf(line, sizeof(line), ">JUICE: %s", juices[i]);
+        oledDrawLine(0, "SUGARCANE JUICE");  // Unchanged: costs nothing
+        oledDrawLine(2, line);
+        oledDrawLine(6, "TURN: JUICE");
+
+        snprintf(path, sizeof(path), "frame_%d.pbm", i + 1);
+        printf("frame %d: %4u bytes (full redraw: %d)\n", i + 1, oledFlush(), OLED_FB_SIZE);
+        oledHostDumpPbm(path);
+    }
+    printf("total bytes sent: %lu\n", (unsigned long)oledHostBytesWritten());
+}
+
+/** Port registers of the simulated ATmega2560 (see host_avr.h) */
+volatile uint8_t PIND, PORTD, DDRD;
+volatile uint8_t ADCSRA, ACSR, PRR0, EICRA, EIMSK;
+volatile uint8_t UCSR0A, UCSR0B, UCSR0C, UDR0;
+volatile uint16_t UBRR0;
+volatile uint8_t PINK, PORTK, DDRK, PCICR, PCMSK2;
+volatile uint8_t TWCR, TWDR, TWSR, TWBR;
+
+/** Scripted user of the menu: one action per "user" task run */
+typedef enum { USER_CW, USER_CCW, USER_SELECT, USER_CONFIRM, USER_RELEASE } UserAction;
+
+static const UserAction userScript[] = {
+    USER_CW, USER_CW, USER_CCW, USER_SELECT, USER_RELEASE, USER_CW, USER_CONFIRM, USER_RELEASE,
+};
+#define USER_SCRIPT_LEN (sizeof(userScript) / sizeof(userScript[0]))
+
+static const char *const userActionNames[] = {
+    [USER_CW] = "turn cw", [USER_CCW] = "turn ccw", [USER_SELECT] = "press select",
+    [USER_CONFIRM] = "press confirm", [USER_RELEASE] = "release",
+};
+static const char *const uiStateNames[NUM_UI_STATES] = {
+    [UI_IDLE] = "IDLE", [UI_MENU_SELECT] = "MENU_SELECT",
+    [UI_VOLUME_SELECT] = "VOLUME_SELECT", [UI_CONFIRMATION] = "CONFIRMATION",
+};
+static uint8_t userStep = 0;
+
+/** Encoder pin-change ISR (rotary_encoder.c) */
+void PCINT2_vect(void);
+
+/**
+ * @brief Turns the encoder one detent: four Gray-code edges, each raising the pin-change interrupt.
+ */
+static void turnEncoder(uint8_t cw) {
+    static const uint8_t cwSequence[4] = { 1, 3, 2, 0 }; // AB after each edge
+
+    for (uint8_t i = 0; i < 4; i++) {
+        uint8_t ab = cw ? cwSequence[i] : cwSequence[(6 - i) % 4];
+        PINK = (uint8_t)((PINK & ~((1 << ENCODER_A) | (1 << ENCODER_B))) |
+                         (((ab >> 1) & 1) << ENCODER_A) | ((ab & 1) << ENCODER_B));
+        PCINT2_vect();
+    }
+}
+
+/**
+ * @brief User task: reports what the previous action did, then performs the next one.
+ */
+static void userTask(void) {
+    static uint32_t lastBytes = 0;
+
+    if (userStep > USER_SCRIPT_LEN) {
+        return;
+    }
+    if (userStep > 0) {
+        printf("%-14s -> %-13s juice=%u volume=%u, %3lu bytes to the OLED\n",
+               userActionNames[userScript[userStep - 1]], uiStateNames[getUIState()],
+               getJuiceType(), getVolume(), (unsigned long)(oledHostBytesWritten() - lastBytes));
+    }
+    lastBytes = oledHostBytesWritten();
+
+    if (userStep < USER_SCRIPT_LEN) {
+        switch (userScript[userStep]) {
+        case USER_CW:      turnEncoder(1); break;
+        case USER_CCW:     turnEncoder(0); break;
+        case USER_SELECT:  UI_BUTTON_PIN &= (uint8_t)~(1 << ROTARY_SW); break;   // Active LOW
+        case USER_CONFIRM: UI_BUTTON_PIN &= (uint8_t)~(1 << CONFIRM_BTN); break;
+        case USER_RELEASE: UI_BUTTON_PIN |= (1 << ROTARY_SW) | (1 << CONFIRM_BTN); break;
+        }
+    }
+    userStep++;
+}
+
+/**
+ * @brief Runs the menu against the scripted user.
+ */
+static void simulateUI(void) {
+    static const TaskConfig uiTasks[] = {
+        { "ui",   readUserInput, 5,  5  },
+        { "user", userTask,      50, 50 },
+    };
+
+    PINK = (1 << ROTARY_SW) | (1 << CONFIRM_BTN);  // Released, encoder AB = 00
+    initUI();
+    oledInit(oledHostWritePage);                   // Host panel in place of the SSD1306
+    updateDisplay();
+
+    printf("\n");
+    schedulerInit(uiTasks, sizeof(uiTasks) / sizeof(uiTasks[0]));
+    schedulerPortInit();
+    while (userStep <= USER_SCRIPT_LEN) {
+        if (!schedulerRunOnce()) {
+            schedulerIdle();
+        }
+    }
+    oledHostDumpPbm("ui.pbm");
+
+    // The user walks away: the menu must return to UI_IDLE so the MCU can power down
+    uint32_t leftMs = schedulerMillis();
+    while (uiBusy()) {
+        if (!schedulerRunOnce()) {
+            schedulerIdle();
+        }
+    }
+    printf("%-14s -> %-13s juice=%u volume=%u after %lu ms, may power down (wake mask 0x%02X)\n",
+           "no input", uiStateNames[getUIState()], getJuiceType(), getVolume(),
+           (unsigned long)(schedulerMillis() - leftMs), PCMSK2);
+}
+
+/**
+ * @brief Spins for `us` microseconds to emulate task execution time.
+ */
+static void burn(uint32_t us) {
+    uint32_t start = schedulerPortMicros();
+    while (schedulerPortMicros() - start < us);
+}
+
+static void inputTask(void)     { burn(150); }  // Encoder + buttons
+static void fsmTask(void)       { burn(300); }  // Dispense state machine
+static void displayTask(void)   { burn(3500); } // Partial OLED flush over I2C
+static void telemetryTask(void) { burn(800); }  // UART export
+
+/**
+ * @brief Runs a representative task set and prints per-task statistics.
+ */
+static void simulateScheduler(void) {
+    static const TaskConfig simTasks[] = {
+        { "input",     inputTask,     5,   5   },
+        { "fsm",       fsmTask,       10,  10  },
+        { "display",   displayTask,   50,  50  },
+        { "telemetry", telemetryTask, 100, 100 },
+    };
+    const uint8_t n = sizeof(simTasks) / sizeof(simTasks[0]);
+
+    schedulerInit(simTasks, n);
+    schedulerPortInit();
+    while (schedulerMillis() < SIM_DURATION_MS) {
+        if (!schedulerRunOnce()) {
+            schedulerPortIdle();
+        }
+    }
+    uint32_t elapsedUs = schedulerPortMicros();
+
+    printf("\n%-10s %6s %6s %7s %8s %8s %10s %6s %6s\n",
+           "task", "period", "runs", "load%", "avg(us)", "max(us)", "jitter(us)", "miss", "skip");
+    for (uint8_t i = 0; i < n; i++) {
+        const TaskStats *st = schedulerGetStats(i);
+        printf("%-10s %6u %6lu %7.2f %8lu %8lu %10lu %6u %6u\n",
+               simTasks[i].name, simTasks[i].periodMs, (unsigned long)st->runs,
+               100.0 * st->busyUs / elapsedUs,
+               (unsigned long)(st->runs ? st->busyUs / st->runs : 0),
+               (unsigned long)st->maxRunUs, (unsigned long)st->maxJitterUs,
+               st->deadlineMisses, st->skippedReleases);
+    }
+}
+
+/** Simulated customer */
+typedef enum { CUSTOMER_AWAY, CUSTOMER_PRESSING, CUSTOMER_WAITING } CustomerPhase;
+
+static volatile sig_atomic_t customer = CUSTOMER_AWAY;
+static volatile uint32_t pressMs = 0;
+static uint8_t machineBusy = 0;
+static int cyclesDone = 0;
+static timer_t customerTimer;
+
+/**
+ * @brief "INT0": a customer pressed the button. Same latch as the firmware ISR.
+ */
+static void onCustomer(int sig) {
+    (void)sig;
+    if (cyclesDone == SIM_LOW_JUICE_CYCLE) {
+        PIND &= (uint8_t)~(1 << FLOAT_SWITCH);
+    } else {
+        PIND |= (1 << FLOAT_SWITCH);
+    }
+    PIND &= (uint8_t)~(1 << BUTTON_PIN);    // Active LOW
+    pressMs = schedulerMillis();
+    customer = CUSTOMER_PRESSING;
+    if (!buttonEdge) {
+        telemetryMarkButton(schedulerPortMicros());
+        buttonEdge = 1;
+    }
+}
+
+/**
+ * @brief Schedules the next customer press SIM_CUSTOMER_GAP_MS from now.
+ */
+static void armCustomer(void) {
+    struct itimerspec shot = { { 0, 0 }, { SIM_CUSTOMER_GAP_MS / 1000, (SIM_CUSTOMER_GAP_MS % 1000) * 1000000L } };
+    timer_settime(customerTimer, 0, &shot, NULL);
+}
+
+/**
+ * @brief Customer task: releases the button and comes back once the machine is done.
+ */
+static void customerTask(void) {
+    if (customer == CUSTOMER_PRESSING && schedulerMillis() - pressMs >= SIM_PRESS_MS) {
+        PIND |= (1 << BUTTON_PIN);
+        customer = CUSTOMER_WAITING;
+    }
+    if (getMachineState() != IDLE) {
+        machineBusy = 1;
+    } else if (customer == CUSTOMER_WAITING && machineBusy) {
+        machineBusy = 0;
+        customer = CUSTOMER_AWAY;
+        if (++cyclesDone < SIM_CYCLES) {
+            armCustomer();
+        }
+    }
+}
+
+/**
+ * @brief Buzzer task, as in main.c.
+ */
+static void buzzerTask(void) {
+    updateBuzzer(schedulerMillis());
+}
+
+/**
+ * @brief Quiescent hook: the firmware's conditions, and no customer at the machine.
+ */
+static uint8_t simQuiescent(void) {
+    return getMachineState() == IDLE && !buttonPressed && !buzzerActive() && !debounceBusy() &&
+           customer == CUSTOMER_AWAY;
+}
+
+/**
+ * @brief Runs SIM_CYCLES customers through the firmware and reports where the time went.
+ */
+static void simulateLowPower(void) {
+    static const TaskConfig lpTasks[] = {
+        { "button",   debounceButton,  4,  4  },
+        { "fsm",      runStateMachine, 10, 10 },
+        { "buzz",     buzzerTask,      10, 10 },
+        { "customer", customerTask,    10, 10 },
+    };
+    struct sigaction sa;
+    struct sigevent sev;
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = onCustomer;
+    sa.sa_flags = SA_RESTART;
+    sigaction(SIGUSR1, &sa, NULL);
+    memset(&sev, 0, sizeof(sev));
+    sev.sigev_notify = SIGEV_SIGNAL;
+    sev.sigev_signo = SIGUSR1;
+    timer_create(CLOCK_MONOTONIC, &sev, &customerTimer);
+
+    initHardware();
+    PIND = (1 << BUTTON_PIN) | (1 << FLOAT_SWITCH);  // Released, tank full
+    initStateMachine();
+    schedulerInit(lpTasks, sizeof(lpTasks) / sizeof(lpTasks[0]));
+    schedulerSetQuiescentHook(simQuiescent);
+    schedulerPortInit();
+    uint32_t startUs = schedulerPortMicros();
+    armCustomer();
+
+    while (cyclesDone < SIM_CYCLES || !simQuiescent()) {
+        if (!schedulerRunOnce()) {
+            schedulerIdle();
+        }
+    }
+
+    const SleepStats *sl = schedulerGetSleepStats();
+    double totalMs = (schedulerPortMicros() - startUs) / 1000.0;
+    double idleMs = sl->idleUs / 1000.0;
+    double deepMs = sl->deepUs / 1000.0;
+    double activeMs = totalMs - idleMs - deepMs;
+    double chargeMAs = (activeMs * MCU_ACTIVE_MA + idleMs * MCU_IDLE_MA + deepMs * MCU_PWR_DOWN_MA) / 1000.0;
+
+    printf("\n%d cycles in %.0f ms: active %.1f%%, idle sleep %.1f%% (%lu), power-down %.1f%% (%lu)\n",
+           cyclesDone, totalMs, 100.0 * activeMs / totalMs, 100.0 * idleMs / totalMs,
+           (unsigned long)sl->idleSleeps, 100.0 * deepMs / totalMs, (unsigned long)sl->deepSleeps);
+    printf("est. MCU charge per cycle: %.2f mAs (always active: %.2f mAs)\n",
+           chargeMAs / cyclesDone, totalMs * MCU_ACTIVE_MA / 1000.0 / cyclesDone);
+}
+
+static void stdoutPutc(char c) {
+    putchar(c);
+}
+
+int main(void) {
+    simulateDisplay();
+    simulateUI();
+    simulateScheduler();
+    simulateLowPower();
+    printf("\n");
+    telemetryExport(stdoutPutc);
+    return 0;
+}
@@ -2,75 +2,122 @@
  * @file main.c
  * @brief Sugarcane Juice Vending Machine (MVP) - Main Control File
  * @author 
- * @version 1.1
+ * @version 1.3
  * @date 2025
  * 
  * @details
  * This firmware controls a simple vending machine that dispenses sugarcane juice. 
  * It follows a state machine model and interacts with hardware components via `hardware.h`.
+ * The transitions themselves live in `state_machine.c`.
+ *
+ * The main loop is the cooperative scheduler (`scheduler.h`): every activity
+ * is a periodic task with its own period and deadline. Build with
+ * `make VARIANT=mid` (-DMID_VARIANT) to add the rotary encoder / OLED user
+ * interface task.
+ * Between tasks the CPU sleeps; while the machine waits for a customer it
+ * powers down and is woken by the button (INT0) or the encoder and menu
+ * buttons (PCINT).
  *
  * Target Microcontroller: ATmega2560
  */
 
 #include "hardware.h"
-#include <util/delay.h>
+#include "state_machine.h"
+#include "scheduler.h"
+#include "telemetry.h"
+#include "debounce.h"
 #include <avr/interrupt.h>
 
-/** Global variable to track the machine's state */
-volatile State currentState = IDLE;
+#ifdef MID_VARIANT
+#include "ui_control.h"
+#endif
 
-/** Global flag to track button press event */
-volatile uint8_t buttonPressed = 0;
+/** Telemetry report being sent, one field at a time */
+static TelemetryCursor report;
+static uint8_t reportPending = 0;
 
 /**
- * @brief Interrupt Service Routine for Button Press
- * @details Debounces the button press and sets the event flag.
+ * @brief Telemetry task: starts a new report unless the last one is still going out.
  */
-ISR(INT0_vect) {
-    _delay_ms(50); // Simple debounce delay
-    if (!(PIND & (1 << BUTTON_PIN))) {
-        buttonPressed = 1;
+static void startTelemetry(void) {
+    if (!reportPending) {
+        telemetryExportBegin(&report);
+        reportPending = 1;
     }
 }
 
 /**
- * @brief Main function implementing the state machine loop.
+ * @brief UART task: queues report fields while the TX ring has room for one.
+ * @details The UDRE interrupt drains the ring, so this never waits on the
+ * line and formats at most UART_TX_BUFFER characters per run.
  */
-int main(void) {
-    initHardware();  // Initialize hardware components
+static void sendTelemetry(void) {
+    while (reportPending && uartTxFree() >= TM_MAX_FIELD) {
+        reportPending = telemetryExportStep(&report, uartPutc);
+    }
+}
 
-    while (1) {
-        switch (currentState) {
-            case IDLE:
-                updateLEDStatus();
-                if (buttonPressed) {
-                    currentState = CHECK_JUICE_LEVEL;
-                    buttonPressed = 0;
-                }
-                break;
+/**
+ * @brief Buzzer task: advances the beep pattern started by the state machine.
+ */
+static void runBuzzer(void) {
+    updateBuzzer(schedulerMillis());
+}
 
-            case CHECK_JUICE_LEVEL:
-                if (PIND & (1 << FLOAT_SWITCH)) {  // Check if juice is available
-                    currentState = DISPENSING;
-                    startDispensing();
-                } else {
-                    PORTD |= (1 << ORANGE_LED);  // Indicate low juice warning
-                    playBuzzerSound(1); // Fast beeps for low juice warning
-                    currentState = IDLE;
-                }
-                break;
+/** Task table: earlier entries have higher priority */
+static const TaskConfig tasks[] = {
+    /* name     body              period  deadline (ms) */
+#ifdef MID_VARIANT
+    { "ui",     readUserInput,    5,      5  },
+#endif
+    { "button", debounceButton,   4,      4  },
+    { "fsm",    runStateMachine,  10,     10 },
+    { "buzz",   runBuzzer,        10,     10 },
+    { "tm",     startTelemetry,   60000,  10 },
+    { "tx",     sendTelemetry,    10,     10 },
+};
 
-            case DISPENSING:
-                _delay_ms(DISPENSE_TIME_MS); // Simulate dispensing time
-                stopDispensing();
-                playBuzzerSound(2); // Single long beep for completion
-                currentState = COMPLETION;
-                break;
+/**
+ * @brief Interrupt Service Routine for Button Press
+ * @details Only latches the edge and its time; the "button" task debounces.
+ */
+ISR(INT0_vect) {
+    if (!buttonEdge) {
+        telemetryMarkButton(schedulerPortMicros());
+        buttonEdge = 1;
+    }
+}
 
-            case COMPLETION:
-                _delay_ms(COOLDOWN_TIME_MS); // Cooldown before allowing next dispense
-                currentState = IDLE;
-                break;
-        }
+/**
+ * @brief Quiescent hook: nothing pending, nothing being timed.
+ * @return 1 if the MCU may power down until the next external interrupt.
+ */
+static uint8_t machineQuiescent(void) {
+    if (getMachineState() != IDLE || buttonPressed || buzzerActive() || debounceBusy() ||
+        reportPending || uartTxBusy()) {
+        return 0;
+    }
+#ifdef MID_VARIANT
+    if (uiBusy()) {
+        return 0;
     }
+#endif
+    return 1;
+}
+
+/**
+ * @brief Main function: initializes the system and runs the scheduler.
+ */
+int main(void) {
+    initHardware();      // Initialize hardware components
+    initUART();          // Telemetry export
+    initStateMachine();  // Enter IDLE
+#ifdef MID_VARIANT
+    initUI();            // Rotary encoder, buttons, OLED
+#endif
+
+    schedulerInit(tasks, sizeof(tasks) / sizeof(tasks[0]));
+    schedulerSetQuiescentHook(machineQuiescent);
+    schedulerPortInit(); // 1 ms timer tick
+    schedulerRun();      // Never returns
 }
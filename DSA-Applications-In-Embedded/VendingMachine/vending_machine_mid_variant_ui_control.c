@@ -2,24 +2,188 @@
  * @file ui_control.c
  * @brief Implementation of User Interface for Sugarcane Juice Vending Machine
  * @author 
- * @version 1.0
+ * @version 1.1
  * @date 2025
  *
  * @details
  * This module handles user input from a rotary encoder and buttons.
  * It also updates the OLED display for menu navigation and user feedback.
+ * Inputs are turned into `UIEvent`s and dispatched through a constant
+ * transition table (see `fsm.h`). Encoder edges are counted by the
+ * pin-change ISR in `rotary_encoder.c`; buttons use a shift-register
+ * debounce sampled on every call, so nothing here blocks. After
+ * UI_IDLE_TIMEOUT_MS without input the menu falls back to UI_IDLE and the
+ * selection is reset for the next customer. The OLED is
+ * drawn into a framebuffer and only changed bytes are sent (see
+ * `oled_display.h`).
  */
 
 #include "ui_control.h"
-#include <util/delay.h>
+#include "fsm.h"
+#include "rotary_encoder.h"
+#include "oled_display.h"
+#include "oled_ssd1306.h"
+#include "scheduler.h"
+#include <stddef.h>
+#include <string.h>
 
-/** Global variable to track UI state */
-static UIState currentUIState = UI_IDLE;
+#define NUM_JUICE_TYPES 3 /**< Number of selectable juice types */
+#define NUM_VOLUMES     3 /**< Number of selectable volumes */
+
+/** Menu texts */
+static const char *const juiceNames[NUM_JUICE_TYPES] = { "CLASSIC", "GINGER", "LEMON" };
+static const char *const volumeNames[NUM_VOLUMES + 1] = { "", "SMALL", "MEDIUM", "LARGE" };
+static const char *const statePrompts[NUM_UI_STATES] = {
+    [UI_IDLE]          = "TURN TO START",
+    [UI_MENU_SELECT]   = "TURN: JUICE",
+    [UI_VOLUME_SELECT] = "TURN: SIZE",
+    [UI_CONFIRMATION]  = "CONFIRMED",
+};
+
+/** UI state machine instance */
+static Fsm uiMachine;
 
 /** Global variables to track user selection */
 static uint8_t juiceType = 0;  /**< Selected juice type index */
 static uint8_t volume = 1;     /**< Selected volume: 1=Small, 2=Medium, 3=Large */
 
+/** Time of the last encoder step or button press */
+static uint32_t lastInputMs = 0;
+
+/**
+ * @brief Debounce state of one active-low button.
+ */
+typedef struct {
+    uint8_t history;  /**< Last samples, 1 = released */
+    uint8_t released; /**< Debounced state, 1 = released */
+} ButtonDebounce;
+
+static ButtonDebounce selectButton = { 0xFF, 1 };
+static ButtonDebounce confirmButton = { 0xFF, 1 };
+
+/**
+ * @brief Samples one button and reports a debounced press edge.
+ * @param btn      Debounce state of the button.
+ * @param released Raw pin level (non-zero = released).
+ * @return 1 on the transition to a stable press, 0 otherwise.
+ */
+static uint8_t buttonPressedEdge(ButtonDebounce *btn, uint8_t released) {
+    btn->history = (uint8_t)((btn->history << 1) | (released ? 1 : 0));
+
+    if ((btn->history & BUTTON_DEBOUNCE_MASK) == 0 && btn->released) {
+        btn->released = 0;
+        return 1;
+    }
+    if ((btn->history & BUTTON_DEBOUNCE_MASK) == BUTTON_DEBOUNCE_MASK) {
+        btn->released = 1;
+    }
+    return 0;
+}
+
+/* ---------------- Guards ---------------- */
+
+static uint8_t canStepJuiceBack(void *ctx) {
+    (void)ctx;
+    return juiceType > 0;
+}
+
+/* ---------------- Actions ---------------- */
+
+/*
+ * Transition actions run before the state changes, so they only update the
+ * selection: the new screen is drawn by the entry action, or by
+ * readUserInput() after an internal transition.
+ */
+
+static void redraw(void *ctx) {
+    (void)ctx;
+    updateDisplay();
+}
+
+static void nextJuice(void *ctx) {
+    (void)ctx;
+    juiceType = (juiceType + 1) % NUM_JUICE_TYPES;  // Cycle through juice options
+}
+
+static void prevJuice(void *ctx) {
+    (void)ctx;
+    juiceType--;  // Cycle backwards (guarded by canStepJuiceBack)
+}
+
+static void nextVolume(void *ctx) {
+    (void)ctx;
+    volume = (volume % NUM_VOLUMES) + 1;  // Cycle through volume options
+}
+
+static void prevVolume(void *ctx) {
+    (void)ctx;
+    volume = (volume > 1) ? volume - 1 : NUM_VOLUMES;
+}
+
+static void resetSelection(void *ctx) {
+    (void)ctx;
+    juiceType = 0;
+    volume = 1;
+}
+
+/* ---------------- Tables ---------------- */
+
+#define NONE { FSM_NO_TRANSITION, NULL, NULL }
+
+/** Transition table, indexed by [state][event] */
+static const FsmTransition uiTransitions[NUM_UI_STATES][NUM_UI_EVENTS] = {
+    [UI_IDLE] = {
+        [UI_EV_ROTATE_CW]  = { UI_MENU_SELECT, NULL, nextJuice },
+        [UI_EV_ROTATE_CCW] = { UI_MENU_SELECT, canStepJuiceBack, prevJuice },
+        [UI_EV_SELECT]     = { UI_VOLUME_SELECT, NULL, nextVolume },
+        [UI_EV_CONFIRM]    = { UI_CONFIRMATION, NULL, NULL },
+        [UI_EV_TIMEOUT]    = NONE,
+    },
+    [UI_MENU_SELECT] = {
+        [UI_EV_ROTATE_CW]  = { UI_MENU_SELECT, NULL, nextJuice },
+        [UI_EV_ROTATE_CCW] = { UI_MENU_SELECT, canStepJuiceBack, prevJuice },
+        [UI_EV_SELECT]     = { UI_VOLUME_SELECT, NULL, nextVolume },
+        [UI_EV_CONFIRM]    = { UI_CONFIRMATION, NULL, NULL },
+        [UI_EV_TIMEOUT]    = { UI_IDLE, NULL, resetSelection },
+    },
+    [UI_VOLUME_SELECT] = {
+        [UI_EV_ROTATE_CW]  = { UI_VOLUME_SELECT, NULL, nextVolume },
+        [UI_EV_ROTATE_CCW] = { UI_VOLUME_SELECT, NULL, prevVolume },
+        [UI_EV_SELECT]     = { UI_VOLUME_SELECT, NULL, nextVolume },
+        [UI_EV_CONFIRM]    = { UI_CONFIRMATION, NULL, NULL },
+        [UI_EV_TIMEOUT]    = { UI_IDLE, NULL, resetSelection },
+    },
+    [UI_CONFIRMATION] = {
+        [UI_EV_ROTATE_CW]  = { UI_MENU_SELECT, NULL, nextJuice },
+        [UI_EV_ROTATE_CCW] = { UI_MENU_SELECT, canStepJuiceBack, prevJuice },
+        [UI_EV_SELECT]     = { UI_VOLUME_SELECT, NULL, nextVolume },
+        [UI_EV_CONFIRM]    = NONE,
+        [UI_EV_TIMEOUT]    = { UI_IDLE, NULL, resetSelection },
+    },
+};
+
+/** Entry actions, indexed by `UIState`: every new screen is redrawn */
+static const FsmStateActions uiStateActions[NUM_UI_STATES] = {
+    [UI_IDLE]          = { redraw, NULL },
+    [UI_MENU_SELECT]   = { redraw, NULL },
+    [UI_VOLUME_SELECT] = { redraw, NULL },
+    [UI_CONFIRMATION]  = { redraw, NULL },
+};
+
+static const FsmDefinition uiMachineDef = {
+    &uiTransitions[0][0], uiStateActions, NUM_UI_STATES, NUM_UI_EVENTS
+};
+
+/**
+ * @brief Dispatches one UI event.
+ * @return 1 if it was an internal transition, whose screen is not redrawn yet.
+ */
+static uint8_t dispatchEvent(uint8_t event) {
+    uint8_t before = fsmState(&uiMachine);
+
+    return fsmDispatch(&uiMachine, event) && fsmState(&uiMachine) == before;
+}
+
 /**
  * @brief Initializes the user interface components.
  *
@@ -27,59 +191,124 @@ static uint8_t volume = 1;     /**< Selected volume: 1=Small, 2=Medium, 3=Large
  */
 void initUI(void) {
     // Set pin directions
-    DDRC &= ~(1 << ROTARY_CLK);  // Rotary encoder CLK as input
-    DDRC &= ~(1 << ROTARY_DT);   // Rotary encoder DT as input
-    DDRC &= ~(1 << ROTARY_SW);   // Rotary encoder button as input
-    DDRC &= ~(1 << CONFIRM_BTN); // Confirmation button as input
+    UI_BUTTON_DDR &= ~(1 << ROTARY_SW);   // Rotary encoder button as input
+    UI_BUTTON_DDR &= ~(1 << CONFIRM_BTN); // Confirmation button as input
 
     // Enable internal pull-up resistors
-    PORTC |= (1 << ROTARY_CLK) | (1 << ROTARY_DT) | (1 << ROTARY_SW) | (1 << CONFIRM_BTN);
+    UI_BUTTON_PORT |= (1 << ROTARY_SW) | (1 << CONFIRM_BTN);
 
-    // Initialize OLED display (placeholder function)
-    updateDisplay();
+    // Rotary encoder A/B lines and pin-change interrupt
+    encoderInit();
+
+    // Button presses raise the same pin-change interrupt: they wake the MCU too
+    PCMSK2 |= (1 << PCINT18) | (1 << PCINT19);
+
+    // OLED controller and framebuffer
+    ssd1306Init();
+    oledInit(ssd1306WritePage);
+
+    // Enter UI_IDLE, which draws the initial OLED screen
+    fsmInit(&uiMachine, &uiMachineDef, UI_IDLE, NULL);
 }
 
 /**
  * @brief Reads user input from rotary encoder and buttons.
  *
- * Updates selection variables and detects confirmation.
+ * Converts inputs into UI events and dispatches them to the UI state machine.
+ * Selection changes within a screen are drawn once, after all events.
  */
 void readUserInput(void) {
-    static uint8_t lastRotaryState = 0;
-
-    uint8_t rotaryState = PINC & (1 << ROTARY_CLK);
-    if (rotaryState != lastRotaryState) {
-        if (PINC & (1 << ROTARY_DT)) {
-            juiceType = (juiceType + 1) % 3;  // Cycle through juice options
-        } else {
-            if (juiceType > 0) juiceType--;  // Cycle backwards
-        }
-        updateDisplay();  // Update OLED with new selection
+    uint32_t now = schedulerMillis();
+    int16_t steps = encoderReadSteps();
+    uint8_t event = (steps > 0) ? UI_EV_ROTATE_CW : UI_EV_ROTATE_CCW;
+    uint8_t changed = 0;
+
+    if (steps != 0) {
+        lastInputMs = now;
+    }
+    if (steps < 0) {
+        steps = -steps;
+    }
+    if (steps > UI_MAX_STEPS_PER_POLL) {
+        steps = UI_MAX_STEPS_PER_POLL;
+    }
+    while (steps-- > 0) {
+        changed |= dispatchEvent(event);
     }
-    lastRotaryState = rotaryState;
 
     // Check rotary encoder button press
-    if (!(PINC & (1 << ROTARY_SW))) {
-        volume = (volume % 3) + 1;  // Cycle through volume options
-        updateDisplay();
-        _delay_ms(200);  // Debounce delay
+    if (buttonPressedEdge(&selectButton, UI_BUTTON_PIN & (1 << ROTARY_SW))) {
+        lastInputMs = now;
+        changed |= dispatchEvent(UI_EV_SELECT);
     }
 
     // Check confirmation button press
-    if (!(PINC & (1 << CONFIRM_BTN))) {
-        currentUIState = UI_CONFIRMATION;
+    if (buttonPressedEdge(&confirmButton, UI_BUTTON_PIN & (1 << CONFIRM_BTN))) {
+        lastInputMs = now;
+        changed |= dispatchEvent(UI_EV_CONFIRM);
+    }
+
+    // Nobody at the menu: back to UI_IDLE (drawn by its entry action)
+    if (fsmState(&uiMachine) != UI_IDLE && now - lastInputMs >= UI_IDLE_TIMEOUT_MS) {
+        dispatchEvent(UI_EV_TIMEOUT);
+    }
+
+    if (changed) {
         updateDisplay();
-        _delay_ms(200);  // Debounce delay
     }
 }
 
 /**
  * @brief Updates the OLED display with current menu selection.
  *
- * Shows juice type, quantity, and confirmation options.
+ * Shows juice type, quantity, and confirmation options. Lines are redrawn
+ * into the framebuffer; only the bytes that changed are sent to the OLED.
  */
 void updateDisplay(void) {
-    // Placeholder function to update OLED display
-    // In actual implementation, use I2C/SPI commands to send text to OLED
+    char line[OLED_CHARS_PER_LINE + 1];
+    UIState state = (UIState)fsmState(&uiMachine);
+
+    oledDrawLine(0, "SUGARCANE JUICE");
+
+    strcpy(line, (state == UI_MENU_SELECT) ? ">JUICE: " : " JUICE: ");
+    strcat(line, juiceNames[juiceType]);
+    oledDrawLine(2, line);
+
+    strcpy(line, (state == UI_VOLUME_SELECT) ? ">SIZE:  " : " SIZE:  ");
+    strcat(line, volumeNames[volume]);
+    oledDrawLine(3, line);
+
+    oledDrawLine(6, statePrompts[state]);
+    oledFlush();
+}
+
+/**
+ * @brief Returns the current UI state.
+ */
+UIState getUIState(void) {
+    return (UIState)fsmState(&uiMachine);
 }
 
+/**
+ * @brief Returns 1 while the menu needs the CPU awake.
+ */
+uint8_t uiBusy(void) {
+    uint8_t released = (1 << ROTARY_SW) | (1 << CONFIRM_BTN);
+
+    return fsmState(&uiMachine) != UI_IDLE || (UI_BUTTON_PIN & released) != released ||
+           !selectButton.released || !confirmButton.released || encoderPending();
+}
+
+/**
+ * @brief Returns the selected juice type index.
+ */
+uint8_t getJuiceType(void) {
+    return juiceType;
+}
+
+/**
+ * @brief Returns the selected volume (1=Small, 2=Medium, 3=Large).
+ */
+uint8_t getVolume(void) {
+    return volume;
+}
@@ -2,25 +2,43 @@
  * @file ui_control.h
  * @brief User Interface Module for Sugarcane Juice Vending Machine
  * @author 
- * @version 1.0
+ * @version 1.1
  * @date 2025
  *
  * @details
  * This module handles user input via a rotary encoder and buttons.
  * It also updates the OLED display for menu navigation.
+ * Menu navigation is a table-driven state machine (see `fsm.h`).
+ * The rotary encoder is decoded in an interrupt (see `rotary_encoder.h`) and
+ * the buttons are debounced without blocking delays. Without input the menu
+ * returns to UI_IDLE after UI_IDLE_TIMEOUT_MS, so the machine can power down
+ * again; a turn or a button press wakes it through the pin-change interrupt.
  */
 
 #ifndef UI_CONTROL_H
 #define UI_CONTROL_H
 
 #include <avr/io.h>
+#include <stdint.h>
 
 /** @defgroup UI Hardware Pins */
 ///@{
-#define ROTARY_CLK     PC0 /**< Rotary Encoder Clock Pin */
-#define ROTARY_DT      PC1 /**< Rotary Encoder Data Pin */
-#define ROTARY_SW      PC2 /**< Rotary Encoder Button */
-#define CONFIRM_BTN    PC3 /**< Confirmation Button */
+#define UI_BUTTON_PIN  PINK  /**< Input register of the UI buttons */
+#define UI_BUTTON_PORT PORTK /**< Port register (pull-ups) */
+#define UI_BUTTON_DDR  DDRK  /**< Direction register */
+#define ROTARY_SW      PK2   /**< Rotary Encoder Button (PCINT18) */
+#define CONFIRM_BTN    PK3   /**< Confirmation Button (PCINT19) */
+///@}
+// The buttons share PORTK with the encoder A/B lines (rotary_encoder.h): PORTC has
+// no pin-change interrupts, and only a pin change wakes the MCU from power-down.
+
+/** @defgroup UI Input Configuration */
+///@{
+#define BUTTON_DEBOUNCE_MASK   0x0F /**< Consecutive equal samples required (4) */
+#define UI_MAX_STEPS_PER_POLL  8    /**< Cap on menu steps dispatched per call */
+#ifndef UI_IDLE_TIMEOUT_MS
+#define UI_IDLE_TIMEOUT_MS     30000 /**< Inactivity before the menu returns to UI_IDLE */
+#endif
 ///@}
 
 /** @defgroup OLED Display Definitions */
@@ -35,10 +53,23 @@ typedef enum {
     UI_IDLE,          /**< Default state */
     UI_MENU_SELECT,   /**< User selecting juice type */
     UI_VOLUME_SELECT, /**< User selecting quantity */
-    UI_CONFIRMATION   /**< User confirms selection */
+    UI_CONFIRMATION,  /**< User confirms selection */
+    NUM_UI_STATES
 } UIState;
 ///@}
 
+/** @defgroup UI Events */
+///@{
+typedef enum {
+    UI_EV_ROTATE_CW,  /**< Rotary encoder turned clockwise */
+    UI_EV_ROTATE_CCW, /**< Rotary encoder turned counter-clockwise */
+    UI_EV_SELECT,     /**< Rotary encoder button pressed */
+    UI_EV_CONFIRM,    /**< Confirmation button pressed */
+    UI_EV_TIMEOUT,    /**< No input for UI_IDLE_TIMEOUT_MS */
+    NUM_UI_EVENTS
+} UIEvent;
+///@}
+
 /** 
  * @brief Initializes the user interface components.
  *
@@ -49,7 +80,8 @@ void initUI(void);
 /** 
  * @brief Reads user input from rotary encoder and buttons.
  *
- * Updates selection variables and detects confirmation.
+ * Updates selection variables and detects confirmation. Never blocks; call it
+ * periodically (every few milliseconds) so the button debounce can sample.
  */
 void readUserInput(void);
 
@@ -60,4 +92,27 @@ void readUserInput(void);
  */
 void updateDisplay(void);
 
+/**
+ * @brief Returns the current UI state.
+ */
+UIState getUIState(void);
+
+/**
+ * @brief Returns 1 while the menu needs the CPU awake.
+ *
+ * Busy outside UI_IDLE, while a button is down or not yet debounced as
+ * released, and while encoder detents wait for readUserInput().
+ */
+uint8_t uiBusy(void);
+
+/**
+ * @brief Returns the selected juice type index.
+ */
+uint8_t getJuiceType(void);
+
+/**
+ * @brief Returns the selected volume (1=Small, 2=Medium, 3=Large).
+ */
+uint8_t getVolume(void);
+
 #endif // UI_CONTROL_H
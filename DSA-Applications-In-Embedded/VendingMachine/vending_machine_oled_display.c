@@ -0,0 +1,185 @@
+/**
+ * @file oled_display.c
+ * @brief Implementation of the OLED Framebuffer, Glyph Renderer and Dirty Tracking
+ * @author 
+ * @version 1.0
+ * @date 2025
+ *
+ * @details
+ * Every write compares against the framebuffer first, so redrawing unchanged
+ * text marks nothing dirty. Each page keeps the lowest and highest changed
+ * column; `oledFlush()` sends that range and resets it.
+ */
+
+#include "oled_display.h"
+#include <stddef.h>
+
+#ifdef __AVR__
+#include <avr/pgmspace.h>
+#else
+#define PROGMEM
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#endif
+
+#define FONT_FIRST ' '  /**< First glyph in the font table */
+#define FONT_LAST  'Z'  /**< Last glyph in the font table */
+#define NOT_DIRTY  0xFF /**< dirtyLo value of a clean page */
+
+/** 5x7 font, one byte per column (LSB = top row), ' ' .. 'Z' */
+static const uint8_t font5x7[][5] PROGMEM = {
+    {0x00,0x00,0x00,0x00,0x00}, {0x00,0x00,0x5F,0x00,0x00}, {0x00,0x07,0x00,0x07,0x00}, // ' ' ! "
+    {0x14,0x7F,0x14,0x7F,0x14}, {0x24,0x2A,0x7F,0x2A,0x12}, {0x23,0x13,0x08,0x64,0x62}, // # $ %
+    {0x36,0x49,0x55,0x22,0x50}, {0x00,0x05,0x03,0x00,0x00}, {0x00,0x1C,0x22,0x41,0x00}, // & ' (
+    {0x00,0x41,0x22,0x1C,0x00}, {0x08,0x2A,0x1C,0x2A,0x08}, {0x08,0x08,0x3E,0x08,0x08}, // ) * +
+    {0x00,0x50,0x30,0x00,0x00}, {0x08,0x08,0x08,0x08,0x08}, {0x00,0x60,0x60,0x00,0x00}, // , - .
+    {0x20,0x10,0x08,0x04,0x02}, {0x3E,0x51,0x49,0x45,0x3E}, {0x00,0x42,0x7F,0x40,0x00}, // / 0 1
+    {0x42,0x61,0x51,0x49,0x46}, {0x21,0x41,0x45,0x4B,0x31}, {0x18,0x14,0x12,0x7F,0x10}, // 2 3 4
+    {0x27,0x45,0x45,0x45,0x39}, {0x3C,0x4A,0x49,0x49,0x30}, {0x01,0x71,0x09,0x05,0x03}, // 5 6 7
+    {0x36,0x49,0x49,0x49,0x36}, {0x06,0x49,0x49,0x29,0x1E}, {0x00,0x36,0x36,0x00,0x00}, // 8 9 :
+    {0x00,0x56,0x36,0x00,0x00}, {0x00,0x08,0x14,0x22,0x41}, {0x14,0x14,0x14,0x14,0x14}, // ; < =
+    {0x41,0x22,0x14,0x08,0x00}, {0x02,0x01,0x51,0x09,0x06}, {0x32,0x49,0x79,0x41,0x3E}, // > ? @
+    {0x7E,0x11,0x11,0x11,0x7E}, {0x7F,0x49,0x49,0x49,0x36}, {0x3E,0x41,0x41,0x41,0x22}, // A B C
+    {0x7F,0x41,0x41,0x22,0x1C}, {0x7F,0x49,0x49,0x49,0x41}, {0x7F,0x09,0x09,0x01,0x01}, // D E F
+    {0x3E,0x41,0x41,0x51,0x32}, {0x7F,0x08,0x08,0x08,0x7F}, {0x00,0x41,0x7F,0x41,0x00}, // G H I
+    {0x20,0x40,0x41,0x3F,0x01}, {0x7F,0x08,0x14,0x22,0x41}, {0x7F,0x40,0x40,0x40,0x40}, // J K L
+    {0x7F,0x02,0x04,0x02,0x7F}, {0x7F,0x04,0x08,0x10,0x7F}, {0x3E,0x41,0x41,0x41,0x3E}, // M N O
+    {0x7F,0x09,0x09,0x09,0x06}, {0x3E,0x41,0x51,0x21,0x5E}, {0x7F,0x09,0x19,0x29,0x46}, // P Q R
+    {0x46,0x49,0x49,0x49,0x31}, {0x01,0x01,0x7F,0x01,0x01}, {0x3F,0x40,0x40,0x40,0x3F}, // S T U
+    {0x1F,0x20,0x40,0x20,0x1F}, {0x7F,0x20,0x18,0x20,0x7F}, {0x63,0x14,0x08,0x14,0x63}, // V W X
+    {0x03,0x04,0x78,0x04,0x03}, {0x61,0x51,0x49,0x45,0x43}                              // Y Z
+};
+
+/** Framebuffer in SSD1306 page layout */
+static uint8_t framebuffer[OLED_PAGES][OLED_COLUMNS];
+
+/** Dirty column range of each page (dirtyLo == NOT_DIRTY means clean) */
+static uint8_t dirtyLo[OLED_PAGES];
+static uint8_t dirtyHi[OLED_PAGES];
+
+/** Transport used by oledFlush() */
+static OledWriteFn transport = NULL;
+
+/**
+ * @brief Stores one framebuffer byte and widens the dirty range if it changed.
+ */
+static void putByte(uint8_t page, uint8_t column, uint8_t value) {
+    if (framebuffer[page][column] == value) {
+        return;
+    }
+    framebuffer[page][column] = value;
+
+    if (dirtyLo[page] == NOT_DIRTY) {
+        dirtyLo[page] = column;
+        dirtyHi[page] = column;
+    } else if (column < dirtyLo[page]) {
+        dirtyLo[page] = column;
+    } else if (column > dirtyHi[page]) {
+        dirtyHi[page] = column;
+    }
+}
+
+/**
+ * @brief Initializes the framebuffer and marks the whole screen dirty.
+ */
+void oledInit(OledWriteFn write) {
+    transport = write;
+    for (uint8_t page = 0; page < OLED_PAGES; page++) {
+        for (uint8_t col = 0; col < OLED_COLUMNS; col++) {
+            framebuffer[page][col] = 0;
+        }
+        // Panel RAM is undefined after power-up: push everything once
+        dirtyLo[page] = 0;
+        dirtyHi[page] = OLED_COLUMNS - 1;
+    }
+}
+
+/**
+ * @brief Clears the framebuffer (only non-blank bytes become dirty).
+ */
+void oledClear(void) {
+    for (uint8_t page = 0; page < OLED_PAGES; page++) {
+        for (uint8_t col = 0; col < OLED_COLUMNS; col++) {
+            putByte(page, col, 0);
+        }
+    }
+}
+
+/**
+ * @brief Sets or clears one pixel.
+ */
+void oledSetPixel(uint8_t x, uint8_t y, uint8_t on) {
+    if (x >= OLED_COLUMNS || y >= OLED_PAGES * 8) {
+        return;
+    }
+    uint8_t page = y >> 3;
+    uint8_t mask = (uint8_t)(1 << (y & 7));
+    uint8_t value = framebuffer[page][x];
+
+    putByte(page, x, on ? (uint8_t)(value | mask) : (uint8_t)(value & ~mask));
+}
+
+/**
+ * @brief Draws one character on a page-aligned text line.
+ */
+void oledDrawChar(uint8_t column, uint8_t page, char c) {
+    if (page >= OLED_PAGES || column > OLED_COLUMNS - OLED_GLYPH_WIDTH) {
+        return;
+    }
+    if (c >= 'a' && c <= 'z') {
+        c = (char)(c - 'a' + 'A');
+    }
+    if (c < FONT_FIRST || c > FONT_LAST) {
+        c = '?';
+    }
+
+    const uint8_t *glyph = font5x7[c - FONT_FIRST];
+    for (uint8_t i = 0; i < 5; i++) {
+        putByte(page, (uint8_t)(column + i), pgm_read_byte(&glyph[i]));
+    }
+    putByte(page, (uint8_t)(column + 5), 0); // Spacing column
+}
+
+/**
+ * @brief Draws a string on a text line, clearing the rest of the line.
+ */
+void oledDrawLine(uint8_t page, const char *str) {
+    uint8_t column = 0;
+
+    if (page >= OLED_PAGES) {
+        return;
+    }
+    while (*str != '\0' && column <= OLED_COLUMNS - OLED_GLYPH_WIDTH) {
+        oledDrawChar(column, page, *str++);
+        column += OLED_GLYPH_WIDTH;
+    }
+    while (column < OLED_COLUMNS) {
+        putByte(page, column++, 0);
+    }
+}
+
+/**
+ * @brief Pushes all dirty column ranges to the display.
+ */
+uint16_t oledFlush(void) {
+    uint16_t sent = 0;
+
+    for (uint8_t page = 0; page < OLED_PAGES; page++) {
+        if (dirtyLo[page] == NOT_DIRTY) {
+            continue;
+        }
+        uint8_t len = (uint8_t)(dirtyHi[page] - dirtyLo[page] + 1);
+        if (transport != NULL) {
+            transport(page, dirtyLo[page], &framebuffer[page][dirtyLo[page]], len);
+        }
+        sent += len;
+        dirtyLo[page] = NOT_DIRTY;
+    }
+    return sent;
+}
+
+/**
+ * @brief Returns a pointer to the framebuffer (read-only).
+ */
+const uint8_t *oledFramebuffer(void) {
+    return &framebuffer[0][0];
+}
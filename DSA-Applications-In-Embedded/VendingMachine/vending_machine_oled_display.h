@@ -0,0 +1,81 @@
+/**
+ * @file oled_display.h
+ * @brief Framebuffer and Incremental Refresh for the 128x64 OLED
+ * @author 
+ * @version 1.0
+ * @date 2025
+ *
+ * @details
+ * The display contents are kept in a 1 KB framebuffer laid out like the
+ * SSD1306 GDDRAM: 8 pages of 128 columns, one byte = 8 vertical pixels.
+ * Drawing only touches RAM and records, per page, the range of columns that
+ * actually changed. `oledFlush()` then pushes just those ranges through a
+ * transport callback (I2C on the target, PBM dump on the host), so a menu
+ * change costs a few dozen bytes instead of a full 1 KB redraw.
+ */
+
+#ifndef OLED_DISPLAY_H
+#define OLED_DISPLAY_H
+
+#include <stdint.h>
+
+/** @defgroup OLED Geometry */
+///@{
+#define OLED_COLUMNS    128                     /**< Display width in pixels */
+#define OLED_PAGES      8                       /**< 8-pixel high pages */
+#define OLED_FB_SIZE    (OLED_COLUMNS * OLED_PAGES) /**< Framebuffer size in bytes */
+#define OLED_GLYPH_WIDTH 6                      /**< 5 font columns + 1 spacing column */
+#define OLED_CHARS_PER_LINE (OLED_COLUMNS / OLED_GLYPH_WIDTH)
+///@}
+
+/**
+ * @brief Transport callback: writes `len` bytes to `page` starting at `column`.
+ */
+typedef void (*OledWriteFn)(uint8_t page, uint8_t column, const uint8_t *data, uint8_t len);
+
+/**
+ * @brief Initializes the framebuffer and marks the whole screen dirty.
+ * @param write Transport used by oledFlush().
+ */
+void oledInit(OledWriteFn write);
+
+/**
+ * @brief Clears the framebuffer (only non-blank bytes become dirty).
+ */
+void oledClear(void);
+
+/**
+ * @brief Sets or clears one pixel.
+ * @param x  Column (0..127).
+ * @param y  Row (0..63).
+ * @param on 1 = pixel lit, 0 = pixel off.
+ */
+void oledSetPixel(uint8_t x, uint8_t y, uint8_t on);
+
+/**
+ * @brief Draws one character on a page-aligned text line.
+ * @param column Left column of the glyph.
+ * @param page   Text line (0..7).
+ * @param c      ASCII character; lower case is drawn as upper case.
+ */
+void oledDrawChar(uint8_t column, uint8_t page, char c);
+
+/**
+ * @brief Draws a string on a text line, clearing the rest of the line.
+ * @param page Text line (0..7); lines outside the display are ignored.
+ * @param str  NUL-terminated string.
+ */
+void oledDrawLine(uint8_t page, const char *str);
+
+/**
+ * @brief Pushes all dirty column ranges to the display.
+ * @return Number of framebuffer bytes sent.
+ */
+uint16_t oledFlush(void);
+
+/**
+ * @brief Returns a pointer to the framebuffer (read-only).
+ */
+const uint8_t *oledFramebuffer(void);
+
+#endif // OLED_DISPLAY_H
@@ -0,0 +1,55 @@
+/**
+ * @file oled_host.c
+ * @brief Implementation of the Host (PC) OLED Transport
+ * @author 
+ * @version 1.0
+ * @date 2025
+ */
+
+#include "oled_host.h"
+#include "oled_display.h"
+#include <stdio.h>
+
+/** Emulated panel RAM */
+static uint8_t panel[OLED_PAGES][OLED_COLUMNS];
+
+/** Bytes written since start-up */
+static uint32_t bytesWritten = 0;
+
+/**
+ * @brief Writes `len` bytes to the emulated panel (OledWriteFn).
+ */
+void oledHostWritePage(uint8_t page, uint8_t column, const uint8_t *data, uint8_t len) {
+    for (uint8_t i = 0; i < len && column + i < OLED_COLUMNS; i++) {
+        panel[page][column + i] = data[i];
+    }
+    bytesWritten += len;
+}
+
+/**
+ * @brief Writes the emulated panel contents to a plain PBM (P1) file.
+ */
+int oledHostDumpPbm(const char *path) {
+    FILE *fp = fopen(path, "w");
+    if (fp == NULL) {
+        perror(path);
+        return -1;
+    }
+
+    fprintf(fp, "P1\n%d %d\n", OLED_COLUMNS, OLED_PAGES * 8);
+    for (int y = 0; y < OLED_PAGES * 8; y++) {
+        for (int x = 0; x < OLED_COLUMNS; x++) {
+            fputc((panel[y >> 3][x] >> (y & 7)) & 1 ? '1' : '0', fp);
+        }
+        fputc('\n', fp);
+    }
+    fclose(fp);
+    return 0;
+}
+
+/**
+ * @brief Returns the number of bytes written to the panel so far.
+ */
+uint32_t oledHostBytesWritten(void) {
+    return bytesWritten;
+}
@@ -0,0 +1,37 @@
+/**
+ * @file oled_host.h
+ * @brief Host (PC) Transport for the OLED Framebuffer
+ * @author 
+ * @version 1.0
+ * @date 2025
+ *
+ * @details
+ * Emulates the panel RAM on a PC so display code can be tested without the
+ * hardware. Writes land in a shadow of the panel; frames can be dumped as
+ * PBM images and the number of bytes that would have crossed the bus is
+ * counted.
+ */
+
+#ifndef OLED_HOST_H
+#define OLED_HOST_H
+
+#include <stdint.h>
+
+/**
+ * @brief Writes `len` bytes to the emulated panel (OledWriteFn).
+ */
+void oledHostWritePage(uint8_t page, uint8_t column, const uint8_t *data, uint8_t len);
+
+/**
+ * @brief Writes the emulated panel contents to a plain PBM (P1) file.
+ * @param path Output file name.
+ * @return 0 on success, -1 on error.
+ */
+int oledHostDumpPbm(const char *path);
+
+/**
+ * @brief Returns the number of bytes written to the panel so far.
+ */
+uint32_t oledHostBytesWritten(void);
+
+#endif // OLED_HOST_H
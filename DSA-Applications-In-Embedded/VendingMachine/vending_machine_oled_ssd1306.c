@@ -0,0 +1,95 @@
+/**
+ * @file oled_ssd1306.c
+ * @brief Implementation of the SSD1306 I2C Transport
+ * @author 
+ * @version 1.0
+ * @date 2025
+ *
+ * @details
+ * Uses page addressing mode: a page write is "set page, set column" commands
+ * followed by one data transfer, so only the dirty range crosses the bus.
+ */
+
+#include "oled_ssd1306.h"
+#include <avr/io.h>
+
+#define SSD1306_CTRL_CMD   0x00 /**< Control byte: command stream */
+#define SSD1306_CTRL_DATA  0x40 /**< Control byte: data stream */
+
+/** Power-up command sequence (128x64, page addressing, charge pump on) */
+static const uint8_t initSequence[] = {
+    0xAE,       // Display off
+    0xD5, 0x80, // Clock divide
+    0xA8, 0x3F, // Multiplex 64
+    0xD3, 0x00, // Display offset 0
+    0x40,       // Start line 0
+    0x8D, 0x14, // Charge pump on
+    0x20, 0x02, // Page addressing mode
+    0xA1,       // Segment remap
+    0xC8,       // COM scan descending
+    0xDA, 0x12, // COM pins
+    0x81, 0x7F, // Contrast
+    0xD9, 0xF1, // Pre-charge
+    0xDB, 0x40, // VCOMH
+    0xA4,       // Display RAM content
+    0xA6,       // Normal (not inverted)
+    0xAF        // Display on
+};
+
+static void twiWait(void) {
+    while (!(TWCR & (1 << TWINT)));
+}
+
+static void twiStart(void) {
+    TWCR = (1 << TWINT) | (1 << TWSTA) | (1 << TWEN);
+    twiWait();
+}
+
+static void twiStop(void) {
+    TWCR = (1 << TWINT) | (1 << TWSTO) | (1 << TWEN);
+}
+
+static void twiWrite(uint8_t byte) {
+    TWDR = byte;
+    TWCR = (1 << TWINT) | (1 << TWEN);
+    twiWait();
+}
+
+static void sendCommands(const uint8_t *cmds, uint8_t len) {
+    twiStart();
+    twiWrite(SSD1306_I2C_ADDR << 1);
+    twiWrite(SSD1306_CTRL_CMD);
+    while (len--) {
+        twiWrite(*cmds++);
+    }
+    twiStop();
+}
+
+/**
+ * @brief Initializes the TWI peripheral and the SSD1306 controller.
+ */
+void ssd1306Init(void) {
+    TWSR = 0; // Prescaler 1
+    TWBR = (uint8_t)(((F_CPU / SSD1306_I2C_FREQ) - 16) / 2);
+    sendCommands(initSequence, sizeof(initSequence));
+}
+
+/**
+ * @brief Writes `len` bytes to `page` starting at `column` (OledWriteFn).
+ */
+void ssd1306WritePage(uint8_t page, uint8_t column, const uint8_t *data, uint8_t len) {
+    uint8_t address[3] = {
+        (uint8_t)(0xB0 | page),           // Page start address
+        (uint8_t)(0x00 | (column & 0x0F)), // Lower column nibble
+        (uint8_t)(0x10 | (column >> 4))    // Upper column nibble
+    };
+    sendCommands(address, sizeof(address));
+
+    twiStart();
+    twiWrite(SSD1306_I2C_ADDR << 1);
+    twiWrite(SSD1306_CTRL_DATA);
+    while (len--) {
+        twiWrite(*data++);
+    }
+    twiStop();
+}
@@ -0,0 +1,35 @@
+/**
+ * @file oled_ssd1306.h
+ * @brief SSD1306 I2C Transport for the OLED Framebuffer
+ * @author 
+ * @version 1.0
+ * @date 2025
+ *
+ * @details
+ * Implements the `OledWriteFn` transport on the ATmega2560 TWI peripheral.
+ * Each call addresses one page/column range and streams the bytes in a single
+ * I2C data transfer.
+ */
+
+#ifndef OLED_SSD1306_H
+#define OLED_SSD1306_H
+
+#include <stdint.h>
+
+/** @defgroup SSD1306 Configuration */
+///@{
+#define SSD1306_I2C_ADDR  0x3C     /**< 7-bit slave address */
+#define SSD1306_I2C_FREQ  400000UL /**< I2C fast mode */
+///@}
+
+/**
+ * @brief Initializes the TWI peripheral and the SSD1306 controller.
+ */
+void ssd1306Init(void);
+
+/**
+ * @brief Writes `len` bytes to `page` starting at `column` (OledWriteFn).
+ */
+void ssd1306WritePage(uint8_t page, uint8_t column, const uint8_t *data, uint8_t len);
+
+#endif // OLED_SSD1306_H
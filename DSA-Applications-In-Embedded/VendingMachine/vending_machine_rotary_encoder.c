@@ -0,0 +1,109 @@
+/**
+ * @file rotary_encoder.c
+ * @brief Implementation of the Interrupt-Driven Quadrature Decoder
+ * @author 
+ * @version 1.0
+ * @date 2025
+ *
+ * @details
+ * The pin-change ISR samples both encoder lines, forms a 4-bit index from the
+ * previous and current AB state and adds the table entry to the position.
+ * The UI buttons share the PCINT2 vector; their edges leave AB unchanged and
+ * decode as 0.
+ */
+
+#include "rotary_encoder.h"
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+
+/**
+ * @brief Quadrature transition table indexed by (previous AB << 2) | current AB.
+ *
+ * Gray-code sequence 00 -> 01 -> 11 -> 10 is clockwise. No change and
+ * impossible double-steps decode as 0.
+ */
+static const int8_t quadratureTable[16] = {
+     0, +1, -1,  0,
+    -1,  0,  0, +1,
+    +1,  0,  0, -1,
+     0, -1, +1,  0
+};
+
+/** Signed position in quadrature counts (written by the ISR) */
+static volatile int16_t position = 0;
+
+/** Last sampled AB state (used only by the ISR) */
+static uint8_t lastAB = 0;
+
+/** Position already converted to steps by encoderReadSteps() */
+static int16_t consumed = 0;
+
+/**
+ * @brief Samples the A/B lines as a 2-bit value.
+ */
+static inline uint8_t readAB(void) {
+    uint8_t pins = ENCODER_PIN;
+    return (uint8_t)((((pins >> ENCODER_A) & 1) << 1) | ((pins >> ENCODER_B) & 1));
+}
+
+/**
+ * @brief Configures the encoder pins and enables the pin-change interrupt.
+ */
+void encoderInit(void) {
+    ENCODER_DDR &= ~((1 << ENCODER_A) | (1 << ENCODER_B));  // Inputs
+    ENCODER_PORT |= (1 << ENCODER_A) | (1 << ENCODER_B);    // Pull-ups
+
+    lastAB = readAB();
+    position = 0;
+    consumed = 0;
+
+    PCMSK2 |= (1 << PCINT16) | (1 << PCINT17); // A and B edges
+    PCICR |= (1 << PCIE2);                     // Enable PCINT[23:16]
+}
+
+/**
+ * @brief Pin-change ISR: decodes one quadrature transition.
+ */
+ISR(PCINT2_vect) {
+    uint8_t ab = readAB();
+    position += quadratureTable[(lastAB << 2) | ab];
+    lastAB = ab;
+}
+
+/**
+ * @brief Returns the raw signed position in quadrature counts.
+ */
+int16_t encoderGetPosition(void) {
+    int16_t pos;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        pos = position;
+    }
+    return pos;
+}
+
+/**
+ * @brief Returns 1 if at least one whole detent was turned since the last encoderReadSteps().
+ */
+uint8_t encoderPending(void) {
+    int16_t delta = (int16_t)(encoderGetPosition() - consumed);
+    return delta >= ENCODER_COUNTS_PER_DETENT || delta <= -ENCODER_COUNTS_PER_DETENT;
+}
+
+/**
+ * @brief Returns the number of menu steps since the last call.
+ */
+int16_t encoderReadSteps(void) {
+    int16_t delta = (int16_t)(encoderGetPosition() - consumed);
+    int16_t detents = delta / ENCODER_COUNTS_PER_DETENT;
+
+    if (detents == 0) {
+        return 0;
+    }
+    consumed += detents * ENCODER_COUNTS_PER_DETENT;
+
+    // Velocity scaling: many detents between two polls means fast turning
+    if (detents >= ENCODER_ACCEL_THRESHOLD || detents <= -ENCODER_ACCEL_THRESHOLD) {
+        return (int16_t)(detents * ENCODER_ACCEL_FACTOR);
+    }
+    return detents;
+}
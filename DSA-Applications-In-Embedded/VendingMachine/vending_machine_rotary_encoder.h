@@ -0,0 +1,68 @@
+/**
+ * @file rotary_encoder.h
+ * @brief Interrupt-Driven Quadrature Decoder for the Rotary Encoder
+ * @author 
+ * @version 1.0
+ * @date 2025
+ *
+ * @details
+ * The encoder A/B lines are decoded in a pin-change interrupt using a
+ * 16-entry transition table indexed by (previous AB, current AB). Each valid
+ * transition adds +1/-1 to a signed position counter; invalid (bounced or
+ * skipped) transitions add 0. No edge is lost however slowly the main loop
+ * runs.
+ *
+ * The ATmega2560 has no pin-change interrupts on PORTC, so the encoder A/B
+ * lines are on PORTK (PCINT16/PCINT17).
+ */
+
+#ifndef ROTARY_ENCODER_H
+#define ROTARY_ENCODER_H
+
+#include <avr/io.h>
+#include <stdint.h>
+
+/** @defgroup Encoder Hardware Pins */
+///@{
+#define ENCODER_PIN    PINK   /**< Input register of the encoder lines */
+#define ENCODER_PORT   PORTK  /**< Port register (pull-ups) */
+#define ENCODER_DDR    DDRK   /**< Direction register */
+#define ENCODER_A      PK0    /**< Encoder CLK / A line (PCINT16) */
+#define ENCODER_B      PK1    /**< Encoder DT / B line (PCINT17) */
+///@}
+
+/** @defgroup Encoder Configuration */
+///@{
+#define ENCODER_COUNTS_PER_DETENT 4  /**< Quadrature counts per mechanical click */
+#define ENCODER_ACCEL_THRESHOLD   3  /**< Detents per poll above which steps are scaled */
+#define ENCODER_ACCEL_FACTOR      4  /**< Step multiplier when turning fast */
+///@}
+
+/**
+ * @brief Configures the encoder pins and enables the pin-change interrupt.
+ */
+void encoderInit(void);
+
+/**
+ * @brief Returns the raw signed position in quadrature counts.
+ */
+int16_t encoderGetPosition(void);
+
+/**
+ * @brief Returns 1 if at least one whole detent was turned since the last encoderReadSteps().
+ */
+uint8_t encoderPending(void);
+
+/**
+ * @brief Returns the number of menu steps since the last call.
+ *
+ * Whole detents turned since the previous call are converted to steps. When
+ * the encoder is turned quickly (many detents between two polls) the steps
+ * are multiplied by ENCODER_ACCEL_FACTOR. Partial detents are kept for the
+ * next call.
+ *
+ * @return Signed step count (positive = clockwise).
+ */
+int16_t encoderReadSteps(void);
+
+#endif // ROTARY_ENCODER_H
@@ -0,0 +1,189 @@
+/**
+ * @file scheduler.c
+ * @brief Implementation of the Cooperative Task Scheduler
+ * @author 
+ * @version 1.0
+ * @date 2025
+ *
+ * @details
+ * Hardware independent: the tick arrives through schedulerTick() and time
+ * measurements come from schedulerPortMicros(). Both ports keep the
+ * microsecond clock aligned with the tick count, so a release at tick N
+ * corresponds to N * 1000 us.
+ */
+
+#include "scheduler.h"
+#include <stddef.h>
+
+#ifdef __AVR__
+#include <util/atomic.h>
+#define SCHED_ATOMIC ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+#else
+#define SCHED_ATOMIC
+#endif
+
+/** Task table installed by schedulerInit() */
+static const TaskConfig *taskTable = NULL;
+static uint8_t taskCount = 0;
+
+/** Next release time of each task (in ticks) */
+static uint32_t nextRelease[SCHED_MAX_TASKS];
+
+/** Run-time accounting of each task */
+static TaskStats taskStats[SCHED_MAX_TASKS];
+
+/** Tick counter, incremented by the timer ISR */
+static volatile uint32_t ticks = 0;
+
+/** Application hook allowing power-down */
+static QuiescentFn quiescent = NULL;
+
+/** Sleep accounting */
+static SleepStats sleepStats;
+
+/**
+ * @brief Installs the task table and resets all statistics.
+ */
+void schedulerInit(const TaskConfig *tasks, uint8_t numTasks) {
+    if (numTasks > SCHED_MAX_TASKS) {
+        numTasks = SCHED_MAX_TASKS;
+    }
+    taskTable = tasks;
+    taskCount = numTasks;
+
+    for (uint8_t i = 0; i < numTasks; i++) {
+        nextRelease[i] = 0;
+        taskStats[i] = (TaskStats){ 0 };
+    }
+    sleepStats = (SleepStats){ 0 };
+    SCHED_ATOMIC {
+        ticks = 0;
+    }
+}
+
+/**
+ * @brief Advances scheduler time by one tick. Called from the timer ISR.
+ */
+void schedulerTick(void) {
+    ticks++;
+}
+
+/**
+ * @brief Returns the number of milliseconds since schedulerInit().
+ */
+uint32_t schedulerMillis(void) {
+    uint32_t now;
+    SCHED_ATOMIC {
+        now = ticks;
+    }
+    return now * SCHED_TICK_MS;
+}
+
+/**
+ * @brief Runs the highest-priority task that is due, if any.
+ */
+uint8_t schedulerRunOnce(void) {
+    uint32_t now = schedulerMillis();
+
+    for (uint8_t i = 0; i < taskCount; i++) {
+        if ((int32_t)(now - nextRelease[i]) < 0) {
+            continue;
+        }
+
+        const TaskConfig *task = &taskTable[i];
+        TaskStats *st = &taskStats[i];
+        uint32_t releaseUs = nextRelease[i] * 1000UL;
+
+        uint32_t startUs = schedulerPortMicros();
+        task->run();
+        uint32_t endUs = schedulerPortMicros();
+
+        int32_t jitter = (int32_t)(startUs - releaseUs);
+        uint32_t runUs = endUs - startUs;
+
+        st->runs++;
+        st->busyUs += runUs;
+        if (runUs > st->maxRunUs) {
+            st->maxRunUs = runUs;
+        }
+        if (jitter > 0 && (uint32_t)jitter > st->maxJitterUs) {
+            st->maxJitterUs = (uint32_t)jitter;
+        }
+        if ((int32_t)(endUs - releaseUs) > (int32_t)task->deadlineMs * 1000L) {
+            st->deadlineMisses++;
+        }
+
+        // Next release; drop releases that are already in the past
+        nextRelease[i] += task->periodMs;
+        now = schedulerMillis();
+        while ((int32_t)(now - nextRelease[i]) >= 0) {
+            nextRelease[i] += task->periodMs;
+            st->skippedReleases++;
+        }
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Returns 1 if at least one task is due to run.
+ */
+uint8_t schedulerTaskDue(void) {
+    uint32_t now = schedulerMillis();
+
+    for (uint8_t i = 0; i < taskCount; i++) {
+        if ((int32_t)(now - nextRelease[i]) >= 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Sleeps until the next interrupt, or powers down if the application is quiescent.
+ */
+void schedulerIdle(void) {
+    uint32_t start = schedulerPortMicros();
+
+    if (quiescent != NULL && quiescent()) {
+        schedulerPortPowerDown(quiescent);
+        sleepStats.deepSleeps++;
+        sleepStats.deepUs += schedulerPortMicros() - start;
+    } else {
+        schedulerPortIdle();
+        sleepStats.idleSleeps++;
+        sleepStats.idleUs += schedulerPortMicros() - start;
+    }
+}
+
+/**
+ * @brief Runs tasks forever, sleeping in schedulerIdle() when nothing is due.
+ */
+void schedulerRun(void) {
+    while (1) {
+        if (!schedulerRunOnce()) {
+            schedulerIdle();
+        }
+    }
+}
+
+/**
+ * @brief Installs the hook that tells the idle path it may power down.
+ */
+void schedulerSetQuiescentHook(QuiescentFn fn) {
+    quiescent = fn;
+}
+
+/**
+ * @brief Returns the sleep accounting of the idle path.
+ */
+const SleepStats *schedulerGetSleepStats(void) {
+    return &sleepStats;
+}
+
+/**
+ * @brief Returns the statistics of task `index`.
+ */
+const TaskStats *schedulerGetStats(uint8_t index) {
+    return (index < taskCount) ? &taskStats[index] : NULL;
+}
@@ -0,0 +1,160 @@
+/**
+ * @file scheduler.h
+ * @brief Cooperative Task Scheduler for Sugarcane Juice Vending Machine
+ * @author
+ * @version 1.0
+ * @date 2025
+ *
+ * @details
+ * Tasks are listed in a fixed, constant table. Each task has a period and a
+ * relative deadline in milliseconds and runs to completion (no preemption).
+ * A 1 ms hardware timer tick releases tasks; when several tasks are due the
+ * one earliest in the table runs first.
+ *
+ * For every task the scheduler records run count, total and worst-case run
+ * time, worst release jitter (start time minus release time) and deadline
+ * misses, measured with the microsecond clock of the port layer.
+ *
+ * The port layer (`scheduler_avr.c` on the target, `scheduler_host.c` on a PC)
+ * provides the tick and the microsecond clock.
+ *
+ * When no task is due the CPU sleeps until the next interrupt (the tick keeps
+ * running). If the application also reports that it is quiescent (no event
+ * pending, nothing being timed) the port stops the tick and powers down until
+ * an external interrupt (button, pin change) wakes it.
+ */
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdint.h>
+
+/** @defgroup Scheduler Configuration */
+///@{
+#define SCHED_MAX_TASKS  8  /**< Capacity of the task table */
+#define SCHED_TICK_MS    1  /**< Timer tick period in milliseconds */
+///@}
+
+/** Task body: must return quickly, never block */
+typedef void (*TaskFn)(void);
+
+/** Returns non-zero when the application may power down until an external wake */
+typedef uint8_t (*QuiescentFn)(void);
+
+/**
+ * @brief Static description of one task.
+ */
+typedef struct {
+    const char *name;    /**< Name used in reports */
+    TaskFn run;          /**< Task body */
+    uint16_t periodMs;   /**< Release period */
+    uint16_t deadlineMs; /**< Deadline relative to release */
+} TaskConfig;
+
+/**
+ * @brief Run-time accounting of one task (all times in microseconds).
+ */
+typedef struct {
+    uint32_t runs;           /**< Number of completed runs */
+    uint32_t busyUs;         /**< Total run time */
+    uint32_t maxRunUs;       /**< Worst-case run time */
+    uint32_t maxJitterUs;    /**< Worst start delay after release */
+    uint16_t deadlineMisses; /**< Runs that finished after their deadline */
+    uint16_t skippedReleases;/**< Releases dropped because the task overran */
+} TaskStats;
+
+/**
+ * @brief Sleep accounting of the idle path (times in microseconds).
+ *
+ * On the target the microsecond clock stops during power-down, so `deepUs`
+ * is only meaningful on the host.
+ */
+typedef struct {
+    uint32_t idleSleeps; /**< Sleeps until the next tick */
+    uint32_t deepSleeps; /**< Power-downs until an external wake */
+    uint32_t idleUs;     /**< Time spent in idle sleep */
+    uint32_t deepUs;     /**< Time spent powered down */
+} SleepStats;
+
+/**
+ * @brief Installs the task table and resets all statistics.
+ * @param tasks    Constant task table (priority = table order).
+ * @param numTasks Number of entries (at most SCHED_MAX_TASKS).
+ */
+void schedulerInit(const TaskConfig *tasks, uint8_t numTasks);
+
+/**
+ * @brief Advances scheduler time by one tick. Called from the timer ISR.
+ */
+void schedulerTick(void);
+
+/**
+ * @brief Returns the number of milliseconds since schedulerInit().
+ */
+uint32_t schedulerMillis(void);
+
+/**
+ * @brief Runs the highest-priority task that is due, if any.
+ * @return 1 if a task ran, 0 if nothing was due.
+ */
+uint8_t schedulerRunOnce(void);
+
+/**
+ * @brief Returns 1 if at least one task is due to run.
+ */
+uint8_t schedulerTaskDue(void);
+
+/**
+ * @brief Sleeps until the next interrupt, or powers down if the application is quiescent.
+ */
+void schedulerIdle(void);
+
+/**
+ * @brief Runs tasks forever, sleeping in schedulerIdle() when nothing is due.
+ */
+void schedulerRun(void);
+
+/**
+ * @brief Installs the hook that tells the idle path it may power down.
+ * @param fn Hook, or NULL to never power down.
+ */
+void schedulerSetQuiescentHook(QuiescentFn fn);
+
+/**
+ * @brief Returns the sleep accounting of the idle path.
+ */
+const SleepStats *schedulerGetSleepStats(void);
+
+/**
+ * @brief Returns the statistics of task `index`.
+ */
+const TaskStats *schedulerGetStats(uint8_t index);
+
+/** @defgroup Scheduler Port Layer */
+///@{
+
+/**
+ * @brief Starts the hardware timer that calls schedulerTick() every SCHED_TICK_MS.
+ */
+void schedulerPortInit(void);
+
+/**
+ * @brief Returns a free-running microsecond clock for run-time accounting.
+ */
+uint32_t schedulerPortMicros(void);
+
+/**
+ * @brief Sleeps until the next interrupt unless a task became due meanwhile.
+ */
+void schedulerPortIdle(void);
+
+/**
+ * @brief Stops the tick and sleeps until an external wake-up.
+ *
+ * `stillQuiescent` is re-checked with interrupts disabled, right before
+ * sleeping, so an event that arrived after the first check is not lost.
+ */
+void schedulerPortPowerDown(QuiescentFn stillQuiescent);
+///@}
+
+#endif // SCHEDULER_H
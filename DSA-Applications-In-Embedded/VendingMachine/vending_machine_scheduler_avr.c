@@ -0,0 +1,98 @@
+/**
+ * @file scheduler_avr.c
+ * @brief ATmega2560 Port of the Cooperative Task Scheduler
+ * @author 
+ * @version 1.0
+ * @date 2025
+ *
+ * @details
+ * Timer0 runs in CTC mode with a prescaler of 64: at 16 MHz one count is
+ * 4 us and a compare match every 250 counts gives the 1 ms tick.
+ *
+ * Idle uses SLEEP_MODE_IDLE (Timer0 keeps running, next compare match wakes
+ * the CPU). Power-down stops Timer0 and uses SLEEP_MODE_PWR_DOWN; on the
+ * ATmega2560 INT3:0 edges and pin-change interrupts are detected
+ * asynchronously, so the button (INT0) and the encoder and menu buttons
+ * (PCINT) still wake it.
+ */
+
+#include "scheduler.h"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+#include <util/atomic.h>
+
+#define TIMER0_TOP        249 /**< 250 counts = 1 ms at 16 MHz / 64 */
+#define TIMER0_US_PER_CNT 4   /**< Microseconds per timer count */
+#define TIMER0_PRESCALER  ((1 << CS01) | (1 << CS00)) /**< clk/64 */
+
+/**
+ * @brief Starts Timer0 for a 1 ms compare-match interrupt.
+ */
+void schedulerPortInit(void) {
+    TCCR0A = (1 << WGM01);              // CTC mode
+    OCR0A  = TIMER0_TOP;
+    TCCR0B = TIMER0_PRESCALER;          // Prescaler 64
+    TIMSK0 = (1 << OCIE0A);             // Compare match interrupt
+    sei();
+}
+
+/**
+ * @brief Timer0 compare match: one scheduler tick.
+ */
+ISR(TIMER0_COMPA_vect) {
+    schedulerTick();
+}
+
+/**
+ * @brief Returns a free-running microsecond clock for run-time accounting.
+ */
+uint32_t schedulerPortMicros(void) {
+    uint32_t ms;
+    uint8_t count;
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        count = TCNT0;
+        ms = schedulerMillis();
+        // Compare match pending but not yet serviced: the tick already happened
+        if ((TIFR0 & (1 << OCF0A)) && count < (TIMER0_TOP / 2)) {
+            ms++;
+        }
+    }
+    return ms * 1000UL + (uint32_t)count * TIMER0_US_PER_CNT;
+}
+
+/**
+ * @brief Sleeps until the next interrupt unless a task became due meanwhile.
+ *
+ * `sei` followed by `sleep` is atomic on AVR: an interrupt that arrives after
+ * the check is serviced only after the CPU is asleep, and then wakes it.
+ */
+void schedulerPortIdle(void) {
+    set_sleep_mode(SLEEP_MODE_IDLE);
+    cli();
+    if (!schedulerTaskDue()) {
+        sleep_enable();
+        sei();
+        sleep_cpu();
+        sleep_disable();
+    }
+    sei();
+}
+
+/**
+ * @brief Stops the tick and sleeps until an external wake-up.
+ */
+void schedulerPortPowerDown(QuiescentFn stillQuiescent) {
+    set_sleep_mode(SLEEP_MODE_PWR_DOWN);
+    cli();
+    if (stillQuiescent() && !schedulerTaskDue()) {
+        TCCR0B = 0;                 // Stop the tick: time is frozen while asleep
+        sleep_enable();
+        sei();
+        sleep_cpu();                // INT0 / PCINT wake-up
+        sleep_disable();
+        TCCR0B = TIMER0_PRESCALER;  // Resume the tick
+    }
+    sei();
+}
@@ -0,0 +1,111 @@
+/**
+ * @file scheduler_host.c
+ * @brief Host (PC) Port of the Cooperative Task Scheduler
+ * @author 
+ * @version 1.0
+ * @date 2025
+ *
+ * @details
+ * A 1 ms POSIX interval timer on CLOCK_MONOTONIC delivers SIGALRM, whose
+ * handler plays the role of the timer ISR. Expirations the kernel coalesced
+ * are added back from timer_getoverrun(), so the tick count stays aligned
+ * with the microsecond clock (CLOCK_MONOTONIC relative to
+ * schedulerPortInit()).
+ *
+ * Idle blocks in sigsuspend() until the next tick. Power-down disarms the
+ * tick timer and waits for any other signal (the host stand-in for INT0 or a
+ * pin change), then re-arms it.
+ */
+
+#include "scheduler.h"
+#include <signal.h>
+#include <string.h>
+#include <time.h>
+
+/** Clock value at schedulerPortInit() */
+static struct timespec epoch;
+
+/** Interval timer delivering the tick */
+static timer_t tickTimer;
+static int timerCreated = 0;
+
+/** Tick period */
+static const struct itimerspec tickPeriod = {
+    { 0, SCHED_TICK_MS * 1000000L }, { 0, SCHED_TICK_MS * 1000000L }
+};
+
+static void onAlarm(int sig) {
+    (void)sig;
+    for (int n = timer_getoverrun(tickTimer); n >= 0; n--) {
+        schedulerTick();
+    }
+}
+
+/**
+ * @brief Starts a 1 ms interval timer that calls schedulerTick().
+ */
+void schedulerPortInit(void) {
+    struct sigaction sa;
+    struct sigevent sev;
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = onAlarm;
+    sa.sa_flags = SA_RESTART;
+    sigaction(SIGALRM, &sa, NULL);
+
+    if (!timerCreated) {
+        memset(&sev, 0, sizeof(sev));
+        sev.sigev_notify = SIGEV_SIGNAL;
+        sev.sigev_signo = SIGALRM;
+        timer_create(CLOCK_MONOTONIC, &sev, &tickTimer);
+        timerCreated = 1;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &epoch);
+    timer_settime(tickTimer, 0, &tickPeriod, NULL);
+}
+
+/**
+ * @brief Returns microseconds since schedulerPortInit().
+ */
+uint32_t schedulerPortMicros(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint32_t)((now.tv_sec - epoch.tv_sec) * 1000000L + (now.tv_nsec - epoch.tv_nsec) / 1000);
+}
+
+/**
+ * @brief Sleeps until the next interrupt unless a task became due meanwhile.
+ *
+ * All signals are blocked around the check; sigsuspend() unblocks them and
+ * waits atomically, the host equivalent of AVR `sei; sleep`.
+ */
+void schedulerPortIdle(void) {
+    sigset_t all, old;
+
+    sigfillset(&all);
+    sigprocmask(SIG_BLOCK, &all, &old);
+    if (!schedulerTaskDue()) {
+        sigsuspend(&old);
+    }
+    sigprocmask(SIG_SETMASK, &old, NULL);
+}
+
+/**
+ * @brief Stops the tick and sleeps until an external wake-up.
+ */
+void schedulerPortPowerDown(QuiescentFn stillQuiescent) {
+    static const struct itimerspec stop = { { 0, 0 }, { 0, 0 } };
+    sigset_t all, old;
+
+    sigfillset(&all);
+    sigprocmask(SIG_BLOCK, &all, &old);
+    if (stillQuiescent() && !schedulerTaskDue()) {
+        timer_settime(tickTimer, 0, &stop, NULL);   // Time is frozen while asleep
+        while (stillQuiescent()) {
+            sigsuspend(&old);                       // Any signal may be the wake-up
+        }
+        timer_settime(tickTimer, 0, &tickPeriod, NULL);
+    }
+    sigprocmask(SIG_SETMASK, &old, NULL);
+}
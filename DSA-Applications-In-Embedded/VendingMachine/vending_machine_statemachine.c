@@ -2,69 +2,219 @@
  * @file state_machine.c
  * @brief Implementation of State Machine for Sugarcane Juice Vending Machine
  * @author 
- * @version 1.0
+ * @version 1.1
  * @date 2025
  *
  * @details
  * This file implements the logic for state transitions in the vending machine.
  * It ensures smooth operation from user input to dispensing and completion.
+ *
+ * Each state has an event source that turns inputs into events; the events
+ * are dispatched through a constant (state x event) transition table.
+ * Dispense and cooldown times are measured against the scheduler clock, so
+ * runStateMachine() never blocks and can run as a periodic task.
+ *
+ * Every transition is timed and fed to the telemetry module (`telemetry.h`):
+ * button-to-valve latency, full cycle time, transition cost and counters for
+ * dispenses, low-juice checks and aborted cycles.
  */
 
 #include "state_machine.h"
-#include <util/delay.h>
-
-/** Global variable to track the machine's state */
-static State currentState = IDLE;
+#include "scheduler.h"
+#include "telemetry.h"
+#include <stddef.h>
 
 /** Global flag to track button press event */
 volatile uint8_t buttonPressed = 0;
 
+/** State machine instance */
+static Fsm machine;
+
+/** Time (ms) at which the current timed state was entered */
+static uint32_t stateEnteredMs = 0;
+
+/** Time (us) at which the current dispense cycle started (button press) */
+static uint32_t cycleStartUs = 0;
+
+/* ---------------- Actions ---------------- */
+
+static void enterIdle(void *ctx) {
+    (void)ctx;
+    updateLEDStatus();
+}
+
+static void enterDispensing(void *ctx) {
+    (void)ctx;
+    stateEnteredMs = schedulerMillis();
+    startDispensing();
+}
+
+static void enterCompletion(void *ctx) {
+    (void)ctx;
+    stateEnteredMs = schedulerMillis();
+}
+
+static void exitDispensing(void *ctx) {
+    (void)ctx;
+    stopDispensing();
+}
+
+static void warnLowJuice(void *ctx) {
+    (void)ctx;
+    PORTD |= (1 << ORANGE_LED);  // Indicate low juice warning
+    playBuzzerSound(1); // Fast beeps for low juice warning (played by the buzzer task)
+}
+
+static void beepComplete(void *ctx) {
+    (void)ctx;
+    playBuzzerSound(2); // Single long beep for completion (played by the buzzer task)
+}
+
+/* ---------------- Event Sources ---------------- */
+
+static uint8_t pollIdle(void) {
+    updateLEDStatus();
+    if (buttonPressed) {
+        buttonPressed = 0;
+        return EV_BUTTON_PRESSED;
+    }
+    return FSM_NO_EVENT;
+}
+
+static uint8_t pollJuiceLevel(void) {
+    return (PIND & (1 << FLOAT_SWITCH)) ? EV_JUICE_OK : EV_JUICE_LOW;
+}
+
+static uint8_t pollDispensing(void) {
+    if (!(PIND & (1 << FLOAT_SWITCH))) {  // Ran dry while pouring: abort
+        return EV_JUICE_LOW;
+    }
+    if (schedulerMillis() - stateEnteredMs >= DISPENSE_TIME_MS) {
+        return EV_TIMER_EXPIRED;
+    }
+    return FSM_NO_EVENT;
+}
+
+static uint8_t pollCompletion(void) {
+    // Cooldown before allowing next dispense
+    if (schedulerMillis() - stateEnteredMs >= COOLDOWN_TIME_MS) {
+        return EV_TIMER_EXPIRED;
+    }
+    return FSM_NO_EVENT;
+}
+
+/** Event source of each state, indexed by `State` */
+static uint8_t (*const eventSource[NUM_STATES])(void) = {
+    [IDLE]              = pollIdle,
+    [CHECK_JUICE_LEVEL] = pollJuiceLevel,
+    [DISPENSING]        = pollDispensing,
+    [COMPLETION]        = pollCompletion,
+};
+
+/* ---------------- Tables ---------------- */
+
+#define NONE { FSM_NO_TRANSITION, NULL, NULL }
+
+/** Transition table, indexed by [state][event] */
+static const FsmTransition transitions[NUM_STATES][NUM_EVENTS] = {
+    [IDLE] = {
+        [EV_BUTTON_PRESSED] = { CHECK_JUICE_LEVEL, NULL, NULL },
+        [EV_JUICE_OK]       = NONE,
+        [EV_JUICE_LOW]      = NONE,
+        [EV_TIMER_EXPIRED]  = NONE,
+    },
+    [CHECK_JUICE_LEVEL] = {
+        [EV_BUTTON_PRESSED] = NONE,
+        [EV_JUICE_OK]       = { DISPENSING, NULL, NULL },
+        [EV_JUICE_LOW]      = { IDLE, NULL, warnLowJuice },
+        [EV_TIMER_EXPIRED]  = NONE,
+    },
+    [DISPENSING] = {
+        [EV_BUTTON_PRESSED] = NONE,
+        [EV_JUICE_OK]       = NONE,
+        [EV_JUICE_LOW]      = { IDLE, NULL, warnLowJuice },
+        [EV_TIMER_EXPIRED]  = { COMPLETION, NULL, beepComplete },
+    },
+    [COMPLETION] = {
+        [EV_BUTTON_PRESSED] = NONE,
+        [EV_JUICE_OK]       = NONE,
+        [EV_JUICE_LOW]      = NONE,
+        [EV_TIMER_EXPIRED]  = { IDLE, NULL, NULL },
+    },
+};
+
+/** Entry/exit actions, indexed by `State` */
+static const FsmStateActions stateActions[NUM_STATES] = {
+    [IDLE]              = { enterIdle, NULL },
+    [CHECK_JUICE_LEVEL] = { NULL, NULL },
+    [DISPENSING]        = { enterDispensing, exitDispensing },
+    [COMPLETION]        = { enterCompletion, NULL },
+};
+
+static const FsmDefinition machineDef = {
+    &transitions[0][0], stateActions, NUM_STATES, NUM_EVENTS
+};
+
+/* ---------------- Telemetry ---------------- */
+
+/**
+ * @brief Trace hook: turns transitions into telemetry samples and counters.
+ */
+static void traceTelemetry(uint8_t from, uint8_t event, uint8_t to, uint32_t us) {
+    uint32_t now = schedulerPortMicros();
+    (void)event;
+
+    telemetryRecord(TM_TRANSITION, us);
+
+    if (from == IDLE && to == CHECK_JUICE_LEVEL) {
+        cycleStartUs = telemetryButtonMark();
+    } else if (to == DISPENSING) {
+        telemetryRecord(TM_BUTTON_TO_VALVE, now - cycleStartUs);
+    } else if (from == DISPENSING && to == COMPLETION) {
+        telemetryCount(TM_DISPENSES);
+    } else if (from == CHECK_JUICE_LEVEL && to == IDLE) {
+        telemetryCount(TM_LOW_JUICE);
+    } else if (from == DISPENSING && to == IDLE) {
+        telemetryCount(TM_ABORTED);
+    } else if (from == COMPLETION && to == IDLE) {
+        telemetryRecord(TM_CYCLE_TIME, now - cycleStartUs);
+    }
+}
+
 /**
  * @brief Initializes the state machine.
  *
- * Sets the system to IDLE state and ensures hardware is ready.
+ * Sets the system to IDLE state, ensures hardware is ready and attaches the
+ * telemetry trace hook.
  */
 void initStateMachine(void) {
-    currentState = IDLE;
-    updateLEDStatus();
+    telemetryInit();
+    fsmInit(&machine, &machineDef, IDLE, NULL);
+    fsmSetTrace(&machine, traceTelemetry, schedulerPortMicros);
 }
 
 /**
  * @brief Runs the state machine loop.
  *
- * Handles transitions between different states.
+ * Polls the event source of the current state and dispatches the result.
+ * Returns immediately when nothing happened.
  */
 void runStateMachine(void) {
-    switch (currentState) {
-        case IDLE:
-            updateLEDStatus();
-            if (buttonPressed) {
-                currentState = CHECK_JUICE_LEVEL;
-                buttonPressed = 0;
-            }
-            break;
-
-        case CHECK_JUICE_LEVEL:
-            if (PIND & (1 << FLOAT_SWITCH)) {  // Check if juice is available
-                currentState = DISPENSING;
-                startDispensing();
-            } else {
-                PORTD |= (1 << ORANGE_LED);  // Indicate low juice warning
-                playBuzzerSound(1); // Fast beeps for low juice warning
-                currentState = IDLE;
-            }
-            break;
-
-        case DISPENSING:
-            _delay_ms(DISPENSE_TIME_MS); // Simulate dispensing time
-            stopDispensing();
-            playBuzzerSound(2); // Single long beep for completion
-            currentState = COMPLETION;
-            break;
-
-        case COMPLETION:
-            _delay_ms(COOLDOWN_TIME_MS); // Cooldown before allowing next dispense
-            currentState = IDLE;
-            break;
-    }
+    fsmDispatch(&machine, eventSource[fsmState(&machine)]());
+}
+
+/**
+ * @brief Returns the current state of the machine.
+ */
+State getMachineState(void) {
+    return (State)fsmState(&machine);
+}
+
+/**
+ * @brief Installs a trace hook that reports every transition and its duration.
+ *
+ * Replaces the telemetry hook installed by initStateMachine().
+ */
+void setStateMachineTrace(FsmTraceHook hook, FsmClock clock) {
+    fsmSetTrace(&machine, hook, clock);
 }
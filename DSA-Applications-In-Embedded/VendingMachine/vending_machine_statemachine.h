@@ -2,19 +2,40 @@
  * @file state_machine.h
  * @brief State Machine for Sugarcane Juice Vending Machine
  * @author 
- * @version 1.0
+ * @version 1.1
  * @date 2025
  *
  * @details
  * This file defines the state machine transitions for the vending machine.
  * It ensures a structured process for handling user input, checking juice levels,
  * controlling dispensing, and managing completion.
+ *
+ * The transitions are described by a constant table and executed by the
+ * generic table-driven engine in `fsm.h`.
  */
 
 #ifndef STATE_MACHINE_H
 #define STATE_MACHINE_H
 
 #include "hardware.h"
+#include "fsm.h"
+
+/** Number of states in the `State` enumeration */
+#define NUM_STATES (COMPLETION + 1)
+
+/** @defgroup State Machine Events */
+///@{
+typedef enum {
+    EV_BUTTON_PRESSED, /**< Debounced button press */
+    EV_JUICE_OK,       /**< Float switch reports juice available */
+    EV_JUICE_LOW,      /**< Float switch reports low juice */
+    EV_TIMER_EXPIRED,  /**< Dispense or cooldown time elapsed */
+    NUM_EVENTS
+} Event;
+///@}
+
+/** Global flag to track button press event (set by ISR / debounce logic) */
+extern volatile uint8_t buttonPressed;
 
 /** 
  * @brief Initializes the state machine.
@@ -26,8 +47,23 @@ void initStateMachine(void);
 /** 
  * @brief Runs the state machine loop.
  *
- * This function should be called in the main loop to handle state transitions.
+ * This function should be called periodically (scheduler task) to handle
+ * state transitions. It never blocks.
  */
 void runStateMachine(void);
 
+/**
+ * @brief Returns the current state of the machine.
+ */
+State getMachineState(void);
+
+/**
+ * @brief Installs a trace hook that reports every transition and its duration.
+ *
+ * Replaces the telemetry hook installed by initStateMachine().
+ * @param hook  Trace hook (NULL to disable).
+ * @param clock Free-running tick source used to time the transition.
+ */
+void setStateMachineTrace(FsmTraceHook hook, FsmClock clock);
+
 #endif // STATE_MACHINE_H
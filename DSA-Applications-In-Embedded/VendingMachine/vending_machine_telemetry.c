@@ -0,0 +1,229 @@
+/**
+ * @file telemetry.c
+ * @brief Implementation of Dispense Telemetry
+ * @author 
+ * @version 1.0
+ * @date 2025
+ *
+ * @details
+ * Histogram counts saturate at 0xFFFF instead of wrapping. Export formats
+ * numbers with a small decimal converter so no printf is pulled in. A
+ * report is a sequence of fields (line header, counter, bucket, newline)
+ * so it can be sent a few at a time.
+ */
+
+#include "telemetry.h"
+
+#ifdef __AVR__
+#include <util/atomic.h>
+#define TM_ATOMIC ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+#else
+#define TM_ATOMIC
+#endif
+
+/**
+ * @brief One latency histogram.
+ */
+typedef struct {
+    uint16_t bucket[TM_BUCKETS]; /**< Sample counts per log2 bucket */
+    uint16_t samples;            /**< Total samples (saturating) */
+    uint32_t maxUs;              /**< Largest sample */
+} Histogram;
+
+static Histogram histograms[TM_NUM_HISTS];
+static uint16_t counters[TM_NUM_COUNTERS];
+static volatile uint32_t buttonMarkUs = 0;
+
+static const char *const histNames[TM_NUM_HISTS] = {
+    [TM_BUTTON_TO_VALVE] = "button_to_valve_us",
+    [TM_CYCLE_TIME]      = "cycle_us",
+    [TM_TRANSITION]      = "transition_us",
+};
+
+static const char *const counterNames[TM_NUM_COUNTERS] = {
+    [TM_DISPENSES] = "dispenses",
+    [TM_LOW_JUICE] = "low_juice",
+    [TM_ABORTED]   = "aborted",
+};
+
+static inline void saturatingInc(uint16_t *v) {
+    if (*v != 0xFFFF) {
+        (*v)++;
+    }
+}
+
+/**
+ * @brief Clears all histograms and counters.
+ */
+void telemetryInit(void) {
+    for (uint8_t h = 0; h < TM_NUM_HISTS; h++) {
+        histograms[h] = (Histogram){ { 0 }, 0, 0 };
+    }
+    for (uint8_t c = 0; c < TM_NUM_COUNTERS; c++) {
+        counters[c] = 0;
+    }
+}
+
+/**
+ * @brief Adds one latency sample to a histogram.
+ */
+void telemetryRecord(TelemetryHist hist, uint32_t us) {
+    Histogram *h = &histograms[hist];
+    uint8_t b = 0;
+
+    // Bucket = number of significant bits of the sample
+    for (uint32_t v = us; v != 0 && b < TM_BUCKETS - 1; v >>= 1) {
+        b++;
+    }
+    saturatingInc(&h->bucket[b]);
+    saturatingInc(&h->samples);
+    if (us > h->maxUs) {
+        h->maxUs = us;
+    }
+}
+
+/**
+ * @brief Increments a counter.
+ */
+void telemetryCount(TelemetryCounter counter) {
+    saturatingInc(&counters[counter]);
+}
+
+/**
+ * @brief Remembers when the button was pressed (safe to call from an ISR).
+ */
+void telemetryMarkButton(uint32_t us) {
+    buttonMarkUs = us;
+}
+
+/**
+ * @brief Returns the timestamp stored by telemetryMarkButton().
+ */
+uint32_t telemetryButtonMark(void) {
+    uint32_t us;
+    TM_ATOMIC {
+        us = buttonMarkUs;
+    }
+    return us;
+}
+
+/**
+ * @brief Returns the sample count of bucket `bucket` of histogram `hist`.
+ */
+uint16_t telemetryBucket(TelemetryHist hist, uint8_t bucket) {
+    return (bucket < TM_BUCKETS) ? histograms[hist].bucket[bucket] : 0;
+}
+
+/**
+ * @brief Returns the value of a counter.
+ */
+uint16_t telemetryCounter(TelemetryCounter counter) {
+    return counters[counter];
+}
+
+/* ---------------- Export ---------------- */
+
+static void putString(TelemetryPutc putc, const char *s) {
+    while (*s != '\0') {
+        putc(*s++);
+    }
+}
+
+static void putNumber(TelemetryPutc putc, uint32_t v) {
+    char digits[10];
+    uint8_t n = 0;
+
+    do {
+        digits[n++] = (char)('0' + v % 10);
+        v /= 10;
+    } while (v != 0);
+    while (n > 0) {
+        putc(digits[--n]);
+    }
+}
+
+/**
+ * @brief Writes counters and non-empty histogram buckets as text lines.
+ */
+void telemetryExport(TelemetryPutc putc) {
+    TelemetryCursor cursor;
+
+    telemetryExportBegin(&cursor);
+    while (telemetryExportStep(&cursor, putc));
+}
+
+/**
+ * @brief Starts a report at its first field.
+ */
+void telemetryExportBegin(TelemetryCursor *cursor) {
+    cursor->line = 0;
+    cursor->item = 0;
+}
+
+/**
+ * @brief Ends the current line and moves the cursor to the next one.
+ */
+static uint8_t endLine(TelemetryCursor *cursor, TelemetryPutc putc) {
+    putc('\n');
+    cursor->line++;
+    cursor->item = 0;
+    return cursor->line <= TM_NUM_HISTS;
+}
+
+/**
+ * @brief Writes the next field of the report (at most TM_MAX_FIELD characters).
+ */
+uint8_t telemetryExportStep(TelemetryCursor *cursor, TelemetryPutc putc) {
+    if (cursor->line == 0) {
+        // "TM name=N ..."
+        if (cursor->item == TM_NUM_COUNTERS + 1) {
+            return endLine(cursor, putc);
+        }
+        if (cursor->item == 0) {
+            putString(putc, "TM");
+        } else {
+            putc(' ');
+            putString(putc, counterNames[cursor->item - 1]);
+            putc('=');
+            putNumber(putc, counters[cursor->item - 1]);
+        }
+        cursor->item++;
+        return 1;
+    }
+    if (cursor->line > TM_NUM_HISTS) {
+        return 0;
+    }
+
+    // "H name n=N max=M upper:count ..."; item b + 1 is bucket b
+    uint8_t h = (uint8_t)(cursor->line - 1);
+    const Histogram *hg = &histograms[h];
+
+    if (cursor->item == 0) {
+        putString(putc, "H ");
+        putString(putc, histNames[h]);
+        putString(putc, " n=");
+        putNumber(putc, hg->samples);
+        putString(putc, " max=");
+        putNumber(putc, hg->maxUs);
+        cursor->item++;
+        return 1;
+    }
+    while (cursor->item <= TM_BUCKETS && hg->bucket[cursor->item - 1] == 0) {
+        cursor->item++;
+    }
+    if (cursor->item > TM_BUCKETS) {
+        return endLine(cursor, putc);
+    }
+
+    uint8_t b = (uint8_t)(cursor->item - 1);
+    putc(' ');
+    if (b == TM_BUCKETS - 1) {
+        putc('+');  // Overflow bucket has no upper bound
+    } else {
+        putNumber(putc, 1UL << b);
+    }
+    putc(':');
+    putNumber(putc, hg->bucket[b]);
+    cursor->item++;
+    return 1;
+}
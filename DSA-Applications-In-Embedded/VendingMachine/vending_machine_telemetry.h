@@ -0,0 +1,126 @@
+/**
+ * @file telemetry.h
+ * @brief Dispense Telemetry: Latency Histograms and Event Counters
+ * @author 
+ * @version 1.0
+ * @date 2025
+ *
+ * @details
+ * Latencies are recorded in microseconds into fixed log2 buckets: bucket 0
+ * holds 0 us, bucket i holds [2^(i-1), 2^i) us, the last bucket everything
+ * larger. Recording is a few shifts and an increment (no floats, no
+ * division), so it can run inside state transitions. Counters track
+ * dispenses, low-juice checks and aborted cycles. Everything can be exported
+ * as text through a character output callback (e.g. the UART), in one call
+ * or one field at a time with a TelemetryCursor.
+ *
+ * This module does not touch hardware and also builds on the host.
+ */
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdint.h>
+
+/** @defgroup Telemetry Configuration */
+///@{
+#define TM_BUCKETS   26  /**< log2 buckets: up to 2^24 us (~16.8 s), last = overflow */
+#define TM_MAX_FIELD 48  /**< Longest text written by one telemetryExportStep() */
+///@}
+
+/** @defgroup Telemetry Histograms */
+///@{
+typedef enum {
+    TM_BUTTON_TO_VALVE, /**< Button press to valve open */
+    TM_CYCLE_TIME,      /**< Button press back to IDLE after a dispense */
+    TM_TRANSITION,      /**< Execution time of a single transition */
+    TM_NUM_HISTS
+} TelemetryHist;
+///@}
+
+/** @defgroup Telemetry Counters */
+///@{
+typedef enum {
+    TM_DISPENSES,  /**< Completed dispenses */
+    TM_LOW_JUICE,  /**< CHECK_JUICE_LEVEL found the tank low */
+    TM_ABORTED,    /**< Dispense aborted (tank ran dry while pouring) */
+    TM_NUM_COUNTERS
+} TelemetryCounter;
+///@}
+
+/** Character output used by telemetryExport() */
+typedef void (*TelemetryPutc)(char c);
+
+/** Position in a report exported with telemetryExportStep() */
+typedef struct {
+    uint8_t line; /**< 0 = counters, h + 1 = histogram h */
+    uint8_t item; /**< Field within the line */
+} TelemetryCursor;
+
+/**
+ * @brief Clears all histograms and counters.
+ */
+void telemetryInit(void);
+
+/**
+ * @brief Adds one latency sample to a histogram.
+ * @param hist Histogram.
+ * @param us   Latency in microseconds.
+ */
+void telemetryRecord(TelemetryHist hist, uint32_t us);
+
+/**
+ * @brief Increments a counter.
+ */
+void telemetryCount(TelemetryCounter counter);
+
+/**
+ * @brief Remembers when the button was pressed (safe to call from an ISR).
+ * @param us Timestamp in microseconds.
+ */
+void telemetryMarkButton(uint32_t us);
+
+/**
+ * @brief Returns the timestamp stored by telemetryMarkButton().
+ */
+uint32_t telemetryButtonMark(void);
+
+/**
+ * @brief Returns the sample count of bucket `bucket` of histogram `hist`.
+ */
+uint16_t telemetryBucket(TelemetryHist hist, uint8_t bucket);
+
+/**
+ * @brief Returns the value of a counter.
+ */
+uint16_t telemetryCounter(TelemetryCounter counter);
+
+/**
+ * @brief Writes counters and non-empty histogram buckets as text lines.
+ *
+ * Format: `TM dispenses=N low_juice=N aborted=N` followed by one line per
+ * histogram: `H <name> n=<count> max=<us> <upper_us>:<count> ...`, where
+ * `<upper_us>` is the exclusive upper bound of the bucket.
+ *
+ * @param putc Character output (e.g. uartPutc).
+ */
+void telemetryExport(TelemetryPutc putc);
+
+/**
+ * @brief Starts a report at its first field.
+ */
+void telemetryExportBegin(TelemetryCursor *cursor);
+
+/**
+ * @brief Writes the next field of the report (at most TM_MAX_FIELD characters).
+ *
+ * Lets a periodic task send a report piecewise, e.g. only while the UART
+ * ring has TM_MAX_FIELD characters free.
+ *
+ * @param cursor Position, advanced past the field.
+ * @param putc   Character output.
+ * @return 1 while fields remain, 0 once the report is complete.
+ */
+uint8_t telemetryExportStep(TelemetryCursor *cursor, TelemetryPutc putc);
+
+#endif // TELEMETRY_H
@@ -0,0 +1,113 @@
+// Host test of the bus manager: three devices at two speeds share the
+// simulated bus, one of them NACKs while busy and needs retries.
+// Build (the driver header is included as drv.h):
+//   ln -sf i2_drv.h drv.h && gcc -O2 -Wall -I../regs -o bus_test bus_test.c i2c_bus.c i2c_drv.c i2c_sim.c
+
+#include <stdio.h>
+#include <string.h>
+#include "drv.h"
+#include "i2c_bus.h"
+#include "i2c_sim.h"
+
+#define IMU_ADDR 0x68
+#define EEPROM_ADDR 0x50
+#define TEMP_ADDR 0x48
+#define ACCEL_REG 0x3B
+
+#define IMU_READS 12
+#define EEPROM_READS 3
+#define TEMP_READS 4
+
+static I2CSim sim;
+static char order[64];          // Device letter per completed request
+static int completed;
+
+static uint64_t sim_clock(void) {
+    return sim.now_ns;
+}
+
+static void on_done(I2CTransfer* xfer) {
+    order[completed++] = *(const char*)xfer->user;
+}
+
+static void print_device(const char* name, const I2CBusDevice* dev) {
+    printf("%-7s %3u kHz: %2u requests, %u failed, %u retries, wait avg %7.1f us max %7.1f us, bus %7.1f us\n",
+           name, (unsigned)dev->speed_khz, (unsigned)dev->requests, (unsigned)dev->failures,
+           (unsigned)dev->retried, dev->requests ? dev->wait_ns / 1000.0 / dev->requests : 0.0,
+           dev->max_wait_ns / 1000.0, dev->bus_ns / 1000.0);
+}
+
+int main(void) {
+    static I2CSlave imu, eeprom, temp;
+    static I2CBusRequest imu_req[IMU_READS], eeprom_req[EEPROM_READS], temp_req[TEMP_READS];
+    static uint8_t accel[IMU_READS][6], page[EEPROM_READS][16], temperature[TEMP_READS][2];
+    static const char imu_tag = 'I', eeprom_tag = 'E', temp_tag = 'T';
+    I2CDriverState state;
+    I2CBusDevice imu_dev, eeprom_dev, temp_dev;
+    I2CBus bus;
+    int i, errors = 0;
+
+    i2c_sim_init(&sim, 100);
+    for (i = 0; i < 6; i++) {
+        imu.regs[ACCEL_REG + i] = (uint8_t)(0xA0 + i);
+    }
+    for (i = 0; i < 48; i++) {
+        eeprom.regs[i] = (uint8_t)i;
+    }
+    temp.regs[0] = 0x19;
+    temp.regs[1] = 0x80;
+    i2c_sim_add_slave(&sim, &imu, IMU_ADDR);
+    i2c_sim_add_slave(&sim, &eeprom, EEPROM_ADDR);
+    i2c_sim_add_slave(&sim, &temp, TEMP_ADDR);
+    eeprom.busy_starts = 2;     // Still finishing a write cycle: NACKs the first two addresses
+
+    state.i2c = &sim.regs;
+    initialize_i2c(&state);
+    i2c_bus_init(&bus, &state, sim_clock);
+    i2c_bus_add_device(&bus, &imu_dev, IMU_ADDR, 400, 0);
+    i2c_bus_add_device(&bus, &eeprom_dev, EEPROM_ADDR, 100, 3);
+    i2c_bus_add_device(&bus, &temp_dev, TEMP_ADDR, 100, 0);
+
+    // Everything is queued at once; the IMU alone has more than a batch waiting
+    for (i = 0; i < IMU_READS; i++) {
+        i2c_prepare_read_burst(&imu_req[i].xfer, IMU_ADDR, ACCEL_REG, accel[i], 6);
+        imu_req[i].xfer.done = on_done;
+        imu_req[i].xfer.user = (void*)&imu_tag;
+        errors += (i2c_bus_submit(&bus, &imu_dev, &imu_req[i]) != 0);
+    }
+    for (i = 0; i < EEPROM_READS; i++) {
+        i2c_prepare_read_burst(&eeprom_req[i].xfer, EEPROM_ADDR, (uint8_t)(16 * i), page[i], 16);
+        eeprom_req[i].xfer.done = on_done;
+        eeprom_req[i].xfer.user = (void*)&eeprom_tag;
+        errors += (i2c_bus_submit(&bus, &eeprom_dev, &eeprom_req[i]) != 0);
+    }
+    for (i = 0; i < TEMP_READS; i++) {
+        i2c_prepare_read_burst(&temp_req[i].xfer, TEMP_ADDR, 0, temperature[i], 2);
+        temp_req[i].xfer.done = on_done;
+        temp_req[i].xfer.user = (void*)&temp_tag;
+        errors += (i2c_bus_submit(&bus, &temp_dev, &temp_req[i]) != 0);
+    }
+
+    while (i2c_bus_busy(&bus)) {
+        i2c_sim_step(&sim);
+    }
+
+    for (i = 0; i < IMU_READS; i++) {
+        errors += (imu_req[i].xfer.result != I2C_OK) || (accel[i][0] != 0xA0) || (accel[i][5] != 0xA5);
+    }
+    for (i = 0; i < EEPROM_READS; i++) {
+        errors += (eeprom_req[i].xfer.result != I2C_OK) || (page[i][0] != 16 * i) || (page[i][15] != 16 * i + 15);
+    }
+    for (i = 0; i < TEMP_READS; i++) {
+        errors += (temp_req[i].xfer.result != I2C_OK) || (temperature[i][0] != 0x19);
+    }
+    errors += (completed != IMU_READS + EEPROM_READS + TEMP_READS) || (eeprom_dev.retried != 2);
+
+    printf("%d requests, %d errors, completion order %s\n", completed, errors, order);
+    print_device("imu", &imu_dev);
+    print_device("eeprom", &eeprom_dev);
+    print_device("temp", &temp_dev);
+    printf("bus: %.1f%% utilised over %.1f us, %u clock switches\n",
+           i2c_bus_utilisation(&bus) / 10.0, (sim.now_ns - bus.since_ns) / 1000.0, (unsigned)bus.clock_switches);
+    return errors != 0;
+}
@@ -3,27 +3,117 @@
 #define DRV_H
 
 #include <stdint.h>
+#include "regs.h"
 
-// I2C Device Structure
+// I2C Device Structure (volatile: every access in the driver reaches the hardware)
 struct I2CDevice {
-    uint16_t control;     // Control register, offset 0x00
-    uint16_t status;      // Status register, offset 0x02
-    uint16_t data;        // Data register, offset 0x04
-    uint16_t address;     // Address register, offset 0x06
+    reg16_t control;      // Control register, offset 0x00
+    reg16_t status;       // Status register, offset 0x02
+    reg16_t data;         // Data register, offset 0x04
+    reg16_t address;      // Address register, offset 0x06
+    reg16_t clock;        // SCL clock in kHz, offset 0x08
 };
 
+// Control Register Fields
+#define I2C_CTRL_ENABLE_SHIFT 0
+#define I2C_CTRL_ENABLE_WIDTH 1
+#define I2C_CTRL_START_SHIFT 1
+#define I2C_CTRL_START_WIDTH 1
+#define I2C_CTRL_STOP_SHIFT 2
+#define I2C_CTRL_STOP_WIDTH 1
+#define I2C_CTRL_READ_SHIFT 3
+#define I2C_CTRL_READ_WIDTH 1
+#define I2C_CTRL_WRITE_SHIFT 4
+#define I2C_CTRL_WRITE_WIDTH 1
+#define I2C_CTRL_ACK_SHIFT 5
+#define I2C_CTRL_ACK_WIDTH 1
+#define I2C_CTRL_IRQ_EN_SHIFT 6
+#define I2C_CTRL_IRQ_EN_WIDTH 1
+
 // Control Register Bitmasks
-#define I2C_ENABLE 0x0001
-#define I2C_START 0x0002
-#define I2C_STOP 0x0004
-#define I2C_READ 0x0008
-#define I2C_WRITE 0x0010
-#define I2C_ACK 0x0020
+#define I2C_ENABLE REG_MASK(I2C_CTRL_ENABLE)
+#define I2C_START REG_MASK(I2C_CTRL_START)
+#define I2C_STOP REG_MASK(I2C_CTRL_STOP)
+#define I2C_READ REG_MASK(I2C_CTRL_READ)
+#define I2C_WRITE REG_MASK(I2C_CTRL_WRITE)
+#define I2C_ACK REG_MASK(I2C_CTRL_ACK)
+#define I2C_IRQ_EN REG_MASK(I2C_CTRL_IRQ_EN)     // Raise the interrupt when a command finishes
+
+// Status Register Fields (write 0 to clear)
+#define I2C_STAT_DONE_SHIFT 0
+#define I2C_STAT_DONE_WIDTH 1
+#define I2C_STAT_NACK_SHIFT 1
+#define I2C_STAT_NACK_WIDTH 1
+
+#define I2C_DONE REG_MASK(I2C_STAT_DONE)          // START, WRITE, READ or STOP finished
+#define I2C_NACK REG_MASK(I2C_STAT_NACK)          // Slave did not acknowledge the address or data byte
+
+// Address Register Fields
+#define I2C_ADDR_RW_SHIFT 0
+#define I2C_ADDR_RW_WIDTH 1
+#define I2C_ADDR_SLAVE_SHIFT 1
+#define I2C_ADDR_SLAVE_WIDTH 7
+
+// Transaction engine
+#define I2C_QUEUE_LEN 8       // Transfers waiting for the bus
+
+// Transfer results
+#define I2C_OK 0
+#define I2C_ERR_NACK -1
+#define I2C_PENDING 1
+
+// Disable/enable the I2C interrupt around queue updates from the main loop
+#ifndef I2C_IRQ_DISABLE
+#define I2C_IRQ_DISABLE()
+#define I2C_IRQ_ENABLE()
+#endif
+
+struct I2CTransfer;
+typedef void (*I2CCallback)(struct I2CTransfer* xfer);
+
+// One write-then-read transaction: START addr+W, tx bytes, (repeated) START addr+R, rx bytes, STOP.
+// Either part may be empty. The buffers belong to the caller until 'done' runs.
+typedef struct I2CTransfer {
+    uint8_t addr;               // 7 bit slave address
+    const uint8_t* tx_buf;
+    uint16_t tx_len;
+    uint8_t* rx_buf;
+    uint16_t rx_len;
+    I2CCallback done;           // Called from i2c_isr() when finished, may be NULL
+    void* user;
+    volatile int result;        // I2C_PENDING, then I2C_OK or I2C_ERR_NACK
+    uint8_t reg;                // Register address sent before tx_buf ...
+    uint8_t reg_len;            // ... if reg_len is 1 (burst transfers)
+} I2CTransfer;
+
+// Where the engine is in the current transfer
+typedef enum {
+    I2C_PHASE_IDLE,
+    I2C_PHASE_ADDR_W,           // START + address with write bit sent
+    I2C_PHASE_TX,               // Writing tx_buf
+    I2C_PHASE_ADDR_R,           // (Repeated) START + address with read bit sent
+    I2C_PHASE_RX,               // Reading rx_buf
+    I2C_PHASE_STOP              // STOP sent, transfer completes on its interrupt
+} I2CPhase;
 
 // Hardware state tracking
 typedef struct {
     struct I2CDevice* i2c;
     int is_initialized;
+
+    // Transaction queue, driven by i2c_isr()
+    I2CTransfer* queue[I2C_QUEUE_LEN];
+    volatile uint8_t head;
+    volatile uint8_t count;
+    volatile I2CPhase phase;
+    uint16_t index;             // Byte of reg + tx_buf / rx_buf being moved
+    int result;
+    void (*wait)(void);         // Called while a blocking call waits (e.g. sleep until interrupt), may be NULL
+
+    // Statistics
+    uint32_t interrupts;
+    uint32_t completed;
+    uint32_t nacks;
 } I2CDriverState;
 
 // Function Prototypes
@@ -34,4 +124,20 @@ void i2c_write(I2CDriverState* state, uint8_t data);
 uint8_t i2c_read(I2CDriverState* state, int ack);
 void i2c_isr(void);  // Interrupt Service Routine
 
+// Queues a transfer and returns at once; the bus work happens in i2c_isr().
+// Returns 0, or -1 if the queue is full.
+int i2c_submit(I2CDriverState* state, I2CTransfer* xfer);
+
+// Non-zero while transfers are queued or running
+int i2c_busy(const I2CDriverState* state);
+
+// Fill 'xfer' for a burst: the register address, then 'len' bytes written or read
+// with the slave auto-incrementing the register. Submit with i2c_submit().
+void i2c_prepare_write_burst(I2CTransfer* xfer, uint8_t addr, uint8_t reg, const uint8_t* buf, uint16_t len);
+void i2c_prepare_read_burst(I2CTransfer* xfer, uint8_t addr, uint8_t reg, uint8_t* buf, uint16_t len);
+
+// Blocking bursts: one transfer, one call. Return I2C_OK, I2C_ERR_NACK or -1 if not queued.
+int i2c_write_burst(I2CDriverState* state, uint8_t addr, uint8_t reg, const uint8_t* buf, uint16_t len);
+int i2c_read_burst(I2CDriverState* state, uint8_t addr, uint8_t reg, uint8_t* buf, uint16_t len);
+
 #endif // DRV_H
@@ -0,0 +1,198 @@
+#include "i2c_bus.h"
+
+static uint64_t bus_now(const I2CBus* bus) {
+    return (bus->clock != 0) ? bus->clock() : 0;
+}
+
+static void on_complete(I2CTransfer* xfer);
+
+// Next device with pending requests, starting after the current one
+static int next_device(const I2CBus* bus) {
+    int i, d;
+
+    for (i = 1; i <= bus->num_devices; i++) {
+        d = (bus->cursor + i) % bus->num_devices;
+        if (bus->devices[d]->head != 0) {
+            return d;
+        }
+    }
+    return -1;
+}
+
+// Hands one attempt of 'req' to the driver
+static void start_attempt(I2CBus* bus, I2CBusRequest* req) {
+    bus->started_ns = bus_now(bus);
+    req->xfer.done = on_complete;
+    if (i2c_submit(bus->state, &req->xfer) < 0) {
+        // Only the manager submits, so the driver queue cannot be full
+        req->xfer.result = I2C_ERR_NACK;
+        on_complete(&req->xfer);
+    }
+}
+
+// Puts the next request on the bus if it is free. Runs with the I2C interrupt
+// disabled or from i2c_isr().
+static void dispatch(I2CBus* bus) {
+    I2CBusDevice* dev;
+    I2CBusRequest* req;
+    uint64_t wait;
+    int d;
+
+    if (bus->current != 0) {
+        return;
+    }
+    if (bus->cursor < bus->num_devices && bus->devices[bus->cursor]->head != 0 && bus->batch < I2C_BUS_BATCH) {
+        d = bus->cursor;
+    } else {
+        d = next_device(bus);
+        if (d < 0) {
+            return;
+        }
+        bus->cursor = d;
+        bus->batch = 0;
+    }
+
+    dev = bus->devices[d];
+    req = dev->head;
+    dev->head = req->next;
+    if (dev->head == 0) {
+        dev->tail = 0;
+    }
+    bus->batch++;
+    bus->current = req;
+
+    if (bus->speed_khz != dev->speed_khz) {
+        reg_write16(&bus->state->i2c->clock, dev->speed_khz);
+        bus->speed_khz = dev->speed_khz;
+        bus->clock_switches++;
+    }
+    wait = bus_now(bus) - req->queued_ns;
+    dev->wait_ns += wait;
+    if (wait > dev->max_wait_ns) {
+        dev->max_wait_ns = wait;
+    }
+    start_attempt(bus, req);
+}
+
+// Driver callback for every attempt: retry, or report and move on
+static void on_complete(I2CTransfer* xfer) {
+    I2CBusRequest* req = (I2CBusRequest*)xfer;
+    I2CBus* bus = req->bus;
+    I2CBusDevice* dev = req->device;
+    uint64_t spent = bus_now(bus) - bus->started_ns;
+
+    bus->busy_ns += spent;
+    dev->bus_ns += spent;
+
+    if (xfer->result == I2C_ERR_NACK && req->tries < dev->retries) {
+        req->tries++;
+        dev->retried++;
+        start_attempt(bus, req);
+        return;
+    }
+
+    dev->requests++;
+    if (xfer->result != I2C_OK) {
+        dev->failures++;
+    }
+    bus->current = 0;
+    dispatch(bus);
+
+    xfer->done = req->done;
+    if (xfer->done != 0) {
+        xfer->done(xfer);
+    }
+}
+
+void i2c_bus_init(I2CBus* bus, I2CDriverState* state, I2CBusClock clock) {
+    bus->state = state;
+    bus->clock = clock;
+    bus->num_devices = 0;
+    bus->cursor = 0;
+    bus->batch = 0;
+    bus->current = 0;
+    bus->started_ns = 0;
+    bus->speed_khz = reg_read16(&state->i2c->clock);
+    i2c_bus_reset_stats(bus);
+}
+
+int i2c_bus_add_device(I2CBus* bus, I2CBusDevice* dev, uint8_t addr, uint16_t speed_khz, uint8_t retries) {
+    if (bus->num_devices == I2C_BUS_MAX_DEVICES || speed_khz == 0) {
+        return -1;
+    }
+
+    dev->addr = addr;
+    dev->speed_khz = speed_khz;
+    dev->retries = retries;
+    dev->head = 0;
+    dev->tail = 0;
+    dev->requests = 0;
+    dev->failures = 0;
+    dev->retried = 0;
+    dev->wait_ns = 0;
+    dev->max_wait_ns = 0;
+    dev->bus_ns = 0;
+
+    I2C_IRQ_DISABLE();
+    bus->devices[bus->num_devices++] = dev;
+    I2C_IRQ_ENABLE();
+    return 0;
+}
+
+int i2c_bus_submit(I2CBus* bus, I2CBusDevice* dev, I2CBusRequest* req) {
+    if (dev == 0 || req == 0 ||
+        (req->xfer.tx_len > 0 && req->xfer.tx_buf == 0) || (req->xfer.rx_len > 0 && req->xfer.rx_buf == 0)) {
+        return -1;
+    }
+
+    req->bus = bus;
+    req->device = dev;
+    req->next = 0;
+    req->done = req->xfer.done;
+    req->tries = 0;
+    req->queued_ns = bus_now(bus);
+    req->xfer.addr = dev->addr;
+    req->xfer.result = I2C_PENDING;
+
+    I2C_IRQ_DISABLE();
+    if (dev->tail != 0) {
+        dev->tail->next = req;
+    } else {
+        dev->head = req;
+    }
+    dev->tail = req;
+    dispatch(bus);
+    I2C_IRQ_ENABLE();
+    return 0;
+}
+
+int i2c_bus_busy(const I2CBus* bus) {
+    return bus->current != 0;
+}
+
+uint32_t i2c_bus_utilisation(const I2CBus* bus) {
+    uint64_t elapsed = bus_now(bus) - bus->since_ns;
+
+    if (elapsed == 0) {
+        return 0;
+    }
+    return (uint32_t)(bus->busy_ns * 1000u / elapsed);
+}
+
+void i2c_bus_reset_stats(I2CBus* bus) {
+    int i;
+
+    I2C_IRQ_DISABLE();
+    bus->clock_switches = 0;
+    bus->busy_ns = 0;
+    bus->since_ns = bus_now(bus);
+    for (i = 0; i < bus->num_devices; i++) {
+        bus->devices[i]->requests = 0;
+        bus->devices[i]->failures = 0;
+        bus->devices[i]->retried = 0;
+        bus->devices[i]->wait_ns = 0;
+        bus->devices[i]->max_wait_ns = 0;
+        bus->devices[i]->bus_ns = 0;
+    }
+    I2C_IRQ_ENABLE();
+}
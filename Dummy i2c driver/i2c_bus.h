@@ -0,0 +1,90 @@
+#ifndef I2C_BUS_H
+#define I2C_BUS_H
+
+#include <stdint.h>
+#include "drv.h"
+
+// Bus manager: owns the controller and shares it between registered devices.
+// Each device has its own address, SCL speed and retry count and its own
+// queue of requests. The manager keeps one transfer at a time in the driver,
+// so it can change the clock and retry a NACKed transfer between two of them.
+// The next device is picked round-robin; up to I2C_BUS_BATCH requests of one
+// device run back to back before the next device gets its turn, which saves
+// clock switches without letting a busy device starve the others.
+
+#define I2C_BUS_MAX_DEVICES 8
+#define I2C_BUS_BATCH 4       // Requests served from one device in a row
+
+// Time source for the statistics, in ns (host: clock_gettime or a simulator)
+typedef uint64_t (*I2CBusClock)(void);
+
+struct I2CBus;
+struct I2CBusDevice;
+
+// One queued transaction. Fill 'xfer' (tx/rx buffers, reg, done, user) and
+// pass it to i2c_bus_submit(); the address comes from the device. The request
+// belongs to the manager until xfer.done runs.
+typedef struct I2CBusRequest {
+    I2CTransfer xfer;                   // Must stay first
+    struct I2CBus* bus;
+    struct I2CBusDevice* device;
+    struct I2CBusRequest* next;
+    I2CCallback done;                   // Caller's callback, run once retries are over
+    uint8_t tries;
+    uint64_t queued_ns;
+} I2CBusRequest;
+
+typedef struct I2CBusDevice {
+    uint8_t addr;                       // 7 bit slave address
+    uint16_t speed_khz;                 // SCL clock used for this device
+    uint8_t retries;                    // Extra attempts after a NACK
+
+    I2CBusRequest* head;                // Pending requests, oldest first
+    I2CBusRequest* tail;
+
+    // Statistics
+    uint32_t requests;                  // Completed requests
+    uint32_t failures;                  // Completed with I2C_ERR_NACK after all retries
+    uint32_t retried;                   // Attempts repeated after a NACK
+    uint64_t wait_ns;                   // Total time queued before reaching the bus
+    uint64_t max_wait_ns;
+    uint64_t bus_ns;                    // Total time on the bus
+} I2CBusDevice;
+
+typedef struct I2CBus {
+    I2CDriverState* state;
+    I2CBusClock clock;                  // May be NULL: no timing statistics
+    I2CBusDevice* devices[I2C_BUS_MAX_DEVICES];
+    int num_devices;
+
+    int cursor;                         // Device being served
+    uint8_t batch;                      // Requests served from it in a row
+    I2CBusRequest* current;             // On the bus, 0 when idle
+    uint16_t speed_khz;                 // Last value written to the clock register
+    uint64_t started_ns;                // Start of the current attempt
+
+    // Statistics
+    uint32_t clock_switches;
+    uint64_t busy_ns;                   // Time with a transfer on the bus
+    uint64_t since_ns;                  // Start of the measurement
+} I2CBus;
+
+// Takes over an initialized driver ('state'); 'clock' may be NULL
+void i2c_bus_init(I2CBus* bus, I2CDriverState* state, I2CBusClock clock);
+
+// Registers a device. Returns 0, or -1 if the table is full or the speed is 0.
+int i2c_bus_add_device(I2CBus* bus, I2CBusDevice* dev, uint8_t addr, uint16_t speed_khz, uint8_t retries);
+
+// Queues a request for 'dev' and returns at once. Returns 0, or -1 on bad arguments.
+int i2c_bus_submit(I2CBus* bus, I2CBusDevice* dev, I2CBusRequest* req);
+
+// Non-zero while requests are queued or running
+int i2c_bus_busy(const I2CBus* bus);
+
+// Bus utilisation since i2c_bus_init() or the last reset, in per mille
+uint32_t i2c_bus_utilisation(const I2CBus* bus);
+
+// Clears the bus and device statistics
+void i2c_bus_reset_stats(I2CBus* bus);
+
+#endif // I2C_BUS_H
@@ -1,42 +1,241 @@
 
 #include "drv.h"
 
+// Driver instance served by i2c_isr()
+static I2CDriverState* isr_state;
+
 // Initialize the I2C Device
 void initialize_i2c(I2CDriverState* state) {
     // Code to initialize the I2C hardware
-    state->i2c->control = I2C_ENABLE;
+    reg_write16(&state->i2c->control, I2C_ENABLE);
+    reg_write16(&state->i2c->status, 0);
     state->is_initialized = 1;
+
+    state->head = 0;
+    state->count = 0;
+    state->phase = I2C_PHASE_IDLE;
+    state->index = 0;
+    state->result = I2C_OK;
+    state->interrupts = 0;
+    state->completed = 0;
+    state->nacks = 0;
+    state->wait = 0;
+    isr_state = state;
 }
 
 // Start I2C Communication
 void i2c_start(I2CDriverState* state) {
     // Code to send start condition
-    state->i2c->control |= I2C_START;
+    reg_modify16(&state->i2c->control, 0, I2C_START);
 }
 
 // Stop I2C Communication
 void i2c_stop(I2CDriverState* state) {
     // Code to send stop condition
-    state->i2c->control |= I2C_STOP;
+    reg_modify16(&state->i2c->control, 0, I2C_STOP);
 }
 
 // Write data to I2C Device
 void i2c_write(I2CDriverState* state, uint8_t data) {
     // Code to write data
-    state->i2c->data = data;
-    state->i2c->control |= I2C_WRITE;
+    reg_write16(&state->i2c->data, data);
+    reg_modify16(&state->i2c->control, 0, I2C_WRITE);
 }
 
 // Read data from I2C Device
 uint8_t i2c_read(I2CDriverState* state, int ack) {
     // Code to read data
-    state->i2c->control = ack ? I2C_ACK : 0;
-    state->i2c->control |= I2C_READ;
-    return state->i2c->data;
+    reg_write16(&state->i2c->control, I2C_ENABLE | I2C_READ | REG_VAL(I2C_CTRL_ACK, ack != 0));
+    return (uint8_t)reg_read16(&state->i2c->data);
+}
+
+// Issues one command with the interrupt enabled; the next step runs in i2c_isr()
+static void issue(I2CDriverState* state, uint16_t command) {
+    reg_write16(&state->i2c->control, I2C_ENABLE | I2C_IRQ_EN | command);
+}
+
+// Sends (repeated) START with the address and the direction bit
+static void issue_start(I2CDriverState* state, uint8_t addr, int read) {
+    reg_write16(&state->i2c->address, REG_VAL(I2C_ADDR_SLAVE, addr) | REG_VAL(I2C_ADDR_RW, read != 0));
+    issue(state, I2C_START);
+}
+
+// Reads the next byte, ACK on all but the last one
+static void issue_read(I2CDriverState* state, const I2CTransfer* xfer) {
+    issue(state, I2C_READ | ((state->index + 1 < xfer->rx_len) ? I2C_ACK : 0));
+}
+
+// Starts the transfer at the head of the queue
+static void start_transfer(I2CDriverState* state) {
+    I2CTransfer* xfer = state->queue[state->head];
+
+    state->index = 0;
+    state->result = I2C_OK;
+    if (xfer->reg_len + xfer->tx_len > 0 || xfer->rx_len == 0) {
+        state->phase = I2C_PHASE_ADDR_W;    // A transfer with nothing to move just probes the address
+        issue_start(state, xfer->addr, 0);
+    } else {
+        state->phase = I2C_PHASE_ADDR_R;
+        issue_start(state, xfer->addr, 1);
+    }
+}
+
+int i2c_submit(I2CDriverState* state, I2CTransfer* xfer) {
+    if (!state->is_initialized || xfer == 0 ||
+        (xfer->tx_len > 0 && xfer->tx_buf == 0) || (xfer->rx_len > 0 && xfer->rx_buf == 0)) {
+        return -1;
+    }
+
+    I2C_IRQ_DISABLE();
+    if (state->count == I2C_QUEUE_LEN) {
+        I2C_IRQ_ENABLE();
+        return -1;
+    }
+    xfer->result = I2C_PENDING;
+    state->queue[(state->head + state->count) % I2C_QUEUE_LEN] = xfer;
+    state->count++;
+    if (state->phase == I2C_PHASE_IDLE) {
+        start_transfer(state);
+    }
+    I2C_IRQ_ENABLE();
+    return 0;
 }
 
-// Interrupt Service Routine for the I2C
+int i2c_busy(const I2CDriverState* state) {
+    return state->count != 0;
+}
+
+// Interrupt Service Routine for the I2C: one call per finished command
 void i2c_isr(void) {
-    // ISR code to handle I2C interrupts
-    // This is a placeholder and should be replaced with actual ISR logic for I2C
+    I2CDriverState* state = isr_state;
+    I2CTransfer* xfer;
+    uint16_t status;
+
+    if (state == 0 || state->phase == I2C_PHASE_IDLE) {
+        return;
+    }
+    status = reg_read16(&state->i2c->status);
+    if (!(status & I2C_DONE)) {
+        return;
+    }
+    reg_write16(&state->i2c->status, 0);
+    state->interrupts++;
+    xfer = state->queue[state->head];
+
+    // Address or data byte not acknowledged: give up on this transfer
+    if ((status & I2C_NACK) && state->phase != I2C_PHASE_STOP && state->phase != I2C_PHASE_RX) {
+        state->result = I2C_ERR_NACK;
+        state->nacks++;
+        state->phase = I2C_PHASE_STOP;
+        issue(state, I2C_STOP);
+        return;
+    }
+
+    switch (state->phase) {
+    case I2C_PHASE_ADDR_W:
+    case I2C_PHASE_TX:
+        if (state->phase == I2C_PHASE_TX) {
+            state->index++;
+        }
+        if (state->index < xfer->reg_len + xfer->tx_len) {
+            state->phase = I2C_PHASE_TX;
+            reg_write16(&state->i2c->data, (state->index < xfer->reg_len) ? xfer->reg
+                                                                          : xfer->tx_buf[state->index - xfer->reg_len]);
+            issue(state, I2C_WRITE);
+        } else if (xfer->rx_len > 0) {
+            state->index = 0;
+            state->phase = I2C_PHASE_ADDR_R;
+            issue_start(state, xfer->addr, 1);
+        } else {
+            state->phase = I2C_PHASE_STOP;
+            issue(state, I2C_STOP);
+        }
+        break;
+
+    case I2C_PHASE_ADDR_R:
+        state->phase = I2C_PHASE_RX;
+        issue_read(state, xfer);
+        break;
+
+    case I2C_PHASE_RX:
+        xfer->rx_buf[state->index++] = (uint8_t)reg_read16(&state->i2c->data);
+        if (state->index < xfer->rx_len) {
+            issue_read(state, xfer);
+        } else {
+            state->phase = I2C_PHASE_STOP;
+            issue(state, I2C_STOP);
+        }
+        break;
+
+    case I2C_PHASE_STOP:
+        // Transfer complete: hand it back and start the next one
+        state->head = (uint8_t)((state->head + 1) % I2C_QUEUE_LEN);
+        state->count--;
+        state->completed++;
+        xfer->result = state->result;
+        if (state->count > 0) {
+            start_transfer(state);
+        } else {
+            state->phase = I2C_PHASE_IDLE;
+            reg_write16(&state->i2c->control, I2C_ENABLE);
+        }
+        if (xfer->done != 0) {
+            xfer->done(xfer);
+        }
+        break;
+
+    case I2C_PHASE_IDLE:
+        break;
+    }
+}
+
+void i2c_prepare_write_burst(I2CTransfer* xfer, uint8_t addr, uint8_t reg, const uint8_t* buf, uint16_t len) {
+    xfer->addr = addr;
+    xfer->reg = reg;
+    xfer->reg_len = 1;
+    xfer->tx_buf = buf;
+    xfer->tx_len = len;
+    xfer->rx_buf = 0;
+    xfer->rx_len = 0;
+    xfer->done = 0;
+    xfer->user = 0;
+}
+
+void i2c_prepare_read_burst(I2CTransfer* xfer, uint8_t addr, uint8_t reg, uint8_t* buf, uint16_t len) {
+    xfer->addr = addr;
+    xfer->reg = reg;
+    xfer->reg_len = 1;
+    xfer->tx_buf = 0;
+    xfer->tx_len = 0;
+    xfer->rx_buf = buf;
+    xfer->rx_len = len;
+    xfer->done = 0;
+    xfer->user = 0;
+}
+
+// Submits 'xfer' and waits for it
+static int run_blocking(I2CDriverState* state, I2CTransfer* xfer) {
+    if (i2c_submit(state, xfer) < 0) {
+        return -1;
+    }
+    while (xfer->result == I2C_PENDING) {
+        if (state->wait != 0) {
+            state->wait();
+        }
+    }
+    return xfer->result;
+}
+
+int i2c_write_burst(I2CDriverState* state, uint8_t addr, uint8_t reg, const uint8_t* buf, uint16_t len) {
+    I2CTransfer xfer;
+
+    i2c_prepare_write_burst(&xfer, addr, reg, buf, len);
+    return run_blocking(state, &xfer);
+}
+
+int i2c_read_burst(I2CDriverState* state, uint8_t addr, uint8_t reg, uint8_t* buf, uint16_t len) {
+    I2CTransfer xfer;
+
+    i2c_prepare_read_burst(&xfer, addr, reg, buf, len);
+    return run_blocking(state, &xfer);
 }
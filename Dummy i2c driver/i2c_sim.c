@@ -0,0 +1,88 @@
+#include <string.h>
+#include "i2c_sim.h"
+
+#define COMMAND_BITS (I2C_START | I2C_STOP | I2C_READ | I2C_WRITE)
+
+void i2c_sim_init(I2CSim* sim, uint32_t bus_khz) {
+    memset(sim, 0, sizeof(*sim));
+    sim->bit_ns = 1000000u / bus_khz;
+    sim->regs.clock = (uint16_t)bus_khz;
+}
+
+void i2c_sim_add_slave(I2CSim* sim, I2CSlave* slave, uint8_t address) {
+    if (sim->num_slaves < I2C_SIM_MAX_SLAVES) {
+        slave->address = address;
+        slave->pointer = 0;
+        slave->pointer_set = 0;
+        slave->busy_starts = 0;
+        sim->slaves[sim->num_slaves++] = slave;
+    }
+}
+
+// START/repeated START and the address byte; returns 1 if a slave acknowledged
+static int bus_start(I2CSim* sim) {
+    uint8_t addr = (uint8_t)(sim->regs.address >> 1);
+    int i;
+
+    sim->selected = 0;
+    for (i = 0; i < sim->num_slaves; i++) {
+        if (sim->slaves[i]->address == addr) {
+            if (sim->slaves[i]->busy_starts > 0) {
+                sim->slaves[i]->busy_starts--;
+                return 0;
+            }
+            sim->selected = sim->slaves[i];
+            sim->selected->pointer_set = 0;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int i2c_sim_step(I2CSim* sim) {
+    uint16_t command = sim->regs.control & COMMAND_BITS;
+    uint16_t status = I2C_DONE;
+    uint32_t bits;
+
+    if (command == 0 || !(sim->regs.control & I2C_ENABLE)) {
+        return 0;
+    }
+    if (sim->regs.clock != 0) {
+        sim->bit_ns = 1000000u / sim->regs.clock;
+    }
+
+    if (command & I2C_START) {
+        bits = 1 + 9;                   // START + address + ACK
+        if (!bus_start(sim)) {
+            status |= I2C_NACK;
+        }
+    } else if (command & I2C_WRITE) {
+        bits = 9;
+        if (sim->selected == 0) {
+            status |= I2C_NACK;
+        } else if (!sim->selected->pointer_set) {
+            sim->selected->pointer = (uint8_t)sim->regs.data;
+            sim->selected->pointer_set = 1;
+        } else {
+            sim->selected->regs[sim->selected->pointer++] = (uint8_t)sim->regs.data;
+        }
+    } else if (command & I2C_READ) {
+        bits = 9;                       // The master drives ACK/NACK, nothing to check
+        sim->regs.data = (sim->selected != 0) ? sim->selected->regs[sim->selected->pointer++] : 0xFF;
+    } else {
+        bits = 1;                       // STOP
+        sim->selected = 0;
+    }
+
+    sim->now_ns += (uint64_t)bits * sim->bit_ns;
+    sim->busy_ns += (uint64_t)bits * sim->bit_ns;
+    sim->commands++;
+
+    // Command finished: clear it, report, interrupt
+    sim->regs.control &= (uint16_t)~COMMAND_BITS;
+    sim->regs.status = status;
+    if (sim->regs.control & I2C_IRQ_EN) {
+        i2c_isr();
+    }
+    return 1;
+}
@@ -0,0 +1,48 @@
+#ifndef I2C_SIM_H
+#define I2C_SIM_H
+
+#include <stdint.h>
+#include "drv.h"
+
+// Host simulation of the I2C controller and the slaves on its bus.
+// The driver talks to 'regs' exactly as it would to the memory mapped
+// I2CDevice; i2c_sim_step() plays the hardware: it executes the command
+// written to 'control', advances the simulated clock by the time the bus
+// needs for it, sets 'status' and calls i2c_isr() if I2C_IRQ_EN is set.
+
+#define I2C_SIM_MAX_SLAVES 4
+
+// Slave with 256 byte registers: the first byte written after the address
+// selects the register, further bytes are written from there on and reads
+// continue from there, the register pointer auto-incrementing (like most
+// sensors and EEPROMs).
+typedef struct {
+    uint8_t address;            // 7 bit address
+    uint8_t regs[256];
+    uint8_t pointer;
+    int pointer_set;            // Register byte received in this write
+    int busy_starts;            // NACK this many address bytes (e.g. EEPROM write cycle)
+} I2CSlave;
+
+typedef struct {
+    struct I2CDevice regs;      // What the driver sees
+    I2CSlave* slaves[I2C_SIM_MAX_SLAVES];
+    int num_slaves;
+    I2CSlave* selected;         // Addressed slave, 0 if none
+
+    uint32_t bit_ns;            // One SCL period, follows regs.clock
+    uint64_t now_ns;            // Simulated time
+    uint64_t busy_ns;           // Time the bus was driven
+    uint32_t commands;
+} I2CSim;
+
+// Resets the simulation for a bus running at 'bus_khz'
+void i2c_sim_init(I2CSim* sim, uint32_t bus_khz);
+
+// Puts a slave on the bus
+void i2c_sim_add_slave(I2CSim* sim, I2CSlave* slave, uint8_t address);
+
+// Executes the pending command, if any. Returns 1 if one was executed.
+int i2c_sim_step(I2CSim* sim);
+
+#endif // I2C_SIM_H
@@ -0,0 +1,151 @@
+// Host test of the interrupt driven transaction engine against the simulated bus.
+// Build (the driver header is included as drv.h):
+//   ln -sf i2_drv.h drv.h && gcc -O2 -Wall -I../regs -o i2c_test i2c_test.c i2c_drv.c i2c_sim.c
+// With the register access trace:
+//   gcc -O2 -Wall -I../regs -DREGS_TRACE -o i2c_test i2c_test.c i2c_drv.c i2c_sim.c ../regs/regs_trace.c
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "drv.h"
+#include "i2c_sim.h"
+#ifdef REGS_TRACE
+#include "regs_trace.h"
+#endif
+
+#define IMU_ADDR 0x68
+#define EEPROM_ADDR 0x50
+#define ABSENT_ADDR 0x23
+#define ACCEL_REG 0x3B
+
+static int callbacks;
+static I2CSim sim;
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void on_done(I2CTransfer* xfer) {
+    (void)xfer;
+    callbacks++;
+}
+
+// Blocking calls wait here: the hardware moves on by one command
+static void step_bus(void) {
+    i2c_sim_step(&sim);
+}
+
+// Reads the 6 accelerometer registers one blocking transfer per register, then
+// as one burst, and writes and reads back an EEPROM page with the burst calls
+static int test_bursts(I2CDriverState* state, I2CSlave* eeprom) {
+    static const uint8_t data[] = "burst write";
+    uint8_t accel[6], readback[sizeof(data)];
+    uint32_t commands;
+    uint64_t busy_ns, single_ns;
+    int i, errors = 0;
+
+    state->wait = step_bus;
+
+    commands = sim.commands;
+    busy_ns = sim.busy_ns;
+    for (i = 0; i < 6; i++) {
+        errors += (i2c_read_burst(state, IMU_ADDR, (uint8_t)(ACCEL_REG + i), &accel[i], 1) != I2C_OK);
+        errors += (accel[i] != 0xA0 + i);
+    }
+    single_ns = sim.busy_ns - busy_ns;
+    printf("6 single register reads: %u commands, %.1f us on the bus\n",
+           (unsigned)(sim.commands - commands), single_ns / 1000.0);
+
+    memset(accel, 0, sizeof(accel));
+    commands = sim.commands;
+    busy_ns = sim.busy_ns;
+#ifdef REGS_TRACE
+    regs_trace_reset();
+#endif
+    errors += (i2c_read_burst(state, IMU_ADDR, ACCEL_REG, accel, sizeof(accel)) != I2C_OK);
+#ifdef REGS_TRACE
+    // Per command: control written once, status read and cleared in the ISR,
+    // plus the address for the two STARTs, the register byte and the 6 data bytes
+    printf("burst read register accesses: %u (control %u writes, status %u, address %u, data %u)\n",
+           (unsigned)regs_trace_count(),
+           (unsigned)regs_trace_count_of(REGS_WRITE, (uintptr_t)&state->i2c->control),
+           (unsigned)regs_trace_count_of(0, (uintptr_t)&state->i2c->status),
+           (unsigned)regs_trace_count_of(0, (uintptr_t)&state->i2c->address),
+           (unsigned)regs_trace_count_of(0, (uintptr_t)&state->i2c->data));
+    errors += (regs_trace_count_of(REGS_READ, (uintptr_t)&state->i2c->control) != 0);
+#endif
+    for (i = 0; i < 6; i++) {
+        errors += (accel[i] != 0xA0 + i);
+    }
+    printf("1 burst read of 6 registers: %u commands, %.1f us on the bus (%.1fx faster)\n",
+           (unsigned)(sim.commands - commands), (sim.busy_ns - busy_ns) / 1000.0,
+           (double)single_ns / (double)(sim.busy_ns - busy_ns));
+
+    errors += (i2c_write_burst(state, EEPROM_ADDR, 0x40, data, sizeof(data)) != I2C_OK);
+    errors += (memcmp(eeprom->regs + 0x40, data, sizeof(data)) != 0);
+    errors += (i2c_read_burst(state, EEPROM_ADDR, 0x40, readback, sizeof(readback)) != I2C_OK);
+    errors += (memcmp(readback, data, sizeof(data)) != 0);
+    errors += (i2c_read_burst(state, ABSENT_ADDR, 0x00, readback, 1) != I2C_ERR_NACK);
+
+    state->wait = 0;
+    return errors;
+}
+
+int main(void) {
+    static I2CSlave imu, eeprom;
+    I2CDriverState state;
+    const uint8_t accel_reg = ACCEL_REG;
+    const uint8_t page[] = { 0x10, 'A', 'B', 'C', 'D' };    // Register, then data
+    uint8_t accel[6], probe_buf[1], readback[4];
+    double t, submit_us;
+    int i, errors = 0;
+
+    I2CTransfer read_accel = { IMU_ADDR, &accel_reg, 1, accel, sizeof(accel), on_done, 0, 0, 0, 0 };
+    I2CTransfer write_page = { EEPROM_ADDR, page, sizeof(page), 0, 0, on_done, 0, 0, 0, 0 };
+    I2CTransfer probe = { ABSENT_ADDR, &accel_reg, 1, probe_buf, 1, on_done, 0, 0, 0, 0 };
+    I2CTransfer read_page = { EEPROM_ADDR, page, 1, readback, sizeof(readback), on_done, 0, 0, 0, 0 };
+
+    i2c_sim_init(&sim, 400);
+    for (i = 0; i < 6; i++) {
+        imu.regs[ACCEL_REG + i] = (uint8_t)(0xA0 + i);
+    }
+    i2c_sim_add_slave(&sim, &imu, IMU_ADDR);
+    i2c_sim_add_slave(&sim, &eeprom, EEPROM_ADDR);
+
+    state.i2c = &sim.regs;
+    initialize_i2c(&state);
+
+    // The CPU queues everything and goes back to work; the bus runs from the ISR
+    t = now_us();
+    i2c_submit(&state, &read_accel);
+    i2c_submit(&state, &write_page);
+    i2c_submit(&state, &probe);
+    i2c_submit(&state, &read_page);
+    submit_us = now_us() - t;
+    while (i2c_busy(&state)) {
+        i2c_sim_step(&sim);     // The hardware moves on by one command
+    }
+
+    for (i = 0; i < 6; i++) {
+        errors += (accel[i] != 0xA0 + i);
+    }
+    errors += (read_accel.result != I2C_OK);
+    errors += (write_page.result != I2C_OK) || (memcmp(eeprom.regs + 0x10, "ABCD", 4) != 0);
+    errors += (probe.result != I2C_ERR_NACK);
+    errors += (read_page.result != I2C_OK) || (memcmp(readback, "ABCD", 4) != 0);
+    errors += (callbacks != 4);
+
+    printf("4 transfers, %d errors: accel %02X %02X %02X %02X %02X %02X, probe of 0x%02X %s\n",
+           errors, accel[0], accel[1], accel[2], accel[3], accel[4], accel[5], ABSENT_ADDR,
+           probe.result == I2C_ERR_NACK ? "NACKed" : "answered");
+    printf("bus at 400 kHz: %u commands, %.1f us on the bus, %u interrupts, %u NACKs\n",
+           (unsigned)sim.commands, sim.busy_ns / 1000.0, (unsigned)state.interrupts, (unsigned)state.nacks);
+    printf("CPU time to queue the 4 transfers: %.2f us (a polling driver would wait the whole bus time)\n",
+           submit_us);
+
+    errors += test_bursts(&state, &eeprom);
+    printf("bursts: %s\n", errors ? "FAILED" : "ok");
+    return errors != 0;
+}
@@ -0,0 +1,477 @@
+#include <stddef.h>
+#include "enc28j60.h"
+
+#define RX_HEADER_LEN   (2 + RSV_SIZE)  /* Next packet pointer + receive status vector */
+#define FRAME_CRC_LEN   4
+
+static void spi_write_block(const enc28j60_spi *spi, const uint8_t *buf, uint16_t len) {
+    uint16_t i;
+
+    if(NULL != spi->write) {
+        spi->write(buf, len);
+        return;
+    }
+    for(i = 0; i < len; i++) {
+        spi->transfer(buf[i]);
+    }
+}
+
+static void spi_read_block(const enc28j60_spi *spi, uint8_t *buf, uint16_t len) {
+    uint16_t i;
+
+    if(NULL != spi->read) {
+        spi->read(buf, len);
+        return;
+    }
+    for(i = 0; i < len; i++) {
+        buf[i] = spi->transfer(0);
+    }
+}
+
+/* Two byte command (WCR, BFS, BFC) in its own transaction */
+static void command(enc28j60 *dev, uint8_t op, uint8_t arg) {
+    dev->spi->select();
+    dev->spi->transfer(op);
+    dev->spi->transfer(arg);
+    dev->spi->deselect();
+    dev->transactions++;
+}
+
+/* Makes 'reg' reachable: changes only the BSEL bits that differ, and only if needed */
+static void select_bank(enc28j60 *dev, uint16_t reg) {
+    uint8_t bank, clear, set;
+
+    if(ENC28J60_REG_COMMON(reg)) {
+        return;
+    }
+    bank = ENC28J60_REG_BANK(reg);
+    if(bank == dev->bank) {
+        dev->bank_hits++;
+        return;
+    }
+
+    if(dev->bank == ENC28J60_BANK_UNKNOWN) {
+        clear = (uint8_t)(ENC28J60_BIT_ECON1_BSEL & ~bank);
+        set = bank;
+    } else {
+        clear = (uint8_t)(dev->bank & ~bank);
+        set = (uint8_t)(bank & ~dev->bank);
+    }
+    if(clear != 0) {
+        command(dev, ENC28J60_SPI_BFC | ENC28J60_REG_ADDR(ENC28J60_REG_ECON1), clear);
+    }
+    if(set != 0) {
+        command(dev, ENC28J60_SPI_BFS | ENC28J60_REG_ADDR(ENC28J60_REG_ECON1), set);
+    }
+    dev->bank = bank;
+    dev->bank_switches++;
+}
+
+uint8_t enc28j60_read_reg(enc28j60 *dev, uint16_t reg) {
+    uint8_t value;
+
+    select_bank(dev, reg);
+    dev->spi->select();
+    dev->spi->transfer(ENC28J60_SPI_RCR | ENC28J60_REG_ADDR(reg));
+    if(ENC28J60_REG_DUMMY(reg)) {
+        dev->spi->transfer(0);      /* MAC and MII registers answer after a dummy byte */
+    }
+    value = dev->spi->transfer(0);
+    dev->spi->deselect();
+    dev->transactions++;
+
+    REGS_TRACE_ACCESS(REGS_READ, reg, value);
+    return value;
+}
+
+void enc28j60_write_reg(enc28j60 *dev, uint16_t reg, uint8_t value) {
+    select_bank(dev, reg);
+    REGS_TRACE_ACCESS(REGS_WRITE, reg, value);
+    command(dev, ENC28J60_SPI_WCR | ENC28J60_REG_ADDR(reg), value);
+    if(reg == ENC28J60_REG_ECON1) {
+        dev->bank = (uint8_t)REG_GET(ENC28J60_ECON1_BSEL, value);
+    }
+}
+
+uint16_t enc28j60_read_reg16(enc28j60 *dev, uint16_t reg_l) {
+    uint16_t value = enc28j60_read_reg(dev, reg_l);
+
+    return (uint16_t)(value | (enc28j60_read_reg(dev, (uint16_t)(reg_l + 1)) << 8));
+}
+
+void enc28j60_write_reg16(enc28j60 *dev, uint16_t reg_l, uint16_t value) {
+    enc28j60_write_reg(dev, reg_l, (uint8_t)(value & 0xFF));
+    enc28j60_write_reg(dev, (uint16_t)(reg_l + 1), (uint8_t)(value >> 8));
+}
+
+void enc28j60_modify_reg(enc28j60 *dev, uint16_t reg, uint8_t clear, uint8_t set) {
+    if(ENC28J60_REG_DUMMY(reg)) {
+        enc28j60_write_reg(dev, reg, (uint8_t)((enc28j60_read_reg(dev, reg) & ~clear) | set));
+        return;
+    }
+
+    select_bank(dev, reg);
+    if(clear != 0) {
+        REGS_TRACE_ACCESS(REGS_WRITE, reg, clear);
+        command(dev, ENC28J60_SPI_BFC | ENC28J60_REG_ADDR(reg), clear);
+    }
+    if(set != 0) {
+        REGS_TRACE_ACCESS(REGS_WRITE, reg, set);
+        command(dev, ENC28J60_SPI_BFS | ENC28J60_REG_ADDR(reg), set);
+    }
+}
+
+/* Waits for the MII interface to finish. Returns 0 or -1 on timeout. */
+static int phy_wait(enc28j60 *dev) {
+    int i;
+
+    for(i = 0; i < ENC28J60_POLL_LIMIT; i++) {
+        if(!(enc28j60_read_reg(dev, ENC28J60_REG_MISTAT) & ENC28J60_BIT_MISTAT_BUSY)) {
+            return 0;
+        }
+    }
+    return -1;
+}
+
+uint16_t enc28j60_phy_read(enc28j60 *dev, uint8_t reg) {
+    enc28j60_write_reg(dev, ENC28J60_REG_MIREGADR, reg);
+    enc28j60_write_reg(dev, ENC28J60_REG_MICMD, ENC28J60_BIT_MICMD_MIIRD);
+    phy_wait(dev);
+    enc28j60_write_reg(dev, ENC28J60_REG_MICMD, 0);
+    return enc28j60_read_reg16(dev, ENC28J60_REG_MIRDL);
+}
+
+int enc28j60_phy_write(enc28j60 *dev, uint8_t reg, uint16_t value) {
+    enc28j60_write_reg(dev, ENC28J60_REG_MIREGADR, reg);
+    enc28j60_write_reg16(dev, ENC28J60_REG_MIWRL, value);     /* Writing MIWRH starts it */
+    return phy_wait(dev);
+}
+
+static void read_burst(enc28j60 *dev, uint16_t addr, uint8_t *buf, uint16_t len);
+
+void enc28j60_read_buffer(enc28j60 *dev, uint16_t addr, uint8_t *buf, uint16_t len) {
+    read_burst(dev, addr, buf, len);
+}
+
+void enc28j60_write_buffer(enc28j60 *dev, uint16_t addr, const uint8_t *buf, uint16_t len) {
+    enc28j60_write_reg16(dev, ENC28J60_REG_EWRPTL, addr);
+    dev->spi->select();
+    dev->spi->transfer(ENC28J60_SPI_WBM);
+    spi_write_block(dev->spi, buf, len);
+    dev->spi->deselect();
+    dev->transactions++;
+}
+
+int enc28j60_init(enc28j60 *dev, const enc28j60_spi *spi, const uint8_t mac[6]) {
+    int i;
+
+    if((NULL == dev) || (NULL == spi) || (NULL == mac)) {
+        return -1;
+    }
+    dev->spi = spi;
+    dev->bank = ENC28J60_BANK_UNKNOWN;
+    dev->next_packet = ENC28J60_RXSTART;
+    dev->read_pointer = ENC28J60_POINTER_UNKNOWN;
+    dev->transactions = 0;
+    dev->bank_switches = 0;
+    dev->bank_hits = 0;
+    dev->tx_frames = 0;
+    dev->tx_errors = 0;
+    dev->rx_frames = 0;
+    dev->rx_errors = 0;
+    dev->rx_resets = 0;
+    dev->dma_checksums = 0;
+
+    spi->select();
+    spi->transfer(ENC28J60_SPI_SC);
+    spi->deselect();
+    dev->transactions++;
+    dev->bank = 0;              /* ECON1 is cleared by the reset */
+    dev->read_pointer = ENC28J60_POINTER_UNKNOWN;
+
+    for(i = 0; !(enc28j60_read_reg(dev, ENC28J60_REG_ESTAT) & ENC28J60_BIT_ESTAT_CLKRDY); i++) {
+        if(i == ENC28J60_POLL_LIMIT) {
+            return -1;
+        }
+    }
+
+    /* Bank 0: buffer layout. ERXRDPT must be odd (Rev. B errata), so it starts at RXEND. */
+    enc28j60_write_reg16(dev, ENC28J60_REG_ERXSTL, ENC28J60_RXSTART);
+    enc28j60_write_reg16(dev, ENC28J60_REG_ERXNDL, ENC28J60_RXEND);
+    enc28j60_write_reg16(dev, ENC28J60_REG_ERXRDPTL, ENC28J60_RXEND);
+    enc28j60_write_reg16(dev, ENC28J60_REG_ETXSTL, ENC28J60_TXSTART);
+
+    /* Bank 1: receive filters */
+    enc28j60_write_reg(dev, ENC28J60_REG_ERXFCON, ENC28J60_RECEIVE_FILTERS);
+
+    /* Bank 2: MAC, half duplex */
+    enc28j60_write_reg(dev, ENC28J60_REG_MACON1,
+                       ENC28J60_BIT_MACON1_MARXEN | ENC28J60_BIT_MACON1_TXPAUS | ENC28J60_BIT_MACON1_RXPAUS);
+    enc28j60_write_reg(dev, ENC28J60_REG_MACON3, ENC28J60_MAC_CONFIG);
+    enc28j60_write_reg16(dev, ENC28J60_REG_MAMXFLL, ENC28J60_MAX_FRAME);
+    enc28j60_write_reg(dev, ENC28J60_REG_MABBIPG, ENC28J60_MAC_BBIPG_HD);
+    enc28j60_write_reg(dev, ENC28J60_REG_MAIPGL, ENC28J60_MAC_NBBIPGL);
+    enc28j60_write_reg(dev, ENC28J60_REG_MAIPGH, ENC28J60_MAC_NBBIPGH);
+
+    /* Bank 3: station address */
+    enc28j60_write_reg(dev, ENC28J60_REG_MAADR1, mac[0]);
+    enc28j60_write_reg(dev, ENC28J60_REG_MAADR2, mac[1]);
+    enc28j60_write_reg(dev, ENC28J60_REG_MAADR3, mac[2]);
+    enc28j60_write_reg(dev, ENC28J60_REG_MAADR4, mac[3]);
+    enc28j60_write_reg(dev, ENC28J60_REG_MAADR5, mac[4]);
+    enc28j60_write_reg(dev, ENC28J60_REG_MAADR6, mac[5]);
+
+    /* PHY: no loopback of own transmissions in half duplex, LEDs */
+    if((enc28j60_phy_write(dev, ENC28J60_PHY_PHCON2, ENC28J60_BIT_PHCON2_HDLDIS) < 0) ||
+       (enc28j60_phy_write(dev, ENC28J60_PHY_PHLCON, ENC28J60_PHY_LEDCONF) < 0)) {
+        return -1;
+    }
+
+    enc28j60_modify_reg(dev, ENC28J60_REG_ECON2, 0, ENC28J60_BIT_ECON2_AUTOINC);
+    enc28j60_modify_reg(dev, ENC28J60_REG_ECON1, 0, ENC28J60_BIT_ECON1_RXEN);
+    return 0;
+}
+
+int enc28j60_tx_load(enc28j60 *dev, const uint8_t *frame, uint16_t len) {
+    const uint8_t control = ENC28J60_PPCTL_BYTE;
+    int i;
+
+    if((NULL == frame) || (len == 0) || (len > ENC28J60_MAX_FRAME)) {
+        return -1;
+    }
+
+    /* The buffer holds one frame: wait for the previous one to leave */
+    for(i = 0; enc28j60_read_reg(dev, ENC28J60_REG_ECON1) & ENC28J60_BIT_ECON1_TXRTS; i++) {
+        if(i == ENC28J60_POLL_LIMIT) {
+            dev->tx_errors++;
+            return -1;
+        }
+    }
+
+    /* Per packet control byte and the frame in one Write Buffer Memory command */
+    enc28j60_write_reg16(dev, ENC28J60_REG_EWRPTL, ENC28J60_TXSTART);
+    dev->spi->select();
+    dev->spi->transfer(ENC28J60_SPI_WBM);
+    spi_write_block(dev->spi, &control, 1);
+    spi_write_block(dev->spi, frame, len);
+    dev->spi->deselect();
+    dev->transactions++;
+    return 0;
+}
+
+int enc28j60_tx_send(enc28j60 *dev, uint16_t len) {
+    if((len == 0) || (len > ENC28J60_MAX_FRAME)) {
+        return -1;
+    }
+
+    /* Rev. B errata: reset the transmit logic after a transmit error */
+    if(enc28j60_read_reg(dev, ENC28J60_REG_EIR) & ENC28J60_BIT_EIR_TXERIF) {
+        enc28j60_modify_reg(dev, ENC28J60_REG_ECON1, 0, ENC28J60_BIT_ECON1_TXRST);
+        enc28j60_modify_reg(dev, ENC28J60_REG_ECON1, ENC28J60_BIT_ECON1_TXRST, 0);
+        enc28j60_modify_reg(dev, ENC28J60_REG_EIR, ENC28J60_BIT_EIR_TXERIF, 0);
+        dev->tx_errors++;
+    }
+
+    enc28j60_write_reg16(dev, ENC28J60_REG_ETXNDL, (uint16_t)(ENC28J60_TXSTART + len));
+    enc28j60_modify_reg(dev, ENC28J60_REG_EIR, ENC28J60_BIT_EIR_TXIF, 0);
+    enc28j60_modify_reg(dev, ENC28J60_REG_ECON1, 0, ENC28J60_BIT_ECON1_TXRTS);
+    dev->tx_frames++;
+    return 0;
+}
+
+int enc28j60_send_packet(enc28j60 *dev, const uint8_t *frame, uint16_t len) {
+    if(enc28j60_tx_load(dev, frame, len) < 0) {
+        return -1;
+    }
+    return enc28j60_tx_send(dev, len);
+}
+
+/* Buffer address 'n' bytes after 'addr', wrapping inside the RX ring like ERDPT does */
+static uint16_t rx_advance(uint16_t addr, uint16_t n) {
+    const uint16_t size = ENC28J60_RXEND - ENC28J60_RXSTART + 1;
+
+    if((uint16_t)(addr - ENC28J60_RXSTART) >= size) {
+        return (uint16_t)(addr + n);
+    }
+    return (uint16_t)(ENC28J60_RXSTART + (addr - ENC28J60_RXSTART + (uint32_t)n) % size);
+}
+
+/* Points ERDPT at 'addr' unless a previous read already left it there */
+static void set_read_pointer(enc28j60 *dev, uint16_t addr) {
+    if(dev->read_pointer != addr) {
+        enc28j60_write_reg16(dev, ENC28J60_REG_ERDPTL, addr);
+    }
+}
+
+/* Reads 'len' bytes from ERDPT on, in one Read Buffer Memory command */
+static void read_burst(enc28j60 *dev, uint16_t addr, uint8_t *buf, uint16_t len) {
+    set_read_pointer(dev, addr);
+    dev->spi->select();
+    dev->spi->transfer(ENC28J60_SPI_RBM);
+    spi_read_block(dev->spi, buf, len);
+    dev->spi->deselect();
+    dev->transactions++;
+    dev->read_pointer = rx_advance(addr, len);
+}
+
+/* Lost track of the ring (corrupted next packet pointer): drop everything in it and start over */
+static void rx_reset(enc28j60 *dev) {
+    enc28j60_modify_reg(dev, ENC28J60_REG_ECON1, ENC28J60_BIT_ECON1_RXEN, ENC28J60_BIT_ECON1_RXRST);
+    enc28j60_modify_reg(dev, ENC28J60_REG_ECON1, ENC28J60_BIT_ECON1_RXRST, 0);
+    enc28j60_write_reg16(dev, ENC28J60_REG_ERXSTL, ENC28J60_RXSTART);
+    enc28j60_write_reg16(dev, ENC28J60_REG_ERXRDPTL, ENC28J60_RXEND);
+    while(enc28j60_read_reg(dev, ENC28J60_REG_EPKTCNT) != 0) {
+        enc28j60_modify_reg(dev, ENC28J60_REG_ECON2, 0, ENC28J60_BIT_ECON2_PKTDEC);
+    }
+    dev->next_packet = ENC28J60_RXSTART;
+    dev->rx_resets++;
+    enc28j60_modify_reg(dev, ENC28J60_REG_ECON1, 0, ENC28J60_BIT_ECON1_RXEN);
+}
+
+int enc28j60_rx_peek(enc28j60 *dev, enc28j60_rx_desc *desc) {
+    uint8_t header[RX_HEADER_LEN];
+    uint16_t count;
+
+    if(enc28j60_read_reg(dev, ENC28J60_REG_EPKTCNT) == 0) {
+        return 0;
+    }
+
+    read_burst(dev, dev->next_packet, header, RX_HEADER_LEN);
+    desc->next = (uint16_t)(header[0] | (header[1] << 8));
+    count = (uint16_t)(header[2] | (header[3] << 8));
+    desc->status = (uint16_t)(header[4] | (header[5] << 8));
+    desc->start = rx_advance(dev->next_packet, RX_HEADER_LEN);
+    desc->len = (count >= FRAME_CRC_LEN) ? (uint16_t)(count - FRAME_CRC_LEN) : 0;
+
+    /* Packets start on even addresses inside the ring and are no longer than the MAC allows */
+    if((desc->next & 1) || (desc->next > ENC28J60_RXEND) || (count > ENC28J60_MAX_FRAME + FRAME_CRC_LEN)) {
+        dev->rx_errors++;
+        rx_reset(dev);
+        return -1;
+    }
+    return 1;
+}
+
+uint16_t enc28j60_rx_read(enc28j60 *dev, const enc28j60_rx_desc *desc, uint16_t offset, uint8_t *buf, uint16_t len) {
+    if((NULL == buf) || (offset >= desc->len)) {
+        return 0;
+    }
+    if(len > desc->len - offset) {
+        len = (uint16_t)(desc->len - offset);
+    }
+    read_burst(dev, rx_advance(desc->start, offset), buf, len);
+    return len;
+}
+
+void enc28j60_rx_release(enc28j60 *dev, const enc28j60_rx_desc *desc) {
+    uint16_t rdpt;
+
+    if(ENC28J60_RX_OK(desc)) {
+        dev->rx_frames++;
+    } else {
+        dev->rx_errors++;
+    }
+
+    /* ERXRDPT must stay odd (Rev. B errata): free up to the byte before the next packet */
+    dev->next_packet = desc->next;
+    rdpt = (desc->next == ENC28J60_RXSTART) ? ENC28J60_RXEND : (uint16_t)(desc->next - 1);
+    enc28j60_write_reg16(dev, ENC28J60_REG_ERXRDPTL, rdpt);
+    enc28j60_modify_reg(dev, ENC28J60_REG_ECON2, 0, ENC28J60_BIT_ECON2_PKTDEC);
+}
+
+int enc28j60_receive_packet(enc28j60 *dev, uint8_t *buf, uint16_t max) {
+    enc28j60_rx_desc desc;
+    int ret;
+
+    ret = enc28j60_rx_peek(dev, &desc);
+    if(ret <= 0) {
+        return ret;
+    }
+    if(ENC28J60_RX_OK(&desc)) {
+        enc28j60_rx_read(dev, &desc, 0, buf, max);
+    }
+    enc28j60_rx_release(dev, &desc);
+    return ENC28J60_RX_OK(&desc) ? desc.len : -1;
+}
+
+int enc28j60_dma_checksum(enc28j60 *dev, uint16_t start, uint16_t len, uint16_t *csum) {
+    int i;
+
+    if((len == 0) || (NULL == csum)) {
+        return -1;
+    }
+
+    enc28j60_write_reg16(dev, ENC28J60_REG_EDMASTL, start);
+    enc28j60_write_reg16(dev, ENC28J60_REG_EDMANDL, rx_advance(start, (uint16_t)(len - 1)));
+    enc28j60_modify_reg(dev, ENC28J60_REG_ECON1, 0, ENC28J60_BIT_ECON1_CSUMEN | ENC28J60_BIT_ECON1_DMAST);
+    for(i = 0; enc28j60_read_reg(dev, ENC28J60_REG_ECON1) & ENC28J60_BIT_ECON1_DMAST; i++) {
+        if(i == ENC28J60_POLL_LIMIT) {
+            return -1;
+        }
+    }
+    enc28j60_modify_reg(dev, ENC28J60_REG_ECON1, ENC28J60_BIT_ECON1_CSUMEN, 0);
+
+    /* EDMACSH holds the byte that goes first on the wire */
+    *csum = (uint16_t)((enc28j60_read_reg(dev, ENC28J60_REG_EDMACSH) << 8) |
+                       enc28j60_read_reg(dev, ENC28J60_REG_EDMACSL));
+    dev->dma_checksums++;
+    return 0;
+}
+
+int enc28j60_rx_checksum(enc28j60 *dev, const enc28j60_rx_desc *desc, uint16_t offset, uint16_t len,
+                         uint16_t *csum) {
+    if((uint32_t)offset + len > desc->len) {
+        return -1;
+    }
+    return enc28j60_dma_checksum(dev, rx_advance(desc->start, offset), len, csum);
+}
+
+int enc28j60_tx_checksum(enc28j60 *dev, uint16_t offset, uint16_t len, uint16_t store) {
+    uint8_t bytes[2];
+    uint16_t csum;
+
+    /* Frame byte 0 follows the per packet control byte */
+    if(enc28j60_dma_checksum(dev, (uint16_t)(ENC28J60_TXSTART + 1 + offset), len, &csum) < 0) {
+        return -1;
+    }
+    bytes[0] = (uint8_t)(csum >> 8);
+    bytes[1] = (uint8_t)(csum & 0xFF);
+    enc28j60_write_buffer(dev, (uint16_t)(ENC28J60_TXSTART + 1 + store), bytes, 2);
+    return 0;
+}
+
+/*
+ * The MAC's CRC-32 is not the usual reflected one: an MSB first shift
+ * register (poly 0x04C11DB7, init 0xFFFFFFFF) fed the data bits LSB first,
+ * without the final inversion (Microchip's reference code, Linux ether_crc()).
+ */
+uint8_t enc28j60_hash_index(const uint8_t addr[6]) {
+    uint32_t crc = 0xFFFFFFFF;
+    uint8_t byte;
+    int i, bit;
+
+    for(i = 0; i < 6; i++) {
+        byte = addr[i];
+        for(bit = 0; bit < 8; bit++, byte >>= 1) {
+            crc = (((crc >> 31) ^ byte) & 1) ? (crc << 1) ^ 0x04C11DB7 : crc << 1;
+        }
+    }
+    return (uint8_t)((crc >> 23) & 0x3F);
+}
+
+void enc28j60_set_multicast(enc28j60 *dev, const uint8_t (*addrs)[6], int count) {
+    uint8_t table[8] = { 0 }, index;
+    int i;
+
+    for(i = 0; i < count; i++) {
+        index = enc28j60_hash_index(addrs[i]);
+        table[index >> 3] |= (uint8_t)(1u << (index & 7));
+    }
+
+    /* Multicast now only through the hash table: MCEN off, HTEN on */
+    for(i = 0; i < 8; i++) {
+        enc28j60_write_reg(dev, (uint16_t)(ENC28J60_REG_EHT0 + i), table[i]);
+    }
+    enc28j60_write_reg(dev, ENC28J60_REG_ERXFCON,
+                       (ENC28J60_RECEIVE_FILTERS & ~ENC28J60_BIT_ERXFCON_MCEN) | ENC28J60_BIT_ERXFCON_HTEN);
+}
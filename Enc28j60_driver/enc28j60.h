@@ -0,0 +1,157 @@
+#ifndef ENC28J60_H
+#define ENC28J60_H
+
+#include <stdint.h>
+#include "enc28j60_regs.h"
+
+/*
+ * ENC28J60 driver.
+ *
+ * Two things decide the throughput with this chip:
+ *  - bank switches: every banked register access may need ECON1 changed
+ *    first. The driver remembers the selected bank and only touches ECON1
+ *    when it really changes, and then only the BSEL bits that differ.
+ *  - SPI transactions: packets move with one Read/Write Buffer Memory
+ *    command each (chip select held for the whole packet), never byte by
+ *    byte.
+ */
+
+#define ENC28J60_MAX_FRAME      1518    /* Without the CRC, which the MAC adds/strips */
+#define ENC28J60_POLL_LIMIT     10000   /* Status polls before giving up */
+#define ENC28J60_BANK_UNKNOWN   0xFF
+#define ENC28J60_POINTER_UNKNOWN 0xFFFF
+
+/* Receive status vector bits 16-31 */
+#define ENC28J60_RSV_RECEIVED_OK    0x0080
+#define ENC28J60_RSV_MULTICAST      0x0100
+#define ENC28J60_RSV_BROADCAST      0x0200
+
+/*
+ * SPI port. 'write' and 'read' move a block with chip select held and may be
+ * NULL, then 'transfer' is called per byte.
+ */
+typedef struct {
+    void (*select)(void);
+    void (*deselect)(void);
+    uint8_t (*transfer)(uint8_t byte);
+    void (*write)(const uint8_t *buf, uint16_t len);
+    void (*read)(uint8_t *buf, uint16_t len);
+} enc28j60_spi;
+
+typedef struct {
+    const enc28j60_spi *spi;
+    uint8_t bank;               /* Bank selected in ECON1 or ENC28J60_BANK_UNKNOWN */
+    uint16_t next_packet;       /* Start of the next packet in the RX ring */
+    uint16_t read_pointer;      /* ERDPT as left by the last buffer read */
+
+    /* Statistics */
+    uint32_t transactions;      /* Chip select cycles */
+    uint32_t bank_switches;     /* ECON1 changed to reach a register */
+    uint32_t bank_hits;         /* Banked accesses that needed no switch */
+    uint32_t tx_frames;
+    uint32_t tx_errors;
+    uint32_t rx_frames;
+    uint32_t rx_errors;
+    uint32_t rx_resets;         /* Ring dropped after a corrupted packet header */
+    uint32_t dma_checksums;
+} enc28j60;
+
+/*
+ * A received packet left in the chip's RX ring. Only its 6 byte header has
+ * crossed SPI; the frame is read on demand with enc28j60_rx_read().
+ */
+typedef struct {
+    uint16_t start;             /* Buffer address of the first frame byte */
+    uint16_t len;               /* Frame length, without the CRC */
+    uint16_t next;              /* Next packet pointer */
+    uint16_t status;            /* Receive status vector bits 16-31 */
+} enc28j60_rx_desc;
+
+#define ENC28J60_RX_OK(desc)    (((desc)->status & ENC28J60_RSV_RECEIVED_OK) != 0)
+
+/* Resets and configures the chip (half duplex), enables reception. Returns 0 or -1. */
+int enc28j60_init(enc28j60 *dev, const enc28j60_spi *spi, const uint8_t mac[6]);
+
+/* Control registers, 'reg' is an ENC28J60_REG_* code */
+uint8_t enc28j60_read_reg(enc28j60 *dev, uint16_t reg);
+void enc28j60_write_reg(enc28j60 *dev, uint16_t reg, uint8_t value);
+
+/* Register pairs (..L, ..H): low byte first */
+uint16_t enc28j60_read_reg16(enc28j60 *dev, uint16_t reg_l);
+void enc28j60_write_reg16(enc28j60 *dev, uint16_t reg_l, uint16_t value);
+
+/*
+ * Clears then sets bits. ETH registers use the Bit Field Clear/Set commands
+ * (one SPI command each, no read); MAC and MII registers do not support them
+ * and are read, modified and written.
+ */
+void enc28j60_modify_reg(enc28j60 *dev, uint16_t reg, uint8_t clear, uint8_t set);
+
+/* PHY registers through the MII interface */
+uint16_t enc28j60_phy_read(enc28j60 *dev, uint8_t reg);
+int enc28j60_phy_write(enc28j60 *dev, uint8_t reg, uint16_t value);
+
+/* Buffer memory, one SPI transaction per call */
+void enc28j60_read_buffer(enc28j60 *dev, uint16_t addr, uint8_t *buf, uint16_t len);
+void enc28j60_write_buffer(enc28j60 *dev, uint16_t addr, const uint8_t *buf, uint16_t len);
+
+/* Sends one frame (destination MAC onwards, no CRC). Returns 0 or -1. */
+int enc28j60_send_packet(enc28j60 *dev, const uint8_t *frame, uint16_t len);
+
+/*
+ * enc28j60_send_packet() in two steps, so the frame can be completed in the
+ * chip in between (e.g. enc28j60_tx_checksum()): load waits for the previous
+ * frame and writes this one to the TX buffer, send starts the transmission.
+ */
+int enc28j60_tx_load(enc28j60 *dev, const uint8_t *frame, uint16_t len);
+int enc28j60_tx_send(enc28j60 *dev, uint16_t len);
+
+/*
+ * Checksum offload: the DMA engine computes the Internet checksum (one's
+ * complement of the one's complement sum, an odd last byte padded with zero)
+ * of 'len' buffer bytes from 'start', wrapping in the RX ring. 'csum' has the
+ * byte that goes first on the wire in its high half. Returns 0 or -1.
+ */
+int enc28j60_dma_checksum(enc28j60 *dev, uint16_t start, uint16_t len, uint16_t *csum);
+
+/* Checksum of frame bytes [offset, offset + len) of a received packet; 0 means the sum checks */
+int enc28j60_rx_checksum(enc28j60 *dev, const enc28j60_rx_desc *desc, uint16_t offset, uint16_t len,
+                         uint16_t *csum);
+
+/* Checksum of frame bytes [offset, offset + len) of the loaded TX frame, stored at frame byte 'store' */
+int enc28j60_tx_checksum(enc28j60 *dev, uint16_t offset, uint16_t len, uint16_t store);
+
+/*
+ * Multicast hash filter: the MAC accepts a multicast frame when the bit of
+ * the 64 bit table (EHT0-EHT7) selected by bits 28:23 of the CRC-32 of its
+ * destination address is set (the MAC's own CRC: 01-00-00-00-01-2C gives
+ * 0xDA0B4575, bit 0x34). Programs the table from 'count' addresses and
+ * switches multicast reception from "all" (MCEN) to the table (HTEN).
+ */
+void enc28j60_set_multicast(enc28j60 *dev, const uint8_t (*addrs)[6], int count);
+uint8_t enc28j60_hash_index(const uint8_t addr[6]);
+
+/*
+ * Zero-copy receive: peek at the next packet, read the parts the upper layer
+ * needs (e.g. the headers to filter on), then release it. Reads at any offset
+ * follow the ring wrap; a read continuing where the previous one stopped does
+ * not re-write ERDPT.
+ *
+ * enc28j60_rx_peek() returns 1 and fills 'desc', 0 if no packet is waiting, or
+ * -1 if the header is corrupted (the ring is then reset and its packets lost).
+ * enc28j60_rx_read() copies up to 'len' frame bytes from 'offset' and returns
+ * how many. enc28j60_rx_release() frees the packet in the chip; 'desc' must be
+ * the last one peeked.
+ */
+int enc28j60_rx_peek(enc28j60 *dev, enc28j60_rx_desc *desc);
+uint16_t enc28j60_rx_read(enc28j60 *dev, const enc28j60_rx_desc *desc, uint16_t offset, uint8_t *buf, uint16_t len);
+void enc28j60_rx_release(enc28j60 *dev, const enc28j60_rx_desc *desc);
+
+/*
+ * Copies the next received frame into 'buf' (at most 'max' bytes, the rest is
+ * dropped) and frees it in the chip. Returns the frame length, 0 if none
+ * is waiting, -1 if the frame was bad (it is freed as well).
+ */
+int enc28j60_receive_packet(enc28j60 *dev, uint8_t *buf, uint16_t max);
+
+#endif /* ENC28J60_H */
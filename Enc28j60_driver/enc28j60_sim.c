@@ -0,0 +1,346 @@
+#include <string.h>
+#include "enc28j60_sim.h"
+
+#define ADDR(r)         ENC28J60_REG_ADDR(r)
+#define MEM_MASK        (ENC28J60_SIM_MEM_LEN - 1)
+#define RSV_RECEIVED_OK 0x80
+#define RSV_MULTICAST   0x01
+#define RSV_BROADCAST   0x02
+#define TSV_DONE        0x80
+
+static const uint8_t broadcast[6] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+
+static enc28j60_sim *current;
+
+static uint8_t *reg_at(enc28j60_sim *sim, uint8_t addr) {
+    uint8_t bank = (uint8_t)REG_GET(ENC28J60_ECON1_BSEL, sim->regs[0][ADDR(ENC28J60_REG_ECON1)]);
+
+    return (addr >= ADDR(ENC28J60_REG_EIE)) ? &sim->regs[0][addr] : &sim->regs[bank][addr];
+}
+
+/* MAC and MII registers answer RCR after a dummy byte */
+static int is_mac_mii(uint8_t bank, uint8_t addr) {
+    return (bank == 2 && addr < ADDR(ENC28J60_REG_EIE)) ||
+           (bank == 3 && (addr <= ADDR(ENC28J60_REG_MAADR2) || addr == ADDR(ENC28J60_REG_MISTAT)));
+}
+
+/* Bank 0 register pairs */
+static uint16_t get16(const enc28j60_sim *sim, uint16_t reg_l) {
+    return (uint16_t)(sim->regs[0][ADDR(reg_l)] | (sim->regs[0][ADDR(reg_l) + 1] << 8));
+}
+
+static void set16(enc28j60_sim *sim, uint16_t reg_l, uint16_t value) {
+    sim->regs[0][ADDR(reg_l)] = (uint8_t)(value & 0xFF);
+    sim->regs[0][ADDR(reg_l) + 1] = (uint8_t)(value >> 8);
+}
+
+static void reset(enc28j60_sim *sim) {
+    memset(sim->regs, 0, sizeof(sim->regs));
+    memset(sim->phy, 0, sizeof(sim->phy));
+    sim->regs[0][ADDR(ENC28J60_REG_ECON2)] = ENC28J60_BIT_ECON2_AUTOINC;
+    sim->regs[0][ADDR(ENC28J60_REG_ESTAT)] = ENC28J60_BIT_ESTAT_CLKRDY;
+    set16(sim, ENC28J60_REG_ERDPTL, 0x05FA);
+    set16(sim, ENC28J60_REG_ERXSTL, 0x05FA);
+    set16(sim, ENC28J60_REG_ERXNDL, 0x1FFF);
+    set16(sim, ENC28J60_REG_ERXRDPTL, 0x05FA);
+    set16(sim, ENC28J60_REG_ERXWRPTL, 0x0000);
+    sim->regs[3][ADDR(ENC28J60_REG_EREVID)] = 0x06;
+    sim->phy[ENC28J60_PHY_PHID1] = 0x0083;
+    sim->phy[ENC28J60_PHY_PHID2] = 0x1400;
+    sim->phy[ENC28J60_PHY_PHLCON] = 0x3422;
+}
+
+/* Copies ETXST+1..ETXND out (ETXST holds the control byte) and writes the status vector */
+static void transmit(enc28j60_sim *sim) {
+    uint16_t start = get16(sim, ENC28J60_REG_ETXSTL), end = get16(sim, ENC28J60_REG_ETXNDL);
+    uint16_t len = (uint16_t)(end - start), i;
+    uint8_t *tsv;
+
+    if(end > start && len <= ENC28J60_SIM_TX_LEN) {
+        for(i = 0; i < len; i++) {
+            sim->tx_frame[i] = sim->mem[(start + 1 + i) & MEM_MASK];
+        }
+        sim->tx_len = len;
+        sim->tx_frames++;
+    }
+    tsv = &sim->mem[(end + 1) & MEM_MASK];
+    memset(tsv, 0, TSV_SIZE);
+    tsv[0] = (uint8_t)(len & 0xFF);
+    tsv[1] = (uint8_t)(len >> 8);
+    tsv[2] = TSV_DONE;
+
+    sim->regs[0][ADDR(ENC28J60_REG_ECON1)] &= (uint8_t)~ENC28J60_BIT_ECON1_TXRTS;
+    sim->regs[0][ADDR(ENC28J60_REG_EIR)] |= ENC28J60_BIT_EIR_TXIF;
+}
+
+/* Buffer address after 'addr' for the DMA: it follows the RX ring wrap like ERDPT */
+static uint16_t dma_next(const enc28j60_sim *sim, uint16_t addr) {
+    return (addr == get16(sim, ENC28J60_REG_ERXNDL)) ? get16(sim, ENC28J60_REG_ERXSTL)
+                                                     : (uint16_t)((addr + 1) & MEM_MASK);
+}
+
+/*
+ * ECON1.DMAST: with CSUMEN the Internet checksum of EDMAST..EDMAND goes to
+ * EDMACS, otherwise the block is copied to EDMADST. Done at once here.
+ */
+static void dma(enc28j60_sim *sim) {
+    uint16_t addr = get16(sim, ENC28J60_REG_EDMASTL) & MEM_MASK, end = get16(sim, ENC28J60_REG_EDMANDL) & MEM_MASK;
+    uint16_t dst = get16(sim, ENC28J60_REG_EDMADSTL) & MEM_MASK;
+    uint32_t sum = 0, n = 0;
+
+    for(;; n++) {
+        if(sim->regs[0][ADDR(ENC28J60_REG_ECON1)] & ENC28J60_BIT_ECON1_CSUMEN) {
+            sum += (n & 1) ? sim->mem[addr] : (uint32_t)(sim->mem[addr] << 8);
+        } else {
+            sim->mem[dst] = sim->mem[addr];
+            dst = dma_next(sim, dst);
+        }
+        if(addr == end) {
+            break;
+        }
+        addr = dma_next(sim, addr);
+    }
+    while(sum >> 16) {
+        sum = (sum & 0xFFFF) + (sum >> 16);
+    }
+    sum = ~sum & 0xFFFF;
+    if(sim->regs[0][ADDR(ENC28J60_REG_ECON1)] & ENC28J60_BIT_ECON1_CSUMEN) {
+        sim->regs[0][ADDR(ENC28J60_REG_EDMACSH)] = (uint8_t)(sum >> 8);
+        sim->regs[0][ADDR(ENC28J60_REG_EDMACSL)] = (uint8_t)(sum & 0xFF);
+    }
+    sim->dma_bytes += n + 1;
+    sim->regs[0][ADDR(ENC28J60_REG_ECON1)] &= (uint8_t)~ENC28J60_BIT_ECON1_DMAST;
+    sim->regs[0][ADDR(ENC28J60_REG_EIR)] |= ENC28J60_BIT_EIR_DMAIF;
+}
+
+/* The MAC's CRC-32 for the hash filter: MSB first register, data bits in LSB first, no final inversion */
+static uint32_t mac_crc(const uint8_t *data, int len) {
+    uint32_t crc = 0xFFFFFFFF;
+    int i, bit;
+
+    for(i = 0; i < len; i++) {
+        for(bit = 0; bit < 8; bit++) {
+            crc = (((crc >> 31) ^ (uint32_t)(data[i] >> bit)) & 1) ? (crc << 1) ^ 0x04C11DB7 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+/* ERXFCON in OR mode (ANDOR clear): accept if one enabled filter matches, everything if none is enabled */
+static int accept(const enc28j60_sim *sim, const uint8_t *dest) {
+    static const uint16_t maadr[6] = { ENC28J60_REG_MAADR1, ENC28J60_REG_MAADR2, ENC28J60_REG_MAADR3,
+                                       ENC28J60_REG_MAADR4, ENC28J60_REG_MAADR5, ENC28J60_REG_MAADR6 };
+    uint8_t filters = sim->regs[1][ADDR(ENC28J60_REG_ERXFCON)], index;
+    int i, unicast = 1, bcast = (memcmp(dest, broadcast, 6) == 0);
+
+    for(i = 0; i < 6; i++) {
+        unicast &= (dest[i] == enc28j60_sim_reg(sim, maadr[i]));
+    }
+    if(!(filters & (ENC28J60_BIT_ERXFCON_UCEN | ENC28J60_BIT_ERXFCON_HTEN | ENC28J60_BIT_ERXFCON_MCEN |
+                    ENC28J60_BIT_ERXFCON_BCEN))) {
+        return 1;
+    }
+    index = (uint8_t)((mac_crc(dest, 6) >> 23) & 0x3F);
+    return ((filters & ENC28J60_BIT_ERXFCON_UCEN) && unicast) ||
+           ((filters & ENC28J60_BIT_ERXFCON_BCEN) && bcast) ||
+           ((filters & ENC28J60_BIT_ERXFCON_MCEN) && (dest[0] & 1) && !bcast) ||
+           ((filters & ENC28J60_BIT_ERXFCON_HTEN) &&
+            (sim->regs[1][ADDR(ENC28J60_REG_EHT0) + (index >> 3)] & (1u << (index & 7))));
+}
+
+/* A register write from WCR, BFS or BFC, with the side effects of the chip */
+static void write_reg(enc28j60_sim *sim, uint8_t addr, uint8_t value) {
+    uint8_t bank = (uint8_t)REG_GET(ENC28J60_ECON1_BSEL, sim->regs[0][ADDR(ENC28J60_REG_ECON1)]);
+    uint8_t *reg = reg_at(sim, addr);
+    uint8_t old = *reg;
+
+    if(addr == ADDR(ENC28J60_REG_ECON1)) {
+        sim->econ1_writes++;
+        *reg = value;
+        if((value & ENC28J60_BIT_ECON1_TXRTS) && !(old & ENC28J60_BIT_ECON1_TXRTS)) {
+            transmit(sim);
+        }
+        if((value & ENC28J60_BIT_ECON1_DMAST) && !(old & ENC28J60_BIT_ECON1_DMAST)) {
+            dma(sim);
+        }
+        return;
+    }
+    if(addr == ADDR(ENC28J60_REG_ECON2)) {
+        if(value & ENC28J60_BIT_ECON2_PKTDEC) {
+            uint8_t *count = &sim->regs[1][ADDR(ENC28J60_REG_EPKTCNT)];
+            if(*count > 0 && --*count == 0) {
+                sim->regs[0][ADDR(ENC28J60_REG_EIR)] &= (uint8_t)~ENC28J60_BIT_EIR_PKTIF;
+            }
+        }
+        *reg = (uint8_t)(value & ~ENC28J60_BIT_ECON2_PKTDEC);
+        return;
+    }
+    if(addr == ADDR(ENC28J60_REG_ESTAT)) {
+        return;                                 /* Read only here */
+    }
+
+    if(bank == 1 && addr == ADDR(ENC28J60_REG_EPKTCNT)) {
+        return;
+    }
+    if(bank == 3 && addr == ADDR(ENC28J60_REG_MISTAT)) {
+        return;
+    }
+    *reg = value;
+
+    if(bank == 0 && addr == ADDR(ENC28J60_REG_ERXSTH)) {
+        set16(sim, ENC28J60_REG_ERXWRPTL, get16(sim, ENC28J60_REG_ERXSTL));
+    } else if(bank == 2 && addr == ADDR(ENC28J60_REG_MICMD) && (value & ENC28J60_BIT_MICMD_MIIRD)) {
+        uint16_t v = sim->phy[sim->regs[2][ADDR(ENC28J60_REG_MIREGADR)] & 0x1F];
+        sim->regs[2][ADDR(ENC28J60_REG_MIRDL)] = (uint8_t)(v & 0xFF);
+        sim->regs[2][ADDR(ENC28J60_REG_MIRDH)] = (uint8_t)(v >> 8);
+    } else if(bank == 2 && addr == ADDR(ENC28J60_REG_MIWRH)) {
+        sim->phy[sim->regs[2][ADDR(ENC28J60_REG_MIREGADR)] & 0x1F] =
+            (uint16_t)(sim->regs[2][ADDR(ENC28J60_REG_MIWRL)] | (value << 8));
+    }
+}
+
+/* Read Buffer Memory: ERDPT wraps from ERXND back to ERXST */
+static uint8_t read_mem(enc28j60_sim *sim) {
+    uint16_t addr = get16(sim, ENC28J60_REG_ERDPTL) & MEM_MASK;
+    uint8_t value = sim->mem[addr];
+
+    if(sim->regs[0][ADDR(ENC28J60_REG_ECON2)] & ENC28J60_BIT_ECON2_AUTOINC) {
+        addr = (addr == get16(sim, ENC28J60_REG_ERXNDL)) ? get16(sim, ENC28J60_REG_ERXSTL)
+                                                         : (uint16_t)((addr + 1) & MEM_MASK);
+        set16(sim, ENC28J60_REG_ERDPTL, addr);
+    }
+    return value;
+}
+
+static void write_mem(enc28j60_sim *sim, uint8_t value) {
+    uint16_t addr = get16(sim, ENC28J60_REG_EWRPTL) & MEM_MASK;
+
+    sim->mem[addr] = value;
+    if(sim->regs[0][ADDR(ENC28J60_REG_ECON2)] & ENC28J60_BIT_ECON2_AUTOINC) {
+        set16(sim, ENC28J60_REG_EWRPTL, (uint16_t)((addr + 1) & MEM_MASK));
+    }
+}
+
+static void sim_select(void) {
+    current->selected = 1;
+    current->position = 0;
+    current->transactions++;
+}
+
+static void sim_deselect(void) {
+    current->selected = 0;
+}
+
+static uint8_t sim_transfer(uint8_t byte) {
+    enc28j60_sim *sim = current;
+    uint32_t pos = sim->position++;
+    uint8_t addr, bank;
+
+    sim->spi_bytes++;
+    if(!sim->selected) {
+        return 0xFF;
+    }
+    if(pos == 0) {
+        sim->opcode = byte;
+        if(byte == ENC28J60_SPI_SC) {
+            reset(sim);
+        }
+        return 0;
+    }
+    if(sim->opcode == ENC28J60_SPI_RBM) {
+        return read_mem(sim);
+    }
+    if(sim->opcode == ENC28J60_SPI_WBM) {
+        write_mem(sim, byte);
+        return 0;
+    }
+
+    addr = sim->opcode & 0x1F;
+    bank = (uint8_t)REG_GET(ENC28J60_ECON1_BSEL, sim->regs[0][ADDR(ENC28J60_REG_ECON1)]);
+    switch(sim->opcode & 0xE0) {
+        case ENC28J60_SPI_RCR:
+            if(pos == 1 && addr < ADDR(ENC28J60_REG_EIE) && is_mac_mii(bank, addr)) {
+                return 0;               /* Dummy byte */
+            }
+            return *reg_at(sim, addr);
+        case ENC28J60_SPI_WCR:
+            if(pos == 1) {
+                write_reg(sim, addr, byte);
+            }
+            break;
+        case ENC28J60_SPI_BFS:
+            if(pos == 1) {
+                write_reg(sim, addr, (uint8_t)(*reg_at(sim, addr) | byte));
+            }
+            break;
+        case ENC28J60_SPI_BFC:
+            if(pos == 1) {
+                write_reg(sim, addr, (uint8_t)(*reg_at(sim, addr) & ~byte));
+            }
+            break;
+    }
+    return 0;
+}
+
+const enc28j60_spi enc28j60_sim_spi = { sim_select, sim_deselect, sim_transfer, NULL, NULL };
+
+void enc28j60_sim_init(enc28j60_sim *sim) {
+    memset(sim, 0, sizeof(*sim));
+    reset(sim);
+    current = sim;
+}
+
+uint8_t enc28j60_sim_reg(const enc28j60_sim *sim, uint16_t reg) {
+    if(ENC28J60_REG_COMMON(reg)) {
+        return sim->regs[0][ADDR(reg)];
+    }
+    return sim->regs[ENC28J60_REG_BANK(reg)][ADDR(reg)];
+}
+
+int enc28j60_sim_receive(enc28j60_sim *sim, const uint8_t *frame, uint16_t len) {
+    uint16_t start = get16(sim, ENC28J60_REG_ERXSTL), end = get16(sim, ENC28J60_REG_ERXNDL);
+    uint16_t wr = get16(sim, ENC28J60_REG_ERXWRPTL), rd = get16(sim, ENC28J60_REG_ERXRDPTL);
+    uint32_t size = (uint32_t)(end - start) + 1, room, need, i;
+    uint16_t next, count = (uint16_t)(len + 4);
+    uint8_t header[6];
+
+    if(!(sim->regs[0][ADDR(ENC28J60_REG_ECON1)] & ENC28J60_BIT_ECON1_RXEN) || end <= start) {
+        sim->rx_dropped++;
+        return -1;
+    }
+    if(len < 6 || !accept(sim, frame)) {
+        sim->rx_filtered++;
+        return -1;
+    }
+
+    /* The chip never writes over ERXRDPT; packets start on even addresses */
+    need = 6u + count;
+    need += need & 1;
+    room = (rd + size - wr) % size;
+    if(need > room || sim->regs[1][ADDR(ENC28J60_REG_EPKTCNT)] == 0xFF) {
+        sim->regs[0][ADDR(ENC28J60_REG_EIR)] |= ENC28J60_BIT_EIR_RXERIF;
+        sim->rx_dropped++;
+        return -1;
+    }
+
+    next = (uint16_t)(start + (wr - start + need) % size);
+    header[0] = (uint8_t)(next & 0xFF);
+    header[1] = (uint8_t)(next >> 8);
+    header[2] = (uint8_t)(count & 0xFF);
+    header[3] = (uint8_t)(count >> 8);
+    header[4] = RSV_RECEIVED_OK;
+    header[5] = 0;
+    if(frame[0] & 1) {
+        header[5] = (memcmp(frame, broadcast, 6) == 0) ? RSV_BROADCAST : RSV_MULTICAST;
+    }
+    for(i = 0; i < 6u + count; i++) {
+        uint8_t byte = (i < 6) ? header[i] : (i < 6u + len) ? frame[i - 6] : 0;   /* CRC not modelled */
+        sim->mem[start + (wr - start + i) % size] = byte;
+    }
+
+    set16(sim, ENC28J60_REG_ERXWRPTL, next);
+    sim->regs[1][ADDR(ENC28J60_REG_EPKTCNT)]++;
+    sim->regs[0][ADDR(ENC28J60_REG_EIR)] |= ENC28J60_BIT_EIR_PKTIF;
+    sim->rx_frames++;
+    return 0;
+}
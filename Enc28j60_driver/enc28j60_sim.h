@@ -0,0 +1,65 @@
+#ifndef ENC28J60_SIM_H
+#define ENC28J60_SIM_H
+
+#include <stdint.h>
+#include "enc28j60.h"
+
+/*
+ * Host model of the ENC28J60 as seen over SPI, to run the driver without the
+ * chip. It decodes the SPI commands byte by byte (RCR with the MAC/MII dummy
+ * byte, WCR, BFS, BFC, RBM, WBM, SC) and models:
+ *  - the four register banks selected by ECON1.BSEL and the common registers
+ *  - the 8 KB buffer memory with ERDPT/EWRPT auto-increment, ERDPT wrapping
+ *    from ERXND to ERXST
+ *  - the PHY registers behind MIREGADR/MICMD/MIWR/MIRD
+ *  - transmission (ECON1.TXRTS: the frame is copied out, a status vector is
+ *    written after ETXND) and reception into the ERXST..ERXND ring with the
+ *    next packet pointer, the status vector, EPKTCNT and ERXRDPT respected
+ *  - the receive filters of ERXFCON in OR mode: unicast, broadcast, all
+ *    multicast and the EHT0-EHT7 hash table
+ *  - the DMA engine (ECON1.DMAST): copy or, with CSUMEN, checksum into EDMACS
+ *
+ * The SPI hooks have no context argument, so they drive the simulator last
+ * given to enc28j60_sim_init().
+ */
+
+#define ENC28J60_SIM_MEM_LEN    8192
+#define ENC28J60_SIM_TX_LEN     1536
+
+typedef struct {
+    uint8_t regs[4][32];                /* Common registers live in bank 0 */
+    uint16_t phy[32];
+    uint8_t mem[ENC28J60_SIM_MEM_LEN];
+
+    /* SPI transaction in progress */
+    int selected;
+    uint8_t opcode;
+    uint32_t position;                  /* Bytes of the transaction so far */
+
+    /* Last transmitted frame */
+    uint8_t tx_frame[ENC28J60_SIM_TX_LEN];
+    uint16_t tx_len;
+    uint32_t tx_frames;
+
+    /* Statistics */
+    uint32_t transactions;              /* Chip select cycles */
+    uint32_t spi_bytes;
+    uint32_t econ1_writes;              /* WCR/BFS/BFC on ECON1 (bank switches among them) */
+    uint32_t rx_frames;
+    uint32_t rx_dropped;                /* No room in the ring or reception disabled */
+    uint32_t rx_filtered;               /* Rejected by the receive filters */
+    uint32_t dma_bytes;                 /* Buffer bytes through the DMA engine */
+} enc28j60_sim;
+
+extern const enc28j60_spi enc28j60_sim_spi;
+
+/* Power-on state; makes 'sim' the target of enc28j60_sim_spi */
+void enc28j60_sim_init(enc28j60_sim *sim);
+
+/* A frame arrives from the wire (without CRC). Returns 0, or -1 if dropped. */
+int enc28j60_sim_receive(enc28j60_sim *sim, const uint8_t *frame, uint16_t len);
+
+/* Register as the driver sees it (code from enc28j60_regs.h), without side effects */
+uint8_t enc28j60_sim_reg(const enc28j60_sim *sim, uint16_t reg);
+
+#endif /* ENC28J60_SIM_H */
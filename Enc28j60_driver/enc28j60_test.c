@@ -0,0 +1,342 @@
+/*
+ * Host test of the ENC28J60 driver against the SPI simulator: init, PHY
+ * access, frames sent and received through the RX ring (wrapping it many
+ * times), zero-copy receive with header filtering, checksum offload, the
+ * multicast hash filter, and the SPI cost of a frame with burst and per-byte
+ * buffer access.
+ * Build: gcc -O2 -Wall -I../regs -o enc28j60_test enc28j60_test.c enc28j60.c enc28j60_sim.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "enc28j60.h"
+#include "enc28j60_sim.h"
+
+#define RX_FRAMES 500
+#define ZC_FRAMES 200
+
+static const uint8_t mac[6] = { 0x02, 0x00, 0x5E, 0x10, 0x20, 0x30 };
+
+static void make_frame(uint8_t *frame, uint16_t len, unsigned seed) {
+    uint16_t i;
+
+    memset(frame, 0xFF, 6);                     /* Broadcast */
+    memcpy(frame + 6, mac, 6);
+    for(i = 12; i < len; i++) {
+        frame[i] = (uint8_t)(seed * 31 + i);
+    }
+}
+
+/*
+ * Upper layer that only wants IPv4: it reads the 14 byte Ethernet header from
+ * the chip and fetches the payload only for the frames it keeps. Compared
+ * with copying every frame into RAM first.
+ */
+static int test_zero_copy(enc28j60 *dev, enc28j60_sim *sim) {
+    static uint8_t frame[ENC28J60_MAX_FRAME], rx[ENC28J60_MAX_FRAME];
+    static uint16_t sizes[ZC_FRAMES];
+    enc28j60_rx_desc desc;
+    uint32_t bytes, copy_bytes;
+    uint16_t off, n;
+    int i, kept = 0, errors = 0;
+
+    /* Copy everything, then filter in RAM */
+    srand(2);
+    bytes = sim->spi_bytes;
+    for(i = 0; i < ZC_FRAMES; i++) {
+        sizes[i] = (uint16_t)(60 + rand() % (ENC28J60_MAX_FRAME - 59));
+        make_frame(frame, sizes[i], (unsigned)i);
+        frame[12] = (i % 4 == 0) ? 0x08 : 0x86;     /* 1 in 4 is IPv4, the rest IPv6 */
+        frame[13] = (i % 4 == 0) ? 0x00 : 0xDD;
+        enc28j60_sim_receive(sim, frame, sizes[i]);
+        errors += (enc28j60_receive_packet(dev, rx, sizeof(rx)) != sizes[i]);
+        kept += (rx[12] == 0x08 && rx[13] == 0x00);
+    }
+    copy_bytes = sim->spi_bytes - bytes;
+
+    /* Peek at the header, read the rest only when kept */
+    bytes = sim->spi_bytes;
+    for(i = 0; i < ZC_FRAMES; i++) {
+        make_frame(frame, sizes[i], (unsigned)i);
+        frame[12] = (i % 4 == 0) ? 0x08 : 0x86;
+        frame[13] = (i % 4 == 0) ? 0x00 : 0xDD;
+        enc28j60_sim_receive(sim, frame, sizes[i]);
+        errors += (enc28j60_rx_peek(dev, &desc) != 1) || (desc.len != sizes[i]);
+        enc28j60_rx_read(dev, &desc, 0, rx, 14);
+        if(rx[12] == 0x08 && rx[13] == 0x00) {
+            enc28j60_rx_read(dev, &desc, 14, rx + 14, (uint16_t)(sizeof(rx) - 14));
+            errors += (memcmp(rx, frame, sizes[i]) != 0);
+        }
+        enc28j60_rx_release(dev, &desc);
+    }
+    printf("filter %d frames keeping %d: copy all %u SPI bytes, peek headers %u SPI bytes\n",
+           ZC_FRAMES, kept, (unsigned)copy_bytes, (unsigned)(sim->spi_bytes - bytes));
+
+    /* Out of order partial reads, across the ring wrap as well */
+    for(i = 0; i < 20; i++) {
+        n = (uint16_t)(ENC28J60_MAX_FRAME - i);
+        make_frame(frame, n, (unsigned)i + 100);
+        enc28j60_sim_receive(sim, frame, n);
+        enc28j60_rx_peek(dev, &desc);
+        memset(rx, 0, sizeof(rx));
+        for(off = (uint16_t)((n - 1) / 100 * 100); ; off = (uint16_t)(off - 100)) {
+            enc28j60_rx_read(dev, &desc, off, rx + off, 100);
+            if(off == 0) {
+                break;
+            }
+        }
+        errors += (memcmp(rx, frame, n) != 0);
+        enc28j60_rx_release(dev, &desc);
+    }
+
+    /* A corrupted next packet pointer resets the ring, reception goes on */
+    make_frame(frame, 100, 1);
+    enc28j60_sim_receive(sim, frame, 100);
+    sim->mem[dev->next_packet] |= 1;
+    errors += (enc28j60_rx_peek(dev, &desc) != -1) || (dev->rx_resets != 1);
+    enc28j60_sim_receive(sim, frame, 100);
+    errors += (enc28j60_receive_packet(dev, rx, sizeof(rx)) != 100) || (memcmp(rx, frame, 100) != 0);
+    return errors;
+}
+
+/* RFC 1071 reference */
+static uint16_t inet_checksum(const uint8_t *buf, uint16_t len) {
+    uint32_t sum = 0;
+    uint16_t i;
+
+    for(i = 0; i < len; i++) {
+        sum += (i & 1) ? buf[i] : (uint32_t)(buf[i] << 8);
+    }
+    while(sum >> 16) {
+        sum = (sum & 0xFFFF) + (sum >> 16);
+    }
+    return (uint16_t)(~sum & 0xFFFF);
+}
+
+/* IPv4/UDP frame of 'len' bytes with the header checksum left at zero */
+static void make_ipv4_frame(uint8_t *frame, uint16_t len, unsigned seed) {
+    static const uint8_t header[20] = { 0x45, 0x00, 0x00, 0x00, 0x12, 0x34, 0x40, 0x00, 0x40, 0x11,
+                                        0x00, 0x00, 192, 168, 1, 10, 192, 168, 1, 255 };
+
+    make_frame(frame, len, seed);
+    frame[12] = 0x08;
+    frame[13] = 0x00;
+    memcpy(frame + 14, header, sizeof(header));
+    frame[16] = (uint8_t)((len - 14) >> 8);
+    frame[17] = (uint8_t)((len - 14) & 0xFF);
+}
+
+/* IP header checksum filled in by the DMA engine on send, checked by it on receive */
+static int test_checksum_offload(enc28j60 *dev, enc28j60_sim *sim) {
+    static uint8_t frame[ENC28J60_MAX_FRAME], rx[ENC28J60_MAX_FRAME];
+    enc28j60_rx_desc desc;
+    uint32_t bytes, dma_bytes = 0, soft_bytes = 0;
+    uint16_t csum, n;
+    int i, errors = 0;
+
+    for(i = 0; i < 3; i++) {
+        n = (i == 0) ? 60 : (i == 1) ? 591 : ENC28J60_MAX_FRAME;
+        make_ipv4_frame(frame, n, (unsigned)i);
+        errors += (enc28j60_tx_load(dev, frame, n) != 0);
+        errors += (enc28j60_tx_checksum(dev, 14, 20, 24) != 0);
+        errors += (enc28j60_tx_send(dev, n) != 0);
+        errors += (inet_checksum(sim->tx_frame + 14, 20) != 0) ||
+                  ((sim->tx_frame[24] << 8 | sim->tx_frame[25]) != inet_checksum(frame + 14, 20));
+
+        /* Odd length, over the whole frame */
+        errors += (enc28j60_dma_checksum(dev, ENC28J60_TXSTART + 1, n, &csum) != 0) ||
+                  (csum != inet_checksum(sim->tx_frame, n));
+    }
+
+    /* Receive: random sizes, so the sums cross the ring wrap */
+    srand(3);
+    for(i = 0; i < 40; i++) {
+        n = (uint16_t)(60 + rand() % (ENC28J60_MAX_FRAME - 59));
+        make_ipv4_frame(frame, n, (unsigned)i);
+        csum = inet_checksum(frame + 14, 20);
+        frame[24] = (uint8_t)(csum >> 8);
+        frame[25] = (uint8_t)(csum & 0xFF);
+        if(i % 5 == 0) {
+            frame[20] ^= 0x40;                      /* Damaged in transit */
+        }
+        enc28j60_sim_receive(sim, frame, n);
+        errors += (enc28j60_rx_peek(dev, &desc) != 1);
+        errors += (enc28j60_rx_checksum(dev, &desc, 14, 20, &csum) != 0) || ((csum == 0) != (i % 5 != 0));
+
+        /* The payload summed in the chip or read and summed here */
+        bytes = sim->spi_bytes;
+        errors += (enc28j60_rx_checksum(dev, &desc, 34, (uint16_t)(n - 34), &csum) != 0) ||
+                  (csum != inet_checksum(frame + 34, (uint16_t)(n - 34)));
+        dma_bytes += sim->spi_bytes - bytes;
+        bytes = sim->spi_bytes;
+        enc28j60_rx_read(dev, &desc, 34, rx, (uint16_t)(n - 34));
+        errors += (inet_checksum(rx, (uint16_t)(n - 34)) != csum);
+        soft_bytes += sim->spi_bytes - bytes;
+        enc28j60_rx_release(dev, &desc);
+    }
+    errors += (enc28j60_rx_checksum(dev, &desc, 14, (uint16_t)desc.len, &csum) != -1);
+    printf("checksum 40 payloads: DMA %u SPI bytes, read and sum %u SPI bytes (%u bytes summed by the chip)\n",
+           (unsigned)dma_bytes, (unsigned)soft_bytes, (unsigned)sim->dma_bytes);
+    return errors;
+}
+
+/* Reference for the hash filter, written like Linux ether_crc(): not the driver's code */
+static uint32_t ether_crc(const uint8_t *data, int len) {
+    uint32_t crc = 0xFFFFFFFF;
+    int i, bit;
+
+    for(i = 0; i < len; i++) {
+        for(bit = 0; bit < 8; bit++) {
+            crc = (crc << 1) ^ ((((crc & 0x80000000) != 0) ^ ((data[i] >> bit) & 1)) ? 0x04C11DB7 : 0);
+        }
+    }
+    return crc;
+}
+
+static unsigned ether_hash(const uint8_t *addr) {
+    return (ether_crc(addr, 6) >> 23) & 0x3F;
+}
+
+/* Only the subscribed multicast groups (and what shares their hash bits) get through */
+static int test_hash_filter(enc28j60 *dev, enc28j60_sim *sim) {
+    static const uint8_t groups[3][6] = { { 0x01, 0x00, 0x5E, 0x00, 0x00, 0x01 },
+                                          { 0x01, 0x00, 0x5E, 0x7F, 0xFF, 0xFA },
+                                          { 0x33, 0x33, 0x00, 0x00, 0x00, 0x01 } };
+    /* Datasheet example: CRC 0xDA0B4575, pointer 0x34, i.e. EHT6 bit 4 */
+    static const uint8_t example[1][6] = { { 0x01, 0x00, 0x00, 0x00, 0x01, 0x2C } };
+    static uint8_t frame[64], rx[64];
+    uint64_t table = 0;
+    uint32_t filtered;
+    int i, len, hashed, accepted = 0, expected = 0, errors = 0;
+
+    errors += (ether_crc(example[0], 6) != 0xDA0B4575u);
+    enc28j60_set_multicast(dev, example, 1);
+    for(i = 0; i < 8; i++) {
+        errors += (enc28j60_sim_reg(sim, (uint16_t)(ENC28J60_REG_EHT0 + i)) != ((i == 6) ? 0x10 : 0x00));
+    }
+
+    enc28j60_set_multicast(dev, groups, 3);
+    for(i = 0; i < 3; i++) {
+        table |= (uint64_t)1 << ether_hash(groups[i]);
+    }
+    for(i = 0; i < 8; i++) {
+        errors += (enc28j60_sim_reg(sim, (uint16_t)(ENC28J60_REG_EHT0 + i)) != (uint8_t)(table >> (8 * i)));
+    }
+
+    /* 256 IPv4 multicast groups, the subscribed ones among them */
+    filtered = sim->rx_filtered;
+    for(i = 0; i < 256; i++) {
+        make_frame(frame, sizeof(frame), (unsigned)i);
+        memcpy(frame, groups[0], 6);
+        frame[5] = (uint8_t)i;
+        if(i == 0) {
+            memcpy(frame, groups[1], 6);
+        }
+        hashed = (int)((table >> ether_hash(frame)) & 1);
+        expected += hashed;
+        enc28j60_sim_receive(sim, frame, sizeof(frame));
+        len = enc28j60_receive_packet(dev, rx, sizeof(rx));
+        accepted += (len > 0);
+        errors += ((len > 0) != hashed);
+    }
+    errors += (accepted < 2);
+    printf("hash filter: %d of 256 multicast groups accepted, %u filtered by the chip\n", accepted,
+           (unsigned)(sim->rx_filtered - filtered));
+
+    /* Unicast to us and broadcast still pass, unicast to others does not */
+    make_frame(frame, sizeof(frame), 1);
+    memcpy(frame, mac, 6);
+    enc28j60_sim_receive(sim, frame, sizeof(frame));
+    errors += (enc28j60_receive_packet(dev, rx, sizeof(rx)) != (int)sizeof(frame));
+    frame[5] ^= 1;
+    enc28j60_sim_receive(sim, frame, sizeof(frame));
+    errors += (enc28j60_receive_packet(dev, rx, sizeof(rx)) != 0);
+    make_frame(frame, sizeof(frame), 2);
+    enc28j60_sim_receive(sim, frame, sizeof(frame));
+    errors += (enc28j60_receive_packet(dev, rx, sizeof(rx)) != (int)sizeof(frame));
+    return errors + (expected != accepted);
+}
+
+int main(void) {
+    static enc28j60_sim sim;
+    static uint8_t frame[ENC28J60_MAX_FRAME], rx[ENC28J60_MAX_FRAME];
+    enc28j60 dev;
+    uint32_t transactions, bytes, switches, hits;
+    int i, len, errors = 0, received = 0;
+
+    enc28j60_sim_init(&sim);
+    if(enc28j60_init(&dev, &enc28j60_sim_spi, mac) < 0) {
+        printf("init failed\n");
+        return 1;
+    }
+    errors += (enc28j60_sim_reg(&sim, ENC28J60_REG_MAADR1) != mac[0]) ||
+              (enc28j60_sim_reg(&sim, ENC28J60_REG_MAADR6) != mac[5]);
+    errors += (sim.phy[ENC28J60_PHY_PHCON2] != ENC28J60_BIT_PHCON2_HDLDIS);
+    errors += (enc28j60_phy_read(&dev, ENC28J60_PHY_PHID1) != 0x0083);
+    errors += (enc28j60_read_reg(&dev, ENC28J60_REG_MACON3) != ENC28J60_MAC_CONFIG);
+    printf("init: %u SPI transactions, %u bank switches, %u accesses without a switch\n",
+           (unsigned)dev.transactions, (unsigned)dev.bank_switches, (unsigned)dev.bank_hits);
+
+    /* Transmit */
+    for(i = 0; i < 3; i++) {
+        uint16_t n = (i == 0) ? 60 : (i == 1) ? 590 : ENC28J60_MAX_FRAME;
+        make_frame(frame, n, (unsigned)i);
+        transactions = sim.transactions;
+        bytes = sim.spi_bytes;
+        errors += (enc28j60_send_packet(&dev, frame, n) != 0);
+        errors += (sim.tx_len != n) || (memcmp(sim.tx_frame, frame, n) != 0);
+        printf("send %4u bytes: %2u SPI transactions, %4u SPI bytes\n", (unsigned)n,
+               (unsigned)(sim.transactions - transactions), (unsigned)(sim.spi_bytes - bytes));
+    }
+
+    /* Receive: random sizes, sometimes two frames waiting, so the ring wraps many times */
+    srand(1);
+    transactions = sim.transactions;
+    switches = dev.bank_switches;
+    hits = dev.bank_hits;
+    for(i = 0; i < RX_FRAMES; i++) {
+        uint16_t n = (uint16_t)(60 + rand() % (ENC28J60_MAX_FRAME - 59));
+        make_frame(frame, n, (unsigned)i);
+        errors += (enc28j60_sim_receive(&sim, frame, n) != 0);
+        if(i % 2 == 0) {
+            continue;
+        }
+        while((len = enc28j60_receive_packet(&dev, rx, sizeof(rx))) > 0) {
+            received++;
+        }
+        /* The last frame received is the one just injected */
+        errors += (len != 0) || (memcmp(rx, frame, n) != 0);
+    }
+    errors += (received != RX_FRAMES) || (enc28j60_sim_reg(&sim, ENC28J60_REG_EPKTCNT) != 0);
+    printf("receive: %d frames, %u dropped by the chip, %.1f SPI transactions and %.2f bank switches per frame "
+           "(%u accesses without a switch)\n",
+           received, (unsigned)sim.rx_dropped, (double)(sim.transactions - transactions) / RX_FRAMES,
+           (double)(dev.bank_switches - switches) / RX_FRAMES, (unsigned)(dev.bank_hits - hits));
+
+    errors += test_zero_copy(&dev, &sim);
+    errors += test_checksum_offload(&dev, &sim);
+    errors += test_hash_filter(&dev, &sim);
+
+    /* The same frame through the buffer byte by byte, one command each */
+    make_frame(frame, ENC28J60_MAX_FRAME, 7);
+    transactions = sim.transactions;
+    bytes = sim.spi_bytes;
+    enc28j60_write_buffer(&dev, ENC28J60_TXSTART, frame, ENC28J60_MAX_FRAME);
+    printf("write %u bytes to the buffer as one burst: %u SPI transactions, %u SPI bytes\n",
+           (unsigned)ENC28J60_MAX_FRAME, (unsigned)(sim.transactions - transactions),
+           (unsigned)(sim.spi_bytes - bytes));
+    transactions = sim.transactions;
+    bytes = sim.spi_bytes;
+    for(i = 0; i < ENC28J60_MAX_FRAME; i++) {
+        enc28j60_write_buffer(&dev, (uint16_t)(ENC28J60_TXSTART + i), &frame[i], 1);
+    }
+    printf("write %u bytes to the buffer byte by byte: %u SPI transactions, %u SPI bytes\n",
+           (unsigned)ENC28J60_MAX_FRAME, (unsigned)(sim.transactions - transactions),
+           (unsigned)(sim.spi_bytes - bytes));
+    enc28j60_read_buffer(&dev, ENC28J60_TXSTART, rx, ENC28J60_MAX_FRAME);
+    errors += (memcmp(rx, frame, ENC28J60_MAX_FRAME) != 0);
+
+    printf("%d errors\n", errors);
+    return errors != 0;
+}
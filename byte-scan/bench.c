@@ -0,0 +1,111 @@
+/*
+ * Benchmark of the byte scanning kernels on large payloads.
+ * Build: gcc -O2 -o bench bench.c scan.c
+ *
+ * Every implementation supported by the CPU is checked against the scalar one
+ * and timed on two 16 MB payloads: random bytes (a special byte every 128
+ * bytes on average) and text with rare specials.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "scan.h"
+
+#define PAYLOAD_LEN (16u * 1024u * 1024u)
+#define ROUNDS      8
+
+/* GET-SET and ByteFrame special bytes */
+static const struct {
+    const char *name;
+    uint8_t a, b;
+} specials[] = {
+    { "get-set  ($ /)    ", '$', '/' },
+    { "byteframe (C0 DB) ", 0xC0, 0xDB },
+};
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Walks the payload like an encoder: find the next special byte, skip it, repeat */
+static size_t walk(const uint8_t *buf, size_t len, uint8_t a, uint8_t b) {
+    size_t i = 0, hits = 0;
+
+    while(i < len) {
+        i += scan_find2(buf + i, len - i, a, b);
+        if(i < len) {
+            hits++;
+            i++;
+        }
+    }
+    return hits;
+}
+
+static void bench(const char *label, const uint8_t *buf, size_t len) {
+    static const scan_impl impls[] = { SCAN_SCALAR, SCAN_SSE2, SCAN_AVX2 };
+    uint64_t ref_sum;
+    size_t ref_hits[2], s, k;
+    int r;
+
+    scan_select(SCAN_SCALAR);
+    ref_sum = scan_sum(buf, len);
+    for(s = 0; s < 2; s++) {
+        ref_hits[s] = walk(buf, len, specials[s].a, specials[s].b);
+    }
+
+    printf("%s payload, %u MB\n", label, (unsigned)(len >> 20));
+    for(k = 0; k < sizeof(impls) / sizeof(impls[0]); k++) {
+        if(scan_select(impls[k]) != impls[k]) {
+            continue;   /* Not supported by this CPU */
+        }
+
+        double t = now_sec();
+        volatile uint64_t sum = 0;
+        for(r = 0; r < ROUNDS; r++) {
+            sum += scan_sum(buf, len);
+        }
+        double sum_gbs = (double)len * ROUNDS / (now_sec() - t) / 1e9;
+
+        printf("  %-6s sum %6.2f GB/s%s\n", scan_impl_name(), sum_gbs,
+               (scan_sum(buf, len) == ref_sum) ? "" : "  MISMATCH");
+
+        for(s = 0; s < 2; s++) {
+            size_t hits = 0;
+            t = now_sec();
+            for(r = 0; r < ROUNDS; r++) {
+                hits = walk(buf, len, specials[s].a, specials[s].b);
+            }
+            double find_gbs = (double)len * ROUNDS / (now_sec() - t) / 1e9;
+            printf("         find %s %6.2f GB/s, %zu escapes%s\n", specials[s].name, find_gbs, hits,
+                   (hits == ref_hits[s] && scan_count2(buf, len, specials[s].a, specials[s].b) == hits)
+                   ? "" : "  MISMATCH");
+        }
+    }
+}
+
+int main(void) {
+    uint8_t *buf = malloc(PAYLOAD_LEN);
+    size_t i;
+
+    if(NULL == buf) {
+        return 1;
+    }
+
+    srand(1);
+    for(i = 0; i < PAYLOAD_LEN; i++) {
+        buf[i] = (uint8_t)rand();
+    }
+    bench("random", buf, PAYLOAD_LEN);
+
+    /* Text: lowercase letters with a '$' or 0xC0 every 4 KB */
+    for(i = 0; i < PAYLOAD_LEN; i++) {
+        buf[i] = (i % 4096 == 4095) ? ((i & 4096) ? '$' : 0xC0) : (uint8_t)('a' + i % 26);
+    }
+    bench("text", buf, PAYLOAD_LEN);
+
+    free(buf);
+    return 0;
+}
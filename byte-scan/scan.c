@@ -0,0 +1,231 @@
+#include "scan.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SCAN_X86 1
+#include <immintrin.h>
+#endif
+
+/* ---------- scalar ---------- */
+
+static uint64_t sum_scalar(const uint8_t *buf, size_t len) {
+    uint64_t sum = 0;
+    size_t i;
+
+    for(i = 0; i < len; i++) {
+        sum += buf[i];
+    }
+    return sum;
+}
+
+static size_t find2_scalar(const uint8_t *buf, size_t len, uint8_t a, uint8_t b) {
+    size_t i;
+
+    for(i = 0; i < len; i++) {
+        if((buf[i] == a) || (buf[i] == b)) {
+            return i;
+        }
+    }
+    return len;
+}
+
+static size_t count2_scalar(const uint8_t *buf, size_t len, uint8_t a, uint8_t b) {
+    size_t i, n = 0;
+
+    for(i = 0; i < len; i++) {
+        n += (buf[i] == a) | (buf[i] == b);
+    }
+    return n;
+}
+
+#ifdef SCAN_X86
+
+#define COUNT_STEPS 255    /* Steps before a byte lane counter could wrap */
+
+/* ---------- SSE2: 16 bytes per step ---------- */
+
+__attribute__((target("sse2")))
+static uint64_t sum_sse2(const uint8_t *buf, size_t len) {
+    __m128i acc = _mm_setzero_si128();
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+
+    /* psadbw against zero adds 8 bytes into each 64 bit lane */
+    for(; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(buf + i));
+        acc = _mm_add_epi64(acc, _mm_sad_epu8(v, zero));
+    }
+    uint64_t lanes[2];
+    _mm_storeu_si128((__m128i *)lanes, acc);
+    return lanes[0] + lanes[1] + sum_scalar(buf + i, len - i);
+}
+
+__attribute__((target("sse2")))
+static size_t find2_sse2(const uint8_t *buf, size_t len, uint8_t a, uint8_t b) {
+    const __m128i va = _mm_set1_epi8((char)a);
+    const __m128i vb = _mm_set1_epi8((char)b);
+    size_t i = 0;
+
+    for(; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(buf + i));
+        int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, va), _mm_cmpeq_epi8(v, vb)));
+        if(mask != 0) {
+            return i + (size_t)__builtin_ctz((unsigned)mask);
+        }
+    }
+    return i + find2_scalar(buf + i, len - i, a, b);
+}
+
+__attribute__((target("sse2")))
+static size_t count2_sse2(const uint8_t *buf, size_t len, uint8_t a, uint8_t b) {
+    const __m128i va = _mm_set1_epi8((char)a);
+    const __m128i vb = _mm_set1_epi8((char)b);
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0, n = 0;
+
+    /* A match compares as 0xFF (-1): subtracting it counts per byte lane, which
+       holds COUNT_STEPS steps before psadbw folds the lanes. No POPCNT needed. */
+    while(i + 16 <= len) {
+        __m128i acc = zero;
+        size_t end = ((len - i) / 16 > COUNT_STEPS) ? i + COUNT_STEPS * 16 : len;
+
+        for(; i + 16 <= end; i += 16) {
+            __m128i v = _mm_loadu_si128((const __m128i *)(buf + i));
+            acc = _mm_sub_epi8(acc, _mm_or_si128(_mm_cmpeq_epi8(v, va), _mm_cmpeq_epi8(v, vb)));
+        }
+        acc = _mm_sad_epu8(acc, zero);
+        n += (size_t)_mm_extract_epi16(acc, 0) + (size_t)_mm_extract_epi16(acc, 4);
+    }
+    return n + count2_scalar(buf + i, len - i, a, b);
+}
+
+/* ---------- AVX2: 32 bytes per step ---------- */
+
+__attribute__((target("avx2")))
+static uint64_t sum_avx2(const uint8_t *buf, size_t len) {
+    __m256i acc = _mm256_setzero_si256();
+    const __m256i zero = _mm256_setzero_si256();
+    size_t i = 0;
+
+    for(; i + 32 <= len; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(buf + i));
+        acc = _mm256_add_epi64(acc, _mm256_sad_epu8(v, zero));
+    }
+    uint64_t lanes[4];
+    _mm256_storeu_si256((__m256i *)lanes, acc);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + sum_scalar(buf + i, len - i);
+}
+
+__attribute__((target("avx2")))
+static size_t find2_avx2(const uint8_t *buf, size_t len, uint8_t a, uint8_t b) {
+    const __m256i va = _mm256_set1_epi8((char)a);
+    const __m256i vb = _mm256_set1_epi8((char)b);
+    size_t i = 0;
+
+    for(; i + 32 <= len; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(buf + i));
+        unsigned mask = (unsigned)_mm256_movemask_epi8(
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, va), _mm256_cmpeq_epi8(v, vb)));
+        if(mask != 0) {
+            return i + (size_t)__builtin_ctz(mask);
+        }
+    }
+    return i + find2_scalar(buf + i, len - i, a, b);
+}
+
+__attribute__((target("avx2")))
+static size_t count2_avx2(const uint8_t *buf, size_t len, uint8_t a, uint8_t b) {
+    const __m256i va = _mm256_set1_epi8((char)a);
+    const __m256i vb = _mm256_set1_epi8((char)b);
+    const __m256i zero = _mm256_setzero_si256();
+    size_t i = 0, n = 0;
+
+    /* Per byte lane counts as in count2_sse2 */
+    while(i + 32 <= len) {
+        __m256i acc = zero;
+        size_t end = ((len - i) / 32 > COUNT_STEPS) ? i + COUNT_STEPS * 32 : len;
+
+        for(; i + 32 <= end; i += 32) {
+            __m256i v = _mm256_loadu_si256((const __m256i *)(buf + i));
+            acc = _mm256_sub_epi8(acc, _mm256_or_si256(_mm256_cmpeq_epi8(v, va), _mm256_cmpeq_epi8(v, vb)));
+        }
+        uint64_t lanes[4];
+        _mm256_storeu_si256((__m256i *)lanes, _mm256_sad_epu8(acc, zero));
+        n += (size_t)(lanes[0] + lanes[1] + lanes[2] + lanes[3]);
+    }
+    return n + count2_scalar(buf + i, len - i, a, b);
+}
+
+#endif /* SCAN_X86 */
+
+/* ---------- dispatch ---------- */
+
+static uint64_t (*sum_fn)(const uint8_t *, size_t);
+static size_t (*find2_fn)(const uint8_t *, size_t, uint8_t, uint8_t);
+static size_t (*count2_fn)(const uint8_t *, size_t, uint8_t, uint8_t);
+static scan_impl current = SCAN_AUTO;
+
+scan_impl scan_select(scan_impl impl) {
+#ifdef SCAN_X86
+    __builtin_cpu_init();
+    if(impl == SCAN_AUTO) {
+        impl = __builtin_cpu_supports("avx2") ? SCAN_AVX2 : SCAN_SSE2;
+    }
+    if((impl == SCAN_AVX2) && !__builtin_cpu_supports("avx2")) {
+        impl = SCAN_SSE2;
+    }
+    if((impl == SCAN_SSE2) && !__builtin_cpu_supports("sse2")) {
+        impl = SCAN_SCALAR;
+    }
+#else
+    impl = SCAN_SCALAR;
+#endif
+
+    switch(impl) {
+#ifdef SCAN_X86
+        case SCAN_AVX2:
+            sum_fn = sum_avx2;
+            find2_fn = find2_avx2;
+            count2_fn = count2_avx2;
+            break;
+        case SCAN_SSE2:
+            sum_fn = sum_sse2;
+            find2_fn = find2_sse2;
+            count2_fn = count2_sse2;
+            break;
+#endif
+        default:
+            impl = SCAN_SCALAR;
+            sum_fn = sum_scalar;
+            find2_fn = find2_scalar;
+            count2_fn = count2_scalar;
+            break;
+    }
+    current = impl;
+    return impl;
+}
+
+const char *scan_impl_name(void) {
+    static const char *const names[] = { "scalar", "sse2", "avx2", "auto" };
+    return names[current];
+}
+
+uint64_t scan_sum(const uint8_t *buf, size_t len) {
+    if(current == SCAN_AUTO) {
+        scan_select(SCAN_AUTO);
+    }
+    return sum_fn(buf, len);
+}
+
+size_t scan_find2(const uint8_t *buf, size_t len, uint8_t a, uint8_t b) {
+    if(current == SCAN_AUTO) {
+        scan_select(SCAN_AUTO);
+    }
+    return find2_fn(buf, len, a, b);
+}
+
+size_t scan_count2(const uint8_t *buf, size_t len, uint8_t a, uint8_t b) {
+    if(current == SCAN_AUTO) {
+        scan_select(SCAN_AUTO);
+    }
+    return count2_fn(buf, len, a, b);
+}
@@ -0,0 +1,50 @@
+#ifndef __SCAN_H_
+#define __SCAN_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Byte scanning kernels shared by the framing protocols.
+ *
+ * scan_sum()   - sum of all bytes (feed it into a one's complement fold)
+ * scan_find2() - index of the first byte equal to 'a' or 'b' (e.g. SOF/ESC)
+ *
+ * On x86 the AVX2 (32 bytes per step) or SSE2 (16 bytes per step) version is
+ * picked at run time; everywhere else the scalar version is used.
+ */
+
+/* Below this many bytes the call and vector setup cost more than a plain loop */
+#define SCAN_MIN_LEN 64
+
+typedef enum scan_impl {
+    SCAN_SCALAR = 0,
+    SCAN_SSE2,
+    SCAN_AVX2,
+    SCAN_AUTO
+} scan_impl;
+
+/* Sum of 'len' bytes */
+uint64_t scan_sum(const uint8_t *buf, size_t len);
+
+/* Index of the first byte equal to 'a' or 'b', or 'len' if there is none */
+size_t scan_find2(const uint8_t *buf, size_t len, uint8_t a, uint8_t b);
+
+/* Number of bytes equal to 'a' or 'b' (extra bytes needed to escape them) */
+size_t scan_count2(const uint8_t *buf, size_t len, uint8_t a, uint8_t b);
+
+/* Forces an implementation (for benchmarks). Unsupported choices fall back. Returns the one in use. */
+scan_impl scan_select(scan_impl impl);
+
+/* Name of the implementation in use */
+const char *scan_impl_name(void);
+
+/* Folds a byte sum into 16 bits with end-around carry (one's complement addition) */
+static inline uint16_t scan_fold16(uint64_t sum) {
+    while(sum >> 16) {
+        sum = (sum & 0xFFFF) + (sum >> 16);
+    }
+    return (uint16_t)sum;
+}
+
+#endif
@@ -0,0 +1,107 @@
+/*
+ * Checks every CRC variant against the known check values and a bit-at-a-time
+ * reference, then measures their throughput on a 16 MB buffer.
+ * Build: make bench
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "crc.h"
+
+#define BUF_LEN (16u * 1024u * 1024u)
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Bit-at-a-time references */
+static uint16_t crc16_bitwise(uint16_t crc, const uint8_t *data, size_t len) {
+    int b;
+
+    while(len--) {
+        crc ^= (uint16_t)(*data++ << 8);
+        for(b = 0; b < 8; b++) {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+static uint32_t crc32_bitwise(uint32_t crc, const uint8_t *data, size_t len) {
+    int b;
+
+    while(len--) {
+        crc ^= *data++;
+        for(b = 0; b < 8; b++) {
+            crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320u : crc >> 1;
+        }
+    }
+    return crc;
+}
+
+static int check(const char *name, uint32_t got, uint32_t want) {
+    if(got != want) {
+        printf("%-28s 0x%08X, expected 0x%08X\n", name, (unsigned)got, (unsigned)want);
+        return 1;
+    }
+    return 0;
+}
+
+#define BENCH(name, expr) do {                                              \
+        double t = now_sec();                                               \
+        volatile uint32_t r = (expr);                                       \
+        double mbs = BUF_LEN / (now_sec() - t) / 1e6;                       \
+        (void)r;                                                            \
+        printf("  %-14s %8.0f MB/s\n", name, mbs);                          \
+    } while(0)
+
+int main(void) {
+    static const uint8_t digits[] = "123456789";
+    uint8_t *buf = malloc(BUF_LEN);
+    int errors = 0;
+    size_t i, len;
+
+    if(NULL == buf) {
+        return 1;
+    }
+    srand(1);
+    for(i = 0; i < BUF_LEN; i++) {
+        buf[i] = (uint8_t)rand();
+    }
+
+    errors += check("crc8", crc8(digits, 9), 0xF4);
+    errors += check("crc16_ccitt", crc16_ccitt(digits, 9), 0x29B1);
+    errors += check("crc32", crc32(digits, 9), 0xCBF43926u);
+
+    /* Every length up to 64 and a few odd splits, against the references */
+    for(len = 0; len <= 64; len++) {
+        uint16_t r16 = crc16_bitwise(CRC16_INIT, buf, len);
+        uint32_t r32 = crc32_bitwise(CRC32_INIT, buf, len);
+        errors += check("crc8 nibble", crc8_update_nibble(CRC8_INIT, buf, len), crc8(buf, len));
+        errors += check("crc16 nibble", crc16_update_nibble(CRC16_INIT, buf, len), r16);
+        errors += check("crc16 slice8", crc16_update_slice8(CRC16_INIT, buf, len), r16);
+        errors += check("crc16 split", crc16_update(crc16_update(CRC16_INIT, buf, len / 3), buf + len / 3,
+                                                    len - len / 3), r16);
+        errors += check("crc32 nibble", crc32_update_nibble(CRC32_INIT, buf, len), r32);
+        errors += check("crc32 slice8", crc32_update_slice8(CRC32_INIT, buf, len), r32);
+        errors += check("crc32 split", crc32_update(crc32_update(CRC32_INIT, buf, len / 3), buf + len / 3,
+                                                    len - len / 3), r32);
+    }
+    printf("check values and references: %d errors\n", errors);
+
+    printf("16 MB buffer:\n");
+    BENCH("crc16 bitwise", crc16_bitwise(CRC16_INIT, buf, BUF_LEN));
+    BENCH("crc16 nibble", crc16_update_nibble(CRC16_INIT, buf, BUF_LEN));
+    BENCH("crc16 slice8", crc16_update_slice8(CRC16_INIT, buf, BUF_LEN));
+    BENCH("crc32 bitwise", crc32_bitwise(CRC32_INIT, buf, BUF_LEN));
+    BENCH("crc32 nibble", crc32_update_nibble(CRC32_INIT, buf, BUF_LEN));
+    BENCH("crc32 slice8", crc32_update_slice8(CRC32_INIT, buf, BUF_LEN));
+    BENCH("crc8 table", crc8(buf, BUF_LEN));
+
+    free(buf);
+    return errors != 0;
+}
@@ -0,0 +1,127 @@
+#include "crc.h"
+
+#ifdef __AVR__
+#include <avr/pgmspace.h>
+#define CRC_FLASH           PROGMEM
+#define CRC_READ8(addr)     pgm_read_byte(addr)
+#define CRC_READ16(addr)    pgm_read_word(addr)
+#define CRC_READ32(addr)    pgm_read_dword(addr)
+#else
+#define CRC_FLASH
+#define CRC_READ8(addr)     (*(addr))
+#define CRC_READ16(addr)    (*(addr))
+#define CRC_READ32(addr)    (*(addr))
+#endif
+
+#include "crc_tables.h"
+
+/* ---------- nibble tables: two lookups per byte ---------- */
+
+uint8_t crc8_update_nibble(uint8_t crc, const uint8_t *data, size_t len) {
+    while(len--) {
+        crc ^= *data++;
+        crc = (uint8_t)(crc << 4) ^ CRC_READ8(&crc8_nibble[crc >> 4]);
+        crc = (uint8_t)(crc << 4) ^ CRC_READ8(&crc8_nibble[crc >> 4]);
+    }
+    return crc;
+}
+
+uint16_t crc16_update_nibble(uint16_t crc, const uint8_t *data, size_t len) {
+    while(len--) {
+        crc ^= (uint16_t)(*data++ << 8);
+        crc = (uint16_t)(crc << 4) ^ CRC_READ16(&crc16_nibble[crc >> 12]);
+        crc = (uint16_t)(crc << 4) ^ CRC_READ16(&crc16_nibble[crc >> 12]);
+    }
+    return crc;
+}
+
+uint32_t crc32_update_nibble(uint32_t crc, const uint8_t *data, size_t len) {
+    while(len--) {
+        crc ^= *data++;
+        crc = (crc >> 4) ^ CRC_READ32(&crc32_nibble[crc & 0x0F]);
+        crc = (crc >> 4) ^ CRC_READ32(&crc32_nibble[crc & 0x0F]);
+    }
+    return crc;
+}
+
+#ifndef CRC_SMALL
+
+/* ---------- byte table (CRC-8) and slice-by-8 (CRC-16, CRC-32) ---------- */
+
+static uint8_t crc8_update_table(uint8_t crc, const uint8_t *data, size_t len) {
+    while(len--) {
+        crc = crc8_table[crc ^ *data++];
+    }
+    return crc;
+}
+
+uint16_t crc16_update_slice8(uint16_t crc, const uint8_t *data, size_t len) {
+    /* MSB first: the first two bytes meet the register, the other six only go through the tables */
+    for(; len >= 8; len -= 8, data += 8) {
+        crc ^= (uint16_t)((data[0] << 8) | data[1]);
+        crc = crc16_table[7][crc >> 8] ^ crc16_table[6][crc & 0xFF] ^
+              crc16_table[5][data[2]] ^ crc16_table[4][data[3]] ^
+              crc16_table[3][data[4]] ^ crc16_table[2][data[5]] ^
+              crc16_table[1][data[6]] ^ crc16_table[0][data[7]];
+    }
+    while(len--) {
+        crc = (uint16_t)(crc << 8) ^ crc16_table[0][(crc >> 8) ^ *data++];
+    }
+    return crc;
+}
+
+uint32_t crc32_update_slice8(uint32_t crc, const uint8_t *data, size_t len) {
+    /* Reflected: the first four bytes meet the register, little endian */
+    for(; len >= 8; len -= 8, data += 8) {
+        crc ^= (uint32_t)data[0] | ((uint32_t)data[1] << 8) |
+               ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+        crc = crc32_table[7][crc & 0xFF] ^ crc32_table[6][(crc >> 8) & 0xFF] ^
+              crc32_table[5][(crc >> 16) & 0xFF] ^ crc32_table[4][crc >> 24] ^
+              crc32_table[3][data[4]] ^ crc32_table[2][data[5]] ^
+              crc32_table[1][data[6]] ^ crc32_table[0][data[7]];
+    }
+    while(len--) {
+        crc = (crc >> 8) ^ crc32_table[0][(crc ^ *data++) & 0xFF];
+    }
+    return crc;
+}
+
+uint8_t crc8_update(uint8_t crc, const uint8_t *data, size_t len) {
+    return crc8_update_table(crc, data, len);
+}
+
+uint16_t crc16_update(uint16_t crc, const uint8_t *data, size_t len) {
+    return crc16_update_slice8(crc, data, len);
+}
+
+uint32_t crc32_update(uint32_t crc, const uint8_t *data, size_t len) {
+    return crc32_update_slice8(crc, data, len);
+}
+
+#else
+
+uint8_t crc8_update(uint8_t crc, const uint8_t *data, size_t len) {
+    return crc8_update_nibble(crc, data, len);
+}
+
+uint16_t crc16_update(uint16_t crc, const uint8_t *data, size_t len) {
+    return crc16_update_nibble(crc, data, len);
+}
+
+uint32_t crc32_update(uint32_t crc, const uint8_t *data, size_t len) {
+    return crc32_update_nibble(crc, data, len);
+}
+
+#endif /* CRC_SMALL */
+
+uint8_t crc8(const uint8_t *data, size_t len) {
+    return crc8_update(CRC8_INIT, data, len);
+}
+
+uint16_t crc16_ccitt(const uint8_t *data, size_t len) {
+    return crc16_update(CRC16_INIT, data, len);
+}
+
+uint32_t crc32(const uint8_t *data, size_t len) {
+    return crc32_update(CRC32_INIT, data, len) ^ 0xFFFFFFFFu;
+}
@@ -0,0 +1,51 @@
+#ifndef CRC_H
+#define CRC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * CRC-8, CRC-16-CCITT and CRC-32 for the framing protocols.
+ *
+ *   crc8        poly 0x07,        init 0x00,       no reflection       check 0xF4
+ *   crc16_ccitt poly 0x1021,      init 0xFFFF,     no reflection       check 0x29B1
+ *   crc32       poly 0x04C11DB7,  init 0xFFFFFFFF, reflected, xor out  check 0xCBF43926
+ *
+ * (check = CRC of the ASCII string "123456789")
+ *
+ * The tables are generated by crc_gen.c into crc_tables.h. Host builds use
+ * slice-by-8 (8 bytes per step, 12 KB of tables); with CRC_SMALL, which is
+ * the default on AVR, only 16 entry nibble tables are kept, in flash.
+ */
+
+#if defined(__AVR__) && !defined(CRC_SMALL)
+#define CRC_SMALL
+#endif
+
+#define CRC8_INIT   0x00
+#define CRC16_INIT  0xFFFF
+#define CRC32_INIT  0xFFFFFFFFu
+
+/* One shot */
+uint8_t crc8(const uint8_t *data, size_t len);
+uint16_t crc16_ccitt(const uint8_t *data, size_t len);
+uint32_t crc32(const uint8_t *data, size_t len);
+
+/*
+ * Incremental: start from CRCx_INIT and feed the data in any number of
+ * pieces. For CRC-32 the final value is crc32_update(...) ^ 0xFFFFFFFF.
+ */
+uint8_t crc8_update(uint8_t crc, const uint8_t *data, size_t len);
+uint16_t crc16_update(uint16_t crc, const uint8_t *data, size_t len);
+uint32_t crc32_update(uint32_t crc, const uint8_t *data, size_t len);
+
+/* The table variants, selectable for benchmarks (crcN_update uses the best one built) */
+uint8_t crc8_update_nibble(uint8_t crc, const uint8_t *data, size_t len);
+uint16_t crc16_update_nibble(uint16_t crc, const uint8_t *data, size_t len);
+uint32_t crc32_update_nibble(uint32_t crc, const uint8_t *data, size_t len);
+#ifndef CRC_SMALL
+uint16_t crc16_update_slice8(uint16_t crc, const uint8_t *data, size_t len);
+uint32_t crc32_update_slice8(uint32_t crc, const uint8_t *data, size_t len);
+#endif
+
+#endif
@@ -0,0 +1,127 @@
+/*
+ * Generates crc_tables.h: the lookup tables used by crc.c.
+ * Build and run: gcc -O2 -o crc_gen crc_gen.c && ./crc_gen > crc_tables.h
+ * (the Makefile does this when crc_gen.c changes).
+ *
+ * Every table is derived from the bit-at-a-time definition of the CRC, so the
+ * polynomials below are the only place they are written down.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+
+#define CRC8_POLY   0x07        /* CRC-8 (SMBus), MSB first */
+#define CRC16_POLY  0x1021      /* CRC-16-CCITT, MSB first */
+#define CRC32_POLY  0xEDB88320u /* CRC-32 (IEEE 802.3), reflected */
+
+/* One byte through the CRC register, bit by bit (the definition) */
+static uint8_t crc8_bits(uint8_t crc, int bits) {
+    while(bits--) {
+        crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ CRC8_POLY) : (uint8_t)(crc << 1);
+    }
+    return crc;
+}
+
+static uint16_t crc16_bits(uint16_t crc, int bits) {
+    while(bits--) {
+        crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ CRC16_POLY) : (uint16_t)(crc << 1);
+    }
+    return crc;
+}
+
+static uint32_t crc32_bits(uint32_t crc, int bits) {
+    while(bits--) {
+        crc = (crc & 1) ? (crc >> 1) ^ CRC32_POLY : crc >> 1;
+    }
+    return crc;
+}
+
+/* Prints 'n' values as a brace enclosed initializer, 8 per line */
+static void print_values(const uint32_t *v, int n, int width, const char *indent) {
+    int i;
+
+    printf("{");
+    for(i = 0; i < n; i++) {
+        if(i % 8 == 0) {
+            printf("\n%s    ", indent);
+        } else {
+            printf(" ");
+        }
+        printf("0x%0*X,", width, (unsigned)v[i]);
+    }
+    printf("\n%s}", indent);
+}
+
+static void print_table(const char *decl, const uint32_t *v, int n, int width) {
+    printf("%s = ", decl);
+    print_values(v, n, width, "");
+    printf(";\n\n");
+}
+
+/* Slice-by-8 tables: 8 rows of 256 */
+static void print_slices(const char *decl, uint32_t t[8][256], int width) {
+    int k;
+
+    printf("%s = {\n", decl);
+    for(k = 0; k < 8; k++) {
+        printf("    ");
+        print_values(t[k], 256, width, "    ");
+        printf(",\n");
+    }
+    printf("};\n\n");
+}
+
+int main(void) {
+    static uint32_t t[8][256];
+    uint32_t n[16];
+    int i, k;
+
+    printf("/* Generated by crc_gen.c - do not edit */\n\n");
+    printf("#ifndef CRC_TABLES_H\n#define CRC_TABLES_H\n\n");
+
+    /* Nibble tables: 16 entries, small enough for AVR flash */
+    for(i = 0; i < 16; i++) {
+        n[i] = crc8_bits((uint8_t)(i << 4), 4);
+    }
+    print_table("static const uint8_t crc8_nibble[16] CRC_FLASH", n, 16, 2);
+    for(i = 0; i < 16; i++) {
+        n[i] = crc16_bits((uint16_t)(i << 12), 4);
+    }
+    print_table("static const uint16_t crc16_nibble[16] CRC_FLASH", n, 16, 4);
+    for(i = 0; i < 16; i++) {
+        n[i] = crc32_bits((uint32_t)i, 4);
+    }
+    print_table("static const uint32_t crc32_nibble[16] CRC_FLASH", n, 16, 8);
+
+    printf("#ifndef CRC_SMALL\n\n");
+
+    /* Byte table for CRC-8 */
+    for(i = 0; i < 256; i++) {
+        t[0][i] = crc8_bits((uint8_t)i, 8);
+    }
+    print_table("static const uint8_t crc8_table[256]", t[0], 256, 2);
+
+    /* Slice-by-8: table k advances a byte followed by k zero bytes */
+    for(i = 0; i < 256; i++) {
+        t[0][i] = crc16_bits((uint16_t)(i << 8), 8);
+    }
+    for(k = 1; k < 8; k++) {
+        for(i = 0; i < 256; i++) {
+            t[k][i] = ((t[k - 1][i] << 8) & 0xFFFF) ^ t[0][t[k - 1][i] >> 8];
+        }
+    }
+    print_slices("static const uint16_t crc16_table[8][256]", t, 4);
+
+    for(i = 0; i < 256; i++) {
+        t[0][i] = crc32_bits((uint32_t)i, 8);
+    }
+    for(k = 1; k < 8; k++) {
+        for(i = 0; i < 256; i++) {
+            t[k][i] = (t[k - 1][i] >> 8) ^ t[0][t[k - 1][i] & 0xFF];
+        }
+    }
+    print_slices("static const uint32_t crc32_table[8][256]", t, 8);
+
+    printf("#endif /* CRC_SMALL */\n\n#endif\n");
+    return 0;
+}
@@ -0,0 +1,314 @@
+/* Copyright (C) 
+* 2020 - B Vamsi Krishna <krishna.bv@gmail.com>
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+* 
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+* 
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+* 
+*/
+
+/*
+ * Small application around the GET-SET protocol files.
+ * Build: gcc -O2 -I../byte-scan -I../crc -o app app.c proto.c ../byte-scan/scan.c ../crc/crc.c
+ */
+
+#include <string.h>
+#include <time.h>
+#include "proto.h"
+
+#define BENCH_FRAMES 1000000
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void print_frame(const char *label, const uint8_t *buf, int len) {
+    int i;
+
+    printf("%-10s (%2d bytes):", label, len);
+    for(i = 0; i < len; i++) {
+        printf(" %02X", buf[i]);
+    }
+    printf("\n");
+}
+
+/* Encodes the same SET frame BENCH_FRAMES times into a stack buffer */
+static void bench_one(const char *name, const uint8_t *value, uint8_t len) {
+    msg_fields fields = { SET, STR, len, value };
+    uint8_t buf[MAX_FRAME_LEN(255)];
+    volatile int sink = 0;
+    double start, elapsed;
+    long i;
+
+    start = now_sec();
+    for(i = 0; i < BENCH_FRAMES; i++) {
+        sink += frame_packet(&fields, buf, sizeof(buf));
+    }
+    elapsed = now_sec() - start;
+
+    printf("frame_packet %s: %d frames in %.3f s = %.0f frames/s, %.0f MB/s\n",
+           name, BENCH_FRAMES, elapsed, BENCH_FRAMES / elapsed, BENCH_FRAMES * (double)len / elapsed / 1e6);
+}
+
+static void bench_frame_packet(void) {
+    static const uint8_t shortval[] = "temperature=$25/C";
+    uint8_t longval[255];
+    int i;
+
+    /* Long VALUE: printable text with an occasional '$' */
+    for(i = 0; i < (int)sizeof(longval); i++) {
+        longval[i] = (i % 97 == 96) ? SOF_CHAR : (uint8_t)('a' + i % 26);
+    }
+    bench_one("(17 B) ", shortval, sizeof(shortval) - 1);
+    bench_one("(255 B)", longval, sizeof(longval));
+}
+
+/* Frame handler used by the receive demo: counts frames and checks them against the sent ones */
+struct rx_check {
+    const msg_fields *sent;
+    int next;
+    int mismatches;
+};
+
+static void on_frame(const msg_fields *f, void *ctx) {
+    struct rx_check *chk = ctx;
+    const msg_fields *exp = &chk->sent[chk->next++ % 3];
+
+    if((f->opc != exp->opc) || (f->typ != exp->typ) || (f->len != exp->len) ||
+       (memcmp(f->val, exp->val, f->len) != 0)) {
+        chk->mismatches++;
+    }
+}
+
+/*
+ * Sends a stream of frames with line noise in between and feeds it to the
+ * parser in random sized chunks (1..64 bytes), then byte by byte.
+ */
+static void demo_parse_stream(void) {
+    static const uint8_t v1[] = "$$//", v2[] = "hello";
+    static const uint8_t v3[] = { 0x24, 0x2F, 0x00, 0xFF };
+    static const msg_fields sent[3] = {
+        { SET, STR, sizeof(v1) - 1, v1 }, { GET, STR, sizeof(v2) - 1, v2 }, { SET, INT, 4, v3 }
+    };
+    static uint8_t stream[200 * MAX_FRAME_LEN(8)];
+    uint8_t store[255];
+    struct rx_check chk = { sent, 0, 0 };
+    parser p;
+    msg_fields out;
+    size_t len = 0, pos = 0, frames = 0;
+    int i;
+
+    srand(1);
+    for(i = 0; i < 200; i++) {
+        stream[len++] = (uint8_t)'x';   /* Noise between frames */
+        len += frame_packet(&sent[i % 3], stream + len, sizeof(stream) - len);
+    }
+
+    parser_init(&p, store, sizeof(store));
+    while(pos < len) {
+        size_t n = 1 + rand() % 64;
+        if(n > len - pos) {
+            n = len - pos;
+        }
+        frames += parse_chunk(&p, stream + pos, n, on_frame, &chk);
+        pos += n;
+    }
+    printf("parse_chunk: %zu frames, %d mismatches, %u checksum errors, %u length errors\n",
+           frames, chk.mismatches, (unsigned)p.chksum_errors, (unsigned)p.length_errors);
+
+    /* Same stream byte by byte (the chunk pass unescaped 'stream' in place, so re-encode) */
+    for(i = 0, len = 0; i < 200; i++) {
+        len += frame_packet(&sent[i % 3], stream + len, sizeof(stream) - len);
+    }
+    parser_init(&p, store, sizeof(store));
+    for(pos = 0, frames = 0, chk.next = 0; pos < len; pos++) {
+        if(parse_byte(&p, stream[pos], &out) == PARSE_FRAME) {
+            on_frame(&out, &chk);
+            frames++;
+        }
+    }
+    printf("parse_byte:  %zu frames, %d mismatches, %u checksum errors, %u length errors\n",
+           frames, chk.mismatches, (unsigned)p.chksum_errors, (unsigned)p.length_errors);
+
+    /* A receiver that only holds 4 VALUE bytes: "hello" is a size error, not line noise */
+    parser_init(&p, store, 4);
+    for(pos = 0, frames = 0; pos < len; pos++) {
+        frames += (parse_byte(&p, stream[pos], &out) == PARSE_FRAME);
+    }
+    printf("4 byte store: %zu frames, %u checksum errors, %u length errors\n",
+           frames, (unsigned)p.chksum_errors, (unsigned)p.length_errors);
+}
+
+/*
+ * Swapping two VALUE bytes keeps the one's complement sum, so only the CRC
+ * trailer catches it.
+ */
+static void demo_crc(void) {
+    static const uint8_t value[] = "OPEN";
+    msg_fields f = { SET, STR, sizeof(value) - 1, value };
+    uint8_t buf[2 * MAX_CRC_FRAME_LEN(4)], store[255], tmp;
+    parser plain, checked;
+    size_t i;
+    int len;
+
+    len = frame_packet_crc(&f, buf, sizeof(buf));
+    print_frame("SET +CRC", buf, len);
+    memcpy(buf + len, buf, (size_t)len);
+    tmp = buf[len + 4];         /* 'O' <-> 'P' in the second copy */
+    buf[len + 4] = buf[len + 5];
+    buf[len + 5] = tmp;
+
+    parser_init(&plain, store, sizeof(store));
+    parser_init(&checked, store, sizeof(store));
+    parser_enable_crc(&checked);
+    for(i = 0; i < 2 * (size_t)len; i++) {
+        parse_byte(&checked, buf[i], NULL);
+        if(i % (size_t)len < (size_t)len - CRC_LEN) {
+            parse_byte(&plain, buf[i], NULL);   /* Same frames without the trailer */
+        }
+    }
+    printf("swapped bytes: checksum only %u/2 frames accepted, with CRC %u/2 accepted (%u CRC errors)\n",
+           (unsigned)plain.frames, (unsigned)checked.frames, (unsigned)checked.crc_errors);
+}
+
+/* Device side of the batch demo: parameter 'key' holds key * 1000 as a 4 byte INT */
+#define NUM_PARAMS 50
+
+struct device {
+    uint8_t tx[4 * MAX_FRAME_LEN(TLV_MAX_LEN)];    /* Response frames */
+    size_t tx_len;
+    int frames;
+};
+
+static void put_u32(uint8_t *buf, uint32_t v) {
+    buf[0] = (uint8_t)(v >> 24);
+    buf[1] = (uint8_t)(v >> 16);
+    buf[2] = (uint8_t)(v >> 8);
+    buf[3] = (uint8_t)v;
+}
+
+static uint32_t get_u32(const uint8_t *buf) {
+    return ((uint32_t)buf[0] << 24) | ((uint32_t)buf[1] << 16) | ((uint32_t)buf[2] << 8) | buf[3];
+}
+
+static void device_send(struct device *dev, const tlv_writer *w) {
+    msg_fields f;
+
+    tlv_fields(w, SET_BATCH, &f);
+    dev->tx_len += frame_packet(&f, dev->tx + dev->tx_len, sizeof(dev->tx) - dev->tx_len);
+    dev->frames++;
+}
+
+/* Answers a GET_BATCH with as many SET_BATCH frames as the values need */
+static void on_batch_request(const msg_fields *f, void *ctx) {
+    struct device *dev = ctx;
+    uint8_t value[TLV_MAX_LEN], v[4];
+    tlv_writer w;
+    tlv_iter it;
+    tlv_item item;
+
+    if((f->opc != GET_BATCH) || (f->typ != TLV)) {
+        return;
+    }
+    tlv_writer_init(&w, value, sizeof(value));
+    tlv_iter_init(&it, f);
+    while(tlv_next(&it, &item) == 1) {
+        put_u32(v, item.key * 1000u);
+        if(tlv_put(&w, item.key, INT, sizeof(v), v) < 0) {
+            device_send(dev, &w);
+            tlv_writer_init(&w, value, sizeof(value));
+            tlv_put(&w, item.key, INT, sizeof(v), v);
+        }
+    }
+    device_send(dev, &w);
+}
+
+/* Host side: checks every reported value */
+struct host {
+    int values;
+    int errors;
+};
+
+static void on_batch_response(const msg_fields *f, void *ctx) {
+    struct host *host = ctx;
+    tlv_iter it;
+    tlv_item item;
+
+    tlv_iter_init(&it, f);
+    while(tlv_next(&it, &item) == 1) {
+        host->values++;
+        if((item.typ != INT) || (item.len != 4) || (get_u32(item.val) != item.key * 1000u)) {
+            host->errors++;
+        }
+    }
+}
+
+/* Reads NUM_PARAMS parameters with one GET_BATCH and compares with one GET per key */
+static void demo_batch(void) {
+    static struct device dev;
+    struct host host = { 0, 0 };
+    uint8_t value[TLV_MAX_LEN], req[MAX_FRAME_LEN(TLV_MAX_LEN)], store[255];
+    uint8_t key, v[4], single[MAX_FRAME_LEN(4)];
+    size_t single_bytes = 0;
+    tlv_writer w;
+    msg_fields f;
+    parser p;
+    int req_len;
+
+    tlv_writer_init(&w, value, sizeof(value));
+    for(key = 0; key < NUM_PARAMS; key++) {
+        tlv_put(&w, key, INT, 0, NULL);
+    }
+    tlv_fields(&w, GET_BATCH, &f);
+    req_len = frame_packet(&f, req, sizeof(req));
+
+    parser_init(&p, store, sizeof(store));
+    parse_chunk(&p, req, (size_t)req_len, on_batch_request, &dev);
+    parser_init(&p, store, sizeof(store));
+    parse_chunk(&p, dev.tx, dev.tx_len, on_batch_response, &host);
+
+    /* Same parameters one frame pair at a time */
+    for(key = 0; key < NUM_PARAMS; key++) {
+        msg_fields get = { GET, INT, 1, &key };
+        msg_fields set = { SET, INT, sizeof(v), v };
+        put_u32(v, key * 1000u);
+        single_bytes += frame_packet(&get, single, sizeof(single));
+        single_bytes += frame_packet(&set, single, sizeof(single));
+    }
+
+    printf("batch: %d values, %d errors: 1 request + %d responses, %zu bytes "
+           "(single GETs: %d round trips, %zu bytes)\n",
+           host.values, host.errors, dev.frames, (size_t)req_len + dev.tx_len, NUM_PARAMS, single_bytes);
+}
+
+int main(void) {
+    static const uint8_t set_val[] = "$5/";
+    uint8_t get_val = 7;
+    msg_fields set_msg = { SET, STR, sizeof(set_val) - 1, set_val };
+    msg_fields get_msg = { GET, INT, 1, &get_val };
+    uint8_t buf[MAX_FRAME_LEN(255)];
+    int len;
+
+    len = frame_packet(&get_msg, buf, sizeof(buf));
+    print_frame("GET INT", buf, len);
+
+    len = frame_packet(&set_msg, buf, sizeof(buf));
+    print_frame("SET STR", buf, len);
+
+    demo_parse_stream();
+    demo_crc();
+    demo_batch();
+    bench_frame_packet();
+    return 0;
+}
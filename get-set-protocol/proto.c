@@ -1,60 +1,377 @@
+#include <string.h>
 #include "proto.h"
+#include "scan.h"
+#include "crc.h"
 
 
-/* setters prototypes */
-void set_opcode(uint8_t);
-void set_type(uint8_t);
-void set_length(uint8_t);
-void set_value(uint8_t *);
-void set_chksum(uint16_t);
+/* Folds the carries of a 32 bit running sum into 16 bits (one's complement addition) */
+static uint16_t fold_sum(uint32_t sum) {
+    while(sum >> 16) {
+        sum = (sum & 0xFFFF) + (sum >> 16);
+    }
+    return (uint16_t)sum;
+}
+
+/* Final checksum from a running sum */
+static inline uint16_t calc_from_sum(uint32_t sum) {
+    return (uint16_t)(~fold_sum(sum) & 0xFFFF);
+}
+
+/* Running summation of OPCODE, TYPE, LENGTH and VALUE, then one's complement */
+uint16_t calculate_chksum(const msg_fields *fields) {
+    uint32_t sum = 0;
+    uint8_t i;
 
-/* getters prototypes */
-uint8_t get_opcode(void);
-uint8_t get_type(void);
-uint8_t get_length(void);
-uint8_t *get_value(void);
-uint16_t get_chksum(void);
+    if(NULL == fields) {
+        return DEF_CHKSUM;
+    }
 
-/* Helper functions */
-uint8_t create_msg();
-uint8_t calculate_chksum();
+    sum += (uint8_t)fields->opc;
+    sum += (uint8_t)fields->typ;
+    sum += fields->len;
+    if(fields->len < SCAN_MIN_LEN) {
+        for(i = 0; i < fields->len; i++) {
+            sum += fields->val[i];
+        }
+    } else {
+        sum += (uint32_t)scan_sum(fields->val, fields->len);
+    }
 
-/* APIs */
-uint8_t frame_packet();
-uint8_t parse_packet();
+    return calc_from_sum(sum);
+}
 
-// Temporarily silence the linker. The protocol files are supposed to get integrated with app file
-int main(void) {
+/* Appends one byte, escaping it if needed. Returns the new position or NULL if full. */
+static inline uint8_t *put_escaped(uint8_t *out, const uint8_t *end, uint8_t byte) {
+    if((byte == SOF_CHAR) || (byte == ESC_CHAR)) {
+        if(end - out < 2) {
+            return NULL;
+        }
+        *out++ = ESC_CHAR;
+    } else if(out >= end) {
+        return NULL;
+    }
+    *out++ = byte;
+    return out;
+}
 
-    return 0;
+/* CRC-16-CCITT over the unescaped OPCODE, TYPE, LENGTH, VALUE and CHECKSUM */
+static uint16_t frame_crc(const msg_fields *fields, uint16_t chksum) {
+    uint8_t bytes[HDR_LEN];
+    uint16_t crc;
 
+    bytes[0] = (uint8_t)fields->opc;
+    bytes[1] = (uint8_t)fields->typ;
+    bytes[2] = fields->len;
+    crc = crc16_update(CRC16_INIT, bytes, HDR_LEN);
+    crc = crc16_update(crc, fields->val, fields->len);
+    bytes[0] = (uint8_t)(chksum >> 8);
+    bytes[1] = (uint8_t)(chksum & 0xFF);
+    return crc16_update(crc, bytes, CHKSUM_LEN);
 }
 
-uint8_t create_msg() {
-    if(NULL == msg) {
-        msg = (msg_fmt *)malloc(sizeof(msg_fmt));   
-        return (1);
+static int encode(const msg_fields *fields, uint8_t *buf, size_t buf_len, uint8_t with_crc) {
+    uint8_t *out = buf;
+    const uint8_t *end = buf + buf_len;
+    uint32_t sum = 0;
+    uint16_t chksum;
+    uint8_t hdr[HDR_LEN];
+    size_t i, run;
+
+    if((NULL == fields) || (NULL == buf) || (buf_len == 0) ||
+       ((fields->len != 0) && (NULL == fields->val))) {
+        return -1;
+    }
+
+    *out++ = SOF_CHAR;
+
+    hdr[0] = (uint8_t)fields->opc;
+    hdr[1] = (uint8_t)fields->typ;
+    hdr[2] = fields->len;
+
+    for(i = 0; i < HDR_LEN; i++) {
+        sum += hdr[i];
+        if(NULL == (out = put_escaped(out, end, hdr[i]))) {
+            return -1;
+        }
+    }
+
+    if(fields->len < SCAN_MIN_LEN) {
+        /* Short VALUE: checksum and escape each byte as it is written */
+        for(i = 0; i < fields->len; i++) {
+            sum += fields->val[i];
+            if(NULL == (out = put_escaped(out, end, fields->val[i]))) {
+                return -1;
+            }
+        }
     } else {
-        // msg already created - singleton pattern
-        return (0);
+        /* Long VALUE: vector sum, then copy the runs between bytes that need escaping */
+        sum += (uint32_t)scan_sum(fields->val, fields->len);
+        for(i = 0; i < fields->len; i += run) {
+            run = scan_find2(fields->val + i, fields->len - i, SOF_CHAR, ESC_CHAR);
+            if((size_t)(end - out) < run) {
+                return -1;
+            }
+            memcpy(out, fields->val + i, run);
+            out += run;
+            if(i + run < fields->len) {
+                if(NULL == (out = put_escaped(out, end, fields->val[i + run]))) {
+                    return -1;
+                }
+                run++;
+            }
+        }
     }
-}
 
-uint8_t frame_packet(struct msg_fields *msg_fields) {
-    if(NULL == msg_fields) {
+    chksum = calc_from_sum(sum);
+    if((NULL == (out = put_escaped(out, end, (uint8_t)(chksum >> 8)))) ||
+       (NULL == (out = put_escaped(out, end, (uint8_t)(chksum & 0xFF))))) {
         return -1;
+    }
+
+    if(with_crc) {
+        uint16_t crc = frame_crc(fields, chksum);
+        if((NULL == (out = put_escaped(out, end, (uint8_t)(crc >> 8)))) ||
+           (NULL == (out = put_escaped(out, end, (uint8_t)(crc & 0xFF))))) {
+            return -1;
+        }
+    }
+
+    return (int)(out - buf);
+}
+
+int frame_packet(const msg_fields *fields, uint8_t *buf, size_t buf_len) {
+    return encode(fields, buf, buf_len, 0);
+}
+
+int frame_packet_crc(const msg_fields *fields, uint8_t *buf, size_t buf_len) {
+    return encode(fields, buf, buf_len, 1);
+}
+
+void parser_init(parser *p, uint8_t *store, size_t store_len) {
+    p->state = WAIT_SOF;
+    p->escaped = 0;
+    p->count = 0;
+    p->sum = 0;
+    p->rx_chksum = 0;
+    p->crc = 0;
+    p->rx_crc = 0;
+    p->wr = store;
+    p->store = store;
+    p->store_len = store_len;
+    p->frames = 0;
+    p->chksum_errors = 0;
+    p->length_errors = 0;
+    p->crc_errors = 0;
+    p->resyncs = 0;
+}
+
+void parser_enable_crc(parser *p) {
+    p->crc = 1;
+}
+
+/*
+ * Core state machine shared by parse_byte() and parse_chunk().
+ * 'byte' is already unescaped; 'sof' tells whether it was an unescaped SOF.
+ * 'rd' is the position right after the byte in the caller buffer (or NULL),
+ * used to unescape the VALUE in place.
+ */
+static int parser_step(parser *p, uint8_t byte, uint8_t sof, uint8_t *rd) {
+    if(sof) {
+        if(p->state != WAIT_SOF) {
+            p->resyncs++;
+        }
+        p->state = WAIT_OPCODE;
+        p->sum = 0;
+        return PARSE_MORE;
+    }
+
+    switch(p->state) {
+        case WAIT_SOF:
+            break;  /* Noise between frames */
+
+        case WAIT_OPCODE:
+            p->cur.opc = (opcode)byte;
+            p->sum += byte;
+            p->state = WAIT_TYPE;
+            break;
+
+        case WAIT_TYPE:
+            p->cur.typ = (type)byte;
+            p->sum += byte;
+            p->state = WAIT_LENGTH;
+            break;
+
+        case WAIT_LENGTH:
+            p->cur.len = byte;
+            p->sum += byte;
+            p->count = 0;
+            if(byte > p->store_len) {
+                p->length_errors++;     /* Cannot hold it: drop and resync */
+                p->state = WAIT_SOF;
+                return PARSE_ERROR;
+            }
+            /* In place when the VALUE starts inside the caller buffer */
+            p->wr = (NULL != rd) ? rd : p->store;
+            p->cur.val = p->wr;
+            p->state = (byte == 0) ? WAIT_CHKSUM_HI : WAIT_VALUE;
+            break;
+
+        case WAIT_VALUE:
+            *p->wr++ = byte;
+            p->sum += byte;
+            if(++p->count == p->cur.len) {
+                p->state = WAIT_CHKSUM_HI;
+            }
+            break;
+
+        case WAIT_CHKSUM_HI:
+            p->rx_chksum = (uint16_t)(byte << 8);
+            p->state = WAIT_CHKSUM_LO;
+            break;
+
+        case WAIT_CHKSUM_LO:
+            p->rx_chksum |= byte;
+            p->state = WAIT_SOF;
+            if(p->rx_chksum != calc_from_sum(p->sum)) {
+                p->chksum_errors++;
+                return PARSE_ERROR;
+            }
+            if(p->crc) {
+                p->state = WAIT_CRC_HI;
+                break;
+            }
+            p->frames++;
+            return PARSE_FRAME;
+
+        case WAIT_CRC_HI:
+            p->rx_crc = (uint16_t)(byte << 8);
+            p->state = WAIT_CRC_LO;
+            break;
+
+        case WAIT_CRC_LO:
+            p->rx_crc |= byte;
+            p->state = WAIT_SOF;
+            if(p->rx_crc != frame_crc(&p->cur, p->rx_chksum)) {
+                p->crc_errors++;
+                return PARSE_ERROR;
+            }
+            p->frames++;
+            return PARSE_FRAME;
+    }
+    return PARSE_MORE;
+}
+
+int parse_byte(parser *p, uint8_t byte, msg_fields *out) {
+    int ret;
+
+    if(p->escaped) {
+        p->escaped = 0;
+        ret = parser_step(p, byte, 0, NULL);
+    } else if(byte == ESC_CHAR) {
+        p->escaped = 1;
+        return PARSE_MORE;
     } else {
-        if(create_msg()) {
-            set_opcode(msg_fields->opcode);
-            set_type(msg_fields->type);
-            set_length(msg_fields->length);
-            set_value(msg_fields->value);
-            
-            if(calculate_chksum()) {
-                set_chksum();
-            } else {
-                set_chksum(DEF_CHKSUM);
-            }
-        }   
+        ret = parser_step(p, byte, byte == SOF_CHAR, NULL);
     }
+
+    if((ret == PARSE_FRAME) && (NULL != out)) {
+        *out = p->cur;
+    }
+    return ret;
+}
+
+size_t parse_chunk(parser *p, uint8_t *data, size_t len, frame_handler handler, void *ctx) {
+    size_t i, frames = 0;
+    int ret;
+
+    for(i = 0; i < len; i++) {
+        uint8_t byte = data[i];
+
+        if(p->escaped) {
+            p->escaped = 0;
+            ret = parser_step(p, byte, 0, &data[i + 1]);
+        } else if(byte == ESC_CHAR) {
+            p->escaped = 1;
+            continue;
+        } else {
+            ret = parser_step(p, byte, byte == SOF_CHAR, &data[i + 1]);
+        }
+
+        if(ret == PARSE_FRAME) {
+            frames++;
+            if(NULL != handler) {
+                handler(&p->cur, ctx);
+            }
+        }
+    }
+
+    /* VALUE still open: move what is in the caller buffer into the store */
+    if((p->state == WAIT_VALUE || p->state == WAIT_CHKSUM_HI || p->state == WAIT_CHKSUM_LO ||
+        p->state == WAIT_CRC_HI || p->state == WAIT_CRC_LO) &&
+       (p->cur.val != p->store) && (p->cur.len != 0)) {
+        memmove(p->store, p->cur.val, p->count);
+        p->cur.val = p->store;
+        p->wr = p->store + p->count;
+    }
+    return frames;
+}
+
+void tlv_writer_init(tlv_writer *w, uint8_t *buf, size_t cap) {
+    w->buf = buf;
+    w->cap = (cap > TLV_MAX_LEN) ? TLV_MAX_LEN : (uint8_t)cap;
+    w->len = 0;
+    w->count = 0;
+}
+
+int tlv_put(tlv_writer *w, uint8_t key, type typ, uint8_t len, const uint8_t *val) {
+    uint8_t *out;
+
+    if((NULL == w) || ((len != 0) && (NULL == val))) {
+        return -1;
+    }
+    if((size_t)w->cap - w->len < (size_t)TLV_HDR_LEN + len) {
+        return -1;
+    }
+
+    out = w->buf + w->len;
+    out[0] = key;
+    out[1] = (uint8_t)typ;
+    out[2] = len;
+    if(len != 0) {
+        memcpy(out + TLV_HDR_LEN, val, len);
+    }
+    w->len = (uint8_t)(w->len + TLV_HDR_LEN + len);
+    w->count++;
+    return 0;
+}
+
+void tlv_fields(const tlv_writer *w, opcode opc, msg_fields *fields) {
+    fields->opc = opc;
+    fields->typ = TLV;
+    fields->len = w->len;
+    fields->val = w->buf;
+}
+
+void tlv_iter_init(tlv_iter *it, const msg_fields *fields) {
+    it->pos = fields->val;
+    it->end = fields->val + fields->len;
+}
+
+int tlv_next(tlv_iter *it, tlv_item *out) {
+    const uint8_t *p = it->pos;
+
+    if(p == it->end) {
+        return 0;
+    }
+    if((it->end - p < TLV_HDR_LEN) || (it->end - p - TLV_HDR_LEN < p[2])) {
+        it->pos = it->end;      /* Malformed: stop here */
+        return -1;
+    }
+
+    out->key = p[0];
+    out->typ = (type)p[1];
+    out->len = p[2];
+    out->val = p + TLV_HDR_LEN;
+    it->pos = p + TLV_HDR_LEN + p[2];
+    return 1;
 }
@@ -25,10 +25,26 @@
 
 #define DEF_CHKSUM  0xFFFF
 
+#define SOF_CHAR    '$'     /* Start of frame */
+#define ESC_CHAR    '/'     /* Escapes SOF_CHAR and ESC_CHAR after the SOF */
+
+/* Unescaped header after SOF: OPCODE, TYPE, LENGTH */
+#define HDR_LEN     3
+#define CHKSUM_LEN  2
+
+/* Optional CRC-16-CCITT trailer after the CHECKSUM */
+#define CRC_LEN     2
+
+/* Worst case encoded size for a value of 'len' bytes: every byte after SOF escaped */
+#define MAX_FRAME_LEN(len)      (1 + 2 * (HDR_LEN + (len) + CHKSUM_LEN))
+#define MAX_CRC_FRAME_LEN(len)  (MAX_FRAME_LEN(len) + 2 * CRC_LEN)
+
 
 typedef enum opcode {
     GET = 0,
     SET = 1,
+    GET_BATCH = 2,  /* VALUE is a list of TLVs, one per key to read (length 0) */
+    SET_BATCH = 3,  /* VALUE is a list of TLVs, one per key to write or reported */
     UNDEFINED = -1
 } opcode;
 
@@ -36,6 +52,7 @@ typedef enum type {
     INT  = 0,
     CHAR = 1,
     STR  = 2,
+    TLV  = 3,       /* Type of GET_BATCH and SET_BATCH frames */
     INVALID = -1
 } type;
 
@@ -43,20 +60,151 @@ typedef struct message_fields {
     opcode opc;
     type typ;
     uint8_t len;
-    uint8_t *val;    
+    const uint8_t *val;
 } msg_fields;
 
-typedef struct message_format {
-    uint8_t SOF;
-    opcode opc;
+/* Batch VALUE: a list of KEY | TYPE | LENGTH | VALUE records */
+#define TLV_HDR_LEN 3
+
+/* Largest VALUE of a batch frame (LENGTH is one byte) */
+#define TLV_MAX_LEN 255
+
+typedef struct tlv_item {
+    uint8_t key;
     type typ;
     uint8_t len;
-    uint8_t *val;
-    uint16_t chksum;
-} msg_fmt;
+    const uint8_t *val;
+} tlv_item;
 
-msg_fmt *msg = NULL;
+/* Builds the VALUE of a batch frame in a caller provided buffer */
+typedef struct tlv_writer {
+    uint8_t *buf;
+    uint8_t cap;
+    uint8_t len;
+    uint8_t count;          /* Records written */
+} tlv_writer;
 
+/* Walks the records of a received batch frame in place */
+typedef struct tlv_iter {
+    const uint8_t *pos;
+    const uint8_t *end;
+} tlv_iter;
 
-#endif
+/* Receiver states */
+typedef enum parse_state {
+    WAIT_SOF = 0,
+    WAIT_OPCODE,
+    WAIT_TYPE,
+    WAIT_LENGTH,
+    WAIT_VALUE,
+    WAIT_CHKSUM_HI,
+    WAIT_CHKSUM_LO,
+    WAIT_CRC_HI,
+    WAIT_CRC_LO
+} parse_state;
+
+/* Result of parse_byte() */
+#define PARSE_MORE      0   /* Frame not complete yet */
+#define PARSE_FRAME     1   /* Complete, valid frame in 'out' */
+#define PARSE_ERROR     -1  /* Frame dropped (bad checksum or too long) */
+
+/*
+ * Streaming receiver. Works on any fragmentation: bytes can arrive one at a
+ * time (UART ISR) or in chunks of any size (read() on a socket).
+ * 'store' is caller provided and holds the unescaped VALUE of a frame that
+ * spans several calls; it should be at least 255 bytes.
+ */
+typedef struct parser {
+    parse_state state;
+    uint8_t escaped;        /* Previous byte was ESC_CHAR */
+    msg_fields cur;         /* Header of the frame being received */
+    uint8_t count;          /* VALUE bytes received so far */
+    uint32_t sum;           /* Running checksum */
+    uint16_t rx_chksum;     /* Received checksum */
+    uint8_t crc;            /* Frames carry a CRC trailer */
+    uint16_t rx_crc;        /* Received CRC */
+    uint8_t *wr;            /* Where the next unescaped VALUE byte goes */
+    uint8_t *store;
+    size_t store_len;
+    /* Statistics */
+    uint32_t frames;
+    uint32_t chksum_errors;
+    uint32_t length_errors; /* Frames whose LENGTH does not fit the store, dropped */
+    uint32_t crc_errors;
+    uint32_t resyncs;       /* Frames abandoned because a new SOF arrived */
+} parser;
+
+/* Called by parse_chunk() for every valid frame. 'fields->val' is only valid during the call. */
+typedef void (*frame_handler)(const msg_fields *fields, void *ctx);
+
+/* Helper functions */
+uint16_t calculate_chksum(const msg_fields *fields);
+
+/* APIs */
 
+/*
+ * Encodes 'fields' into 'buf' in a single pass:
+ *   SOF | OPCODE | TYPE | LENGTH | VALUE | CHECKSUM (big endian)
+ * Every byte after the SOF that equals SOF_CHAR or ESC_CHAR is preceded by
+ * ESC_CHAR. No memory is allocated; 'buf' should hold MAX_FRAME_LEN(len).
+ * Returns the encoded length, or -1 if the arguments are invalid or the
+ * frame does not fit.
+ */
+int frame_packet(const msg_fields *fields, uint8_t *buf, size_t buf_len);
+
+/*
+ * Same as frame_packet() followed by the CRC-16-CCITT of the unescaped
+ * OPCODE..CHECKSUM bytes (big endian, escaped like the rest of the frame).
+ * 'buf' should hold MAX_CRC_FRAME_LEN(len).
+ */
+int frame_packet_crc(const msg_fields *fields, uint8_t *buf, size_t buf_len);
+
+/* Resets 'p' and attaches the VALUE store; longer frames are dropped and counted in length_errors */
+void parser_init(parser *p, uint8_t *store, size_t store_len);
+
+/*
+ * Expects the CRC trailer of frame_packet_crc() on every frame (both sides
+ * must agree). Frames with a wrong CRC are dropped and counted in crc_errors.
+ */
+void parser_enable_crc(parser *p);
+
+/*
+ * Feeds one byte. On PARSE_FRAME, 'out' describes the frame and 'out->val'
+ * points into the parser store (valid until the next call).
+ */
+int parse_byte(parser *p, uint8_t byte, msg_fields *out);
+
+/*
+ * Feeds a chunk of received bytes and calls 'handler' for every valid frame.
+ * Frames that start and end inside the chunk are unescaped in place and
+ * 'val' points into 'data' (no copy); only the part of a frame that crosses
+ * a chunk boundary is kept in the store. 'data' is modified.
+ * Returns the number of valid frames delivered.
+ */
+size_t parse_chunk(parser *p, uint8_t *data, size_t len, frame_handler handler, void *ctx);
+
+/* Batched requests */
+
+/* Starts an empty batch in 'buf' ('cap' is clamped to TLV_MAX_LEN) */
+void tlv_writer_init(tlv_writer *w, uint8_t *buf, size_t cap);
+
+/*
+ * Appends one record. 'val' may be NULL when 'len' is 0 (keys of a GET_BATCH).
+ * Returns 0, or -1 if the record does not fit: send the batch, start a new
+ * one and put the record again.
+ */
+int tlv_put(tlv_writer *w, uint8_t key, type typ, uint8_t len, const uint8_t *val);
+
+/* Fills 'fields' for sending the batch with frame_packet() ('opc' is GET_BATCH or SET_BATCH) */
+void tlv_fields(const tlv_writer *w, opcode opc, msg_fields *fields);
+
+/* Starts iterating the records of a received batch frame */
+void tlv_iter_init(tlv_iter *it, const msg_fields *fields);
+
+/*
+ * Returns the next record in 'out'; 'out->val' points into the frame VALUE.
+ * Returns 1 for a record, 0 at the end, -1 if a record is truncated.
+ */
+int tlv_next(tlv_iter *it, tlv_item *out);
+
+#endif
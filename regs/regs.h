@@ -0,0 +1,109 @@
+#ifndef REGS_H
+#define REGS_H
+
+#include <stdint.h>
+
+/*
+ * Register access layer shared by the drivers (Dummy i2c driver, ENC28J60).
+ * Header only: everything is a macro or a static inline function, so an
+ * access compiles to a single load or store.
+ *
+ * Registers are volatile typed fields, so every read and write in the source
+ * reaches the hardware, in order, and none is merged or dropped:
+ *
+ *   struct I2CDevice { reg16_t control; reg16_t status; ... };
+ *
+ * A field is described by two constants, NAME_SHIFT and NAME_WIDTH, and the
+ * macros below turn them into masks and values at compile time:
+ *
+ *   #define I2C_CTRL_START_SHIFT 1
+ *   #define I2C_CTRL_START_WIDTH 1
+ *
+ *   REG_MASK(I2C_CTRL_START)            0x0002
+ *   REG_VAL(I2C_CTRL_START, 1)          0x0002
+ *   REG_GET(I2C_CTRL_START, value)      0 or 1
+ *
+ * reg_modify*() is the one read-modify-write helper: one load, one store.
+ * Build a whole new value with REG_VAL()s and write it once with reg_write*()
+ * rather than setting fields one at a time.
+ *
+ * With REGS_TRACE defined every access also calls
+ * regs_trace_access(op, addr, value); regs_trace.c is the host recorder
+ * used by the tests.
+ */
+
+typedef volatile uint8_t reg8_t;
+typedef volatile uint16_t reg16_t;
+typedef volatile uint32_t reg32_t;
+
+/* Field constants: NAME_SHIFT and NAME_WIDTH */
+#define REG_MASK(f)         ((uint32_t)((1ul << f##_WIDTH) - 1u) << f##_SHIFT)
+#define REG_VAL(f, v)       (((uint32_t)(v) << f##_SHIFT) & REG_MASK(f))
+#define REG_GET(f, r)       (((uint32_t)(r) & REG_MASK(f)) >> f##_SHIFT)
+
+#define REGS_READ 'R'
+#define REGS_WRITE 'W'
+
+/*
+ * 'addr' is the register's address for memory mapped registers, or the
+ * register code for registers behind a bus (ENC28J60 over SPI).
+ */
+#ifdef REGS_TRACE
+void regs_trace_access(char op, uintptr_t addr, uint32_t value);
+#define REGS_TRACE_ACCESS(op, addr, value) regs_trace_access((op), (uintptr_t)(addr), (value))
+#else
+#define REGS_TRACE_ACCESS(op, addr, value) ((void)0)
+#endif
+
+static inline uint8_t reg_read8(const reg8_t *r) {
+    uint8_t v = *r;
+    REGS_TRACE_ACCESS(REGS_READ, r, v);
+    return v;
+}
+
+static inline void reg_write8(reg8_t *r, uint8_t v) {
+    REGS_TRACE_ACCESS(REGS_WRITE, r, v);
+    *r = v;
+}
+
+static inline uint16_t reg_read16(const reg16_t *r) {
+    uint16_t v = *r;
+    REGS_TRACE_ACCESS(REGS_READ, r, v);
+    return v;
+}
+
+static inline void reg_write16(reg16_t *r, uint16_t v) {
+    REGS_TRACE_ACCESS(REGS_WRITE, r, v);
+    *r = v;
+}
+
+static inline uint32_t reg_read32(const reg32_t *r) {
+    uint32_t v = *r;
+    REGS_TRACE_ACCESS(REGS_READ, r, v);
+    return v;
+}
+
+static inline void reg_write32(reg32_t *r, uint32_t v) {
+    REGS_TRACE_ACCESS(REGS_WRITE, r, v);
+    *r = v;
+}
+
+/* Read-modify-write: clears 'clear', then sets 'set' */
+static inline void reg_modify8(reg8_t *r, uint8_t clear, uint8_t set) {
+    reg_write8(r, (uint8_t)((reg_read8(r) & ~clear) | set));
+}
+
+static inline void reg_modify16(reg16_t *r, uint16_t clear, uint16_t set) {
+    reg_write16(r, (uint16_t)((reg_read16(r) & ~clear) | set));
+}
+
+static inline void reg_modify32(reg32_t *r, uint32_t clear, uint32_t set) {
+    reg_write32(r, (reg_read32(r) & ~clear) | set);
+}
+
+/* One field of a register (read-modify-write) */
+#define REG_FIELD_SET8(r, f, v)     reg_modify8((r), (uint8_t)REG_MASK(f), (uint8_t)REG_VAL(f, v))
+#define REG_FIELD_SET16(r, f, v)    reg_modify16((r), (uint16_t)REG_MASK(f), (uint16_t)REG_VAL(f, v))
+#define REG_FIELD_SET32(r, f, v)    reg_modify32((r), REG_MASK(f), REG_VAL(f, v))
+
+#endif /* REGS_H */
@@ -0,0 +1,49 @@
+#include "regs.h"
+#include "regs_trace.h"
+
+static RegsAccess trace[REGS_TRACE_LEN];
+static uint32_t count;
+
+void regs_trace_access(char op, uintptr_t addr, uint32_t value) {
+    if(count < REGS_TRACE_LEN) {
+        trace[count].op = op;
+        trace[count].addr = addr;
+        trace[count].value = value;
+    }
+    count++;
+}
+
+void regs_trace_reset(void) {
+    count = 0;
+}
+
+uint32_t regs_trace_count(void) {
+    return count;
+}
+
+const RegsAccess *regs_trace_get(uint32_t i) {
+    return (i < count && i < REGS_TRACE_LEN) ? &trace[i] : NULL;
+}
+
+uint32_t regs_trace_count_of(char op, uintptr_t addr) {
+    uint32_t i, n = 0;
+
+    for(i = 0; i < count && i < REGS_TRACE_LEN; i++) {
+        if(trace[i].addr == addr && (op == 0 || trace[i].op == op)) {
+            n++;
+        }
+    }
+    return n;
+}
+
+void regs_trace_print(FILE *out, uintptr_t base) {
+    uint32_t i;
+
+    for(i = 0; i < count && i < REGS_TRACE_LEN; i++) {
+        fprintf(out, "%c 0x%04lX = 0x%04lX\n", trace[i].op,
+                (unsigned long)(trace[i].addr - base), (unsigned long)trace[i].value);
+    }
+    if(count > REGS_TRACE_LEN) {
+        fprintf(out, "... %lu more\n", (unsigned long)(count - REGS_TRACE_LEN));
+    }
+}
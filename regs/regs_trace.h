@@ -0,0 +1,37 @@
+#ifndef REGS_TRACE_H
+#define REGS_TRACE_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * Host recorder for register accesses. Build the code under test with
+ * -DREGS_TRACE and link regs_trace.c: every reg_read*() / reg_write*() is
+ * appended to the trace, so a test can check exactly which registers were
+ * touched, with which values and in which order.
+ */
+
+#define REGS_TRACE_LEN 1024     /* Accesses kept; later ones are only counted */
+
+typedef struct {
+    char op;                    /* REGS_READ or REGS_WRITE */
+    uintptr_t addr;
+    uint32_t value;
+} RegsAccess;
+
+/* Forgets everything recorded so far */
+void regs_trace_reset(void);
+
+/* Accesses since the last reset (may be more than REGS_TRACE_LEN) */
+uint32_t regs_trace_count(void);
+
+/* The i-th access, NULL if not kept */
+const RegsAccess *regs_trace_get(uint32_t i);
+
+/* Number of 'op' accesses of one register; op 0 counts both */
+uint32_t regs_trace_count_of(char op, uintptr_t addr);
+
+/* Prints the trace, addresses as offsets from 'base' (0 for register codes) */
+void regs_trace_print(FILE *out, uintptr_t base);
+
+#endif /* REGS_TRACE_H */
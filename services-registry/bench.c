@@ -0,0 +1,293 @@
+/*
+ * Checks the registry (lookups, updates, deregistration with tombstones
+ * against a local model, a full table, other processes seeing the records),
+ * then measures lookups/s with 1..16 reader processes, without and with a
+ * writer updating records meanwhile, and a lookup over a UNIX socket to a
+ * server process for comparison.
+ * Build: make bench
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include "services_registry.h"
+
+#define SERVICES        1000
+#define RUN_SEC         0.5
+#define MAX_READERS     16
+
+static char shm_name[64];
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void service_name(char *buf, size_t len, int i) {
+    snprintf(buf, len, "service-%d", i);
+}
+
+static void service_endpoint(char *buf, size_t len, int i, int version) {
+    snprintf(buf, len, "/run/services/%d.%d.sock", i, version);
+}
+
+/* Random register/deregister against a model, on a small table so tombstones pile up and get purged */
+static int test_churn(void) {
+    static char model[64][REGISTRY_ENDPOINT_LEN];
+    char name[REGISTRY_NAME_LEN], endpoint[REGISTRY_ENDPOINT_LEN], small[80];
+    registry reg;
+    int i, k, live = 0, errors = 0;
+
+    snprintf(small, sizeof(small), "%s-churn", shm_name);
+    if(registry_open(&reg, small, 64, REGISTRY_CREATE) < 0) {
+        perror("registry_open");
+        return 1;
+    }
+    srand(1);
+    for(i = 0; i < 100000; i++) {
+        k = rand() % 64;
+        service_name(name, sizeof(name), k);
+        if(rand() % 2) {
+            service_endpoint(endpoint, sizeof(endpoint), k, i);
+            if(registry_register(&reg, name, endpoint) == 0) {
+                live += (model[k][0] == '\0');
+                strcpy(model[k], endpoint);
+            } else {
+                errors += (errno != ENOSPC) || (live < 48) || (model[k][0] != '\0');
+            }
+        } else {
+            errors += (registry_deregister(&reg, name) == 0) != (model[k][0] != '\0');
+            live -= (model[k][0] != '\0');
+            model[k][0] = '\0';
+        }
+        if(i % 100 == 0) {
+            for(k = 0; k < 64; k++) {
+                service_name(name, sizeof(name), k);
+                if(registry_lookup(&reg, name, endpoint, sizeof(endpoint)) == 0) {
+                    errors += (strcmp(endpoint, model[k]) != 0);
+                } else {
+                    errors += (model[k][0] != '\0') || (errno != ENOENT);
+                }
+            }
+        }
+    }
+    errors += (registry_count(&reg) != (uint32_t)live);
+    registry_close(&reg);
+    registry_unlink(small);
+    return errors;
+}
+
+static int test_basic(registry *reg) {
+    char name[REGISTRY_NAME_LEN], endpoint[REGISTRY_ENDPOINT_LEN], want[REGISTRY_ENDPOINT_LEN];
+    char long_name[REGISTRY_NAME_LEN + 1];
+    uint64_t generation;
+    registry other;
+    pid_t pid;
+    int i, status, errors = 0;
+
+    for(i = 0; i < SERVICES; i++) {
+        service_name(name, sizeof(name), i);
+        service_endpoint(endpoint, sizeof(endpoint), i, 0);
+        errors += (registry_register(reg, name, endpoint) != 0);
+    }
+    errors += (registry_count(reg) != SERVICES);
+
+    /* Replacing an endpoint keeps the count and moves the generation */
+    generation = registry_generation(reg);
+    errors += (registry_register(reg, "service-7", "/run/services/7.1.sock") != 0);
+    errors += (registry_lookup(reg, "service-7", endpoint, sizeof(endpoint)) != 0) ||
+              (strcmp(endpoint, "/run/services/7.1.sock") != 0);
+    errors += (registry_count(reg) != SERVICES) || (registry_generation(reg) != generation + 1);
+    errors += (registry_register(reg, "service-7", "/run/services/7.0.sock") != 0);
+
+    /* Truncated copy, missing and invalid names */
+    errors += (registry_lookup(reg, "service-7", endpoint, 6) != 0) || (strcmp(endpoint, "/run/") != 0);
+    errors += (registry_lookup(reg, "service-x", endpoint, sizeof(endpoint)) != -1) || (errno != ENOENT);
+    errors += (registry_deregister(reg, "service-x") != -1) || (errno != ENOENT);
+    memset(long_name, 'a', REGISTRY_NAME_LEN);
+    long_name[REGISTRY_NAME_LEN] = '\0';
+    errors += (registry_register(reg, long_name, "x") != -1) || (errno != ENAMETOOLONG);
+
+    /* Another process opens the segment by name and sees every record */
+    pid = fork();
+    if(pid == 0) {
+        int failed = 0;
+
+        if(registry_open(&other, shm_name, 0, 0) < 0) {
+            _exit(1);
+        }
+        for(i = 0; i < SERVICES; i++) {
+            service_name(name, sizeof(name), i);
+            service_endpoint(want, sizeof(want), i, 0);
+            failed += (registry_lookup(&other, name, endpoint, sizeof(endpoint)) != 0) ||
+                      (strcmp(endpoint, want) != 0);
+        }
+        failed += (registry_register(&other, "child", "/run/child.sock") != 0);
+        registry_close(&other);
+        _exit(failed != 0);
+    }
+    waitpid(pid, &status, 0);
+    errors += !WIFEXITED(status) || (WEXITSTATUS(status) != 0);
+    errors += (registry_lookup(reg, "child", endpoint, sizeof(endpoint)) != 0) ||
+              (registry_deregister(reg, "child") != 0);
+    return errors;
+}
+
+/* One reader process: random lookups for RUN_SEC, reports lookups and retries on 'fd' */
+static void reader(int fd, unsigned seed) {
+    char name[REGISTRY_NAME_LEN], endpoint[REGISTRY_ENDPOINT_LEN];
+    uint64_t result[3];
+    double end;
+    registry reg;
+    int i, failed = 0;
+
+    if(registry_open(&reg, shm_name, 0, 0) < 0) {
+        _exit(1);
+    }
+    srand(seed);
+    end = now_sec() + RUN_SEC;
+    do {
+        for(i = 0; i < 1024; i++) {
+            service_name(name, sizeof(name), rand() % SERVICES);
+            failed += (registry_lookup(&reg, name, endpoint, sizeof(endpoint)) != 0) ||
+                      (strncmp(endpoint, "/run/services/", 14) != 0);
+        }
+    } while(now_sec() < end);
+    result[0] = reg.lookups;
+    result[1] = reg.retries;
+    result[2] = (uint64_t)failed;
+    if(write(fd, result, sizeof(result)) != sizeof(result)) {
+        _exit(1);
+    }
+    registry_close(&reg);
+    _exit(0);
+}
+
+/* 'readers' processes at once; with 'writer' this process keeps updating endpoints meanwhile */
+static int run_readers(registry *reg, int readers, int writer) {
+    char name[REGISTRY_NAME_LEN], endpoint[REGISTRY_ENDPOINT_LEN];
+    uint64_t result[3], lookups = 0, retries = 0, failed = 0, updates = 0;
+    int fds[2], i, status, errors = 0;
+    double start, elapsed;
+
+    if(pipe(fds) < 0) {
+        perror("pipe");
+        return 1;
+    }
+    start = now_sec();
+    for(i = 0; i < readers; i++) {
+        if(fork() == 0) {
+            close(fds[0]);
+            reader(fds[1], (unsigned)i + 1);
+        }
+    }
+    close(fds[1]);
+    if(writer) {
+        while(now_sec() - start < RUN_SEC) {
+            i = (int)(updates % SERVICES);
+            service_name(name, sizeof(name), i);
+            service_endpoint(endpoint, sizeof(endpoint), i, (int)(updates / SERVICES) + 1);
+            errors += (registry_register(reg, name, endpoint) != 0);
+            updates++;
+        }
+    }
+    for(i = 0; i < readers; i++) {
+        if(read(fds[0], result, sizeof(result)) != sizeof(result)) {
+            errors++;
+            break;
+        }
+        lookups += result[0];
+        retries += result[1];
+        failed += result[2];
+    }
+    close(fds[0]);
+    while(wait(&status) > 0) {
+        errors += !WIFEXITED(status) || (WEXITSTATUS(status) != 0);
+    }
+    elapsed = now_sec() - start;
+    printf("  %2d readers%s %12.0f lookups/s  %8.0f updates/s  %.4f%% retried\n", readers,
+           writer ? " + writer:" : ":         ", lookups / elapsed, updates / elapsed,
+           lookups ? 100.0 * retries / lookups : 0.0);
+    return errors + (failed != 0);
+}
+
+/* The same lookup as a request/response over a UNIX socket to a server process */
+static int run_ipc(registry *reg) {
+    char name[REGISTRY_NAME_LEN], endpoint[REGISTRY_ENDPOINT_LEN];
+    uint64_t lookups = 0;
+    double start, elapsed;
+    int sv[2], status, errors = 0;
+    ssize_t n;
+    pid_t pid;
+
+    if(socketpair(AF_UNIX, SOCK_SEQPACKET, 0, sv) < 0) {
+        perror("socketpair");
+        return 1;
+    }
+    pid = fork();
+    if(pid == 0) {
+        close(sv[0]);
+        while((n = read(sv[1], name, sizeof(name) - 1)) > 0) {
+            name[n] = '\0';
+            if(registry_lookup(reg, name, endpoint, sizeof(endpoint)) < 0) {
+                endpoint[0] = '\0';
+            }
+            if(write(sv[1], endpoint, strlen(endpoint) + 1) < 0) {
+                break;
+            }
+        }
+        _exit(0);
+    }
+    close(sv[1]);
+    srand(1);
+    start = now_sec();
+    do {
+        service_name(name, sizeof(name), rand() % SERVICES);
+        if(write(sv[0], name, strlen(name)) < 0 || read(sv[0], endpoint, sizeof(endpoint)) <= 0) {
+            errors++;
+            break;
+        }
+        errors += (strncmp(endpoint, "/run/services/", 14) != 0);
+        lookups++;
+    } while(now_sec() - start < RUN_SEC);
+    elapsed = now_sec() - start;
+    close(sv[0]);
+    waitpid(pid, &status, 0);
+    printf("   1 client over a UNIX socket: %12.0f lookups/s\n", lookups / elapsed);
+    return errors;
+}
+
+int main(void) {
+    registry reg;
+    int readers, errors = 0;
+
+    snprintf(shm_name, sizeof(shm_name), "/registry-bench-%d", (int)getpid());
+    if(registry_open(&reg, shm_name, 4096, REGISTRY_CREATE) < 0) {
+        perror("registry_open");
+        return 1;
+    }
+    errors += test_basic(&reg);
+    errors += test_churn();
+    printf("%u services in a %u slot table, %ld CPUs\n", (unsigned)registry_count(&reg),
+           (unsigned)registry_capacity(&reg), sysconf(_SC_NPROCESSORS_ONLN));
+
+    for(readers = 1; readers <= MAX_READERS; readers *= 2) {
+        errors += run_readers(&reg, readers, 0);
+    }
+    for(readers = 1; readers <= MAX_READERS; readers *= 2) {
+        errors += run_readers(&reg, readers, 1);
+    }
+    errors += run_ipc(&reg);
+
+    registry_close(&reg);
+    registry_unlink(shm_name);
+    printf("%d errors\n", errors);
+    return errors != 0;
+}
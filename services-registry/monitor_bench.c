@@ -0,0 +1,361 @@
+/*
+ * Timer wheel: checks that every timer fires on its tick (cascades and timers
+ * beyond the wheels included) and compares the cost of a tick with scanning
+ * every expiry. Registry monitor: services behind UNIX sockets, some healthy,
+ * some renewing a TTL, some letting it run out and some dead; checks that the
+ * right ones are deregistered and measures the monitor's CPU time against
+ * walking the registry every tick. Then register/deregister churn against a
+ * stuck worker, which must not overrun its queues.
+ * Build: make monitor_bench
+ */
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include "registry_monitor.h"
+
+#define WHEEL_RUN_TICKS 300000          /* Past the reach of 3 levels (2^18) */
+#define SERVICES        4000
+#define TTL_MS          300
+#define RENEW_MS        100
+#define RUN_MS          1500
+
+typedef struct {
+    wheel_timer timer;
+    int fired;
+} test_timer;
+
+static int late;
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double thread_cpu_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void on_test_timer(wheel_timer *timer, void *arg) {
+    timer_wheel *wheel = arg;
+
+    late += (wheel->now != timer->expires);
+    ((test_timer *)timer)->fired++;
+}
+
+static int test_wheel(int n) {
+    test_timer *timers = calloc((size_t)n, sizeof(test_timer));
+    uint64_t *expires = calloc((size_t)n, sizeof(uint64_t));
+    timer_wheel wheel;
+    double t, wheel_ns, scan_ns;
+    volatile uint64_t due = 0;
+    uint64_t tick;
+    int i, errors = 0;
+
+    wheel_init(&wheel, 0);
+    srand(1);
+    late = 0;
+    for(i = 0; i < n; i++) {
+        wheel_timer_init(&timers[i].timer, on_test_timer);
+        expires[i] = 1 + (uint64_t)rand() % WHEEL_RUN_TICKS;
+        wheel_add(&wheel, &timers[i].timer, expires[i]);
+    }
+    /* Cancelled and re-armed timers */
+    for(i = 0; i < n; i += 10) {
+        wheel_cancel(&wheel, &timers[i].timer);
+        timers[i].fired = -1;
+    }
+    for(i = 5; i < n; i += 10) {
+        expires[i] = 1 + (uint64_t)rand() % 1000;
+        wheel_add(&wheel, &timers[i].timer, expires[i]);
+    }
+
+    t = now_sec();
+    for(tick = 1; tick <= WHEEL_RUN_TICKS; tick++) {
+        wheel_advance(&wheel, tick, &wheel);
+    }
+    wheel_ns = (now_sec() - t) * 1e9 / WHEEL_RUN_TICKS;
+    for(i = 0; i < n; i++) {
+        errors += (timers[i].fired != ((i % 10 == 0) ? -1 : 1));
+    }
+    errors += late + (wheel.pending != 0);
+
+    /* The same expiries found by scanning them all every tick */
+    t = now_sec();
+    for(tick = 1; tick <= WHEEL_RUN_TICKS / 100; tick++) {
+        for(i = 0; i < n; i++) {
+            due = due + (expires[i] == tick);
+        }
+    }
+    scan_ns = (now_sec() - t) * 1e9 / (WHEEL_RUN_TICKS / 100);
+    printf("wheel %6d timers: %7.0f ns/tick (%llu cascaded), scan %9.0f ns/tick\n", n, wheel_ns,
+           (unsigned long long)wheel.cascaded, scan_ns);
+    free(timers);
+    free(expires);
+    return errors;
+}
+
+/* Healthy services: answer every request with a byte */
+typedef struct {
+    int epoll_fd;
+    volatile int stop;
+} service_host;
+
+static void *serve(void *arg) {
+    service_host *host = arg;
+    struct epoll_event events[64];
+    char request[MONITOR_REQUEST_LEN];
+    int i, n, fd;
+
+    while(!host->stop) {
+        n = epoll_wait(host->epoll_fd, events, 64, 10);
+        for(i = 0; i < n; i++) {
+            while((fd = accept4(events[i].data.fd, NULL, NULL, 0)) >= 0) {
+                /* Read the request first: closing with unread data resets the connection */
+                if(recv(fd, request, sizeof(request), 0) < 0 || send(fd, "ok", 2, MSG_NOSIGNAL) < 0) {
+                    /* The probe went away */
+                }
+                close(fd);
+            }
+        }
+    }
+    return NULL;
+}
+
+static int listen_at(const char *path) {
+    struct sockaddr_un addr;
+    int fd;
+
+    if(strlen(path) >= sizeof(addr.sun_path)) {
+        return -1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path, path, strlen(path) + 1);
+    unlink(path);
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if(fd < 0 || bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(fd, 64) < 0) {
+        return -1;
+    }
+    return fd;
+}
+
+static int count_record(const registry_record *record, void *arg) {
+    (void)record;
+    (*(int *)arg)++;
+    return 0;
+}
+
+static int test_monitor(int services) {
+    static int listeners[SERVICES];
+    char dir[64], name[REGISTRY_NAME_LEN], endpoint[REGISTRY_ENDPOINT_LEN], shm_name[64];
+    monitor_config config;
+    registry_monitor mon;
+    service_host host;
+    pthread_t server;
+    registry reg;
+    struct epoll_event ev;
+    double start, next_renew, cpu, renew_cpu = 0, t, scan_ms;
+    int i, group, records, present[4] = { 0 }, errors = 0;
+
+    snprintf(dir, sizeof(dir), "/tmp/registry-bench-%d", (int)getpid());
+    snprintf(shm_name, sizeof(shm_name), "/registry-monitor-%d", (int)getpid());
+    mkdir(dir, 0700);
+    if(registry_open(&reg, shm_name, (uint32_t)services * 2, REGISTRY_CREATE) < 0) {
+        perror("registry_open");
+        return 1;
+    }
+
+    /* Group 0 healthy, 1 healthy renewing a TTL, 2 healthy letting its TTL run out, 3 dead */
+    host.epoll_fd = epoll_create1(0);
+    host.stop = 0;
+    for(i = 0; i < services; i++) {
+        group = i % 4;
+        snprintf(name, sizeof(name), "service-%d", i);
+        snprintf(endpoint, sizeof(endpoint), "%s/%d.sock", dir, i);
+        listeners[i] = -1;
+        if(group != 3) {
+            listeners[i] = listen_at(endpoint);
+            ev.events = EPOLLIN;
+            ev.data.fd = listeners[i];
+            if(listeners[i] < 0 || epoll_ctl(host.epoll_fd, EPOLL_CTL_ADD, listeners[i], &ev) < 0) {
+                perror("listen");
+                return 1;
+            }
+        }
+        errors += (registry_register_ttl(&reg, name, endpoint, (group == 1 || group == 2) ? TTL_MS : 0) != 0);
+    }
+    pthread_create(&server, NULL, serve, &host);
+
+    memset(&config, 0, sizeof(config));
+    config.tick_ms = 10;
+    config.check_interval_ms = 100;
+    config.probe_timeout_ms = 500;
+    config.max_failures = 3;
+    config.workers = 2;
+    strcpy(config.request, "ping");
+    config.expect_reply = 1;
+    if(registry_monitor_init(&mon, &reg, &config) < 0) {
+        perror("registry_monitor_init");
+        return 1;
+    }
+    errors += (registry_monitor_count(&mon) != (uint32_t)services);
+
+    start = now_sec();
+    next_renew = start + RENEW_MS / 1000.0;
+    cpu = thread_cpu_sec();
+    while(now_sec() - start < RUN_MS / 1000.0) {
+        registry_monitor_poll(&mon, 10);
+        if(now_sec() >= next_renew) {
+            t = thread_cpu_sec();
+            for(i = 1; i < services; i += 4) {
+                snprintf(name, sizeof(name), "service-%d", i);
+                errors += (registry_renew(&reg, name) != 0);
+            }
+            renew_cpu += thread_cpu_sec() - t;
+            next_renew += RENEW_MS / 1000.0;
+        }
+    }
+    cpu = thread_cpu_sec() - cpu - renew_cpu;
+
+    for(i = 0; i < services; i++) {
+        snprintf(name, sizeof(name), "service-%d", i);
+        present[i % 4] += (registry_lookup(&reg, name, endpoint, sizeof(endpoint)) == 0);
+    }
+    errors += (present[0] != services / 4) || (present[1] != services / 4) || (present[2] != 0) ||
+              (present[3] != 0);
+    errors += (mon.stats.expired != (uint64_t)services / 4) || (mon.stats.unhealthy != (uint64_t)services / 4);
+    errors += (registry_monitor_count(&mon) != registry_count(&reg));
+    printf("monitor %d services for %.1f s: %llu checks (%llu failed), %llu expired, %llu unhealthy, "
+           "%llu journal updates, %llu resyncs\n", services, RUN_MS / 1000.0,
+           (unsigned long long)mon.stats.checks, (unsigned long long)mon.stats.check_failures,
+           (unsigned long long)mon.stats.expired, (unsigned long long)mon.stats.unhealthy,
+           (unsigned long long)mon.stats.journal_updates, (unsigned long long)mon.stats.resyncs);
+
+    /* What a scan of every record each tick would cost instead */
+    t = now_sec();
+    for(i = 0; i < 100; i++) {
+        records = 0;
+        registry_foreach(&reg, count_record, &records);
+    }
+    scan_ms = (now_sec() - t) * 1000.0 / 100 * services / (records ? records : 1);
+    printf("  monitor thread %.1f ms CPU per second; scanning the %d records every tick instead of the wheel "
+           "would add %.1f ms per second\n", cpu * 1000.0 / (RUN_MS / 1000.0), services,
+           scan_ms * 1000.0 / config.tick_ms);
+
+    registry_monitor_destroy(&mon);
+    host.stop = 1;
+    pthread_join(server, NULL);
+    for(i = 0; i < services; i++) {
+        if(listeners[i] >= 0) {
+            close(listeners[i]);
+        }
+        snprintf(endpoint, sizeof(endpoint), "%s/%d.sock", dir, i);
+        unlink(endpoint);
+    }
+    rmdir(dir);
+    close(host.epoll_fd);
+    registry_close(&reg);
+    registry_unlink(shm_name);
+    return errors;
+}
+
+/*
+ * Register/deregister churn while the only worker is stuck on probes that time
+ * out: jobs of removed services pile up behind the live ones, more than one
+ * per slot. The queues must hold (checks put off, not overrun) and the monitor
+ * must still follow the registry.
+ */
+static int test_churn(void) {
+    char dir[64], name[REGISTRY_NAME_LEN], endpoint[REGISTRY_ENDPOINT_LEN], shm_name[64];
+    monitor_config config;
+    registry_monitor mon;
+    registry reg;
+    double until;
+    int i, round, listener, errors = 0;
+
+    snprintf(dir, sizeof(dir), "/tmp/registry-churn-%d", (int)getpid());
+    snprintf(shm_name, sizeof(shm_name), "/registry-churn-%d", (int)getpid());
+    snprintf(endpoint, sizeof(endpoint), "%s/stuck.sock", dir);
+    mkdir(dir, 0700);
+    listener = listen_at(endpoint);     /* Never accepted: probes connect, then wait for a reply until timeout */
+    if(listener < 0 || registry_open(&reg, shm_name, 64, REGISTRY_CREATE) < 0) {
+        perror("churn setup");
+        return 1;
+    }
+
+    memset(&config, 0, sizeof(config));
+    config.tick_ms = 10;
+    config.check_interval_ms = 10;
+    config.probe_timeout_ms = 200;
+    config.max_failures = 1000;
+    config.workers = 1;
+    config.max_inflight = 1;
+    strcpy(config.request, "ping");
+    config.expect_reply = 1;
+    if(registry_monitor_init(&mon, &reg, &config) < 0) {
+        perror("registry_monitor_init");
+        return 1;
+    }
+    for(round = 0; round < 50; round++) {
+        for(i = 0; i < 40; i++) {
+            snprintf(name, sizeof(name), "churn-%d", i);
+            errors += (registry_register(&reg, name, endpoint) != 0);
+        }
+        until = now_sec() + 0.03;
+        while(now_sec() < until) {
+            registry_monitor_poll(&mon, 10);
+        }
+        for(i = 0; i < 40; i++) {
+            snprintf(name, sizeof(name), "churn-%d", i);
+            errors += (registry_deregister(&reg, name) != 0);
+        }
+        registry_monitor_poll(&mon, 0);
+        errors += (registry_monitor_count(&mon) != 0);
+    }
+    errors += (mon.stats.deferred == 0);
+    printf("churn 50 x 40 services on a 64 slot registry, 1 stuck worker: %llu checks, %llu put off\n",
+           (unsigned long long)mon.stats.checks, (unsigned long long)mon.stats.deferred);
+
+    registry_monitor_destroy(&mon);
+    close(listener);
+    unlink(endpoint);
+    rmdir(dir);
+    registry_close(&reg);
+    registry_unlink(shm_name);
+    return errors;
+}
+
+int main(void) {
+    struct rlimit limit;
+    int services = SERVICES, errors = 0;
+
+    errors += test_wheel(1000);
+    errors += test_wheel(10000);
+    errors += test_wheel(100000);
+
+    /* A listening socket per healthy service */
+    getrlimit(RLIMIT_NOFILE, &limit);
+    limit.rlim_cur = limit.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &limit);
+    if(limit.rlim_cur < SERVICES + 100) {
+        services = (int)(limit.rlim_cur - 100) / 4 * 4;
+    }
+    errors += test_monitor(services);
+    errors += test_churn();
+
+    printf("%d errors\n", errors);
+    return errors != 0;
+}
@@ -0,0 +1,648 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <poll.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "registry_monitor.h"
+
+#define container_of(ptr, type, member) ((type *)((char *)(ptr) - offsetof(type, member)))
+
+_Static_assert(REGISTRY_ENDPOINT_LEN == sizeof(((struct sockaddr_un *)0)->sun_path), "endpoints are socket paths");
+
+#define JOURNAL_BATCH   64
+#define WORKER_EVENTS   64
+
+struct monitor_service {
+    char name[REGISTRY_NAME_LEN];
+    char endpoint[REGISTRY_ENDPOINT_LEN];
+    uint64_t version;                   /* Of the record as last seen */
+    uint32_t ttl_ms;
+    uint32_t failures;                  /* Checks failed in a row */
+    uint32_t epoch;
+    uint32_t probe_id;                  /* Of the probe in flight; results with another id are stale */
+    int probing;
+    int used;
+    wheel_timer expiry;
+    wheel_timer check;
+    monitor_service *hash_next;         /* Or the next free entry */
+};
+
+typedef struct {
+    uint32_t index;                     /* Into mon->services */
+    uint32_t probe_id;
+    char endpoint[REGISTRY_ENDPOINT_LEN];
+} monitor_job;
+
+struct monitor_result {
+    uint32_t index;
+    uint32_t probe_id;
+    int healthy;
+};
+
+typedef struct probe {
+    int fd;
+    uint64_t deadline_ns;
+    monitor_job job;
+    struct probe *next, *prev;          /* In flight (oldest first) or free */
+} probe;
+
+struct monitor_worker {
+    registry_monitor *mon;
+    pthread_t thread;
+    int started;
+    int epoll_fd;
+    int job_fd;                         /* eventfd: jobs are waiting, or stop */
+
+    /* Filled by the monitor thread */
+    pthread_mutex_t lock;
+    monitor_job *jobs;
+    uint32_t job_head, job_count;
+    int stop;
+
+    /* Worker thread only */
+    probe *probes;
+    probe *free_probes;
+    probe inflight;                     /* List head; every probe has the same timeout */
+};
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static uint32_t hash_name(const char *name) {
+    uint32_t hash = 2166136261u;
+
+    while(*name) {
+        hash = (hash ^ (uint8_t)*name++) * 16777619u;
+    }
+    return hash;
+}
+
+static uint64_t current_tick(const registry_monitor *mon) {
+    return (now_ns() - mon->start_ns) / ((uint64_t)mon->config.tick_ms * 1000000u);
+}
+
+static uint64_t ms_to_ticks(const registry_monitor *mon, uint32_t ms) {
+    uint64_t ticks = (ms + mon->config.tick_ms - 1) / mon->config.tick_ms;
+
+    return (ticks > 0) ? ticks : 1;
+}
+
+/* Worker side */
+
+static void post_result(registry_monitor *mon, const monitor_job *job, int healthy) {
+    struct monitor_result *r;
+    uint64_t one = 1;
+
+    pthread_mutex_lock(&mon->result_lock);
+    /*
+     * Stale results (of services removed, their slot reused) come on top of
+     * one per service: when the queue is full, wait for the monitor to drain
+     * it rather than overrun it.
+     */
+    while(mon->result_count == mon->result_len && !mon->closing) {
+        pthread_cond_wait(&mon->result_space, &mon->result_lock);
+    }
+    if(mon->closing) {
+        pthread_mutex_unlock(&mon->result_lock);
+        return;
+    }
+    r = &mon->results[(mon->result_head + mon->result_count) % mon->result_len];
+    r->index = job->index;
+    r->probe_id = job->probe_id;
+    r->healthy = healthy;
+    mon->result_count++;
+    pthread_mutex_unlock(&mon->result_lock);
+    if(write(mon->result_fd, &one, sizeof(one)) < 0) {
+        /* The counter cannot overflow in practice; the result is queued anyway */
+    }
+}
+
+static void finish_probe(monitor_worker *w, probe *p, int healthy) {
+    close(p->fd);                       /* Leaves the epoll set as well */
+    p->prev->next = p->next;
+    p->next->prev = p->prev;
+    p->next = w->free_probes;
+    w->free_probes = p;
+    post_result(w->mon, &p->job, healthy);
+}
+
+/* Connects without blocking; a UNIX socket connects at once or fails (EAGAIN when its backlog is full) */
+static void start_probe(monitor_worker *w, const monitor_job *job) {
+    const monitor_config *config = &w->mon->config;
+    struct sockaddr_un addr;
+    struct epoll_event ev;
+    size_t request_len = strlen(config->request);
+    probe *p;
+    int fd;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path, job->endpoint, sizeof(addr.sun_path));       /* REGISTRY_ENDPOINT_LEN bytes, terminated */
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if(fd < 0) {
+        post_result(w->mon, job, 0);
+        return;
+    }
+    if((connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 && errno != EINPROGRESS) ||
+       (request_len > 0 && send(fd, config->request, request_len, MSG_NOSIGNAL) != (ssize_t)request_len)) {
+        close(fd);
+        post_result(w->mon, job, 0);
+        return;
+    }
+    if(!config->expect_reply) {
+        close(fd);
+        post_result(w->mon, job, 1);
+        return;
+    }
+
+    p = w->free_probes;
+    w->free_probes = p->next;
+    p->fd = fd;
+    p->job = *job;
+    p->deadline_ns = now_ns() + (uint64_t)config->probe_timeout_ms * 1000000u;
+    p->next = &w->inflight;
+    p->prev = w->inflight.prev;
+    w->inflight.prev->next = p;
+    w->inflight.prev = p;
+    ev.events = EPOLLIN | EPOLLRDHUP;
+    ev.data.ptr = p;
+    if(epoll_ctl(w->epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        finish_probe(w, p, 0);
+    }
+}
+
+/* Starts queued jobs while probes are free. Returns -1 when asked to stop. */
+static int take_jobs(monitor_worker *w) {
+    monitor_job job;
+    int stop;
+
+    for(;;) {
+        pthread_mutex_lock(&w->lock);
+        stop = w->stop;
+        if(stop || w->job_count == 0 || w->free_probes == NULL) {
+            pthread_mutex_unlock(&w->lock);
+            return stop ? -1 : 0;
+        }
+        job = w->jobs[w->job_head];
+        w->job_head = (w->job_head + 1) % w->mon->capacity;
+        w->job_count--;
+        pthread_mutex_unlock(&w->lock);
+        start_probe(w, &job);
+    }
+}
+
+static void *worker_main(void *arg) {
+    monitor_worker *w = arg;
+    struct epoll_event events[WORKER_EVENTS];
+    char reply[64];
+    uint64_t counter, now;
+    int i, n, timeout;
+    ssize_t got;
+
+    for(;;) {
+        timeout = -1;
+        if(w->inflight.next != &w->inflight) {
+            now = now_ns();
+            timeout = (w->inflight.next->deadline_ns <= now) ? 0 :
+                      (int)((w->inflight.next->deadline_ns - now + 999999) / 1000000);
+        }
+        n = epoll_wait(w->epoll_fd, events, WORKER_EVENTS, timeout);
+        for(i = 0; i < n; i++) {
+            probe *p = events[i].data.ptr;
+
+            if(p == NULL) {
+                if(read(w->job_fd, &counter, sizeof(counter)) < 0) {
+                    /* Already drained */
+                }
+                continue;
+            }
+            got = recv(p->fd, reply, sizeof(reply), MSG_DONTWAIT);
+            if(got < 0 && (errno == EAGAIN || errno == EINTR)) {
+                continue;
+            }
+            finish_probe(w, p, got > 0);
+        }
+
+        /* Oldest first: stop at the first probe still in time */
+        now = now_ns();
+        while(w->inflight.next != &w->inflight && w->inflight.next->deadline_ns <= now) {
+            finish_probe(w, w->inflight.next, 0);
+        }
+        if(take_jobs(w) < 0) {
+            break;
+        }
+    }
+    while(w->inflight.next != &w->inflight) {
+        probe *p = w->inflight.next;
+
+        close(p->fd);
+        p->prev->next = p->next;
+        p->next->prev = p->prev;
+    }
+    return NULL;
+}
+
+static int start_worker(registry_monitor *mon, monitor_worker *w) {
+    struct epoll_event ev;
+    uint32_t i;
+
+    w->mon = mon;
+    w->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    w->job_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    w->jobs = calloc(mon->capacity, sizeof(monitor_job));
+    w->probes = calloc(mon->config.max_inflight, sizeof(probe));
+    if(w->epoll_fd < 0 || w->job_fd < 0 || w->jobs == NULL || w->probes == NULL) {
+        errno = (w->jobs == NULL || w->probes == NULL) ? ENOMEM : errno;
+        return -1;
+    }
+    pthread_mutex_init(&w->lock, NULL);
+    for(i = 0; i < mon->config.max_inflight; i++) {
+        w->probes[i].next = w->free_probes;
+        w->free_probes = &w->probes[i];
+    }
+    w->inflight.next = &w->inflight;
+    w->inflight.prev = &w->inflight;
+    ev.events = EPOLLIN;
+    ev.data.ptr = NULL;
+    if(epoll_ctl(w->epoll_fd, EPOLL_CTL_ADD, w->job_fd, &ev) < 0) {
+        return -1;
+    }
+    if((errno = pthread_create(&w->thread, NULL, worker_main, w)) != 0) {
+        return -1;
+    }
+    w->started = 1;
+    return 0;
+}
+
+static void stop_worker(monitor_worker *w) {
+    uint64_t one = 1;
+
+    if(w->started) {
+        pthread_mutex_lock(&w->lock);
+        w->stop = 1;
+        pthread_mutex_unlock(&w->lock);
+        if(write(w->job_fd, &one, sizeof(one)) < 0) {
+            /* Cannot fail on a fresh counter */
+        }
+        pthread_join(w->thread, NULL);
+        pthread_mutex_destroy(&w->lock);
+    }
+    if(w->epoll_fd >= 0) {
+        close(w->epoll_fd);
+    }
+    if(w->job_fd >= 0) {
+        close(w->job_fd);
+    }
+    free(w->jobs);
+    free(w->probes);
+}
+
+/* Monitor side */
+
+static monitor_service *find_service(registry_monitor *mon, const char *name) {
+    monitor_service *svc = mon->buckets[hash_name(name) & (mon->capacity - 1)];
+
+    while(svc != NULL && strcmp(svc->name, name) != 0) {
+        svc = svc->hash_next;
+    }
+    return svc;
+}
+
+static void remove_service(registry_monitor *mon, monitor_service *svc) {
+    monitor_service **link = &mon->buckets[hash_name(svc->name) & (mon->capacity - 1)];
+
+    while(*link != svc) {
+        link = &(*link)->hash_next;
+    }
+    *link = svc->hash_next;
+    wheel_cancel(&mon->wheel, &svc->expiry);
+    wheel_cancel(&mon->wheel, &svc->check);
+    svc->used = 0;
+    svc->probing = 0;
+    svc->probe_id++;                    /* A probe in flight now reports for nobody */
+    svc->hash_next = mon->free_list;
+    mon->free_list = svc;
+    mon->count--;
+}
+
+/* Takes in a record as read from the registry: new, renewed or changed */
+static void apply_record(registry_monitor *mon, const registry_record *record) {
+    monitor_service *svc = find_service(mon, record->name);
+    uint64_t tick = mon->wheel.now;
+    uint32_t bucket;
+
+    if(svc == NULL) {
+        if(mon->free_list == NULL) {
+            return;                     /* Cannot happen: sized like the registry */
+        }
+        svc = mon->free_list;
+        mon->free_list = svc->hash_next;
+        bucket = hash_name(record->name) & (mon->capacity - 1);
+        svc->hash_next = mon->buckets[bucket];
+        mon->buckets[bucket] = svc;
+        memcpy(svc->name, record->name, REGISTRY_NAME_LEN);
+        svc->version = 0;
+        svc->failures = 0;
+        svc->used = 1;
+        mon->count++;
+
+        /* First check spread over an interval by the name, so a burst of registrations is not checked at once */
+        if(mon->config.check_interval_ms > 0) {
+            wheel_add(&mon->wheel, &svc->check,
+                      tick + 1 + hash_name(record->name) % ms_to_ticks(mon, mon->config.check_interval_ms));
+        }
+    }
+    svc->epoch = mon->epoch;
+    if(svc->version == record->version) {
+        return;
+    }
+    if(strcmp(svc->endpoint, record->endpoint) != 0) {
+        memcpy(svc->endpoint, record->endpoint, REGISTRY_ENDPOINT_LEN);
+        svc->failures = 0;
+    }
+    svc->version = record->version;
+    svc->ttl_ms = record->ttl_ms;
+    if(record->ttl_ms > 0) {
+        wheel_add(&mon->wheel, &svc->expiry, tick + ms_to_ticks(mon, record->ttl_ms));
+    } else {
+        wheel_cancel(&mon->wheel, &svc->expiry);
+    }
+}
+
+static int resync_record(const registry_record *record, void *arg) {
+    apply_record(arg, record);
+    return 0;
+}
+
+/* Walks the whole registry: at start and after falling behind the journal */
+static void resync(registry_monitor *mon) {
+    uint32_t i;
+
+    mon->epoch++;
+    mon->journal_pos = registry_journal_head(mon->reg);
+    registry_foreach(mon->reg, resync_record, mon);
+    for(i = 0; i < mon->capacity; i++) {
+        if(mon->services[i].used && mon->services[i].epoch != mon->epoch) {
+            remove_service(mon, &mon->services[i]);
+        }
+    }
+    mon->stats.resyncs++;
+}
+
+static void follow_journal(registry_monitor *mon) {
+    char names[JOURNAL_BATCH][REGISTRY_NAME_LEN];
+    registry_record record;
+    monitor_service *svc;
+    int i, n;
+
+    for(;;) {
+        n = registry_changes(mon->reg, &mon->journal_pos, names, JOURNAL_BATCH);
+        if(n < 0) {
+            resync(mon);
+            continue;
+        }
+        if(n == 0) {
+            break;
+        }
+        mon->stats.journal_updates += (uint64_t)n;
+        for(i = 0; i < n; i++) {
+            if(registry_get(mon->reg, names[i], &record) == 0) {
+                apply_record(mon, &record);
+            } else if((svc = find_service(mon, names[i])) != NULL) {
+                remove_service(mon, svc);
+            }
+        }
+    }
+}
+
+static void on_expiry(wheel_timer *timer, void *arg) {
+    registry_monitor *mon = arg;
+    monitor_service *svc = container_of(timer, monitor_service, expiry);
+
+    /* ESTALE: renewed since, the journal brings the new version and a new expiry */
+    if(registry_deregister_if(mon->reg, svc->name, svc->version) == 0) {
+        mon->stats.expired++;
+        remove_service(mon, svc);
+    } else if(errno == ENOENT) {
+        remove_service(mon, svc);
+    }
+}
+
+static void on_check(wheel_timer *timer, void *arg) {
+    registry_monitor *mon = arg;
+    monitor_service *svc = container_of(timer, monitor_service, check);
+    monitor_worker *w = &mon->workers[mon->next_worker];
+    monitor_job *job;
+    uint64_t one = 1;
+
+    if(svc->probing) {
+        return;
+    }
+    mon->next_worker = (mon->next_worker + 1) % mon->config.workers;
+
+    /* Jobs of removed services may still be queued: a full queue puts the check off a period */
+    pthread_mutex_lock(&w->lock);
+    if(w->job_count == mon->capacity) {
+        pthread_mutex_unlock(&w->lock);
+        mon->stats.deferred++;
+        wheel_add(&mon->wheel, &svc->check, mon->wheel.now + ms_to_ticks(mon, mon->config.check_interval_ms));
+        return;
+    }
+    svc->probing = 1;
+    svc->probe_id++;
+    mon->stats.checks++;
+    job = &w->jobs[(w->job_head + w->job_count) % mon->capacity];
+    job->index = (uint32_t)(svc - mon->services);
+    job->probe_id = svc->probe_id;
+    memcpy(job->endpoint, svc->endpoint, REGISTRY_ENDPOINT_LEN);
+    w->job_count++;
+    pthread_mutex_unlock(&w->lock);
+    if(write(w->job_fd, &one, sizeof(one)) < 0) {
+        /* The job is queued anyway */
+    }
+}
+
+static void apply_results(registry_monitor *mon) {
+    struct monitor_result r;
+    monitor_service *svc;
+
+    for(;;) {
+        pthread_mutex_lock(&mon->result_lock);
+        if(mon->result_count == 0) {
+            pthread_mutex_unlock(&mon->result_lock);
+            break;
+        }
+        r = mon->results[mon->result_head];
+        mon->result_head = (mon->result_head + 1) % mon->result_len;
+        if(mon->result_count-- == mon->result_len) {
+            pthread_cond_broadcast(&mon->result_space);
+        }
+        pthread_mutex_unlock(&mon->result_lock);
+
+        svc = &mon->services[r.index];
+        if(!svc->used || !svc->probing || svc->probe_id != r.probe_id) {
+            continue;
+        }
+        svc->probing = 0;
+        if(r.healthy) {
+            svc->failures = 0;
+        } else {
+            mon->stats.check_failures++;
+            if(++svc->failures >= mon->config.max_failures) {
+                if(registry_deregister_if(mon->reg, svc->name, svc->version) == 0) {
+                    mon->stats.unhealthy++;
+                    remove_service(mon, svc);
+                    continue;
+                }
+                if(errno == ENOENT) {
+                    remove_service(mon, svc);
+                    continue;
+                }
+                svc->failures = 0;      /* Updated meanwhile: give the new registration its chances */
+            }
+        }
+        wheel_add(&mon->wheel, &svc->check, mon->wheel.now + ms_to_ticks(mon, mon->config.check_interval_ms));
+    }
+}
+
+void registry_monitor_defaults(monitor_config *config) {
+    if(config->tick_ms == 0) {
+        config->tick_ms = 10;
+    }
+    if(config->probe_timeout_ms == 0) {
+        config->probe_timeout_ms = 1000;
+    }
+    if(config->max_failures == 0) {
+        config->max_failures = 3;
+    }
+    if(config->workers == 0) {
+        config->workers = 2;
+    }
+    if(config->workers > MONITOR_MAX_WORKERS) {
+        config->workers = MONITOR_MAX_WORKERS;
+    }
+    if(config->max_inflight == 0) {
+        config->max_inflight = 256;
+    }
+    config->request[MONITOR_REQUEST_LEN - 1] = '\0';
+}
+
+int registry_monitor_init(registry_monitor *mon, registry *reg, const monitor_config *config) {
+    uint32_t i;
+
+    memset(mon, 0, sizeof(*mon));
+    mon->reg = reg;
+    mon->config = *config;
+    registry_monitor_defaults(&mon->config);
+    mon->capacity = registry_capacity(reg);
+    mon->start_ns = now_ns();
+    wheel_init(&mon->wheel, 0);
+    mon->result_fd = -1;
+
+    mon->services = calloc(mon->capacity, sizeof(monitor_service));
+    mon->buckets = calloc(mon->capacity, sizeof(monitor_service *));
+    mon->results = calloc(mon->capacity, sizeof(struct monitor_result));
+    mon->workers = calloc(mon->config.workers, sizeof(monitor_worker));
+    if(mon->services == NULL || mon->buckets == NULL || mon->results == NULL || mon->workers == NULL) {
+        registry_monitor_destroy(mon);
+        errno = ENOMEM;
+        return -1;
+    }
+    mon->result_len = mon->capacity;    /* One per service, plus stale ones: workers wait when full */
+    for(i = mon->capacity; i-- > 0; ) {
+        wheel_timer_init(&mon->services[i].expiry, on_expiry);
+        wheel_timer_init(&mon->services[i].check, on_check);
+        mon->services[i].hash_next = mon->free_list;
+        mon->free_list = &mon->services[i];
+    }
+    pthread_mutex_init(&mon->result_lock, NULL);
+    pthread_cond_init(&mon->result_space, NULL);
+    mon->result_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if(mon->result_fd < 0) {
+        registry_monitor_destroy(mon);
+        return -1;
+    }
+    for(i = 0; i < mon->config.workers; i++) {
+        mon->workers[i].epoll_fd = -1;
+        mon->workers[i].job_fd = -1;
+    }
+    for(i = 0; i < mon->config.workers; i++) {
+        if(start_worker(mon, &mon->workers[i]) < 0) {
+            int saved = errno;
+
+            registry_monitor_destroy(mon);
+            errno = saved;
+            return -1;
+        }
+    }
+    resync(mon);
+    return 0;
+}
+
+void registry_monitor_destroy(registry_monitor *mon) {
+    uint32_t i;
+
+    if(mon->result_fd >= 0) {
+        /* Workers waiting for room in the result queue give up */
+        pthread_mutex_lock(&mon->result_lock);
+        mon->closing = 1;
+        pthread_cond_broadcast(&mon->result_space);
+        pthread_mutex_unlock(&mon->result_lock);
+    }
+    if(mon->workers != NULL) {
+        for(i = 0; i < mon->config.workers; i++) {
+            stop_worker(&mon->workers[i]);
+        }
+    }
+    if(mon->result_fd >= 0) {
+        close(mon->result_fd);
+        pthread_cond_destroy(&mon->result_space);
+        pthread_mutex_destroy(&mon->result_lock);
+    }
+    free(mon->workers);
+    free(mon->results);
+    free(mon->buckets);
+    free(mon->services);
+    memset(mon, 0, sizeof(*mon));
+    mon->result_fd = -1;
+}
+
+int registry_monitor_poll(registry_monitor *mon, int timeout_ms) {
+    uint64_t tick_ns = (uint64_t)mon->config.tick_ms * 1000000u, next, now = now_ns(), counter;
+    struct pollfd pfd;
+
+    /* Never sleep past the next tick */
+    next = mon->start_ns + (mon->wheel.now + 1) * tick_ns;
+    if(next <= now) {
+        timeout_ms = 0;
+    } else if(timeout_ms < 0 || (uint64_t)timeout_ms > (next - now + 999999) / 1000000) {
+        timeout_ms = (int)((next - now + 999999) / 1000000);
+    }
+    pfd.fd = mon->result_fd;
+    pfd.events = POLLIN;
+    if(poll(&pfd, 1, timeout_ms) < 0 && errno != EINTR) {
+        return -1;
+    }
+    if(read(mon->result_fd, &counter, sizeof(counter)) < 0 && errno != EAGAIN) {
+        return -1;
+    }
+
+    follow_journal(mon);
+    apply_results(mon);
+    wheel_advance(&mon->wheel, current_tick(mon), mon);
+    return 0;
+}
+
+uint32_t registry_monitor_count(const registry_monitor *mon) {
+    return mon->count;
+}
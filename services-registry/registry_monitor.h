@@ -0,0 +1,102 @@
+#ifndef __REGISTRY_MONITOR_H_
+#define __REGISTRY_MONITOR_H_
+
+#include <stdint.h>
+#include <pthread.h>
+#include "services_registry.h"
+#include "timer_wheel.h"
+
+/*
+ * Registry monitor: expires records past their TTL and health-checks the
+ * registered endpoints, deregistering the ones that stop answering.
+ *
+ * One process runs it (any process that maps the registry). It follows the
+ * registry journal, so its cost is per update, not per record:
+ *  - each record it knows has two timers in a hierarchical timer wheel: its
+ *    expiry (last update + TTL, re-armed when the record is renewed) and its
+ *    next health check. A tick only touches the timers due in it.
+ *  - due checks go to a pool of worker threads. Each worker connects to the
+ *    endpoint (a UNIX stream socket path) without blocking, optionally sends a
+ *    request, and waits in its own epoll set for the reply; probes all get the
+ *    same timeout, so a worker's in-flight list is ordered by deadline and
+ *    timing them out costs nothing per tick. Results come back through a
+ *    queue and an eventfd.
+ *  - a record whose TTL ran out, or that failed 'max_failures' checks in a
+ *    row, is deregistered if it was not updated meanwhile
+ *    (registry_deregister_if()).
+ *
+ * The monitor is driven by registry_monitor_poll() from the caller's loop.
+ */
+
+#define MONITOR_MAX_WORKERS     16
+#define MONITOR_REQUEST_LEN     32
+
+typedef struct {
+    uint32_t tick_ms;                   /* Timer wheel resolution, default 10 */
+    uint32_t check_interval_ms;         /* Between checks of one endpoint, 0: no health checks */
+    uint32_t probe_timeout_ms;          /* Default 1000 */
+    uint32_t max_failures;              /* Failed checks in a row before deregistering, default 3 */
+    uint32_t workers;                   /* Probe threads, default 2 */
+    uint32_t max_inflight;              /* Probes in flight per worker, default 256 */
+    char request[MONITOR_REQUEST_LEN];  /* Sent after connecting, "" for none */
+    int expect_reply;                   /* A check needs a reply byte, not just the connection */
+} monitor_config;
+
+typedef struct monitor_service monitor_service;
+typedef struct monitor_worker monitor_worker;
+
+typedef struct {
+    uint64_t journal_updates;           /* Journal entries followed */
+    uint64_t resyncs;                   /* Full walks after falling behind the journal */
+    uint64_t checks;
+    uint64_t check_failures;
+    uint64_t expired;                   /* Deregistered at the end of their TTL */
+    uint64_t unhealthy;                 /* Deregistered after failed checks */
+    uint64_t deferred;                  /* Checks put off a period: the worker's queue was full */
+} monitor_stats;
+
+typedef struct {
+    registry *reg;
+    monitor_config config;
+    timer_wheel wheel;
+    uint64_t start_ns;
+
+    /* Records followed, hashed by name */
+    monitor_service *services;
+    monitor_service **buckets;
+    monitor_service *free_list;
+    uint32_t capacity;
+    uint32_t count;
+    uint64_t journal_pos;
+    uint32_t epoch;                     /* Mark of the last resync */
+
+    monitor_worker *workers;
+    uint32_t next_worker;
+    int result_fd;                      /* eventfd: results are waiting */
+    pthread_mutex_t result_lock;
+    pthread_cond_t result_space;        /* Signalled when a full result queue is drained */
+    struct monitor_result *results;
+    uint32_t result_head, result_count, result_len;
+    int closing;
+
+    monitor_stats stats;
+} registry_monitor;
+
+/* Defaults for every field left 0 */
+void registry_monitor_defaults(monitor_config *config);
+
+/* Starts the workers and loads the records already registered */
+int registry_monitor_init(registry_monitor *mon, registry *reg, const monitor_config *config);
+void registry_monitor_destroy(registry_monitor *mon);
+
+/*
+ * Waits up to 'timeout_ms' (at most a tick) for probe results, then follows
+ * the journal, applies the results and runs the timer ticks due. Returns 0 or
+ * -1 on error.
+ */
+int registry_monitor_poll(registry_monitor *mon, int timeout_ms);
+
+/* Records followed */
+uint32_t registry_monitor_count(const registry_monitor *mon);
+
+#endif
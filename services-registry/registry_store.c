@@ -0,0 +1,454 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "registry_store.h"
+#include "crc.h"
+
+#define SNAP_FILE       "registry.snap"
+#define SNAP_TMP        "registry.snap.tmp"
+#define LOG_FILE        "registry.log"
+#define LOG_TMP         "registry.log.tmp"
+
+#define SNAP_MAGIC      0x50414E53u     /* "SNAP" */
+#define LOG_MAGIC       0x474F4C52u     /* "RLOG" */
+#define STORE_VERSION   1
+#define SYNC_BATCH      64
+
+#define OP_PUT          1
+#define OP_DEL          2
+
+#define NONE            0xFFFFFFFFu
+
+/* Both files start with one; the records or log entries follow */
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t id;                        /* Snapshot id */
+    uint32_t count;                     /* Snapshot records, 0 in the log */
+    uint32_t record_size;
+    uint32_t crc;                       /* Of the fields above */
+    uint8_t reserved[40];
+} file_header;
+
+typedef struct {
+    uint32_t crc;                       /* Of the rest of the entry */
+    uint32_t op;
+    registry_record record;             /* Only the name for OP_DEL */
+} log_entry;
+
+struct store_entry {
+    char name[REGISTRY_NAME_LEN];
+    uint32_t sum;                       /* Of endpoint and TTL as in the files */
+    uint32_t next;                      /* In its bucket, or the next free entry */
+};
+
+/* Names in the files */
+
+static uint32_t hash_name(const char *name) {
+    uint32_t hash = 2166136261u;
+
+    while(*name) {
+        hash = (hash ^ (uint8_t)*name++) * 16777619u;
+    }
+    return hash;
+}
+
+static uint32_t record_sum(const registry_record *record) {
+    uint32_t crc = crc32_update(CRC32_INIT, (const uint8_t *)record->endpoint, strlen(record->endpoint));
+
+    return crc32_update(crc, (const uint8_t *)&record->ttl_ms, sizeof(record->ttl_ms)) ^ 0xFFFFFFFFu;
+}
+
+static uint32_t *map_link(registry_store *store, const char *name) {
+    uint32_t *link = &store->buckets[hash_name(name) & (store->capacity - 1)];
+
+    while(*link != NONE && strcmp(store->entries[*link].name, name) != 0) {
+        link = &store->entries[*link].next;
+    }
+    return link;
+}
+
+static void map_clear(registry_store *store) {
+    uint32_t i;
+
+    for(i = 0; i < store->capacity; i++) {
+        store->buckets[i] = NONE;
+        store->entries[i].next = (i + 1 < store->capacity) ? i + 1 : NONE;
+    }
+    store->free_entry = 0;
+}
+
+/* Returns 1 if 'record' differs from what the files hold, and records it as held */
+static int map_put(registry_store *store, const registry_record *record) {
+    uint32_t *link = map_link(store, record->name), sum = record_sum(record), i;
+
+    if(*link != NONE) {
+        if(store->entries[*link].sum == sum) {
+            return 0;
+        }
+        store->entries[*link].sum = sum;
+        return 1;
+    }
+    if(store->free_entry == NONE) {
+        return 1;                       /* Cannot happen: sized like the registry */
+    }
+    i = store->free_entry;
+    store->free_entry = store->entries[i].next;
+    memcpy(store->entries[i].name, record->name, REGISTRY_NAME_LEN);
+    store->entries[i].sum = sum;
+    store->entries[i].next = NONE;
+    *link = i;
+    return 1;
+}
+
+/* Returns 1 if the files hold 'name' */
+static int map_del(registry_store *store, const char *name) {
+    uint32_t *link = map_link(store, name), i = *link;
+
+    if(i == NONE) {
+        return 0;
+    }
+    *link = store->entries[i].next;
+    store->entries[i].next = store->free_entry;
+    store->free_entry = i;
+    return 1;
+}
+
+/* Files */
+
+static void make_header(file_header *header, uint32_t magic, uint32_t id, uint32_t count, uint32_t record_size) {
+    memset(header, 0, sizeof(*header));
+    header->magic = magic;
+    header->version = STORE_VERSION;
+    header->id = id;
+    header->count = count;
+    header->record_size = record_size;
+    header->crc = crc32((const uint8_t *)header, offsetof(file_header, crc));
+}
+
+static int check_header(const file_header *header, uint32_t magic, uint32_t record_size) {
+    return header->magic == magic && header->version == STORE_VERSION && header->record_size == record_size &&
+           header->crc == crc32((const uint8_t *)header, offsetof(file_header, crc));
+}
+
+static uint32_t entry_crc(const log_entry *entry) {
+    return crc32((const uint8_t *)&entry->op, sizeof(*entry) - offsetof(log_entry, op));
+}
+
+/* Writes a whole file as 'tmp', syncs it and renames it to 'name' */
+static int replace_file(registry_store *store, const char *tmp, const char *name, int fd) {
+    if(fsync(fd) < 0 || close(fd) < 0 || renameat(store->dir_fd, tmp, store->dir_fd, name) < 0) {
+        return -1;
+    }
+    return fsync(store->dir_fd);
+}
+
+static int new_log(registry_store *store) {
+    file_header header;
+    int fd;
+
+    fd = openat(store->dir_fd, LOG_TMP, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if(fd < 0) {
+        return -1;
+    }
+    make_header(&header, LOG_MAGIC, store->snapshot_id, 0, sizeof(log_entry));
+    if(write(fd, &header, sizeof(header)) != (ssize_t)sizeof(header) ||
+       replace_file(store, LOG_TMP, LOG_FILE, fd) < 0) {
+        return -1;
+    }
+    if(store->log_fd >= 0) {
+        close(store->log_fd);
+    }
+    store->log_fd = openat(store->dir_fd, LOG_FILE, O_WRONLY | O_APPEND | O_CLOEXEC);
+    store->log_entries = 0;
+    return (store->log_fd < 0) ? -1 : 0;
+}
+
+typedef struct {
+    registry_store *store;
+    registry_record *records;
+    uint32_t count, max;
+} snapshot_writer;
+
+static int snapshot_record(const registry_record *record, void *arg) {
+    snapshot_writer *w = arg;
+    registry_record *r;
+
+    if(w->count == w->max) {
+        return 1;                       /* Seen twice too often while the table changed: cannot happen */
+    }
+    r = &w->records[w->count++];
+    *r = *record;
+    r->version = 0;
+    map_put(w->store, record);
+    return 0;
+}
+
+int registry_store_compact(registry_store *store) {
+    snapshot_writer w;
+    file_header header;
+    size_t size;
+    void *map;
+    int fd;
+
+    /* Changes from here on go to the new log; the walk sees at least the table as it is now */
+    store->journal_pos = registry_journal_head(store->reg);
+    map_clear(store);
+
+    w.store = store;
+    w.count = 0;
+    w.max = registry_capacity(store->reg);
+    size = sizeof(file_header) + (size_t)w.max * sizeof(registry_record);
+    fd = openat(store->dir_fd, SNAP_TMP, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if(fd < 0) {
+        return -1;
+    }
+    if(ftruncate(fd, (off_t)size) < 0 ||
+       (map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED) {
+        close(fd);
+        return -1;
+    }
+    w.records = (registry_record *)((char *)map + sizeof(file_header));
+    registry_foreach(store->reg, snapshot_record, &w);
+    make_header(&header, SNAP_MAGIC, store->snapshot_id + 1, w.count, sizeof(registry_record));
+    memcpy(map, &header, sizeof(header));
+    munmap(map, size);
+    if(ftruncate(fd, (off_t)(sizeof(file_header) + (size_t)w.count * sizeof(registry_record))) < 0 ||
+       replace_file(store, SNAP_TMP, SNAP_FILE, fd) < 0) {
+        return -1;
+    }
+
+    /* A crash before the new log is in place leaves an old log, which the new id makes ignored */
+    store->snapshot_id++;
+    store->snapshot_records = w.count;
+    store->stats.compactions++;
+    return new_log(store);
+}
+
+/* At open: the snapshot into the registry in one update */
+static int load_snapshot(registry_store *store) {
+    const file_header *header;
+    struct stat st;
+    void *map;
+    int fd, loaded;
+
+    fd = openat(store->dir_fd, SNAP_FILE, O_RDONLY | O_CLOEXEC);
+    if(fd < 0) {
+        return (errno == ENOENT) ? 0 : -1;
+    }
+    if(fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(file_header)) {
+        close(fd);
+        errno = EPROTO;
+        return -1;
+    }
+    map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    close(fd);
+    if(map == MAP_FAILED) {
+        return -1;
+    }
+    header = map;
+    if(!check_header(header, SNAP_MAGIC, sizeof(registry_record)) ||
+       (size_t)st.st_size < sizeof(file_header) + (size_t)header->count * sizeof(registry_record)) {
+        munmap(map, (size_t)st.st_size);
+        errno = EPROTO;
+        return -1;
+    }
+    loaded = registry_load(store->reg, (const registry_record *)((const char *)map + sizeof(file_header)),
+                           header->count);
+    store->snapshot_id = header->id;
+    store->snapshot_records = header->count;
+    munmap(map, (size_t)st.st_size);
+    if(loaded < 0) {
+        return -1;
+    }
+    store->stats.loaded = (uint32_t)loaded;
+    return 0;
+}
+
+/* At open: replays the log of this snapshot and cuts off a torn tail. Returns 1 if there was one. */
+static int replay_log(registry_store *store) {
+    const file_header *header;
+    const log_entry *entry;
+    struct stat st;
+    size_t n, i;
+    void *map;
+    int fd;
+
+    fd = openat(store->dir_fd, LOG_FILE, O_RDWR | O_CLOEXEC);
+    if(fd < 0) {
+        return (errno == ENOENT) ? 0 : -1;
+    }
+    if(fstat(fd, &st) < 0) {
+        close(fd);
+        return -1;
+    }
+    if((size_t)st.st_size < sizeof(file_header)) {
+        close(fd);
+        return 0;
+    }
+    map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    if(map == MAP_FAILED) {
+        close(fd);
+        return -1;
+    }
+    header = map;
+    if(!check_header(header, LOG_MAGIC, sizeof(log_entry)) || header->id != store->snapshot_id) {
+        munmap(map, (size_t)st.st_size);
+        close(fd);
+        return 0;                       /* From before the last compaction */
+    }
+
+    n = ((size_t)st.st_size - sizeof(file_header)) / sizeof(log_entry);
+    entry = (const log_entry *)((const char *)map + sizeof(file_header));
+    for(i = 0; i < n && entry[i].crc == entry_crc(&entry[i]); i++) {
+        const registry_record *r = &entry[i].record;
+
+        if(memchr(r->name, '\0', REGISTRY_NAME_LEN) == NULL || memchr(r->endpoint, '\0', REGISTRY_ENDPOINT_LEN) == NULL) {
+            break;
+        }
+        if(entry[i].op == OP_PUT) {
+            registry_register_ttl(store->reg, r->name, r->endpoint, r->ttl_ms);
+        } else {
+            registry_deregister(store->reg, r->name);
+        }
+    }
+    store->stats.replayed = (uint32_t)i;
+    store->log_entries = i;
+    munmap(map, (size_t)st.st_size);
+
+    /* Whatever follows the last good entry was being written when the process died */
+    n = sizeof(file_header) + i * sizeof(log_entry);
+    if((size_t)st.st_size > n) {
+        store->stats.torn = (uint32_t)((size_t)st.st_size - n);
+        if(ftruncate(fd, (off_t)n) < 0 || fdatasync(fd) < 0) {
+            close(fd);
+            return -1;
+        }
+    }
+    close(fd);
+    return 1;
+}
+
+static int map_record(const registry_record *record, void *arg) {
+    map_put(arg, record);
+    return 0;
+}
+
+int registry_store_open(registry_store *store, registry *reg, const char *dir, int flags) {
+    int rc, saved;
+
+    memset(store, 0, sizeof(*store));
+    store->reg = reg;
+    store->flags = flags;
+    store->log_fd = -1;
+    store->capacity = registry_capacity(reg);
+    if(mkdir(dir, 0700) < 0 && errno != EEXIST) {
+        return -1;
+    }
+    store->dir_fd = open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    store->entries = calloc(store->capacity, sizeof(store_entry));
+    store->buckets = calloc(store->capacity, sizeof(uint32_t));
+    if(store->dir_fd < 0 || store->entries == NULL || store->buckets == NULL) {
+        saved = (store->dir_fd < 0) ? errno : ENOMEM;
+        registry_store_close(store);
+        errno = saved;
+        return -1;
+    }
+    map_clear(store);
+
+    /* The segment outlived the last store: it is newer than the files */
+    if(registry_count(reg) > 0) {
+        rc = registry_store_compact(store);
+    } else if((rc = load_snapshot(store)) == 0 && (rc = replay_log(store)) >= 0) {
+        store->journal_pos = registry_journal_head(reg);
+        registry_foreach(reg, map_record, store);
+        if(rc == 1) {
+            store->log_fd = openat(store->dir_fd, LOG_FILE, O_WRONLY | O_APPEND | O_CLOEXEC);
+            rc = (store->log_fd < 0) ? -1 : 0;
+        } else {
+            rc = new_log(store);
+        }
+    }
+    if(rc < 0) {
+        saved = errno;
+        registry_store_close(store);
+        errno = saved;
+        return -1;
+    }
+    return 0;
+}
+
+int registry_store_sync(registry_store *store) {
+    char names[SYNC_BATCH][REGISTRY_NAME_LEN];
+    log_entry entries[SYNC_BATCH];
+    registry_record record;
+    size_t len;
+    int i, n, k, written = 0;
+
+    for(;;) {
+        n = registry_changes(store->reg, &store->journal_pos, names, SYNC_BATCH);
+        if(n < 0) {
+            store->stats.resyncs++;     /* Fell behind: the table itself is the log now */
+            return registry_store_compact(store);
+        }
+        if(n == 0) {
+            break;
+        }
+        for(i = 0, k = 0; i < n; i++) {
+            memset(&entries[k], 0, sizeof(entries[k]));
+            if(registry_get(store->reg, names[i], &record) == 0) {
+                if(!map_put(store, &record)) {
+                    store->stats.unchanged++;
+                    continue;
+                }
+                entries[k].op = OP_PUT;
+                entries[k].record = record;
+                entries[k].record.version = 0;
+            } else {
+                if(!map_del(store, names[i])) {
+                    store->stats.unchanged++;   /* Added and removed between two syncs */
+                    continue;
+                }
+                entries[k].op = OP_DEL;
+                memcpy(entries[k].record.name, names[i], REGISTRY_NAME_LEN);
+            }
+            entries[k].crc = entry_crc(&entries[k]);
+            k++;
+        }
+        len = (size_t)k * sizeof(log_entry);
+        if(k > 0 && write(store->log_fd, entries, len) != (ssize_t)len) {
+            return -1;
+        }
+        store->log_entries += (uint64_t)k;
+        store->stats.logged += (uint64_t)k;
+        written += k;
+    }
+    if(written > 0 && (store->flags & REGISTRY_STORE_FSYNC) && fdatasync(store->log_fd) < 0) {
+        return -1;
+    }
+    if(store->log_entries >= REGISTRY_STORE_COMPACT_MIN && store->log_entries > store->snapshot_records) {
+        return registry_store_compact(store);
+    }
+    return 0;
+}
+
+void registry_store_close(registry_store *store) {
+    if(store->log_fd >= 0) {
+        close(store->log_fd);
+    }
+    if(store->dir_fd >= 0) {
+        close(store->dir_fd);
+    }
+    free(store->entries);
+    free(store->buckets);
+    store->entries = NULL;
+    store->buckets = NULL;
+    store->log_fd = -1;
+    store->dir_fd = -1;
+}
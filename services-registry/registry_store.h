@@ -0,0 +1,82 @@
+#ifndef __REGISTRY_STORE_H_
+#define __REGISTRY_STORE_H_
+
+#include <stdint.h>
+#include "services_registry.h"
+
+/*
+ * Persistence of a registry in a directory:
+ *
+ *   registry.snap   snapshot: a header and the records as registry_record,
+ *                   written whole to a temporary file, synced and renamed,
+ *                   read back with one mmap()
+ *   registry.log    append-only change log since that snapshot: put and
+ *                   delete entries, each with a CRC-32, so a torn tail left by
+ *                   a crash is detected and cut off
+ *
+ * Both carry the snapshot id; a log whose id is not the snapshot's is left
+ * over from before the last compaction and already in the snapshot.
+ *
+ * One process runs the store. It follows the registry journal like the
+ * monitor does and logs a record only when its endpoint or TTL changed, so
+ * renewals cost nothing on disk. When the log has more entries than the
+ * snapshot has records, the next sync compacts: a new snapshot of the
+ * current table and an empty log.
+ *
+ * A restarted registry loads the snapshot in one registry_load() call and
+ * replays the log on top, which takes milliseconds for 100k records, instead
+ * of waiting for every service to register again.
+ */
+
+#define REGISTRY_STORE_FSYNC        0x01    /* fdatasync() the log on every sync */
+
+#define REGISTRY_STORE_COMPACT_MIN  1024    /* Log entries before compacting at all */
+
+typedef struct store_entry store_entry;
+
+typedef struct {
+    uint64_t logged;                /* Log entries appended */
+    uint64_t unchanged;             /* Journal updates not logged (renewals) */
+    uint64_t compactions;
+    uint64_t resyncs;
+    uint32_t loaded;                /* At open: records from the snapshot */
+    uint32_t replayed;              /* At open: log entries applied */
+    uint32_t torn;                  /* At open: bytes cut off the log tail */
+} store_stats;
+
+typedef struct {
+    registry *reg;
+    int dir_fd;
+    int log_fd;
+    int flags;
+    uint32_t snapshot_id;
+    uint32_t snapshot_records;
+    uint64_t log_entries;
+    uint64_t journal_pos;
+
+    /* What the files hold per name: a checksum of endpoint and TTL */
+    store_entry *entries;
+    uint32_t *buckets;
+    uint32_t capacity;
+    uint32_t free_entry;
+
+    store_stats stats;
+} registry_store;
+
+/*
+ * Opens (creating it if needed) the store in 'dir' for 'reg'. An empty
+ * registry is filled from the files; a registry that already holds records
+ * (its segment outlived the process) is newer than them and is written out
+ * as a new snapshot instead.
+ */
+int registry_store_open(registry_store *store, registry *reg, const char *dir, int flags);
+
+/* Appends the changes since the last call to the log, compacting when it has grown too long */
+int registry_store_sync(registry_store *store);
+
+/* New snapshot of the current table, empty log */
+int registry_store_compact(registry_store *store);
+
+void registry_store_close(registry_store *store);
+
+#endif
@@ -1,6 +1,707 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "services_registry.h"
 
+#define REGISTRY_MAGIC      0x52454731u         /* "REG1" */
+#define REGISTRY_VERSION    2
+#define CACHE_LINE          64
+#define MAX_CAPACITY        (1u << 24)
+#define SPINS_BEFORE_YIELD  100
+#define OPEN_WAIT_MS        1000                /* For a creator still initialising the segment */
 
-int main(void) {
+#define SLOT_EMPTY          0                   /* Ends a probe sequence */
+#define SLOT_USED           1
+#define SLOT_DELETED        2                   /* Tombstone: probing goes on */
+
+typedef struct {
+    _Alignas(CACHE_LINE) uint32_t state;
+    uint32_t hash;
+    uint32_t ttl_ms;
+    uint64_t version;                           /* Generation of the last update */
+    char name[REGISTRY_NAME_LEN];
+    char endpoint[REGISTRY_ENDPOINT_LEN];
+} registry_slot;
+
+struct registry_table {
+    _Atomic uint32_t magic;                     /* Set last by the creator */
+    uint32_t version;
+    uint32_t capacity;                          /* Power of two */
+    uint32_t slot_size;
+    pthread_mutex_t lock;                       /* Writers only */
+    _Atomic uint32_t count;                     /* Live records */
+    uint32_t used;                              /* Live records and tombstones */
+
+    /* Names of the records updated, the last REGISTRY_JOURNAL_LEN of them */
+    _Atomic uint64_t journal_head;
+    char journal[REGISTRY_JOURNAL_LEN][REGISTRY_NAME_LEN];
+
+    /* Odd while an update is in progress; alone on its line, readers only load it */
+    _Alignas(CACHE_LINE) _Atomic uint64_t seq;
+
+    registry_slot slots[];
+};
+
+static size_t table_size(uint32_t capacity) {
+    return sizeof(registry_table) + (size_t)capacity * sizeof(registry_slot);
+}
+
+/* FNV-1a */
+static uint32_t hash_name(const char *name, size_t len) {
+    uint32_t hash = 2166136261u;
+    size_t i;
+
+    for(i = 0; i < len; i++) {
+        hash = (hash ^ (uint8_t)name[i]) * 16777619u;
+    }
+    return hash;
+}
+
+/*
+ * Seqlock. Readers copy what they need between read_begin() and
+ * read_retry() and only trust it if the sequence did not move; the slot
+ * contents they read may be torn meanwhile, so nothing read there is used as
+ * a pointer or an unbounded length.
+ */
+static uint64_t read_begin(const registry_table *t) {
+    uint64_t seq;
+    int spins = 0;
+
+    while((seq = atomic_load_explicit(&t->seq, memory_order_acquire)) & 1) {
+        if(++spins == SPINS_BEFORE_YIELD) {
+            spins = 0;
+            sched_yield();                      /* The writer may have been preempted */
+        }
+    }
+    return seq;
+}
+
+static int read_retry(const registry_table *t, uint64_t seq) {
+    atomic_thread_fence(memory_order_acquire);
+    return atomic_load_explicit(&t->seq, memory_order_relaxed) != seq;
+}
+
+/* Only called with the lock held, so the writer is alone to change 'seq' */
+static void write_begin(registry_table *t) {
+    atomic_store_explicit(&t->seq, atomic_load_explicit(&t->seq, memory_order_relaxed) + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+}
+
+static void write_end(registry_table *t) {
+    atomic_store_explicit(&t->seq, atomic_load_explicit(&t->seq, memory_order_relaxed) + 1, memory_order_release);
+}
+
+/* Version of the update about to be made: the generation once it is done */
+static uint64_t next_version(const registry_table *t) {
+    return atomic_load_explicit(&t->seq, memory_order_relaxed) / 2 + 1;
+}
+
+/* With the lock held */
+static void journal_append(registry_table *t, const char *name) {
+    uint64_t head = atomic_load_explicit(&t->journal_head, memory_order_relaxed);
+
+    memcpy(t->journal[head % REGISTRY_JOURNAL_LEN], name, REGISTRY_NAME_LEN);
+    atomic_store_explicit(&t->journal_head, head + 1, memory_order_release);
+}
+
+/* Reader side probe, between read_begin() and read_retry() */
+static const registry_slot *probe(const registry_table *t, const char *name, size_t len, uint32_t hash) {
+    uint32_t mask = t->capacity - 1, i, n;
+
+    for(i = hash & mask, n = 0; n < t->capacity; i = (i + 1) & mask, n++) {
+        const registry_slot *s = &t->slots[i];
+        uint32_t state = s->state;
+
+        if(state == SLOT_EMPTY) {
+            break;
+        }
+        if(state == SLOT_USED && s->hash == hash && memcmp(s->name, name, len + 1) == 0) {
+            return s;
+        }
+    }
+    return NULL;
+}
+
+static void copy_record(registry_record *record, const registry_slot *s) {
+    memcpy(record->name, s->name, REGISTRY_NAME_LEN);
+    memcpy(record->endpoint, s->endpoint, REGISTRY_ENDPOINT_LEN);
+    record->ttl_ms = s->ttl_ms;
+    record->version = s->version;
+}
+
+/* A copy taken inside the seqlock may be torn until validated; a validated one is terminated */
+static void terminate_record(registry_record *record) {
+    record->name[REGISTRY_NAME_LEN - 1] = '\0';
+    record->endpoint[REGISTRY_ENDPOINT_LEN - 1] = '\0';
+}
+
+/*
+ * Writer side probe: index of 'name' or -1, and in '*free_slot' the first
+ * tombstone or empty slot on the way (-1 if the table is full of records).
+ */
+static int find(const registry_table *t, const char *name, size_t len, uint32_t hash, int *free_slot) {
+    uint32_t mask = t->capacity - 1, i, n;
+
+    *free_slot = -1;
+    for(i = hash & mask, n = 0; n < t->capacity; i = (i + 1) & mask, n++) {
+        const registry_slot *s = &t->slots[i];
+
+        if(s->state == SLOT_EMPTY) {
+            if(*free_slot < 0) {
+                *free_slot = (int)i;
+            }
+            return -1;
+        }
+        if(s->state == SLOT_DELETED) {
+            if(*free_slot < 0) {
+                *free_slot = (int)i;
+            }
+        } else if(s->hash == hash && memcmp(s->name, name, len + 1) == 0) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+static void put(registry_table *t, const registry_slot *record) {
+    uint32_t mask = t->capacity - 1, i;
+
+    i = record->hash & mask;
+    while(t->slots[i].state != SLOT_EMPTY) {
+        i = (i + 1) & mask;
+    }
+    t->slots[i] = *record;
+}
+
+/*
+ * Re-inserts the live records into an emptied table, dropping tombstones.
+ * With 'check' set the records are validated first, for a table left by a
+ * writer that died in the middle of an update. Runs inside write_begin()/
+ * write_end(): readers wait for it.
+ */
+static int rebuild(registry_table *t, int check) {
+    registry_slot *live;
+    uint32_t i, n = 0;
+
+    live = malloc((size_t)t->capacity * sizeof(registry_slot));
+    if(live == NULL) {
+        errno = ENOMEM;
+        return -1;
+    }
+    for(i = 0; i < t->capacity; i++) {
+        registry_slot *s = &t->slots[i];
+
+        if(s->state != SLOT_USED) {
+            continue;
+        }
+        if(check && (memchr(s->name, '\0', REGISTRY_NAME_LEN) == NULL ||
+                     memchr(s->endpoint, '\0', REGISTRY_ENDPOINT_LEN) == NULL ||
+                     s->hash != hash_name(s->name, strlen(s->name)))) {
+            continue;
+        }
+        live[n++] = *s;
+    }
+    memset(t->slots, 0, (size_t)t->capacity * sizeof(registry_slot));
+    for(i = 0; i < n; i++) {
+        put(t, &live[i]);
+    }
+    free(live);
+    atomic_store_explicit(&t->count, n, memory_order_relaxed);
+    t->used = n;
+    return 0;
+}
+
+static int lock_table(registry_table *t) {
+    int rc = pthread_mutex_lock(&t->lock);
+
+    if(rc == EOWNERDEAD) {
+        /* The previous writer died holding the lock, maybe inside an update */
+        if(atomic_load_explicit(&t->seq, memory_order_relaxed) & 1) {
+            rebuild(t, 1);
+            write_end(t);
+        }
+        pthread_mutex_consistent(&t->lock);
+        rc = 0;
+    }
+    if(rc != 0) {
+        errno = rc;
+        return -1;
+    }
+    return 0;
+}
+
+static int check_name(const char *name, size_t *len) {
+    *len = strlen(name);
+    if(*len == 0 || *len >= REGISTRY_NAME_LEN) {
+        errno = (*len == 0) ? EINVAL : ENAMETOOLONG;
+        return -1;
+    }
+    return 0;
+}
+
+static int init_table(registry_table *t, uint32_t capacity) {
+    pthread_mutexattr_t attr;
+    int rc;
+
+    t->version = REGISTRY_VERSION;
+    t->capacity = capacity;
+    t->slot_size = sizeof(registry_slot);
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+    rc = pthread_mutex_init(&t->lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+    if(rc != 0) {
+        errno = rc;
+        return -1;
+    }
+    atomic_store_explicit(&t->magic, REGISTRY_MAGIC, memory_order_release);
+    return 0;
+}
+
+/* An existing segment: wait for its creator to size and initialise it */
+static int attach(registry *reg, int fd) {
+    const struct timespec pause = { 0, 1000000 };
+    registry_table *t;
+    struct stat st;
+    int waited;
+
+    for(waited = 0; ; waited++) {
+        if(fstat(fd, &st) < 0) {
+            return -1;
+        }
+        if((size_t)st.st_size >= sizeof(registry_table)) {
+            break;
+        }
+        if(waited == OPEN_WAIT_MS) {
+            errno = EPROTO;
+            return -1;
+        }
+        nanosleep(&pause, NULL);
+    }
+
+    t = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if(t == MAP_FAILED) {
+        return -1;
+    }
+    for(waited = 0; atomic_load_explicit(&t->magic, memory_order_acquire) != REGISTRY_MAGIC; waited++) {
+        if(waited == OPEN_WAIT_MS) {
+            break;
+        }
+        nanosleep(&pause, NULL);
+    }
+    if(atomic_load_explicit(&t->magic, memory_order_acquire) != REGISTRY_MAGIC ||
+       t->version != REGISTRY_VERSION || t->slot_size != sizeof(registry_slot) ||
+       table_size(t->capacity) > (size_t)st.st_size) {
+        munmap(t, (size_t)st.st_size);
+        errno = EPROTO;
+        return -1;
+    }
+    reg->table = t;
+    reg->map_len = (size_t)st.st_size;
+    return 0;
+}
+
+int registry_open(registry *reg, const char *shm_name, uint32_t capacity, int flags) {
+    registry_table *t;
+    uint32_t size = 8;
+    int fd = -1, rc, saved;
+
+    memset(reg, 0, sizeof(*reg));
+    if(capacity == 0) {
+        capacity = REGISTRY_DEFAULT_CAPACITY;
+    }
+    if(capacity > MAX_CAPACITY) {
+        errno = EINVAL;
+        return -1;
+    }
+    while(size < capacity) {
+        size <<= 1;
+    }
+
+    if(flags & REGISTRY_CREATE) {
+        fd = shm_open(shm_name, O_RDWR | O_CREAT | O_EXCL, 0600);
+        if(fd < 0 && errno != EEXIST) {
+            return -1;
+        }
+    }
+    if(fd < 0) {
+        fd = shm_open(shm_name, O_RDWR, 0);
+        if(fd < 0) {
+            return -1;
+        }
+        rc = attach(reg, fd);
+        saved = errno;
+        close(fd);
+        errno = saved;
+        return rc;
+    }
+
+    /* Created here: the new pages read as zero, so every slot starts empty */
+    if(ftruncate(fd, (off_t)table_size(size)) < 0) {
+        goto fail;
+    }
+    t = mmap(NULL, table_size(size), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if(t == MAP_FAILED) {
+        goto fail;
+    }
+    if(init_table(t, size) < 0) {
+        saved = errno;
+        munmap(t, table_size(size));
+        errno = saved;
+        goto fail;
+    }
+    close(fd);
+    reg->table = t;
+    reg->map_len = table_size(size);
+    return 0;
+
+fail:
+    saved = errno;
+    close(fd);
+    shm_unlink(shm_name);
+    errno = saved;
+    return -1;
+}
+
+void registry_close(registry *reg) {
+    if(reg->table != NULL) {
+        munmap(reg->table, reg->map_len);
+        reg->table = NULL;
+    }
+}
+
+int registry_unlink(const char *shm_name) {
+    return shm_unlink(shm_name);
+}
+
+/*
+ * Puts a new record at 'free_slot' (from find()), first purging the
+ * tombstones if it would take an empty slot past the 3/4 limit. Inside a
+ * write section.
+ */
+static int place(registry_table *t, const registry_slot *record, size_t len, int free_slot) {
+    if(t->used >= t->capacity / 4 * 3 && t->slots[free_slot].state == SLOT_EMPTY) {
+        if(rebuild(t, 0) < 0) {
+            return -1;
+        }
+        find(t, record->name, len, record->hash, &free_slot);
+    }
+    if(t->slots[free_slot].state == SLOT_EMPTY) {
+        t->used++;
+    }
+    t->slots[free_slot] = *record;
+    atomic_fetch_add_explicit(&t->count, 1, memory_order_relaxed);
     return 0;
 }
+
+/*
+ * Adds or replaces a record; with 'endpoint' NULL only renews an existing one
+ * (new version, same endpoint and TTL).
+ */
+static int store(registry *reg, const char *name, const char *endpoint, uint32_t ttl_ms) {
+    registry_table *t = reg->table;
+    registry_slot record;
+    size_t len;
+    int i, free_slot;
+
+    if(check_name(name, &len) < 0) {
+        return -1;
+    }
+    if(endpoint != NULL && strlen(endpoint) >= REGISTRY_ENDPOINT_LEN) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    memset(&record, 0, sizeof(record));
+    record.state = SLOT_USED;
+    record.hash = hash_name(name, len);
+    record.ttl_ms = ttl_ms;
+    memcpy(record.name, name, len);
+    if(endpoint != NULL) {
+        strcpy(record.endpoint, endpoint);
+    }
+
+    if(lock_table(t) < 0) {
+        return -1;
+    }
+    i = find(t, name, len, record.hash, &free_slot);
+    if(i >= 0) {
+        registry_slot *s = &t->slots[i];
+
+        write_begin(t);
+        s->version = next_version(t);
+        if(endpoint != NULL) {
+            memcpy(s->endpoint, record.endpoint, REGISTRY_ENDPOINT_LEN);
+            s->ttl_ms = ttl_ms;
+        }
+        journal_append(t, s->name);
+        write_end(t);
+        pthread_mutex_unlock(&t->lock);
+        return 0;
+    }
+    if(endpoint == NULL) {
+        pthread_mutex_unlock(&t->lock);
+        errno = ENOENT;
+        return -1;
+    }
+
+    /* Keep probe sequences short: at most 3/4 of the slots hold records or tombstones */
+    if(atomic_load_explicit(&t->count, memory_order_relaxed) >= t->capacity / 4 * 3) {
+        pthread_mutex_unlock(&t->lock);
+        errno = ENOSPC;
+        return -1;
+    }
+    record.version = next_version(t);
+    write_begin(t);
+    if(place(t, &record, len, free_slot) < 0) {
+        write_end(t);
+        pthread_mutex_unlock(&t->lock);
+        return -1;
+    }
+    journal_append(t, record.name);
+    write_end(t);
+    pthread_mutex_unlock(&t->lock);
+    return 0;
+}
+
+int registry_register(registry *reg, const char *name, const char *endpoint) {
+    return store(reg, name, endpoint, 0);
+}
+
+int registry_register_ttl(registry *reg, const char *name, const char *endpoint, uint32_t ttl_ms) {
+    return store(reg, name, endpoint, ttl_ms);
+}
+
+int registry_renew(registry *reg, const char *name) {
+    return store(reg, name, NULL, 0);
+}
+
+int registry_load(registry *reg, const registry_record *records, uint32_t n) {
+    registry_table *t = reg->table;
+    registry_slot slot;
+    uint64_t version;
+    uint32_t i, loaded = 0;
+    size_t len;
+    int k, free_slot, rc = 0;
+
+    if(lock_table(t) < 0) {
+        return -1;
+    }
+    version = next_version(t);
+    write_begin(t);
+    for(i = 0; i < n; i++) {
+        const registry_record *r = &records[i];
+
+        len = strnlen(r->name, REGISTRY_NAME_LEN);
+        if(len == 0 || len == REGISTRY_NAME_LEN || strnlen(r->endpoint, REGISTRY_ENDPOINT_LEN) == REGISTRY_ENDPOINT_LEN) {
+            continue;
+        }
+        memset(&slot, 0, sizeof(slot));
+        slot.state = SLOT_USED;
+        slot.hash = hash_name(r->name, len);
+        slot.ttl_ms = r->ttl_ms;
+        slot.version = version;
+        memcpy(slot.name, r->name, len);
+        memcpy(slot.endpoint, r->endpoint, REGISTRY_ENDPOINT_LEN);
+
+        k = find(t, slot.name, len, slot.hash, &free_slot);
+        if(k >= 0) {
+            t->slots[k] = slot;
+        } else if(atomic_load_explicit(&t->count, memory_order_relaxed) >= t->capacity / 4 * 3) {
+            errno = ENOSPC;
+            rc = -1;
+            break;
+        } else if(place(t, &slot, len, free_slot) < 0) {
+            rc = -1;
+            break;
+        }
+        loaded++;
+    }
+
+    /* Too many names for the journal: move its head out of every follower's reach so they resynchronise */
+    atomic_store_explicit(&t->journal_head,
+                          atomic_load_explicit(&t->journal_head, memory_order_relaxed) + REGISTRY_JOURNAL_LEN,
+                          memory_order_release);
+    write_end(t);
+    pthread_mutex_unlock(&t->lock);
+    return (rc < 0) ? -1 : (int)loaded;
+}
+
+int registry_deregister_if(registry *reg, const char *name, uint64_t version) {
+    registry_table *t = reg->table;
+    size_t len;
+    int i, free_slot;
+
+    if(check_name(name, &len) < 0) {
+        return -1;
+    }
+    if(lock_table(t) < 0) {
+        return -1;
+    }
+    i = find(t, name, len, hash_name(name, len), &free_slot);
+    if(i < 0 || (version != 0 && t->slots[i].version != version)) {
+        pthread_mutex_unlock(&t->lock);
+        errno = (i < 0) ? ENOENT : ESTALE;
+        return -1;
+    }
+    write_begin(t);
+    /* A tombstone is only needed if a probe sequence goes on past this slot */
+    if(t->slots[(uint32_t)(i + 1) & (t->capacity - 1)].state == SLOT_EMPTY) {
+        t->slots[i].state = SLOT_EMPTY;
+        t->used--;
+    } else {
+        t->slots[i].state = SLOT_DELETED;
+    }
+    atomic_fetch_sub_explicit(&t->count, 1, memory_order_relaxed);
+    journal_append(t, t->slots[i].name);
+    write_end(t);
+    pthread_mutex_unlock(&t->lock);
+    return 0;
+}
+
+int registry_deregister(registry *reg, const char *name) {
+    return registry_deregister_if(reg, name, 0);
+}
+
+int registry_lookup(registry *reg, const char *name, char *endpoint, size_t len) {
+    const registry_table *t = reg->table;
+    const registry_slot *s;
+    size_t name_len, copy = (len < REGISTRY_ENDPOINT_LEN) ? len : REGISTRY_ENDPOINT_LEN;
+    uint32_t hash;
+    uint64_t seq;
+
+    if(check_name(name, &name_len) < 0) {
+        return -1;
+    }
+    hash = hash_name(name, name_len);
+    reg->lookups++;
+    for(;;) {
+        seq = read_begin(t);
+        s = probe(t, name, name_len, hash);
+        if(s != NULL && copy > 0) {
+            memcpy(endpoint, s->endpoint, copy);
+        }
+        if(!read_retry(t, seq)) {
+            break;
+        }
+        reg->retries++;
+    }
+
+    if(s == NULL) {
+        errno = ENOENT;
+        return -1;
+    }
+    if(copy > 0) {
+        endpoint[copy - 1] = '\0';              /* The record's own '\0' when not truncated */
+    }
+    return 0;
+}
+
+int registry_get(registry *reg, const char *name, registry_record *record) {
+    const registry_table *t = reg->table;
+    const registry_slot *s;
+    size_t name_len;
+    uint32_t hash;
+    uint64_t seq;
+
+    if(check_name(name, &name_len) < 0) {
+        return -1;
+    }
+    hash = hash_name(name, name_len);
+    reg->lookups++;
+    for(;;) {
+        seq = read_begin(t);
+        s = probe(t, name, name_len, hash);
+        if(s != NULL) {
+            copy_record(record, s);
+        }
+        if(!read_retry(t, seq)) {
+            break;
+        }
+        reg->retries++;
+    }
+
+    if(s == NULL) {
+        errno = ENOENT;
+        return -1;
+    }
+    terminate_record(record);
+    return 0;
+}
+
+int registry_foreach(registry *reg, int (*fn)(const registry_record *record, void *arg), void *arg) {
+    const registry_table *t = reg->table;
+    registry_record record;
+    uint64_t seq;
+    uint32_t i;
+    int used, rc;
+
+    for(i = 0; i < t->capacity; i++) {
+        do {
+            seq = read_begin(t);
+            used = (t->slots[i].state == SLOT_USED);
+            if(used) {
+                copy_record(&record, &t->slots[i]);
+            }
+        } while(read_retry(t, seq));
+        if(used) {
+            terminate_record(&record);
+            if((rc = fn(&record, arg)) != 0) {
+                return rc;
+            }
+        }
+    }
+    return 0;
+}
+
+uint64_t registry_journal_head(const registry *reg) {
+    return atomic_load_explicit(&reg->table->journal_head, memory_order_acquire);
+}
+
+int registry_changes(registry *reg, uint64_t *pos, char (*names)[REGISTRY_NAME_LEN], int max) {
+    const registry_table *t = reg->table;
+    uint64_t head = atomic_load_explicit(&t->journal_head, memory_order_acquire);
+    int i, n;
+
+    /* The entry at 'head' may be being written: only head - LEN + 1 onwards is safe */
+    if(head - *pos >= REGISTRY_JOURNAL_LEN) {
+        *pos = head;
+        errno = EOVERFLOW;
+        return -1;
+    }
+    n = (head - *pos < (uint64_t)max) ? (int)(head - *pos) : max;
+    for(i = 0; i < n; i++) {
+        memcpy(names[i], t->journal[(*pos + (uint64_t)i) % REGISTRY_JOURNAL_LEN], REGISTRY_NAME_LEN);
+        names[i][REGISTRY_NAME_LEN - 1] = '\0';
+    }
+    atomic_thread_fence(memory_order_acquire);
+    head = atomic_load_explicit(&t->journal_head, memory_order_relaxed);
+    if(head - *pos >= REGISTRY_JOURNAL_LEN) {
+        *pos = head;                            /* Overwritten while being copied */
+        errno = EOVERFLOW;
+        return -1;
+    }
+    *pos += (uint64_t)n;
+    return n;
+}
+
+uint32_t registry_count(const registry *reg) {
+    return atomic_load_explicit(&reg->table->count, memory_order_relaxed);
+}
+
+uint32_t registry_capacity(const registry *reg) {
+    return reg->table->capacity;
+}
+
+uint64_t registry_generation(const registry *reg) {
+    return atomic_load_explicit(&reg->table->seq, memory_order_acquire) / 2;
+}
@@ -3,7 +3,123 @@
 
 #include <stdio.h>
 #include <stdint.h>
+#include <stddef.h>
 
+/*
+ * Service registry in a POSIX shared memory segment.
+ *
+ * Processes map the segment and register name -> endpoint records in it; a
+ * lookup is a hash probe in the mapping, with no system call and no IPC round
+ * trip.
+ *
+ *  - One writer at a time: updates take a process-shared (robust) mutex in
+ *    the segment.
+ *  - Readers take no lock: the writer makes a sequence counter odd for the
+ *    time of an update, readers copy the record and retry if the counter was
+ *    odd or changed meanwhile (seqlock). Readers never write to the segment,
+ *    so the lines they read stay shared in every reader's cache.
+ *  - Open addressing with linear probing over a power of two table sized at
+ *    creation; deleted records leave tombstones, which the writer purges by
+ *    rebuilding the table when they get in the way.
+ *  - Every update gets a version (the generation it made) and appends the
+ *    record name to a journal in the segment, so a process following changes
+ *    (registry_monitor.h) reads what changed instead of scanning the table.
+ *
+ * Functions return 0 on success, -1 with errno set otherwise.
+ */
 
+#define REGISTRY_NAME_LEN       48      /* With the terminating '\0' */
+#define REGISTRY_ENDPOINT_LEN   108     /* Fits a UNIX socket path */
+#define REGISTRY_DEFAULT_CAPACITY 4096
+#define REGISTRY_JOURNAL_LEN    4096    /* Updates a follower may lag behind */
+
+/* registry_open() flags */
+#define REGISTRY_CREATE         0x01    /* Create the segment if it does not exist */
+
+typedef struct registry_table registry_table;
+
+typedef struct {
+    char name[REGISTRY_NAME_LEN];
+    char endpoint[REGISTRY_ENDPOINT_LEN];
+    uint32_t ttl_ms;                    /* 0: never expires */
+    uint64_t version;                   /* Generation of its last update, never 0 */
+} registry_record;
+
+typedef struct {
+    registry_table *table;
+    size_t map_len;
+
+    /* Statistics of this process */
+    uint64_t lookups;
+    uint64_t retries;                   /* Lookups repeated because a write overlapped */
+} registry;
+
+/*
+ * Maps the segment 'shm_name' ("/name"). With REGISTRY_CREATE a missing
+ * segment is created with room for 'capacity' records (rounded up to a power
+ * of two, 0 for the default); an existing one is used as it is.
+ */
+int registry_open(registry *reg, const char *shm_name, uint32_t capacity, int flags);
+void registry_close(registry *reg);
+
+/* Removes the segment name; mappings stay valid until closed */
+int registry_unlink(const char *shm_name);
+
+/* Adds 'name' or replaces its endpoint. ENAMETOOLONG, ENOSPC (table 3/4 full). */
+int registry_register(registry *reg, const char *name, const char *endpoint);
+
+/*
+ * The same with a time to live: the record is removed by the registry monitor
+ * 'ttl_ms' after its last update unless renewed. registry_renew() gives it a
+ * new version (a heartbeat), keeping the endpoint and TTL.
+ */
+int registry_register_ttl(registry *reg, const char *name, const char *endpoint, uint32_t ttl_ms);
+int registry_renew(registry *reg, const char *name);
+
+/*
+ * Adds or replaces 'n' records in one update (their versions are ignored),
+ * skipping invalid ones; followers of the journal are made to resynchronise.
+ * For restoring a saved registry. Returns the number loaded, or -1 (ENOSPC:
+ * the records up to the full table are in).
+ */
+int registry_load(registry *reg, const registry_record *records, uint32_t n);
+
+/* ENOENT if 'name' is not registered */
+int registry_deregister(registry *reg, const char *name);
+
+/* Only if the record is still at 'version' (0 for any), ESTALE otherwise */
+int registry_deregister_if(registry *reg, const char *name, uint64_t version);
+
+/* Copies the endpoint of 'name' (truncated to 'len' - 1 characters). ENOENT if not registered. */
+int registry_lookup(registry *reg, const char *name, char *endpoint, size_t len);
+
+/* The whole record of 'name' */
+int registry_get(registry *reg, const char *name, registry_record *record);
+
+/*
+ * Calls 'fn' with a consistent copy of each record, stopping at the first
+ * non-zero return, which is returned. Records updated during the walk may be
+ * missed or seen twice: take registry_journal_head() first and follow the
+ * journal from there.
+ */
+int registry_foreach(registry *reg, int (*fn)(const registry_record *record, void *arg), void *arg);
+
+/*
+ * Journal of updates. registry_changes() copies up to 'max' names of records
+ * updated (registered, renewed or removed) since position '*pos' and advances
+ * it; a name may appear more than once. Returns the count, or -1 with
+ * EOVERFLOW when the reader fell more than REGISTRY_JOURNAL_LEN updates
+ * behind: '*pos' then moves to the head and the reader must resynchronise
+ * with registry_foreach().
+ */
+uint64_t registry_journal_head(const registry *reg);
+int registry_changes(registry *reg, uint64_t *pos, char (*names)[REGISTRY_NAME_LEN], int max);
+
+/* Records registered */
+uint32_t registry_count(const registry *reg);
+uint32_t registry_capacity(const registry *reg);
+
+/* Number of updates so far: a reader can cache lookups until it changes */
+uint64_t registry_generation(const registry *reg);
 
 #endif
@@ -0,0 +1,218 @@
+/*
+ * Registry persistence: 100k records written to a snapshot, then endpoint
+ * changes, removals and renewals logged (renewals must not be), a torn entry
+ * at the end of the log, and the registry process "crashing". Measures the
+ * restart (new segment, snapshot loaded, log replayed, first lookup served)
+ * and checks every record against a model, compared with the services
+ * registering again one by one. Then enough changes to make the log outgrow
+ * the snapshot, which must compact it.
+ * Build: make store_bench
+ */
+
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "registry_store.h"
+
+#define SERVICES        100000
+#define CAPACITY        262144
+#define SYNC_EVERY      1000            /* Updates between syncs, well inside the journal */
+
+typedef struct {
+    int version;                        /* -1: removed */
+    uint32_t ttl_ms;
+} model_record;
+
+static model_record model[SERVICES];
+static char shm_name[64], dir[64];
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void service_name(char *buf, size_t len, int i) {
+    snprintf(buf, len, "service-%d", i);
+}
+
+static void service_endpoint(char *buf, size_t len, int i, int version) {
+    snprintf(buf, len, "/run/services/%d.%d.sock", i, version);
+}
+
+static int set_service(registry *reg, int i, int version) {
+    char name[REGISTRY_NAME_LEN], endpoint[REGISTRY_ENDPOINT_LEN];
+
+    service_name(name, sizeof(name), i);
+    service_endpoint(endpoint, sizeof(endpoint), i, version);
+    model[i].version = version;
+    return registry_register_ttl(reg, name, endpoint, model[i].ttl_ms) != 0;
+}
+
+static int sync_every(registry_store *store, int updates) {
+    if(updates % SYNC_EVERY == 0 && registry_store_sync(store) < 0) {
+        perror("registry_store_sync");
+        return 1;
+    }
+    return 0;
+}
+
+static int check_model(registry *reg) {
+    char name[REGISTRY_NAME_LEN], endpoint[REGISTRY_ENDPOINT_LEN];
+    registry_record record;
+    int i, live = 0, errors = 0;
+
+    for(i = 0; i < SERVICES; i++) {
+        service_name(name, sizeof(name), i);
+        if(model[i].version < 0) {
+            errors += (registry_get(reg, name, &record) == 0);
+            continue;
+        }
+        live++;
+        service_endpoint(endpoint, sizeof(endpoint), i, model[i].version);
+        errors += (registry_get(reg, name, &record) != 0 || strcmp(record.endpoint, endpoint) != 0 ||
+                   record.ttl_ms != model[i].ttl_ms);
+    }
+    return errors + (registry_count(reg) != (uint32_t)live);
+}
+
+/* The registry process starting again: a new segment, filled from the files, serving a lookup */
+static int restart(registry *reg, registry_store *store, double *ms) {
+    char endpoint[REGISTRY_ENDPOINT_LEN];
+    double t = now_sec();
+
+    if(registry_open(reg, shm_name, CAPACITY, REGISTRY_CREATE) < 0 ||
+       registry_store_open(store, reg, dir, 0) < 0) {
+        perror("restart");
+        return 1;
+    }
+    registry_lookup(reg, "service-1", endpoint, sizeof(endpoint));
+    *ms = (now_sec() - t) * 1000.0;
+    return 0;
+}
+
+static void crash(registry *reg, registry_store *store) {
+    registry_store_close(store);
+    registry_close(reg);
+    registry_unlink(shm_name);
+}
+
+int main(void) {
+    char name[REGISTRY_NAME_LEN], path[128], garbage[100];
+    registry_store store;
+    registry reg;
+    double t, restart_ms, register_ms, compact_ms;
+    int i, fd, updates = 0, errors = 0;
+
+    snprintf(shm_name, sizeof(shm_name), "/registry-store-%d", (int)getpid());
+    snprintf(dir, sizeof(dir), "/tmp/registry-store-%d", (int)getpid());
+    if(registry_open(&reg, shm_name, CAPACITY, REGISTRY_CREATE) < 0) {
+        perror("registry_open");
+        return 1;
+    }
+    for(i = 0; i < SERVICES; i++) {
+        model[i].ttl_ms = (i % 3 == 0) ? 30000 : 0;
+        errors += set_service(&reg, i, 0);
+    }
+
+    /* The registry already holds records: they are the first snapshot */
+    t = now_sec();
+    if(registry_store_open(&store, &reg, dir, 0) < 0) {
+        perror("registry_store_open");
+        return 1;
+    }
+    compact_ms = (now_sec() - t) * 1000.0;
+    errors += (store.stats.compactions != 1) || (store.snapshot_records != SERVICES);
+
+    /* Heartbeats: nothing to log */
+    for(i = 0; i < SERVICES; i += 3) {
+        service_name(name, sizeof(name), i);
+        errors += (registry_renew(&reg, name) != 0);
+        errors += sync_every(&store, ++updates);
+    }
+    errors += (registry_store_sync(&store) < 0);
+    errors += (store.stats.logged != 0);
+
+    /* 10000 new endpoints, 5000 removals, 100 services gone before the next sync */
+    for(i = 1; i < SERVICES; i += 10) {
+        errors += set_service(&reg, i, 1);
+        errors += sync_every(&store, ++updates);
+    }
+    for(i = 2; i < SERVICES; i += 20) {
+        service_name(name, sizeof(name), i);
+        model[i].version = -1;
+        errors += (registry_deregister(&reg, name) != 0);
+        errors += sync_every(&store, ++updates);
+    }
+    for(i = 0; i < 100; i++) {
+        snprintf(name, sizeof(name), "transient-%d", i);
+        errors += (registry_register(&reg, name, "/run/transient.sock") != 0);
+        errors += (registry_deregister(&reg, name) != 0);
+    }
+    errors += (registry_store_sync(&store) < 0);
+    errors += (store.stats.logged != 15000) || (store.stats.resyncs != 0) || (store.stats.compactions != 1);
+    printf("logged %llu changes, %llu journal updates left out (renewals, short-lived records)\n",
+           (unsigned long long)store.stats.logged, (unsigned long long)store.stats.unchanged);
+
+    /* Died while appending an entry */
+    snprintf(path, sizeof(path), "%s/registry.log", dir);
+    memset(garbage, 0x5A, sizeof(garbage));
+    fd = open(path, O_WRONLY | O_APPEND);
+    errors += (fd < 0 || write(fd, garbage, sizeof(garbage)) != (ssize_t)sizeof(garbage));
+    close(fd);
+    crash(&reg, &store);
+
+    errors += restart(&reg, &store, &restart_ms);
+    errors += (store.stats.loaded != SERVICES) || (store.stats.replayed != 15000) ||
+              (store.stats.torn != sizeof(garbage));
+    errors += check_model(&reg);
+    printf("restart with %u records: %.1f ms to the first lookup (%u from the snapshot, %u log entries replayed, "
+           "%u torn bytes cut off)\n", registry_count(&reg), restart_ms, store.stats.loaded,
+           store.stats.replayed, store.stats.torn);
+
+    /* Enough changes to make the log longer than the snapshot */
+    for(i = 0; i < SERVICES; i++) {
+        errors += set_service(&reg, i, 2);
+        errors += sync_every(&store, ++updates);
+    }
+    errors += (registry_store_sync(&store) < 0);
+    errors += (store.stats.compactions != 1) || (store.log_entries >= SERVICES / 5);
+    printf("%d more updates: %llu compaction, %llu entries in the new log (first snapshot took %.1f ms)\n",
+           SERVICES, (unsigned long long)store.stats.compactions, (unsigned long long)store.log_entries,
+           compact_ms);
+    crash(&reg, &store);
+
+    errors += restart(&reg, &store, &restart_ms);
+    errors += check_model(&reg);
+    printf("restart after compacting: %.1f ms (%u from the snapshot, %u log entries replayed)\n", restart_ms,
+           store.stats.loaded, store.stats.replayed);
+    crash(&reg, &store);
+
+    /* Without the files: every service registering again */
+    if(registry_open(&reg, shm_name, CAPACITY, REGISTRY_CREATE) < 0) {
+        perror("registry_open");
+        return 1;
+    }
+    t = now_sec();
+    for(i = 0; i < SERVICES; i++) {
+        errors += (model[i].version >= 0) && set_service(&reg, i, model[i].version);
+    }
+    register_ms = (now_sec() - t) * 1000.0;
+    errors += check_model(&reg);
+    printf("registering the %u records one by one instead: %.1f ms, without the round trips to reach them\n",
+           registry_count(&reg), register_ms);
+    registry_close(&reg);
+    registry_unlink(shm_name);
+
+    snprintf(path, sizeof(path), "%s/registry.snap", dir);
+    unlink(path);
+    snprintf(path, sizeof(path), "%s/registry.log", dir);
+    unlink(path);
+    rmdir(dir);
+    printf("%d errors\n", errors);
+    return errors != 0;
+}
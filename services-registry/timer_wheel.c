@@ -0,0 +1,143 @@
+#include <stddef.h>
+#include "timer_wheel.h"
+
+#define SLOT_MASK       (WHEEL_SLOTS - 1)
+
+static void list_init(wheel_timer *head) {
+    head->next = head;
+    head->prev = head;
+}
+
+static void unlink_timer(wheel_timer *timer) {
+    timer->prev->next = timer->next;
+    timer->next->prev = timer->prev;
+    timer->next = NULL;
+    timer->prev = NULL;
+}
+
+/*
+ * Files 'timer' relative to the tick being run. The level is chosen on slot
+ * numbers rather than on the tick distance, so a slot is never one that has
+ * already been emptied in the current round of its level.
+ */
+static void file_timer(timer_wheel *wheel, wheel_timer *timer) {
+    wheel_timer *head;
+    int level, shift;
+
+    for(level = 0; level < WHEEL_LEVELS - 1; level++) {
+        shift = level * WHEEL_BITS;
+        if((timer->expires >> shift) - (wheel->now >> shift) < WHEEL_SLOTS) {
+            break;
+        }
+    }
+    shift = level * WHEEL_BITS;
+    if((timer->expires >> shift) - (wheel->now >> shift) < WHEEL_SLOTS) {
+        head = &wheel->slots[level][(timer->expires >> shift) & SLOT_MASK];
+    } else {
+        head = &wheel->slots[level][((wheel->now >> shift) + SLOT_MASK) & SLOT_MASK];  /* Beyond reach */
+    }
+    timer->next = head;
+    timer->prev = head->prev;
+    head->prev->next = timer;
+    head->prev = timer;
+}
+
+void wheel_init(timer_wheel *wheel, uint64_t now) {
+    int level, slot;
+
+    for(level = 0; level < WHEEL_LEVELS; level++) {
+        for(slot = 0; slot < WHEEL_SLOTS; slot++) {
+            list_init(&wheel->slots[level][slot]);
+        }
+    }
+    wheel->now = now;
+    wheel->pending = 0;
+    wheel->fired = 0;
+    wheel->cascaded = 0;
+}
+
+void wheel_timer_init(wheel_timer *timer, void (*fn)(wheel_timer *timer, void *arg)) {
+    timer->next = NULL;
+    timer->prev = NULL;
+    timer->expires = 0;
+    timer->fn = fn;
+}
+
+void wheel_add(timer_wheel *wheel, wheel_timer *timer, uint64_t expires) {
+    if(wheel_pending(timer)) {
+        unlink_timer(timer);
+    } else {
+        wheel->pending++;
+    }
+    timer->expires = (expires > wheel->now) ? expires : wheel->now + 1;
+    file_timer(wheel, timer);
+}
+
+void wheel_cancel(timer_wheel *wheel, wheel_timer *timer) {
+    if(wheel_pending(timer)) {
+        unlink_timer(timer);
+        wheel->pending--;
+    }
+}
+
+/* Empties a slot of 'level' into the lower levels; timers due at 'now' land in its level 0 slot */
+static void cascade(timer_wheel *wheel, int level) {
+    wheel_timer *head = &wheel->slots[level][(wheel->now >> (level * WHEEL_BITS)) & SLOT_MASK];
+    wheel_timer list, *timer;
+
+    if(head->next == head) {
+        return;
+    }
+    list.next = head->next;
+    list.prev = head->prev;
+    list.next->prev = &list;
+    list.prev->next = &list;
+    list_init(head);
+    while(list.next != &list) {
+        timer = list.next;
+        unlink_timer(timer);
+        file_timer(wheel, timer);
+        wheel->cascaded++;
+    }
+}
+
+uint32_t wheel_advance(timer_wheel *wheel, uint64_t now, void *arg) {
+    wheel_timer list, *head, *timer;
+    uint32_t fired = 0;
+    int level;
+
+    while(wheel->now < now) {
+        if(wheel->pending == 0) {
+            wheel->now = now;                   /* Nothing to run on the way */
+            break;
+        }
+        wheel->now++;
+
+        /* Highest level first, so its timers can fall through the lower cascades of the same tick */
+        for(level = WHEEL_LEVELS - 1; level > 0; level--) {
+            if((wheel->now & ((1ull << (level * WHEEL_BITS)) - 1)) == 0) {
+                cascade(wheel, level);
+            }
+        }
+
+        /* Detach the slot first: functions may add timers to it for later rounds */
+        head = &wheel->slots[0][wheel->now & SLOT_MASK];
+        if(head->next == head) {
+            continue;
+        }
+        list.next = head->next;
+        list.prev = head->prev;
+        list.next->prev = &list;
+        list.prev->next = &list;
+        list_init(head);
+        while(list.next != &list) {
+            timer = list.next;
+            unlink_timer(timer);
+            wheel->pending--;
+            wheel->fired++;
+            fired++;
+            timer->fn(timer, arg);
+        }
+    }
+    return fired;
+}
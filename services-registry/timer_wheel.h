@@ -0,0 +1,61 @@
+#ifndef __TIMER_WHEEL_H_
+#define __TIMER_WHEEL_H_
+
+#include <stdint.h>
+
+/*
+ * Hierarchical timer wheel (Varghese & Lauck), in ticks.
+ *
+ * WHEEL_LEVELS wheels of WHEEL_SLOTS slots: level 0 slots are one tick wide,
+ * level n slots WHEEL_SLOTS^n ticks. A timer goes to the lowest level whose
+ * span reaches its expiry; when level 0 wraps, the next level slot that has
+ * become current is emptied into the lower levels (cascade). Adding and
+ * cancelling are O(1), a tick costs the timers due in it plus the occasional
+ * cascade, whatever the number of timers pending. Timers further away than
+ * the wheels reach (2^24 ticks) wait in the last slot and are re-filed.
+ *
+ * Timers are embedded in the caller's structures and never allocated here.
+ */
+
+#define WHEEL_BITS      6
+#define WHEEL_SLOTS     (1 << WHEEL_BITS)
+#define WHEEL_LEVELS    4
+
+typedef struct wheel_timer {
+    struct wheel_timer *next, *prev;    /* NULL when not pending */
+    uint64_t expires;                   /* Tick */
+    void (*fn)(struct wheel_timer *timer, void *arg);
+} wheel_timer;
+
+typedef struct {
+    wheel_timer slots[WHEEL_LEVELS][WHEEL_SLOTS];   /* List heads */
+    uint64_t now;                       /* Last tick run */
+    uint32_t pending;
+
+    /* Statistics */
+    uint64_t fired;
+    uint64_t cascaded;                  /* Timers moved down a level */
+} timer_wheel;
+
+void wheel_init(timer_wheel *wheel, uint64_t now);
+
+/* Timer not pending, with the function to call when it expires */
+void wheel_timer_init(wheel_timer *timer, void (*fn)(wheel_timer *timer, void *arg));
+
+/* (Re)arms 'timer' for tick 'expires'; one in the past fires on the next tick */
+void wheel_add(timer_wheel *wheel, wheel_timer *timer, uint64_t expires);
+
+void wheel_cancel(timer_wheel *wheel, wheel_timer *timer);
+
+static inline int wheel_pending(const wheel_timer *timer) {
+    return timer->next != 0;
+}
+
+/*
+ * Runs the ticks up to 'now': every timer due is removed, then its function
+ * is called with 'arg' (it may re-arm or cancel any timer). Returns how many
+ * fired.
+ */
+uint32_t wheel_advance(timer_wheel *wheel, uint64_t now, void *arg);
+
+#endif